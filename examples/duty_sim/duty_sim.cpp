@@ -0,0 +1,273 @@
+// Host simulator: GNSS duty cycling while stationary (src/gnss_duty.cpp)
+//
+// Drives gnssDutyStep with a modelled receiver, the way gpsTask does: after
+// every decoded epoch and at least once per second while the receiver sleeps.
+// Awake, the receiver outputs one epoch per second; the first valid fix comes
+// TTFF after the wake (never without sky). The position is a parked point
+// with a few metres of noise or a car driving east.
+//
+// Scenarios: parked with hot starts, TTFF turning slow (ephemeris expired),
+// cold starts only, no sky (garage), and parked / driving / parked. Checks
+// the off-time clamp and floor, the backoff after slow starts and timeouts,
+// the return to continuous on movement, and gnssDutyOnSecPerHour against the
+// on-time the simulation counts itself.
+//
+//   g++ -O2 -std=gnu++11 -Iinclude examples/duty_sim/duty_sim.cpp src/gnss_duty.cpp -o duty_sim
+//   ./duty_sim
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "gnss_duty.h"
+#include "sample_policy.h"
+
+static int failures = 0;
+#define CHECK(cond, ...) do { if (!(cond)) { failures++; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } } while (0)
+
+#define TICK_MS       100                 // simulation step
+#define EPOCH_MS      1000                // receiver output rate while awake
+#define START_LAT_E7  523750000
+#define START_LON_E7  97500000
+
+static const double M_PER_DEG = 111319.491;
+
+// Deterministic noise so runs are comparable
+static uint32_t rngState = 12345;
+static double uniform() {
+  rngState = rngState * 1664525u + 1013904223u;
+  return (rngState >> 8) / 16777216.0;
+}
+
+// ============= SCENARIO =============
+
+struct Leg {
+  uint32_t seconds;
+  double speedMs;                         // 0 = parked
+};
+
+struct Scenario {
+  const char* name;
+  const Leg* legs;
+  size_t nLegs;
+  uint32_t (*ttffMs)(uint32_t wake);      // TTFF of the n-th wake (0-based), 0 = no fix ever
+};
+
+static uint32_t hotTtff(uint32_t) { return 2000; }
+static uint32_t coldTtff(uint32_t) { return 30000; }
+static uint32_t noSky(uint32_t) { return 0; }
+static uint32_t turnsSlow(uint32_t wake) { return wake < 20 ? 2000 : 20000; }
+
+struct Result {
+  uint32_t endMs;
+  uint32_t sleeps;
+  uint32_t onMsCounted;                   // receiver awake, counted by the simulation
+  uint32_t onSecLastHour;                 // same, over the last hour only
+  uint32_t sleepsWhileMoving;
+  uint32_t continuousAfterMoveMs;         // movement start until back in continuous, 0 = never moved
+  uint32_t offMinMs, offMaxMs;            // off time at each sleep
+  bool offBelowFloor;                     // an off time under GNSS_DUTY_OFF_PER_TTFF x average TTFF (below the max)
+  bool offShrankAfterSlowStart;
+  bool offGrewAfterHotStart;
+  uint32_t timeoutSleeps;                 // sleeps straight from ACQUIRE
+  bool timeoutBackedOff;                  // every such sleep used GNSS_DUTY_OFF_MAX_S
+  GnssDuty duty;
+};
+
+static Result run(const Scenario& sc) {
+  Result res;
+  memset(&res, 0, sizeof(res));
+  res.offMinMs = UINT32_MAX;
+  res.timeoutBackedOff = true;
+
+  uint32_t totalS = 0;
+  for (size_t i = 0; i < sc.nLegs; i++) totalS += sc.legs[i].seconds;
+  const uint32_t endMs = totalS * 1000;
+
+  GnssDuty& d = res.duty;
+  gnssDutyInit(d, 0);
+  NmeaFix fix;
+  memset(&fix, 0, sizeof(fix));
+
+  bool on = true;
+  uint32_t wokeMs = 0, wakes = 0, ttff = 2000;   // at boot the receiver is on and finds its first fix
+  uint32_t nextEpochMs = EPOCH_MS;
+  double eastM = 0;
+  uint32_t movingSinceMs = 0;
+  uint32_t lastHourOnMs = 0;
+  uint32_t prevOffMs = d.offMs;
+
+  for (uint32_t now = TICK_MS; now <= endMs; now += TICK_MS) {
+    // Where the device is
+    uint32_t t = now / 1000, legEnd = 0;
+    double speed = 0;
+    for (size_t i = 0; i < sc.nLegs; i++) {
+      legEnd += sc.legs[i].seconds;
+      if (t < legEnd) {
+        speed = sc.legs[i].speedMs;
+        break;
+      }
+    }
+    eastM += speed * TICK_MS / 1000.0;
+    if (speed > 0 && !movingSinceMs) movingSinceMs = now;
+    if (speed == 0) movingSinceMs = 0;
+
+    if (on) {
+      res.onMsCounted += TICK_MS;
+      if (now > endMs - 3600000) lastHourOnMs += TICK_MS;
+    }
+
+    // Receiver output: one epoch per second while awake
+    bool fresh = false;
+    if (on && now >= nextEpochMs) {
+      nextEpochMs += EPOCH_MS;
+      bool valid = ttff && now - wokeMs >= ttff;
+      fix.fixValid = valid;
+      if (valid) {
+        double noiseE = (uniform() - 0.5) * 6, noiseN = (uniform() - 0.5) * 6;   // +-3 m
+        double cosLat = cos(START_LAT_E7 * 1e-7 * M_PI / 180);
+        fix.hasLocation = true;
+        fix.latE7 = START_LAT_E7 + (int32_t)(noiseN / M_PER_DEG * 1e7);
+        fix.lonE7 = START_LON_E7 + (int32_t)((eastM + noiseE) / (M_PER_DEG * cosLat) * 1e7);
+        fix.hasSpeed = true;
+        fix.speedCmS = (uint32_t)(speed * 100 + uniform() * 40);                 // parked: 0-40 cm/s of noise
+        fresh = true;
+      }
+    } else if (!on && now % 1000 != 0) {
+      continue;                           // asleep: gpsTask runs once per GPS_IDLE_WAKE_MS
+    }
+
+    GnssDutyState before = d.state;
+    GnssDutyAction a = gnssDutyStep(d, now, fix, fresh);
+
+    if (movingSinceMs && !res.continuousAfterMoveMs && d.state == GNSS_DUTY_CONTINUOUS && before != GNSS_DUTY_CONTINUOUS) {
+      res.continuousAfterMoveMs = now - movingSinceMs;
+    }
+    if (a == GNSS_DUTY_SLEEP) {
+      on = false;
+      res.sleeps++;
+      if (speed > 0 && now - movingSinceMs > 10000) res.sleepsWhileMoving++;
+      res.offMinMs = std::min(res.offMinMs, d.offMs);
+      res.offMaxMs = std::max(res.offMaxMs, d.offMs);
+      uint32_t floorMs = std::min((uint32_t)GNSS_DUTY_OFF_MAX_S * 1000, d.ttffAvgMs * GNSS_DUTY_OFF_PER_TTFF);
+      if (d.offMs < floorMs) res.offBelowFloor = true;
+      if (before == GNSS_DUTY_ACQUIRE) {
+        res.timeoutSleeps++;
+        if (d.offMs != GNSS_DUTY_OFF_MAX_S * 1000UL) res.timeoutBackedOff = false;
+      } else if (before == GNSS_DUTY_HOLD && d.wakes > 0) {
+        // Adapted on this wake: hot starts grow the off time, slow ones shrink it
+        if (d.ttffLastMs > GNSS_DUTY_HOT_TTFF_MS && d.offMs < prevOffMs) res.offShrankAfterSlowStart = true;
+        if (d.ttffLastMs <= GNSS_DUTY_HOT_TTFF_MS && d.offMs > prevOffMs) res.offGrewAfterHotStart = true;
+      }
+      prevOffMs = d.offMs;
+    } else if (a == GNSS_DUTY_WAKE) {
+      on = true;
+      wokeMs = now;
+      nextEpochMs = now + EPOCH_MS;
+      ttff = sc.ttffMs(wakes++);
+      fix.fixValid = false;
+    }
+  }
+  res.endMs = endMs;
+  res.onSecLastHour = lastHourOnMs / 1000;
+  return res;
+}
+
+static void report(const Scenario& sc, const Result& r) {
+  const GnssDuty& d = r.duty;
+  printf("%-22s %5.1f h  on %4u s/h (last hour %4u s)  wakes %4u  hot %4u  timeouts %3u  "
+         "TTFF last/avg/max %5.1f/%5.1f/%5.1f s  off %3u-%3u s  end %s\n",
+         sc.name, r.endMs / 3600000.0, gnssDutyOnSecPerHour(d, r.endMs), r.onSecLastHour, (unsigned)d.wakes,
+         (unsigned)d.hotStarts, (unsigned)d.timeouts, d.ttffLastMs / 1000.0, d.ttffAvgMs / 1000.0,
+         d.ttffMaxMs / 1000.0, r.sleeps ? r.offMinMs / 1000 : 0, r.offMaxMs / 1000, gnssDutyStateName(d.state));
+
+  // Off time always within its bounds and above the TTFF floor
+  if (r.sleeps) {
+    CHECK(r.offMinMs >= GNSS_DUTY_OFF_MIN_S * 1000UL && r.offMaxMs <= GNSS_DUTY_OFF_MAX_S * 1000UL,
+          "%s: off time %u-%u ms outside %u-%u s", sc.name, (unsigned)r.offMinMs, (unsigned)r.offMaxMs,
+          (unsigned)GNSS_DUTY_OFF_MIN_S, (unsigned)GNSS_DUTY_OFF_MAX_S);
+    CHECK(!r.offBelowFloor, "%s: off time below %u x average TTFF", sc.name, (unsigned)GNSS_DUTY_OFF_PER_TTFF);
+  }
+  // The module's own on-time figure matches what the simulation counted
+  uint32_t counted = (uint32_t)((uint64_t)r.onMsCounted * 3600 / r.endMs);
+  uint32_t reported = gnssDutyOnSecPerHour(d, r.endMs);
+  CHECK(reported + 2 >= counted && reported <= counted + 2, "%s: gnssDutyOnSecPerHour %u s/h, simulation counted %u",
+        sc.name, (unsigned)reported, (unsigned)counted);
+}
+
+// ============= RUN =============
+
+int main() {
+  printf("duty cycle: still %u s, hold %u ms, acquire max %u s, off %u-%u s (start %u), hot TTFF <= %u ms\n",
+         (unsigned)GNSS_DUTY_STILL_S, (unsigned)GNSS_DUTY_HOLD_MS, (unsigned)GNSS_DUTY_ACQUIRE_MAX_S,
+         (unsigned)GNSS_DUTY_OFF_MIN_S, (unsigned)GNSS_DUTY_OFF_MAX_S, (unsigned)GNSS_DUTY_OFF_START_S,
+         (unsigned)GNSS_DUTY_HOT_TTFF_MS);
+
+  // Parked a day, every wake a 2 s hot start
+  static const Leg parkedDay[] = {{24 * 3600, 0}};
+  Scenario sc = {"parked, hot 2 s", parkedDay, 1, hotTtff};
+  Result r = run(sc);
+  report(sc, r);
+  CHECK(r.duty.hotStarts == r.duty.wakes && r.duty.timeouts == 0, "parked: %u of %u wakes hot",
+        (unsigned)r.duty.hotStarts, (unsigned)r.duty.wakes);
+  CHECK(r.offGrewAfterHotStart && r.duty.offMs == GNSS_DUTY_OFF_MAX_S * 1000UL,
+        "parked: off time %u ms, expected to grow to the maximum", (unsigned)r.duty.offMs);
+  CHECK(r.onSecLastHour <= 80, "parked: on %u s in the last hour", (unsigned)r.onSecLastHour);
+  CHECK(r.duty.state != GNSS_DUTY_CONTINUOUS, "parked: never left continuous");
+  printf("  fully parked with hot starts the receiver is on %u s/h (%u s/h over the day including the first "
+         "%u s), instead of 3600\n", (unsigned)r.onSecLastHour, gnssDutyOnSecPerHour(r.duty, r.endMs),
+         (unsigned)GNSS_DUTY_STILL_S);
+
+  // Hot starts for the first 20 wakes, then 20 s TTFFs: the off time comes down
+  static const Leg parked6h[] = {{6 * 3600, 0}};
+  sc.name = "parked, TTFF turns slow";
+  sc.legs = parked6h;
+  sc.ttffMs = turnsSlow;
+  r = run(sc);
+  report(sc, r);
+  CHECK(r.offShrankAfterSlowStart, "slow TTFF did not shorten the off time");
+  CHECK(r.duty.offMs < GNSS_DUTY_OFF_MAX_S * 1000UL && r.duty.offMs >= r.duty.ttffAvgMs * GNSS_DUTY_OFF_PER_TTFF,
+        "slow TTFF: off time %u ms, average TTFF %u ms", (unsigned)r.duty.offMs, (unsigned)r.duty.ttffAvgMs);
+
+  // Cold starts only: 10 x 30 s is above the maximum, so the maximum applies
+  sc.name = "parked, cold 30 s";
+  sc.ttffMs = coldTtff;
+  r = run(sc);
+  report(sc, r);
+  CHECK(r.duty.hotStarts == 0 && r.duty.offMs == GNSS_DUTY_OFF_MAX_S * 1000UL,
+        "cold: off time %u ms, expected the maximum", (unsigned)r.duty.offMs);
+
+  // No sky: every wake times out and backs off to the maximum off time
+  sc.name = "no sky (garage)";
+  sc.ttffMs = noSky;
+  r = run(sc);
+  report(sc, r);
+  CHECK(r.duty.timeouts == r.duty.wakes && r.duty.timeouts > 0 && r.timeoutSleeps == r.duty.timeouts,
+        "no sky: %u timeouts for %u wakes", (unsigned)r.duty.timeouts, (unsigned)r.duty.wakes);
+  CHECK(r.timeoutBackedOff, "no sky: a timeout did not back off to %u s", (unsigned)GNSS_DUTY_OFF_MAX_S);
+  uint32_t cycleS = GNSS_DUTY_ACQUIRE_MAX_S + GNSS_DUTY_OFF_MAX_S;
+  CHECK(r.onSecLastHour <= 3600 * GNSS_DUTY_ACQUIRE_MAX_S / cycleS + GNSS_DUTY_ACQUIRE_MAX_S,
+        "no sky: on %u s in the last hour", (unsigned)r.onSecLastHour);
+
+  // Parked, then a drive: the first wake that sees speed returns to
+  // continuous, no sleep while driving, and cycling resumes once parked again
+  static const Leg errand[] = {{1800, 0}, {1800, 12}, {1800, 0}};
+  sc.name = "parked / drive / parked";
+  sc.legs = errand;
+  sc.nLegs = 3;
+  sc.ttffMs = hotTtff;
+  r = run(sc);
+  report(sc, r);
+  CHECK(r.continuousAfterMoveMs > 0 &&
+        r.continuousAfterMoveMs <= GNSS_DUTY_OFF_MAX_S * 1000UL + GNSS_DUTY_HOT_TTFF_MS + EPOCH_MS,
+        "drive: back to continuous after %u ms", (unsigned)r.continuousAfterMoveMs);
+  CHECK(r.sleepsWhileMoving == 0, "drive: %u sleeps while driving", (unsigned)r.sleepsWhileMoving);
+  CHECK(r.duty.state != GNSS_DUTY_CONTINUOUS, "drive: no cycling after parking again");
+  printf("  driving: continuous %.0f s after setting off (woken from a %u s sleep)\n",
+         r.continuousAfterMoveMs / 1000.0, (unsigned)GNSS_DUTY_OFF_MAX_S);
+
+  if (failures) printf("%d FAILED\n", failures);
+  else printf("all checks passed\n");
+  return failures ? 1 : 0;
+}
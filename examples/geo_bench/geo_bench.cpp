@@ -0,0 +1,272 @@
+// Host tests + benchmark: fixed-point distance kernel (include/geo_distance.h)
+//
+// Checks the cos table against libm over the whole latitude range, then
+// geoDistanceM(), geoFrameDistanceM() and geoPathLengthM() against a double
+// precision haversine on the same sphere: random pairs at 50 m (the LoRa
+// distance trigger), up to 10 km, across the antimeridian, near the poles and
+// past the flat-earth limit. Then times one call of the former float haversine
+// (lora_manager.cpp distanceMeters), the kernel and the frame batch.
+//
+//   g++ -O2 -std=gnu++11 -Iinclude examples/geo_bench/geo_bench.cpp -o geo_bench
+//   ./geo_bench
+//
+// On the board (ESP32-S3 cycle counts) the same file runs as a sketch:
+//   pio ci examples/geo_bench/geo_bench.cpp --board heltec_wifi_lora_32_V4 -O "build_flags=-Iinclude"
+// and prints the report to the USB serial console.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include "geo_distance.h"
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#define OUT(...) Serial.printf(__VA_ARGS__)
+static inline uint32_t cycles() { return ESP.getCycleCount(); }
+#define HAVE_CYCLES 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <chrono>
+#define OUT(...) printf(__VA_ARGS__)
+static inline uint64_t cycles() { return __rdtsc(); }
+#define HAVE_CYCLES 1
+#else
+#include <chrono>
+#define OUT(...) printf(__VA_ARGS__)
+static inline uint64_t cycles() { return 0; }
+#define HAVE_CYCLES 0
+#endif
+
+static int failures = 0;
+#define CHECK(cond, ...) do { if (!(cond)) { failures++; OUT("FAIL %s:%d: ", __FILE__, __LINE__); OUT(__VA_ARGS__); OUT("\n"); } } while (0)
+
+// ============= REFERENCE =============
+
+static double refHaversineM(int32_t lat1E7, int32_t lon1E7, int32_t lat2E7, int32_t lon2E7) {
+  const double k = 1e-7 * M_PI / 180;
+  double lat1 = lat1E7 * k;
+  double lat2 = lat2E7 * k;
+  double sLat = sin((lat2 - lat1) / 2);
+  double sLon = sin(((double)lon2E7 - lon1E7) * k / 2);
+  double a = sLat * sLat + cos(lat1) * cos(lat2) * sLon * sLon;
+  return 2 * 6371000.0 * atan2(sqrt(a), sqrt(1 - a));
+}
+
+// The former lora_manager.cpp distanceMeters()
+static float oldDistanceMeters(int32_t lat1E7, int32_t lon1E7, int32_t lat2E7, int32_t lon2E7) {
+  const float R = 6371000.0f;
+  const float DEG_TO_RAD_F = 0.017453292519943295f;
+  float lat1 = lat1E7 / 1e7f * DEG_TO_RAD_F;
+  float lat2 = lat2E7 / 1e7f * DEG_TO_RAD_F;
+  float dLat = lat2 - lat1;
+  float dLon = (lon2E7 - lon1E7) / 1e7f * DEG_TO_RAD_F;
+  float a = sin(dLat / 2) * sin(dLat / 2) + cos(lat1) * cos(lat2) * sin(dLon / 2) * sin(dLon / 2);
+  return 2 * R * atan2(sqrt(a), sqrt(1 - a));
+}
+
+// ============= RANDOM POINTS =============
+
+static uint32_t rngState = 12345;
+static uint32_t rng() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+static double uniform(double lo, double hi) {
+  return lo + (hi - lo) * (rng() / 4294967296.0);
+}
+
+// Point at 'distM' in a random direction from (latE7, lonE7), on the sphere
+static void offsetPoint(int32_t latE7, int32_t lonE7, double distM, int32_t& outLat, int32_t& outLon) {
+  double brg = uniform(0, 2 * M_PI);
+  double lat = latE7 * 1e-7 * M_PI / 180;
+  double lon = lonE7 * 1e-7 * M_PI / 180;
+  double d = distM / 6371000.0;
+  double lat2 = asin(sin(lat) * cos(d) + cos(lat) * sin(d) * cos(brg));
+  double lon2 = lon + atan2(sin(brg) * sin(d) * cos(lat), cos(d) - sin(lat) * sin(lat2));
+  double lonDeg = lon2 * 180 / M_PI;
+  if (lonDeg >= 180) lonDeg -= 360;
+  if (lonDeg < -180) lonDeg += 360;
+  outLat = (int32_t)lround(lat2 * 180 / M_PI * 1e7);
+  outLon = (int32_t)lround(lonDeg * 1e7);
+}
+
+// ============= TESTS =============
+
+static void testCosTable() {
+  double maxErr = 0;
+  for (int64_t lat = -900000000; lat <= 900000000; lat += 99991) {
+    double ref = cos(lat * 1e-7 * M_PI / 180);
+    double err = fabs(geoCosQ30((int32_t)lat) / 1073741824.0 - ref);
+    if (err > maxErr) maxErr = err;
+  }
+  OUT("cos table: max error %.1e\n", maxErr);
+  CHECK(maxErr <= 3e-7, "cos table error %.1e", maxErr);
+}
+
+// Random pairs 'minM'..'maxM' apart with the first point in [latLo, latHi];
+// error must stay below absM + rel * distance
+static void testPairs(const char* name, double latLo, double latHi, double lonLo, double lonHi,
+                      double minM, double maxM, double absM, double rel, int n) {
+  double maxErr = 0;
+  double maxRel = 0;
+  for (int i = 0; i < n; i++) {
+    int32_t lat1 = (int32_t)(uniform(latLo, latHi) * 1e7);
+    int32_t lon1 = (int32_t)(uniform(lonLo, lonHi) * 1e7);
+    int32_t lat2, lon2;
+    offsetPoint(lat1, lon1, uniform(minM, maxM), lat2, lon2);
+    double ref = refHaversineM(lat1, lon1, lat2, lon2);
+    double err = fabs(geoDistanceM(lat1, lon1, lat2, lon2) - ref);
+    if (err > maxErr) maxErr = err;
+    if (ref >= 10 && err / ref > maxRel) maxRel = err / ref;
+    CHECK(err <= absM + rel * ref, "%s: (%ld,%ld)-(%ld,%ld) %.3f m off at %.1f m", name,
+          (long)lat1, (long)lon1, (long)lat2, (long)lon2, err, ref);
+  }
+  OUT("%-24s max error %8.4f m (%.1e of distance)\n", name, maxErr, maxRel);
+}
+
+static void testFrame() {
+  double maxErr = 0;
+  const size_t N = 64;
+  int32_t lat[N], lon[N];
+  float out[N];
+  for (int round = 0; round < 200; round++) {
+    int32_t lat0 = (int32_t)(uniform(-80, 80) * 1e7);
+    int32_t lon0 = (int32_t)(uniform(-180, 180) * 1e7);
+    for (size_t i = 0; i < N; i++) offsetPoint(lat0, lon0, uniform(0, 2000), lat[i], lon[i]);
+    GeoFrame f = geoFrameAt(lat0, lon0);
+    geoFrameDistancesM(f, lat, lon, N, out);
+    for (size_t i = 0; i < N; i++) {
+      double ref = refHaversineM(lat0, lon0, lat[i], lon[i]);
+      double err = fabs(out[i] - ref);
+      if (err > maxErr) maxErr = err;
+      CHECK(err <= 0.01 + 6e-4 * ref, "frame at %ld: %.3f m off at %.1f m", (long)lat0, err, ref);
+    }
+  }
+  OUT("%-24s max error %8.4f m\n", "frame batch <= 2 km", maxErr);
+}
+
+static void testPath() {
+  const size_t N = 500;
+  int32_t lat[N], lon[N];
+  lat[0] = 523814520;
+  lon[0] = 97253512;
+  double ref = 0;
+  for (size_t i = 1; i < N; i++) {
+    offsetPoint(lat[i - 1], lon[i - 1], uniform(5, 200), lat[i], lon[i]);
+    ref += refHaversineM(lat[i - 1], lon[i - 1], lat[i], lon[i]);
+  }
+  double err = fabs(geoPathLengthM(lat, lon, N) - ref);
+  OUT("%-24s %.1f m, error %.3f m\n", "path 500 fixes", ref, err);
+  CHECK(err <= 1e-4 * ref, "path length %.3f m off", err);
+}
+
+static void testEdges() {
+  CHECK(geoDistanceM(523814520, 97253512, 523814520, 97253512) == 0, "same point");
+  // 1 cm north
+  double d = geoDistanceM(523814520, 97253512, 523814529, 97253512);
+  CHECK(fabs(d - refHaversineM(523814520, 97253512, 523814529, 97253512)) < 0.005, "1 cm step: %.4f m", d);
+  // Symmetric
+  CHECK(geoDistanceM(100, 1799999000, -100, -1799999000) == geoDistanceM(-100, -1799999000, 100, 1799999000), "symmetry");
+}
+
+// ============= BENCHMARK =============
+
+static volatile float sink;
+
+template <typename F>
+static double cyclesPerCall(F f, int n) {
+  decltype(cycles()) c0 = cycles();
+  float acc = 0;
+  for (int i = 0; i < n; i++) acc += f(i);
+  decltype(c0) c = cycles() - c0;
+  sink = acc;
+  return (double)c / n;
+}
+
+#if !defined(ARDUINO)
+template <typename F>
+static double nsPerCall(F f, int n) {
+  using namespace std::chrono;
+  steady_clock::time_point t0 = steady_clock::now();
+  float acc = 0;
+  for (int i = 0; i < n; i++) acc += f(i);
+  double ns = duration_cast<nanoseconds>(steady_clock::now() - t0).count();
+  sink = acc;
+  return ns / n;
+}
+#endif
+
+static void bench() {
+  const int M = 1024;
+  static int32_t lat1[M], lon1[M], lat2[M], lon2[M], latN[M], lonN[M];
+  static float out[M];
+  for (int i = 0; i < M; i++) {
+    lat1[i] = (int32_t)(uniform(47, 55) * 1e7);
+    lon1[i] = (int32_t)(uniform(6, 15) * 1e7);
+    offsetPoint(lat1[i], lon1[i], uniform(0, 200), lat2[i], lon2[i]);
+    offsetPoint(lat1[0], lon1[0], uniform(0, 2000), latN[i], lonN[i]);   // around one origin
+  }
+#if defined(ARDUINO)
+  const int n = 20000;
+#else
+  const int n = 2000000;
+#endif
+
+  auto oldF = [&](int i) { int k = i & (M - 1); return oldDistanceMeters(lat1[k], lon1[k], lat2[k], lon2[k]); };
+  auto newF = [&](int i) { int k = i & (M - 1); return geoDistanceM(lat1[k], lon1[k], lat2[k], lon2[k]); };
+  GeoFrame f = geoFrameAt(lat1[0], lon1[0]);
+  auto batchF = [&](int i) {
+    geoFrameDistancesM(f, latN, lonN, M, out);
+    return out[i & (M - 1)];
+  };
+
+  if (HAVE_CYCLES) {
+    double cOld = cyclesPerCall(oldF, n);
+    double cNew = cyclesPerCall(newF, n);
+    double cBatch = cyclesPerCall(batchF, n / M + 1) / M;
+    OUT("cycles/call: float haversine %.0f, geoDistanceM %.0f (%.1fx), frame batch %.1f per point (%.1fx)\n",
+        cOld, cNew, cOld / cNew, cBatch, cOld / cBatch);
+  }
+#if !defined(ARDUINO)
+  double tOld = nsPerCall(oldF, n);
+  double tNew = nsPerCall(newF, n);
+  double tBatch = nsPerCall(batchF, n / M + 1) / M;
+  OUT("ns/call:     float haversine %.1f, geoDistanceM %.1f (%.1fx), frame batch %.2f per point (%.1fx)\n",
+      tOld, tNew, tOld / tNew, tBatch, tOld / tBatch);
+#endif
+}
+
+static int benchMain() {
+  testCosTable();
+  testPairs("50 m, mid latitudes", -60, 60, -180, 180, 40, 60, 0.01, 0, 200000);
+  testPairs("<= 10 km, mid latitudes", -60, 60, -180, 180, 0, 10000, 0.01, 1e-4, 200000);
+  testPairs("<= 1 km, up to 85 deg", -85, 85, -180, 180, 0, 1000, 0.01, 1e-4, 200000);
+  testPairs("<= 1 km, antimeridian", -60, 60, 179.99, 180, 0, 1000, 0.01, 1e-4, 50000);
+  testPairs("10-100 km", -60, 60, -180, 180, 10000, 100000, 0.01, 1e-4, 50000);
+  testPairs("500-3000 km fallback", -60, 60, -180, 180, 500000, 3000000, 0, 1e-4, 50000);
+  testFrame();
+  testPath();
+  testEdges();
+  bench();
+  if (failures) OUT("%d FAILED\n", failures);
+  else OUT("all checks passed\n");
+  return failures ? 1 : 0;
+}
+
+#if defined(ARDUINO)
+void setup() {
+  Serial.begin(115200);
+  delay(2000);
+  benchMain();
+}
+
+void loop() {}
+#else
+int main() {
+  return benchMain();
+}
+#endif
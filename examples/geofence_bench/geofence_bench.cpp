@@ -0,0 +1,381 @@
+// Host tests + benchmark: geofence engine (include/geofence.h)
+//
+// Loads 1000 fences around Hannover (circles and polygons of 30-500 m, plus a
+// few city-sized zones the grid keeps in its large list), then:
+//  - compares the indexed geofenceQuery() with geofenceQueryLinear() on random
+//    points and points placed next to fence edges: the sets must be identical
+//  - compares both with a double precision reference; points within 5 cm of
+//    an edge may fall either way
+//  - drives through a circle and a square, and jitters on a boundary, to check
+//    the enter/exit events and the hysteresis
+//  - times the indexed and the linear query, and geofenceEvaluate(), along a
+//    simulated drive through the fenced area
+//
+//   g++ -O2 -std=gnu++11 -Iexamples/geofence_bench/host -Iinclude
+//       examples/geofence_bench/geofence_bench.cpp src/geofence.cpp -o geofence_bench
+//   ./geofence_bench         # -v prints the engine's Serial output to stderr
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <LittleFS.h>
+#include "geofence.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t cycles() { return __rdtsc(); }
+#define HAVE_CYCLES 1
+#else
+static inline uint64_t cycles() { return 0; }
+#define HAVE_CYCLES 0
+#endif
+
+bool hostVerbose = false;
+HostSerial Serial;
+HostLittleFS LittleFS;
+
+static int failures = 0;
+#define CHECK(cond, ...) do { if (!(cond)) { failures++; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } } while (0)
+
+// ============= RANDOM POINTS =============
+
+static uint32_t rngState = 12345;
+static uint32_t rng() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+static double uniform(double lo, double hi) {
+  return lo + (hi - lo) * (rng() / 4294967296.0);
+}
+
+static const double R_EARTH = 6371000.0;
+static const double DEG = M_PI / 180;
+
+// Point 'distM' from (lat, lon) degrees on bearing 'brg' radians
+static void offsetDeg(double lat, double lon, double distM, double brg, double& outLat, double& outLon) {
+  double d = distM / R_EARTH;
+  double la = lat * DEG;
+  double lat2 = asin(sin(la) * cos(d) + cos(la) * sin(d) * cos(brg));
+  outLon = lon + atan2(sin(brg) * sin(d) * cos(la), cos(d) - sin(la) * sin(lat2)) / DEG;
+  outLat = lat2 / DEG;
+}
+
+static int32_t e7(double deg) {
+  return (int32_t)lround(deg * 1e7);
+}
+
+// ============= FENCES + REFERENCE =============
+
+struct RefFence {
+  uint16_t id;
+  bool circle;
+  double lat, lon, r;                       // circle, degrees / metres
+  std::vector<int32_t> vLat, vLon;          // polygon, E7 as written to the file
+};
+
+static std::vector<RefFence> ref;
+
+static double refHaversineM(double lat1, double lon1, double lat2, double lon2) {
+  double sLat = sin((lat2 - lat1) * DEG / 2);
+  double sLon = sin((lon2 - lon1) * DEG / 2);
+  double a = sLat * sLat + cos(lat1 * DEG) * cos(lat2 * DEG) * sLon * sLon;
+  return 2 * R_EARTH * atan2(sqrt(a), sqrt(1 - a));
+}
+
+static bool refPolygonContains(const RefFence& f, int32_t lat, int32_t lon) {
+  bool in = false;
+  size_t n = f.vLat.size();
+  for (size_t i = 0, j = n - 1; i < n; j = i++) {
+    double yi = f.vLat[i], yj = f.vLat[j], xi = f.vLon[i], xj = f.vLon[j];
+    if ((yi > lat) != (yj > lat) && lon < xi + (lat - yi) * (xj - xi) / (yj - yi)) in = !in;
+  }
+  return in;
+}
+
+// Distance from the point to the fence boundary, metres (local flat frame)
+static double refEdgeDistanceM(const RefFence& f, int32_t lat, int32_t lon) {
+  if (f.circle) return fabs(refHaversineM(f.lat, f.lon, lat * 1e-7, lon * 1e-7) - f.r);
+  double kx = 1e-7 * DEG * R_EARTH * cos(lat * 1e-7 * DEG), ky = 1e-7 * DEG * R_EARTH;
+  double best = 1e30;
+  size_t n = f.vLat.size();
+  for (size_t i = 0, j = n - 1; i < n; j = i++) {
+    double ax = (f.vLon[j] - lon) * kx, ay = (f.vLat[j] - lat) * ky;
+    double ex = (f.vLon[i] - f.vLon[j]) * kx, ey = (f.vLat[i] - f.vLat[j]) * ky;
+    double t = std::max(0.0, std::min(1.0, -(ax * ex + ay * ey) / (ex * ex + ey * ey)));
+    best = std::min(best, hypot(ax + t * ex, ay + t * ey));
+  }
+  return best;
+}
+
+static bool refContains(const RefFence& f, int32_t lat, int32_t lon) {
+  if (f.circle) return refHaversineM(f.lat, f.lon, lat * 1e-7, lon * 1e-7) <= f.r;
+  return refPolygonContains(f, lat, lon);
+}
+
+static void addCircle(std::string& text, uint16_t id, double lat, double lon, double r) {
+  char line[96];
+  snprintf(line, sizeof(line), "circle %u %.7f %.7f %.1f\n", id, lat, lon, r);
+  text += line;
+  RefFence f;
+  f.id = id;
+  f.circle = true;
+  f.lat = lat;
+  f.lon = lon;
+  f.r = atof(strrchr(line, ' '));
+  ref.push_back(f);
+}
+
+// Star-shaped polygon: n vertices at random radii between rMin and rMax
+static void addPolygon(std::string& text, uint16_t id, double lat, double lon, int n, double rMin, double rMax) {
+  char buf[40];
+  snprintf(buf, sizeof(buf), "poly %u", id);
+  text += buf;
+  RefFence f;
+  f.id = id;
+  f.circle = false;
+  for (int k = 0; k < n; k++) {
+    double vLat, vLon;
+    offsetDeg(lat, lon, uniform(rMin, rMax), 2 * M_PI * (k + uniform(0.1, 0.9)) / n, vLat, vLon);
+    snprintf(buf, sizeof(buf), " %.7f %.7f", vLat, vLon);
+    text += buf;
+    f.vLat.push_back(e7(vLat));
+    f.vLon.push_back(e7(vLon));
+  }
+  text += "\n";
+  ref.push_back(f);
+}
+
+// Hannover: 52.30..52.45 N, 9.60..9.90 E (about 17 x 20 km)
+static const double AREA_LAT0 = 52.30, AREA_LAT1 = 52.45;
+static const double AREA_LON0 = 9.60, AREA_LON1 = 9.90;
+
+static std::string buildFences() {
+  std::string text = "# geofence_bench: 1000 fences around Hannover\n";
+  uint16_t id = 1;
+  for (int i = 0; i < 560; i++) {
+    addCircle(text, id++, uniform(AREA_LAT0, AREA_LAT1), uniform(AREA_LON0, AREA_LON1), uniform(30, 400));
+  }
+  for (int i = 0; i < 436; i++) {
+    addPolygon(text, id++, uniform(AREA_LAT0, AREA_LAT1), uniform(AREA_LON0, AREA_LON1),
+               3 + (int)(rng() % 22), 40, uniform(80, 500));
+  }
+  // City-sized zones for the large list
+  addCircle(text, id++, 52.375, 9.735, 6000);
+  addCircle(text, id++, 52.40, 9.70, 3500);
+  addPolygon(text, id++, 52.37, 9.75, 12, 5000, 8000);
+  addPolygon(text, id++, 52.33, 9.80, 6, 2500, 4000);
+  // Skipped: bad syntax, 2 vertices, antimeridian
+  text += "circle 9001 52.1 9.1\n";
+  text += "poly 9002 52.1 9.1 52.2 9.2\n";
+  text += "poly 9003 10 179.9 10.1 -179.9 10.2 179.9\n";
+  text += "square 9004 52.1 9.1 100\n";
+  return text;
+}
+
+// ============= TESTS =============
+
+static std::vector<uint16_t> sortedIds(const uint16_t* ids, size_t n) {
+  std::vector<uint16_t> v(ids, ids + n);
+  std::sort(v.begin(), v.end());
+  return v;
+}
+
+// Indexed vs linear (identical) vs reference (boundary tolerance)
+static void checkPoint(int32_t lat, int32_t lon, size_t& boundary, size_t& maxHits) {
+  uint16_t a[64], b[64];
+  size_t na = geofenceQuery(lat, lon, a, 64);
+  size_t nb = geofenceQueryLinear(lat, lon, b, 64);
+  CHECK(na <= 64 && nb <= 64, "too many fences at one point");
+  std::vector<uint16_t> ia = sortedIds(a, na), ib = sortedIds(b, nb);
+  CHECK(ia == ib, "index and linear disagree at (%ld, %ld): %u vs %u fences", (long)lat, (long)lon,
+        (unsigned)na, (unsigned)nb);
+  maxHits = std::max(maxHits, na);
+  for (const RefFence& f : ref) {
+    bool want = refContains(f, lat, lon);
+    bool got = std::binary_search(ia.begin(), ia.end(), f.id);
+    if (want == got) continue;
+    double edge = refEdgeDistanceM(f, lat, lon);
+    if (edge <= 0.05) {
+      boundary++;
+      continue;
+    }
+    CHECK(false, "fence %u at (%ld, %ld): engine %d, reference %d, %.3f m from the edge", f.id, (long)lat,
+          (long)lon, got, want, edge);
+  }
+}
+
+static void testQueries() {
+  size_t boundary = 0, maxHits = 0, n = 0;
+  for (int i = 0; i < 20000; i++, n++) {
+    checkPoint(e7(uniform(AREA_LAT0 - 0.02, AREA_LAT1 + 0.02)), e7(uniform(AREA_LON0 - 0.02, AREA_LON1 + 0.02)),
+               boundary, maxHits);
+  }
+  // Right next to edges: circle rims and polygon vertices / edge midpoints
+  for (const RefFence& f : ref) {
+    for (int k = 0; k < 8; k++, n++) {
+      double lat, lon;
+      if (f.circle) {
+        offsetDeg(f.lat, f.lon, f.r + uniform(-0.5, 0.5), uniform(0, 2 * M_PI), lat, lon);
+      } else {
+        size_t i = rng() % f.vLat.size(), j = (i + 1) % f.vLat.size();
+        double t = (k & 1) ? 0 : uniform(0, 1);
+        lat = (f.vLat[i] + t * (f.vLat[j] - f.vLat[i])) * 1e-7 + uniform(-5e-6, 5e-6);
+        lon = (f.vLon[i] + t * (f.vLon[j] - f.vLon[i])) * 1e-7 + uniform(-5e-6, 5e-6);
+      }
+      checkPoint(e7(lat), e7(lon), boundary, maxHits);
+    }
+  }
+  printf("queries: %u points, index == linear, %u within 5 cm of an edge differ from the reference, "
+         "up to %u fences at one point\n", (unsigned)n, (unsigned)boundary, (unsigned)maxHits);
+}
+
+// Walk from (lat0, lon0) on bearing brg in 1 m steps, collecting events
+struct Walk {
+  std::vector<GeofenceEvent> ev;
+  std::vector<double> atM;                  // distance walked at each event
+};
+
+static void walk(Walk& w, double lat0, double lon0, double brg, double fromM, double toM, double jitterM = 0) {
+  for (double m = fromM; m <= toM; m += 1) {
+    double lat, lon;
+    offsetDeg(lat0, lon0, m + (jitterM ? uniform(-jitterM, jitterM) : 0), brg, lat, lon);
+    GeofenceEvent ev[4];
+    size_t n = geofenceEvaluate(e7(lat), e7(lon), ev, 4);
+    for (size_t k = 0; k < n; k++) {
+      w.ev.push_back(ev[k]);
+      w.atM.push_back(m);
+    }
+  }
+}
+
+static void testEvents() {
+  // Separate fence set: a 100 m circle and a 200 m square, away from each other
+  std::string text = "circle 7 52.5000000 9.5000000 100\n";
+  double sLat0, sLon0, sLat1, sLon1;
+  offsetDeg(52.52, 9.52, 100, M_PI, sLat0, sLon0);          // south edge
+  offsetDeg(52.52, 9.52, 100, 0, sLat1, sLon1);             // north edge
+  double w0, e0, tmp;
+  offsetDeg(52.52, 9.52, 100, -M_PI / 2, tmp, w0);
+  offsetDeg(52.52, 9.52, 100, M_PI / 2, tmp, e0);
+  char line[160];
+  snprintf(line, sizeof(line), "poly 8 %.7f %.7f %.7f %.7f %.7f %.7f %.7f %.7f\n",
+           sLat0, w0, sLat0, e0, sLat1, e0, sLat1, w0);
+  text += line;
+  CHECK(geofenceLoad(text.data(), text.size()) == 2, "event fences");
+
+  // Straight through the circle, west to east: enter at 100 m before the
+  // centre, exit once 10 m (hysteresis) beyond the far edge
+  Walk a;
+  walk(a, 52.50, 9.50, -M_PI / 2, -300, 0);
+  CHECK(a.ev.size() == 1 && a.ev[0].id == 7 && a.ev[0].enter && fabs(a.atM[0] + 100) <= 1,
+        "circle enter: %u events", (unsigned)a.ev.size());
+  Walk b;
+  walk(b, 52.50, 9.50, M_PI / 2, 0, 300);
+  CHECK(b.ev.size() == 1 && b.ev[0].id == 7 && !b.ev[0].enter && fabs(b.atM[0] - 100 - GEOFENCE_HYSTERESIS_M) <= 1,
+        "circle exit: %u events, at %.0f m", (unsigned)b.ev.size(), b.atM.empty() ? 0 : b.atM[0]);
+
+  // Jitter of +-4 m on the boundary: one enter, no exit
+  Walk c;
+  walk(c, 52.50, 9.50, 0, 98, 102, 4);
+  walk(c, 52.50, 9.50, 0, 98, 102, 4);
+  walk(c, 52.50, 9.50, 0, 98, 102, 4);
+  size_t enters = 0, exits = 0;
+  for (const GeofenceEvent& e : c.ev) (e.enter ? enters : exits)++;
+  CHECK(enters == 1 && exits == 0, "boundary jitter: %u enters, %u exits", (unsigned)enters, (unsigned)exits);
+  Walk d;
+  walk(d, 52.50, 9.50, 0, 102, 200);
+  CHECK(d.ev.size() == 1 && !d.ev[0].enter, "leave after jitter: %u events", (unsigned)d.ev.size());
+
+  // Through the square, south to north
+  Walk s;
+  walk(s, 52.52, 9.52, 0, -300, 300);
+  CHECK(s.ev.size() == 2 && s.ev[0].id == 8 && s.ev[0].enter && !s.ev[1].enter &&
+        fabs(s.atM[1] - 100 - GEOFENCE_HYSTERESIS_M) <= 1, "square: %u events", (unsigned)s.ev.size());
+
+  // Event log: events are found by the seq of their fix until overwritten
+  GeofenceEvent ev[2] = {{0, 7, true}, {0, 8, false}};
+  geofenceLogEvents(100, ev, 2);
+  GeofenceEvent out[4];
+  size_t n = geofenceEventsAt(100, out, 4);
+  CHECK(n == 2 && out[0].seq == 100 && out[0].id == 7 && out[0].enter && out[1].id == 8 && !out[1].enter,
+        "event log: %u events", (unsigned)n);
+  for (uint32_t seq = 101; seq < 101 + GEOFENCE_EVENT_LOG; seq++) geofenceLogEvents(seq, ev, 1);
+  CHECK(geofenceEventsAt(100, out, 4) == 0, "event log keeps the newest %u", GEOFENCE_EVENT_LOG);
+  CHECK(geofenceEventsAt(100 + GEOFENCE_EVENT_LOG, out, 4) == 1, "newest event");
+  printf("events: circle, square, boundary jitter and event log ok\n");
+}
+
+// ============= BENCHMARK =============
+
+static volatile size_t sink;
+
+template <typename F>
+static void timeIt(const char* name, F f, int n) {
+  using namespace std::chrono;
+  steady_clock::time_point t0 = steady_clock::now();
+  uint64_t c0 = cycles();
+  size_t acc = 0;
+  for (int i = 0; i < n; i++) acc += f(i);
+  uint64_t c = cycles() - c0;
+  double ns = duration_cast<nanoseconds>(steady_clock::now() - t0).count();
+  sink = acc;
+  if (HAVE_CYCLES) {
+    printf("%-22s %9.1f ns/fix %9.0f cycles/fix\n", name, ns / n, (double)c / n);
+  } else {
+    printf("%-22s %9.1f ns/fix\n", name, ns / n);
+  }
+}
+
+static void bench(const std::string& text) {
+  // 1 Hz drive at 10-20 m/s with gentle turns, bouncing inside the area
+  const int N = 100000;
+  static int32_t lat[N], lon[N];
+  double la = 52.375, lo = 9.75, brg = 0;
+  for (int i = 0; i < N; i++) {
+    brg += uniform(-0.15, 0.15);
+    offsetDeg(la, lo, uniform(10, 20), brg, la, lo);
+    if (la < AREA_LAT0 || la > AREA_LAT1 || lo < AREA_LON0 || lo > AREA_LON1) {
+      brg += M_PI;
+      la = std::max(AREA_LAT0, std::min(AREA_LAT1, la));
+      lo = std::max(AREA_LON0, std::min(AREA_LON1, lo));
+    }
+    lat[i] = e7(la);
+    lon[i] = e7(lo);
+  }
+  geofenceLoad(text.data(), text.size());
+  uint16_t ids[64];
+  size_t inside = 0;
+  for (int i = 0; i < N; i++) inside += geofenceQuery(lat[i], lon[i], ids, 64);
+  printf("drive: %d fixes, %.2f fences per fix on average\n", N, (double)inside / N);
+
+  timeIt("geofenceQuery", [&](int i) { return geofenceQuery(lat[i], lon[i], ids, 64); }, N);
+  timeIt("geofenceQueryLinear", [&](int i) { return geofenceQueryLinear(lat[i], lon[i], ids, 64); }, N / 20);
+  GeofenceEvent ev[8];
+  size_t events = 0;
+  timeIt("geofenceEvaluate", [&](int i) { size_t n = geofenceEvaluate(lat[i], lon[i], ev, 8); events += n; return n; }, N);
+  printf("drive: %u enter/exit events\n", (unsigned)events);
+}
+
+int main(int argc, char** argv) {
+  hostVerbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+  std::string text = buildFences();
+  size_t n = geofenceLoad(text.data(), text.size());
+  CHECK(n == 1000, "loaded %u fences", (unsigned)n);
+  printf("loaded %u fences (%u bytes of text)\n", (unsigned)n, (unsigned)text.size());
+
+  testQueries();
+  testEvents();
+  bench(text);
+  if (failures) printf("%d FAILED\n", failures);
+  else printf("all checks passed\n");
+  return failures ? 1 : 0;
+}
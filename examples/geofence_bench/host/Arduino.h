@@ -0,0 +1,26 @@
+// Minimal Arduino shim so src/geofence.cpp builds on the host for geofence_bench
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+
+extern bool hostVerbose;
+
+// Serial output goes to stderr with -v, so stdout stays the report
+class HostSerial {
+public:
+  int printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    if (!hostVerbose) return 0;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    return n;
+  }
+  void println(const char* s) { printf("%s\n", s); }
+};
+
+extern HostSerial Serial;
@@ -0,0 +1,35 @@
+// LittleFS shim for geofence_bench: files are read from the host working directory
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+
+#define FILE_READ "r"
+
+class File {
+public:
+  File(FILE* f = nullptr) : f_(f) {}
+  explicit operator bool() const { return f_ != nullptr; }
+  size_t size() {
+    long pos = ftell(f_);
+    fseek(f_, 0, SEEK_END);
+    long n = ftell(f_);
+    fseek(f_, pos, SEEK_SET);
+    return (size_t)n;
+  }
+  size_t read(uint8_t* buf, size_t n) { return fread(buf, 1, n, f_); }
+  void close() {
+    if (f_) fclose(f_);
+    f_ = nullptr;
+  }
+
+private:
+  FILE* f_;
+};
+
+class HostLittleFS {
+public:
+  File open(const char* path, const char* mode) { return File(fopen(("." + std::string(path)).c_str(), mode)); }
+};
+
+extern HostLittleFS LittleFS;
@@ -0,0 +1,428 @@
+// Host replay: feed a GNSS capture (gnss_capture.h) through the firmware's
+// own receive, sampling and LoRa decision code at accelerated virtual time
+//
+// The GPS task (gpsUpdate), the sampler (sampleGPSTick, every SAMPLE_TICK_MS)
+// and the LoRa task (loraUpdate -> checkAndSend, every 100 ms) run as events
+// on one virtual clock. Captured UART bytes reach the real GnssFramer at the
+// micros() they were read on the device, PPS edges fire the real interrupt
+// handler at their edge time, and every wait in the firmware (delay,
+// vTaskDelay, ulTaskNotifyTake) moves the clock instead of sleeping. The same
+// capture therefore always produces the same fixes and uplinks, which makes
+// the output a golden file for changes to the parser, filter, sampling policy
+// or uplink logic. Radio, flash log, battery, WiFi and geofences are stubs.
+//
+// Pull the capture off the device (README, "GNSS Capture"), then:
+//   g++ -O2 -std=gnu++11 -Iexamples/gnss_replay/host -Iinclude examples/gnss_replay/gnss_replay.cpp
+//       src/gps.cpp src/gps_sampler.cpp src/lora_manager.cpp src/lora_payload.cpp src/gnss_framer.cpp
+//       src/nmea_parser.cpp src/gnss_casic.cpp src/gnss_duty.cpp src/kalman_filter.cpp src/pps_clock.cpp
+//       src/time_service.cpp src/sample_policy.cpp src/motion.cpp src/track_storage.cpp src/track_scan.cpp
+//       src/track_simplify.cpp -o gnss_replay
+//   ./gnss_replay gnsscap/*.cap                  # newest boot in the capture
+//   ./gnss_replay --run 0 gnsscap/*.cap          # first boot
+//   ./gnss_replay --nmea examples/nmea_bench/corpus.nmea   # plain NMEA log, 1 Hz, synthetic PPS
+// Options: -v prints the firmware's Serial output to stderr.
+//
+// stdout carries only deterministic lines:
+//   FIX <virtual s> seq=<seq> ts=<utc> lat=<deg> lon=<deg> bat=<%> flags=0x<hex>
+//       dop=0x<hex> speed=<cm/s> course2=<2 deg> alt=<dm>
+//   TX <virtual s> port=<port> <payload hex>
+// and a summary; the replay speed goes to stderr.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "gps.h"
+#include "gps_sampler.h"
+#include "lora_manager.h"
+#include "track_storage.h"
+#include "track_log.h"
+#include "battery.h"
+#include "wifi_manager.h"
+#include "sample_policy.h"
+#include "geofence.h"
+#include "upload_manager.h"
+#include "gnss_uart.h"
+#include "gnss_framer.h"
+#include "gnss_capture.h"
+#include <RadioLib.h>
+
+// ============= HOST GLOBALS =============
+
+int64_t hostNowUs = 0;
+bool hostVerbose = false;
+HostSerial Serial;
+HostSpi SPI;
+const LoRaWANBand_t EU868 = { 868 };
+
+volatile bool wifiConnected = false;
+
+uint8_t getBatteryPercent() { return 100; }
+bool isCharging() { return false; }
+
+void trackLogAppend(const FixRec&) {}
+
+// No fences loaded (examples/geofence_bench exercises the engine)
+size_t geofenceEvaluate(int32_t, int32_t, GeofenceEvent*, size_t) { return 0; }
+void geofenceLogEvents(uint32_t, const GeofenceEvent*, size_t) {}
+void uploadKick() {}
+
+// ============= CAPTURE =============
+
+struct CapRecord {
+  int64_t us;                   // unwrapped micros()
+  uint8_t type;
+  std::vector<uint8_t> data;
+};
+
+struct CapRun {
+  int64_t bootUs = 0;           // micros() of the BOOT record (in gpsInit)
+  uint8_t version = 0;
+  uint8_t binaryProtocol = 0;
+  uint8_t dutyCycle = 0;
+  std::vector<CapRecord> records;
+};
+
+static uint16_t crc16(const uint8_t* data, size_t n, uint16_t crc = 0xFFFF) {
+  for (size_t i = 0; i < n; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+  FILE* f = fopen(path, "rb");
+  if (!f) return false;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+// Split the concatenated segments into boot runs. Damaged bytes (a segment
+// deleted under a straddling record, a torn write) are skipped up to the next
+// record whose CRC checks out.
+static size_t parseCapture(const std::vector<uint8_t>& b, std::vector<CapRun>& runs) {
+  size_t skipped = 0;
+  size_t i = 0;
+  uint32_t lastRaw = 0;
+  int64_t lastUs = 0;
+  while (i + GNSS_CAP_OVERHEAD <= b.size()) {
+    size_t len = b[i + 2] | (b[i + 3] << 8);
+    if (b[i] != GNSS_CAP_MAGIC || b[i + 1] < GNSS_CAP_BOOT || b[i + 1] > GNSS_CAP_LOST ||
+        i + GNSS_CAP_OVERHEAD + len > b.size() ||
+        crc16(&b[i + 1], 7 + len) != (uint16_t)(b[i + 8 + len] << 8 | b[i + 9 + len])) {
+      i++;
+      skipped++;
+      continue;
+    }
+    CapRecord r;
+    r.type = b[i + 1];
+    uint32_t raw = b[i + 4] | b[i + 5] << 8 | b[i + 6] << 16 | (uint32_t)b[i + 7] << 24;
+    r.data.assign(b.begin() + i + 8, b.begin() + i + 8 + len);
+    i += GNSS_CAP_OVERHEAD + len;
+
+    if (r.type == GNSS_CAP_BOOT) {
+      CapRun run;
+      if (len >= 3) {
+        run.version = r.data[0];
+        run.binaryProtocol = r.data[1];
+        run.dutyCycle = r.data[2];
+      }
+      run.bootUs = raw;
+      runs.push_back(run);
+      lastUs = raw;
+    } else if (runs.empty()) {
+      continue;                 // the segment holding this boot's start was deleted
+    } else {
+      // micros() wraps every 71.6 min; records of the two producers may be slightly out of order
+      r.us = lastUs + (int32_t)(raw - lastRaw);
+      lastUs = r.us;
+      runs.back().records.push_back(r);
+    }
+    lastRaw = raw;
+  }
+  for (CapRun& run : runs) {
+    std::stable_sort(run.records.begin(), run.records.end(),
+                     [](const CapRecord& a, const CapRecord& c) { return a.us < c.us; });
+  }
+  return skipped + (b.size() - i);
+}
+
+// Plain NMEA log -> capture: one epoch per GGA at 1 Hz, output starting 80 ms
+// after the PPS edge at 9600 baud (~1042 us per byte), one RX record per line
+static void synthesizeNmea(const std::vector<uint8_t>& text, CapRun& run) {
+  const int64_t bootUs = 1000000;
+  const int64_t firstEdgeUs = bootUs + 3000000;   // after power-up and the handshake timeout
+  run.version = GNSS_CAP_VERSION;
+  run.binaryProtocol = 0;
+  run.dutyCycle = GPS_DUTY_CYCLE;
+
+  int64_t epoch = -1;
+  int64_t t = firstEdgeUs;
+  size_t i = 0;
+  while (i < text.size()) {
+    size_t end = i;
+    while (end < text.size() && text[end] != '\n') end++;
+    if (end < text.size()) end++;
+    std::string line(text.begin() + i, text.begin() + end);
+    i = end;
+    if (line.size() < 6 || line[0] != '$') continue;
+    if (line.compare(3, 3, "GGA") == 0) {
+      epoch++;
+      int64_t edge = firstEdgeUs + epoch * 1000000;
+      CapRecord pps;
+      pps.us = edge;
+      pps.type = GNSS_CAP_PPS;
+      run.records.push_back(pps);
+      t = edge + 80000;
+    }
+    t += (int64_t)line.size() * 1042;
+    CapRecord r;
+    r.us = t;
+    r.type = GNSS_CAP_RX;
+    r.data.assign(line.begin(), line.end());
+    run.records.push_back(r);
+  }
+  run.bootUs = bootUs;
+}
+
+// ============= HOST GNSS UART =============
+// Same contract as src/gnss_uart.cpp: frames go into a ring the GPS task
+// pops; every committed frame counts as one task notification.
+
+static GnssFramer framer;
+static GnssFrame ring[GNSS_FRAME_SLOTS];
+static uint32_t ringHead = 0;
+static uint32_t ringTail = 0;
+static GnssUartStats uartStats;
+static GnssFraming framing = GNSS_FRAMING_LINES;
+static uint32_t notifications = 0;
+
+static void uartRx(const uint8_t* data, size_t len) {
+  uartStats.rxBytes += len;
+  GnssFrameKind kind;
+  for (size_t i = 0; i < len; i++) {
+    if (!gnssFramerByte(framer, data[i], kind)) continue;
+    if (kind == GNSS_FRAME_BINARY && framing == GNSS_FRAMING_LINES) continue;   // pattern detector sees no line
+    if (ringHead - ringTail >= GNSS_FRAME_SLOTS) {
+      uartStats.ringDrops++;
+      continue;
+    }
+    GnssFrame& f = ring[ringHead++ % GNSS_FRAME_SLOTS];
+    memcpy(f.data, framer.cur, framer.len);
+    f.data[framer.len] = 0;
+    f.len = (uint8_t)framer.len;
+    f.kind = kind;
+    f.arrivalUs = micros();
+    uartStats.frames++;
+    notifications++;
+  }
+}
+
+bool gnssUartBegin(int, int, TaskHandle_t) {
+  gnssFramerReset(framer);
+  return true;
+}
+
+void gnssUartSetFraming(GnssFraming f) {
+  if (f != framing) gnssFramerReset(framer);
+  framing = f;
+}
+
+bool gnssUartSetBaud(uint32_t) { return true; }
+
+bool gnssUartWrite(const void*, size_t) { return true; }   // the capture holds the module's answers
+
+bool gnssUartPop(GnssFrame& out) {
+  if (ringTail == ringHead) return false;
+  out = ring[ringTail++ % GNSS_FRAME_SLOTS];
+  return true;
+}
+
+void gnssUartDiscard() {
+  ringTail = ringHead;
+}
+
+void gnssUartGetStats(GnssUartStats& out) {
+  out = uartStats;
+  out.truncated += framer.truncated;
+}
+
+// ============= VIRTUAL TIME =============
+
+static const std::vector<CapRecord>* replay = nullptr;
+static size_t replayNext = 0;
+static int64_t replayOffsetUs = 0;      // virtual time - capture time
+static void (*ppsIsr)() = nullptr;
+static uint32_t ppsFired = 0;
+static uint32_t lostBytes = 0;
+
+void hostAttachInterrupt(int pin, void (*isr)()) {
+  if (pin == GNSS_PPS) ppsIsr = isr;
+}
+
+static int64_t nextRecordUs() {
+  if (!replay || replayNext >= replay->size()) return INT64_MAX;
+  return (*replay)[replayNext].us + replayOffsetUs;
+}
+
+static void deliverNext() {
+  const CapRecord& r = (*replay)[replayNext++];
+  if (r.us + replayOffsetUs > hostNowUs) hostNowUs = r.us + replayOffsetUs;
+  if (r.type == GNSS_CAP_RX) {
+    uartRx(r.data.data(), r.data.size());
+  } else if (r.type == GNSS_CAP_PPS) {
+    ppsFired++;
+    if (ppsIsr) ppsIsr();
+  } else if (r.type == GNSS_CAP_LOST && r.data.size() >= 4) {
+    lostBytes += r.data[0] | r.data[1] << 8 | r.data[2] << 16 | (uint32_t)r.data[3] << 24;
+  }
+}
+
+void hostAdvanceTo(int64_t us) {
+  while (nextRecordUs() <= us) deliverNext();
+  if (us > hostNowUs) hostNowUs = us;
+}
+
+uint32_t hostNotifyTake(uint32_t timeoutMs) {
+  int64_t deadline = hostNowUs + (int64_t)timeoutMs * 1000;
+  while (!notifications && nextRecordUs() <= deadline) deliverNext();
+  if (!notifications) {
+    hostAdvanceTo(deadline);
+    return 0;
+  }
+  uint32_t n = notifications;
+  notifications = 0;
+  return n;
+}
+
+void hostUplink(const uint8_t* data, size_t len, uint8_t port) {
+  printf("TX %.3f port=%u ", hostNowUs / 1e6, port);
+  for (size_t i = 0; i < len; i++) printf("%02x", data[i]);
+  printf("\n");
+}
+
+// ============= MAIN =============
+
+int main(int argc, char** argv) {
+  int runIndex = -1;
+  const char* nmeaPath = nullptr;
+  std::vector<const char*> files;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-v")) hostVerbose = true;
+    else if (!strcmp(argv[i], "--run") && i + 1 < argc) runIndex = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--nmea") && i + 1 < argc) nmeaPath = argv[++i];
+    else files.push_back(argv[i]);
+  }
+  if (!nmeaPath && files.empty()) {
+    fprintf(stderr, "usage: %s [-v] [--run N] segment.cap...\n       %s [-v] --nmea log.nmea\n", argv[0], argv[0]);
+    return 2;
+  }
+
+  std::vector<CapRun> runs;
+  if (nmeaPath) {
+    std::vector<uint8_t> text;
+    if (!readFile(nmeaPath, text)) {
+      fprintf(stderr, "cannot read %s\n", nmeaPath);
+      return 1;
+    }
+    runs.resize(1);
+    synthesizeNmea(text, runs[0]);
+  } else {
+    std::vector<uint8_t> bytes;
+    for (const char* path : files) {
+      if (!readFile(path, bytes)) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return 1;
+      }
+    }
+    size_t skipped = parseCapture(bytes, runs);
+    if (skipped) fprintf(stderr, "capture: %zu damaged bytes skipped\n", skipped);
+  }
+  if (runs.empty()) {
+    fprintf(stderr, "no BOOT record in the capture\n");
+    return 1;
+  }
+  if (runIndex < 0) runIndex = (int)runs.size() - 1;
+  if (runIndex >= (int)runs.size()) {
+    fprintf(stderr, "capture holds %zu boot runs\n", runs.size());
+    return 1;
+  }
+  const CapRun& run = runs[runIndex];
+  if (run.version != GNSS_CAP_VERSION) fprintf(stderr, "warning: capture format version %u\n", run.version);
+  if (!nmeaPath && run.binaryProtocol != GPS_BINARY_PROTOCOL) {
+    fprintf(stderr, "warning: captured with GPS_BINARY_PROTOCOL %u, replaying with %d\n", run.binaryProtocol, GPS_BINARY_PROTOCOL);
+  }
+  if (run.dutyCycle != GPS_DUTY_CYCLE) {
+    fprintf(stderr, "warning: captured with GPS_DUTY_CYCLE %u, replaying with %d\n", run.dutyCycle, GPS_DUTY_CYCLE);
+  }
+
+  auto wall0 = std::chrono::steady_clock::now();
+
+  // The other tasks are up before the GPS task starts talking to the module
+  initTrackStore(TRACK_CAPACITY);
+  loraInit();
+  replay = &run.records;
+  replayOffsetUs = hostNowUs - run.bootUs;   // the BOOT record was written in gpsInit()
+  int64_t startUs = hostNowUs;
+  gpsInit();
+
+  const int64_t idleUs = (int64_t)GPS_IDLE_WAKE_MS * 1000;
+  const int64_t endUs = (run.records.empty() ? run.bootUs : run.records.back().us) + replayOffsetUs + idleUs * 2;
+  int64_t gpsWakeUs = hostNowUs + idleUs;
+  int64_t sampleUs = startUs + (int64_t)SAMPLE_TICK_MS * 1000;
+  int64_t loraUs = startUs + 100000;
+  uint32_t lastSeq = 0;
+  uint32_t fixes = 0;
+  uint32_t uplinks = 0;
+
+  while (hostNowUs < endUs) {
+    if (notifications || gpsWakeUs <= hostNowUs) {
+      notifications = 0;
+      gpsUpdate();
+      gpsWakeUs = hostNowUs + idleUs;
+      continue;
+    }
+    if (sampleUs <= hostNowUs) {
+      sampleGPSTick();
+      sampleUs += (int64_t)SAMPLE_TICK_MS * 1000;
+      FixRec rec;
+      if (trackStoreGetLatest(rec) && rec.seq != lastSeq) {
+        lastSeq = rec.seq;
+        fixes++;
+        printf("FIX %.3f seq=%u ts=%u lat=%.7f lon=%.7f bat=%u flags=0x%02x dop=0x%02x speed=%u course2=%u alt=%d\n",
+               hostNowUs / 1e6, rec.seq, rec.ts, rec.latE7 / 1e7, rec.lonE7 / 1e7, rec.bat, rec.flags,
+               rec.dop, rec.speedCmS, rec.course2, rec.altDm);
+      }
+      continue;
+    }
+    if (loraUs <= hostNowUs) {
+      uint32_t before = getLoraTxCount();
+      loraUpdate();
+      uplinks += getLoraTxCount() - before;
+      loraUs += 100000;
+      continue;
+    }
+    int64_t t = std::min(std::min(nextRecordUs(), gpsWakeUs), std::min(sampleUs, loraUs));
+    if (t == nextRecordUs()) deliverNext();
+    else hostAdvanceTo(t);
+  }
+
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+  double virtS = (hostNowUs - startUs) / 1e6;
+  GpsStats st;
+  gpsGetStats(st);
+  printf("SUMMARY run=%d/%zu virtual=%.1f s frames=%u dropped=%u pps=%u lost=%u fixes=%u uplinks=%u clock=%s\n",
+         runIndex, runs.size(), virtS, st.frames, st.ringDrops, ppsFired, lostBytes, fixes, uplinks,
+         clockSourceName(st.clockSource));
+  fprintf(stderr, "replayed %.1f s of device time in %.3f s (%.0fx)\n", virtS, wallS, wallS > 0 ? virtS / wallS : 0.0);
+  return 0;
+}
@@ -0,0 +1,105 @@
+// Arduino / FreeRTOS shim for gnss_replay: virtual time, quiet Serial
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+typedef uint8_t byte;
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+#define radians(deg) ((deg) * DEG_TO_RAD)
+#define degrees(rad) ((rad) * RAD_TO_DEG)
+#define sq(x) ((x) * (x))
+
+#define IRAM_ATTR
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define RISING 1
+#define DEC 10
+#define HEX 16
+
+// ============= VIRTUAL TIME =============
+// Provided by gnss_replay.cpp. Everything that waits moves virtual time and
+// delivers the capture records that fall due on the way.
+
+extern int64_t hostNowUs;
+void hostAdvanceTo(int64_t us);
+uint32_t hostNotifyTake(uint32_t timeoutMs);
+void hostAttachInterrupt(int pin, void (*isr)());
+
+inline unsigned long millis() { return (unsigned long)(uint32_t)(hostNowUs / 1000); }
+inline unsigned long micros() { return (unsigned long)(uint32_t)hostNowUs; }
+inline void delay(uint32_t ms) { hostAdvanceTo(hostNowUs + (int64_t)ms * 1000); }
+
+inline void pinMode(int, int) {}
+inline void digitalWrite(int, int) {}
+inline int digitalPinToInterrupt(int pin) { return pin; }
+inline void attachInterrupt(int pin, void (*isr)(), int) { hostAttachInterrupt(pin, isr); }
+
+// ============= STRING / SERIAL =============
+
+class String : public std::string {
+public:
+  String() {}
+  String(const char* s) : std::string(s ? s : "") {}
+  String(const std::string& s) : std::string(s) {}
+};
+
+extern bool hostVerbose;
+
+class HostSerial {
+public:
+  void begin(unsigned long) {}
+  void flush() { if (hostVerbose) fflush(stderr); }
+  int printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    if (!hostVerbose) return 0;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    return n;
+  }
+  void print(const char* s) { printf("%s", s); }
+  void print(const String& s) { printf("%s", s.c_str()); }
+  void print(char c) { printf("%c", c); }
+  void print(double v, int digits = 2) { printf("%.*f", digits, v); }
+  void print(long v, int base = DEC) { printf(base == HEX ? "%lX" : "%ld", base == HEX ? (long)(unsigned long)v : v); }
+  void print(unsigned long v, int base = DEC) { printf(base == HEX ? "%lX" : "%lu", v); }
+  void print(int v, int base = DEC) { print((long)v, base); }
+  void print(unsigned v, int base = DEC) { print((unsigned long)v, base); }
+  void print(short v, int base = DEC) { print((long)v, base); }
+  void print(unsigned short v, int base = DEC) { print((unsigned long)v, base); }
+  void print(unsigned char v, int base = DEC) { print((unsigned long)v, base); }
+  void print(bool v) { print((unsigned long)v); }
+  void println() { printf("\n"); }
+  template <typename T> void println(const T& v) { print(v); println(); }
+  template <typename T> void println(const T& v, int f) { print(v, f); println(); }
+};
+
+extern HostSerial Serial;
+
+// ============= FREERTOS =============
+
+typedef void* TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t ticks) { return hostNotifyTake(ticks); }
+inline void vTaskDelay(TickType_t ticks) { delay(ticks); }
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return (TaskHandle_t)1; }
@@ -0,0 +1,10 @@
+// IPAddress stand-in for gnss_replay
+#pragma once
+#include <stdint.h>
+
+class IPAddress {
+public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : addr((uint32_t)a | b << 8 | c << 16 | (uint32_t)d << 24) {}
+  uint32_t addr = 0;
+};
@@ -0,0 +1,73 @@
+// RadioLib stand-in for gnss_replay: joins at once, hands every uplink to
+// hostUplink() (gnss_replay.cpp) instead of the air
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define RADIOLIB_NC (-1)
+#define RADIOLIB_ERR_NONE 0
+#define RADIOLIB_LORAWAN_NEW_SESSION (-1118)
+#define RADIOLIB_LORAWAN_NO_DOWNLINK (-1116)
+
+void hostUplink(const uint8_t* data, size_t len, uint8_t port);
+
+class HostSpi {
+public:
+  void begin(int, int, int, int) {}
+  void setFrequency(uint32_t) {}
+};
+extern HostSpi SPI;
+
+class Module {
+public:
+  Module(int, int, int, int) {}
+};
+
+class SX1262 {
+public:
+  SX1262(Module*) {}
+  void setRfSwitchPins(int, int) {}
+  int16_t begin(float, float, uint8_t, uint8_t, uint8_t, int8_t, uint16_t, float, bool) { return RADIOLIB_ERR_NONE; }
+  int16_t setDio2AsRfSwitch(bool) { return RADIOLIB_ERR_NONE; }
+  int16_t sleep() { return RADIOLIB_ERR_NONE; }
+};
+
+struct LoRaWANBand_t {
+  int id;
+};
+extern const LoRaWANBand_t EU868;
+
+struct LoRaWANEvent_t {
+  uint8_t dir;
+  bool confirmed;
+  uint8_t datarate;
+  float freq;
+  int16_t power;
+  uint32_t fCnt;
+  uint8_t fPort;
+};
+
+class LoRaWANNode {
+public:
+  LoRaWANNode(SX1262*, const LoRaWANBand_t*, uint8_t) {}
+  int16_t beginOTAA(uint64_t, uint64_t, uint8_t*, uint8_t*) { return RADIOLIB_ERR_NONE; }
+  void setADR(bool) {}
+  int16_t activateOTAA() { return RADIOLIB_LORAWAN_NEW_SESSION; }
+  int16_t sendReceive(const uint8_t* data, size_t len, uint8_t port, uint8_t*, size_t* downLen, bool,
+                      LoRaWANEvent_t* up, LoRaWANEvent_t*) {
+    hostUplink(data, len, port);
+    if (up) {
+      up->fCnt = fCnt++;
+      up->fPort = port;
+    }
+    if (downLen) *downLen = 0;
+    return 0;
+  }
+  uint8_t getMaxPayloadLen() { return 115; }   // EU868 DR3 (SF9)
+  uint32_t getLastToA() { return 0; }
+  int16_t getMacLinkCheckAns(uint8_t*, uint8_t*) { return -1; }
+  int16_t getMacDeviceTimeAns(uint32_t*, uint8_t*, bool) { return -1; }
+
+private:
+  uint32_t fCnt = 0;
+};
@@ -0,0 +1,4 @@
+// WiFi stand-in for gnss_replay: wifi_manager.h only needs the types
+#pragma once
+#include <Arduino.h>
+#include "IPAddress.h"
@@ -0,0 +1,7 @@
+// Host stand-in for ESP-IDF esp_timer: the replay's virtual clock
+#pragma once
+#include <stdint.h>
+
+extern int64_t hostNowUs;
+
+inline int64_t esp_timer_get_time() { return hostNowUs; }
@@ -0,0 +1,3 @@
+// gnss_replay never talks to a network: the template's placeholders will do
+#pragma once
+#include "secrets.template.h"
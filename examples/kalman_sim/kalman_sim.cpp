@@ -0,0 +1,291 @@
+// Host simulator: raw fixes vs the Kalman filter stage (src/kalman_filter.cpp)
+//
+// Runs noisy 1 Hz traces through the filter exactly like gpsUpdate does and
+// compares raw and filtered output on what the firmware and the server do
+// with them: position error, path length of the 30 s track (server distance),
+// 50 m distance triggers and move start/stop flips (checkAndSend) and fixes
+// stored by the sampling policy.
+//
+//   g++ -O2 -std=gnu++11 -Iinclude examples/kalman_sim/kalman_sim.cpp src/kalman_filter.cpp src/sample_policy.cpp src/nmea_parser.cpp -o kalman_sim
+//   ./kalman_sim                     # built-in parked and driving traces
+//   ./kalman_sim capture.nmea ...    # recorded NMEA (no truth: triggers and path length only)
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "kalman_filter.h"
+#include "sample_policy.h"
+#include "nmea_parser.h"
+
+struct Epoch {
+  NmeaFix fix;            // what the receiver reports
+  bool hasTruth;
+  double trueLat, trueLon;
+  bool trueMoving;
+};
+
+static const double M_PER_DEG = 111319.491;
+
+static double distM(double lat1, double lon1, double lat2, double lon2) {
+  double kx = cos(lat1 * M_PI / 180.0);
+  double dx = (lon2 - lon1) * M_PER_DEG * kx;
+  double dy = (lat2 - lat1) * M_PER_DEG;
+  return sqrt(dx * dx + dy * dy);
+}
+
+// ============= TRACES =============
+
+// Deterministic noise so runs are comparable
+static uint32_t rngState = 4711;
+static double uniform() {
+  rngState = rngState * 1664525u + 1013904223u;
+  return (rngState >> 8) / 16777216.0;
+}
+static double gauss() {
+  double u1 = uniform() + 1e-12, u2 = uniform();
+  return sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+// Receiver error model: a slowly wandering bias (multipath, atmosphere;
+// Gauss-Markov, tau 5 min), white noise scaled by HDOP, and now and then a
+// multipath excursion of tens of metres for a few seconds. Doppler speed has
+// its own noise and reads a few km/h during the excursions.
+struct ErrorModel {
+  double biasN = 0, biasE = 0;
+  double hdop = 1.2;
+  uint32_t excursionLeft = 0;
+  double exN = 0, exE = 0;
+};
+
+static void makeFix(ErrorModel& m, double lat, double lon, double speedMs, double headingDeg, Epoch& e) {
+  const double a = exp(-1.0 / 300.0);
+  m.biasN = a * m.biasN + sqrt(1 - a * a) * 3.0 * gauss();
+  m.biasE = a * m.biasE + sqrt(1 - a * a) * 3.0 * gauss();
+  m.hdop = std::max(0.8, std::min(4.0, m.hdop + 0.05 * gauss()));
+  if (!m.excursionLeft && uniform() < 1.0 / 600) {
+    m.excursionLeft = 3 + (uint32_t)(uniform() * 6);
+    double dir = uniform() * 2 * M_PI, len = 30 + 50 * uniform();
+    m.exN = len * cos(dir);
+    m.exE = len * sin(dir);
+  }
+  double n = m.biasN + 2.0 * m.hdop * gauss();
+  double east = m.biasE + 2.0 * m.hdop * gauss();
+  double hdop = m.hdop;
+  double speed = std::max(0.0, speedMs + 0.1 * gauss());
+  double heading = headingDeg + (speedMs > 1 ? 2.0 : 90.0) * gauss();
+  if (m.excursionLeft) {
+    m.excursionLeft--;
+    n += m.exN;
+    east += m.exE;
+    hdop *= 2;
+    speed += 0.5 + uniform();
+  }
+
+  NmeaFix& f = e.fix;
+  f = NmeaFix();
+  f.hasLocation = f.fixValid = true;
+  f.latE7 = (int32_t)llround((lat + n / M_PER_DEG) * 1e7);
+  f.lonE7 = (int32_t)llround((lon + east / (M_PER_DEG * cos(lat * M_PI / 180.0))) * 1e7);
+  f.hdopX100 = (uint16_t)(hdop * 100);
+  f.hasSpeed = true;
+  f.speedCmS = (uint32_t)(speed * 100);
+  double h = fmod(heading, 360.0);
+  f.courseCdeg = (uint16_t)((h < 0 ? h + 360 : h) * 100);
+  f.hasCourse = true;
+  e.hasTruth = true;
+  e.trueLat = lat;
+  e.trueLon = lon;
+  e.trueMoving = speedMs > 0.3;
+}
+
+static std::vector<Epoch> parkedTrace(uint32_t seconds) {
+  std::vector<Epoch> out;
+  ErrorModel m;
+  for (uint32_t t = 0; t < seconds; t++) {
+    Epoch e;
+    makeFix(m, 52.381461, 9.725351, 0, 0, e);
+    out.push_back(e);
+  }
+  return out;
+}
+
+struct Leg {
+  uint32_t seconds;
+  double speedMs;         // cruise speed
+  double turnEveryM;      // distance between corners, 0 = none
+  uint32_t stopEveryS;    // traffic lights: stop for 30 s this often, 0 = never
+};
+
+static std::vector<Epoch> drivingTrace() {
+  static const Leg legs[] = {
+    { 1500, 11.0, 350, 150 },   // city
+    { 1200, 33.0,   0,   0 },   // motorway
+    {  900, 20.0, 900,   0 },   // rural
+  };
+  std::vector<Epoch> out;
+  ErrorModel m;
+  double lat = 52.381461, lon = 9.725351, heading = 30.0, targetHeading = 30.0, speed = 0;
+  uint32_t t = 0;
+  for (const Leg& leg : legs) {
+    double sinceTurn = 0;
+    for (uint32_t s = 0; s < leg.seconds; s++, t++) {
+      double target = leg.speedMs;
+      if (leg.stopEveryS && (s % leg.stopEveryS) >= leg.stopEveryS - 30) target = 0;
+      speed += std::max(-3.0, std::min(2.0, target - speed));
+      targetHeading += 0.05 * sin(t / 120.0);
+      sinceTurn += speed;
+      if (leg.turnEveryM > 0 && sinceTurn >= leg.turnEveryM * (0.6 + 0.8 * uniform())) {
+        targetHeading += (uniform() < 0.5 ? -1 : 1) * 90 * (0.5 + uniform());
+        sinceTurn = 0;
+      }
+      heading += std::max(-20.0, std::min(20.0, targetHeading - heading));   // corners take a few seconds
+      double rad = heading * M_PI / 180.0;
+      lat += speed * cos(rad) / M_PER_DEG;
+      lon += speed * sin(rad) / (M_PER_DEG * cos(lat * M_PI / 180.0));
+      Epoch e;
+      makeFix(m, lat, lon, speed, heading, e);
+      out.push_back(e);
+    }
+  }
+  return out;
+}
+
+static std::vector<Epoch> nmeaTrace(const char* path) {
+  std::vector<Epoch> out;
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return out;
+  }
+  NmeaParser p;
+  nmeaInit(p);
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    NmeaEvent ev = nmeaParse(p, line, strlen(line));
+    // One epoch per GGA: RMC (speed, course) and GSA (DOP) of the epoch came before it
+    if (ev != NMEA_EV_FIX || strncmp(line + 3, "GGA", 3) != 0 || !p.fix.fixValid) continue;
+    Epoch e;
+    e.fix = p.fix;
+    e.hasTruth = false;
+    out.push_back(e);
+  }
+  fclose(f);
+  return out;
+}
+
+// ============= WHAT THE FIRMWARE DOES WITH A FIX =============
+
+struct Output {
+  int32_t latE7, lonE7;
+  uint32_t speedCmS;
+  uint16_t courseCdeg;
+  bool hasCourse;
+};
+
+struct Score {
+  std::vector<double> err;    // vs truth
+  double pathM = 0;           // 30 s track, summed like gps_geojson.php
+  double truePathM = 0;
+  uint32_t distTriggers = 0;  // 50 m from the last trigger point
+  uint32_t moveFlips = 0;     // MOVE_START/STOP_KMH hysteresis
+  uint32_t falseTriggers = 0; // either of the above while truly parked
+  uint32_t stored = 0;        // sample_policy
+};
+
+static void score(const std::vector<Epoch>& trace, const std::vector<Output>& outs, Score& s) {
+  SamplePolicy policy;
+  samplePolicyReset(policy);
+  bool moving = false, hasLast = false;
+  double lastLat = 0, lastLon = 0;
+  for (size_t i = 0; i < outs.size(); i++) {
+    const Output& o = outs[i];
+    const Epoch& e = trace[i];
+    double lat = o.latE7 / 1e7, lon = o.lonE7 / 1e7;
+    if (e.hasTruth) s.err.push_back(distM(e.trueLat, e.trueLon, lat, lon));
+
+    if (i % 30 == 0 && i >= 30) {
+      s.pathM += distM(outs[i - 30].latE7 / 1e7, outs[i - 30].lonE7 / 1e7, lat, lon);
+      if (e.hasTruth) s.truePathM += distM(trace[i - 30].trueLat, trace[i - 30].trueLon, e.trueLat, e.trueLon);
+    }
+
+    // checkAndSend: speed hysteresis, 50 m from the last sent point
+    float kmh = o.speedCmS * 0.036f;
+    bool flip = (!moving && kmh >= 2.0f) || (moving && kmh <= 1.0f);
+    if (flip) {
+      moving = !moving;
+      s.moveFlips++;
+    }
+    bool dist = false;
+    if (!hasLast || distM(lastLat, lastLon, lat, lon) >= 50) {
+      if (hasLast) dist = true;
+      lastLat = lat;
+      lastLon = lon;
+      hasLast = true;
+    }
+    if (dist) s.distTriggers++;
+    if ((flip || dist) && e.hasTruth && !e.trueMoving) s.falseTriggers++;
+
+    SampleInput in;
+    in.nowS = (uint32_t)i;
+    in.latE7 = o.latE7;
+    in.lonE7 = o.lonE7;
+    in.speedCmS = o.speedCmS;
+    in.courseCdeg = o.courseCdeg;
+    in.hasCourse = o.hasCourse;
+    if (samplePolicyDue(policy, in) != SAMPLE_NONE) {
+      samplePolicyStored(policy, in);
+      s.stored++;
+    }
+  }
+}
+
+static void report(const char* name, Score& s, double hours) {
+  printf("  %-9s", name);
+  if (!s.err.empty()) {
+    std::sort(s.err.begin(), s.err.end());
+    double sum = 0;
+    for (double v : s.err) sum += v;
+    printf(" error mean %5.1f m p95 %5.1f m max %5.1f m |", sum / s.err.size(),
+           s.err[(size_t)(0.95 * (s.err.size() - 1))], s.err.back());
+  }
+  printf(" path %7.0f m", s.pathM);
+  if (s.truePathM > 0 || !s.err.empty()) printf(" (true %6.0f)", s.truePathM);
+  printf(" | 50 m triggers %4u  move flips %4u  false %4u | stored %4.0f/h\n",
+         s.distTriggers, s.moveFlips, s.falseTriggers, s.stored / hours);
+}
+
+static void run(const char* title, const std::vector<Epoch>& trace) {
+  if (trace.size() < 2) return;
+  std::vector<Output> raw, filtered;
+  KalmanFilter kf;
+  kalmanReset(kf);
+  for (size_t i = 0; i < trace.size(); i++) {
+    const NmeaFix& f = trace[i].fix;
+    raw.push_back(Output{f.latE7, f.lonE7, f.hasSpeed ? f.speedCmS : 0, f.courseCdeg, f.hasCourse});
+    KalmanOutput k;
+    kalmanUpdate(kf, (uint32_t)(i * 1000 + (i * 7919) % 400), f, k);   // arrival jitter up to 0.4 s
+    filtered.push_back(Output{k.latE7, k.lonE7, k.speedCmS, k.courseCdeg, k.stationaryPct < 50});
+  }
+  double hours = trace.size() / 3600.0;
+  printf("%s: %zu epochs (%lu gated)\n", title, trace.size(), (unsigned long)kf.rejected);
+  Score sr, sf;
+  score(trace, raw, sr);
+  score(trace, filtered, sf);
+  report("raw", sr, hours);
+  report("filtered", sf, hours);
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    run("parked 2 h", parkedTrace(7200));
+    run("driving 1 h", drivingTrace());
+    return 0;
+  }
+  for (int i = 1; i < argc; i++) {
+    run(argv[i], nmeaTrace(argv[i]));
+  }
+  return 0;
+}
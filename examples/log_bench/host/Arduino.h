@@ -0,0 +1,30 @@
+// Minimal Arduino shim so src/track_log.cpp and src/track_storage.cpp build on the host for log_bench
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+
+// Virtual clock: log_bench advances it by the fix interval per stored fix
+extern uint32_t hostNowMs;
+inline unsigned long millis() { return hostNowMs; }
+
+extern bool hostVerbose;
+
+// Serial output goes to stderr with -v, so stdout stays the report
+class HostSerial {
+public:
+  int printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    if (!hostVerbose) return 0;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    return n;
+  }
+  void println(const char* s) { printf("%s\n", s); }
+};
+
+extern HostSerial Serial;
@@ -0,0 +1,138 @@
+// LittleFS shim for log_bench: files live in a host directory (HostLittleFS::root)
+// and every write is charged to a flash cost model of LittleFS on NOR flash.
+//
+// Model (littlefs v2, block LFS_BLOCK bytes, program unit LFS_PROG bytes):
+//  - a file is a chain of blocks; opening it again and appending copies the
+//    partial tail block into a fresh, erased block before the new data
+//    (lfs_ctz_extend), so one append costs tail + data programmed and one
+//    erase per block touched
+//  - every close, create or remove commits to the directory's metadata log:
+//    one program unit, and a metadata block erase every LFS_BLOCK / LFS_PROG
+//    commits (compaction)
+// Reads are counted as they are; wear levelling spreads the erases.
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+
+#define FILE_READ   "r"
+#define FILE_APPEND "a"
+
+#define LFS_BLOCK 4096
+#define LFS_PROG  256
+
+struct FlashStats {
+  uint64_t appended = 0;    // bytes handed to File::write
+  uint64_t programmed = 0;  // bytes programmed by the model, tail copies and metadata included
+  double erases = 0;        // block erases by the model
+  uint64_t read = 0;        // bytes read
+  uint64_t commits = 0;     // metadata commits
+};
+
+extern FlashStats flashStats;
+
+static inline void flashCommit() {
+  flashStats.commits++;
+  flashStats.programmed += LFS_PROG;
+  flashStats.erases += (double)LFS_PROG / LFS_BLOCK;
+}
+
+class File {
+public:
+  File() {}
+  File(FILE* f, const std::string& name, size_t tail) : f_(f), name_(name), tail_(tail) {}
+  File(DIR* d, const std::string& path) : d_(d), name_(path) {}
+
+  explicit operator bool() const { return f_ != nullptr || d_ != nullptr; }
+  bool isDirectory() const { return d_ != nullptr; }
+  const char* name() const { return name_.c_str(); }
+
+  size_t size() {
+    long pos = ftell(f_);
+    fseek(f_, 0, SEEK_END);
+    long n = ftell(f_);
+    fseek(f_, pos, SEEK_SET);
+    return (size_t)n;
+  }
+  size_t read(uint8_t* buf, size_t n) {
+    size_t got = fread(buf, 1, n, f_);
+    flashStats.read += got;
+    return got;
+  }
+  size_t write(const uint8_t* buf, size_t n) {
+    size_t put = fwrite(buf, 1, n, f_);
+    written_ += put;
+    flashStats.appended += put;
+    return put;
+  }
+
+  File openNextFile() {
+    struct dirent* e;
+    while (d_ && (e = readdir(d_)) != nullptr) {
+      if (e->d_name[0] == '.') continue;
+      return File(fopen((name_ + "/" + e->d_name).c_str(), "r"), e->d_name, 0);
+    }
+    return File();
+  }
+
+  void close() {
+    if (f_) {
+      fclose(f_);
+      if (written_) {
+        size_t data = tail_ + written_;
+        flashStats.programmed += (data + LFS_PROG - 1) / LFS_PROG * LFS_PROG;
+        flashStats.erases += (data + LFS_BLOCK - 1) / LFS_BLOCK;
+        flashCommit();
+      }
+    }
+    if (d_) closedir(d_);
+    f_ = nullptr;
+    d_ = nullptr;
+    written_ = 0;
+  }
+
+private:
+  FILE* f_ = nullptr;
+  DIR* d_ = nullptr;
+  std::string name_;
+  size_t tail_ = 0;       // bytes in the partial last block when opened for append
+  size_t written_ = 0;
+};
+
+class HostLittleFS {
+public:
+  std::string root = ".";
+
+  bool begin(bool) { return true; }
+  bool exists(const char* path) {
+    struct stat st;
+    return stat(host(path).c_str(), &st) == 0;
+  }
+  bool mkdir(const char* path) {
+    flashCommit();
+    return ::mkdir(host(path).c_str(), 0755) == 0;
+  }
+  bool remove(const char* path) {
+    flashCommit();
+    return ::remove(host(path).c_str()) == 0;
+  }
+  File open(const char* path, const char* mode = FILE_READ) {
+    std::string p = host(path);
+    struct stat st;
+    bool found = stat(p.c_str(), &st) == 0;
+    if (found && S_ISDIR(st.st_mode)) return File(opendir(p.c_str()), p);
+    if (!found && strcmp(mode, FILE_READ) == 0) return File();
+    size_t tail = found ? (size_t)st.st_size % LFS_BLOCK : 0;
+    const char* base = strrchr(path, '/');
+    return File(fopen(p.c_str(), mode), base ? base + 1 : path, tail);
+  }
+
+private:
+  std::string host(const char* path) const { return root + path; }
+};
+
+extern HostLittleFS LittleFS;
@@ -0,0 +1,344 @@
+// Host benchmark: persistent track log (include/track_log.h)
+//
+// Runs the real src/track_log.cpp and src/track_storage.cpp over a LittleFS
+// shim that keeps the segments in a temporary host directory and charges
+// every write to a LittleFS-on-NOR cost model (host/LittleFS.h), on a virtual
+// millis() clock that advances with the fixes. Then:
+//  - logs a day of fixes at the worst-case rate (one every 2 s) and at one
+//    every 30 s, with an ack and a service call every 30 s, and reports the
+//    bytes appended and the modelled flash bytes programmed per fix byte, the
+//    erases per fix and what that means for flash wear
+//  - resets without any flush and checks that at most the unflushed page is
+//    lost and that an event fix is on flash at once, then tears the last
+//    record and checks only that one is lost
+//  - reboots 30 times and checks that no segment is used up or deleted, and
+//    that a full log keeps every unacked fix the store can hold
+//  - times trackLogInit() (recovery at boot) against the log size
+//
+//   g++ -O2 -std=gnu++11 -Iexamples/log_bench/host -Iinclude examples/log_bench/log_bench.cpp
+//       src/track_log.cpp src/track_storage.cpp src/track_scan.cpp -o log_bench
+//   ./log_bench              # -v prints the log's Serial output to stderr
+//
+// Recovery times are host times; the device reads flash at a few MB/s, so
+// scale by the bytes read column rather than the milliseconds.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <LittleFS.h>
+#include "track_log.h"
+#include "track_storage.h"
+#include "gps_sampler.h"
+
+bool hostVerbose = false;
+uint32_t hostNowMs = 0;
+HostSerial Serial;
+HostLittleFS LittleFS;
+FlashStats flashStats;
+
+static int failures = 0;
+#define CHECK(cond, ...) do { if (!(cond)) { failures++; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } } while (0)
+
+#define FIX_INTERVAL_S   2        // fastest the sampler stores fixes
+#define SERVICE_S        30       // trackLogService() tick (TRACK_LOG_SERVICE_SEC)
+#define PARTITION_BYTES  0x160000 // "spiffs" partition of the default ESP32 layout
+#define FLASH_CYCLES     100000   // NOR erase endurance per block
+
+// ============= HELPERS =============
+
+static void wipeLog() {
+  std::string dir = LittleFS.root + TRACK_LOG_DIR;
+  DIR* d = opendir(dir.c_str());
+  if (d) {
+    struct dirent* e;
+    while ((e = readdir(d)) != nullptr) {
+      if (e->d_name[0] != '.') unlink((dir + "/" + e->d_name).c_str());
+    }
+    closedir(d);
+    rmdir(dir.c_str());
+  }
+}
+
+static size_t logBytes(size_t& segs) {
+  std::string dir = LittleFS.root + TRACK_LOG_DIR;
+  size_t total = 0;
+  segs = 0;
+  DIR* d = opendir(dir.c_str());
+  if (!d) return 0;
+  struct dirent* e;
+  while ((e = readdir(d)) != nullptr) {
+    if (e->d_name[0] == '.') continue;
+    FILE* f = fopen((dir + "/" + e->d_name).c_str(), "r");
+    fseek(f, 0, SEEK_END);
+    total += (size_t)ftell(f);
+    fclose(f);
+    segs++;
+  }
+  closedir(d);
+  return total;
+}
+
+static std::string newestSegment() {
+  std::string dir = LittleFS.root + TRACK_LOG_DIR;
+  std::string best;
+  DIR* d = opendir(dir.c_str());
+  struct dirent* e;
+  while (d && (e = readdir(d)) != nullptr) {
+    if (e->d_name[0] != '.' && e->d_name > best) best = e->d_name;
+  }
+  if (d) closedir(d);
+  return dir + "/" + best;
+}
+
+// Seq of the first record of the oldest segment (a fix when no ack was logged)
+static uint32_t oldestLoggedSeq() {
+  std::string dir = LittleFS.root + TRACK_LOG_DIR;
+  std::string best;
+  DIR* d = opendir(dir.c_str());
+  struct dirent* e;
+  while (d && (e = readdir(d)) != nullptr) {
+    if (e->d_name[0] != '.' && (best.empty() || e->d_name < best)) best = e->d_name;
+  }
+  if (d) closedir(d);
+  uint8_t head[3 + sizeof(uint32_t)] = {};
+  FILE* f = fopen((dir + "/" + best).c_str(), "r");
+  if (!f) return 0;
+  size_t got = fread(head, 1, sizeof(head), f);
+  fclose(f);
+  uint32_t seq = 0;
+  if (got == sizeof(head)) memcpy(&seq, head + 3, sizeof(seq));
+  return seq;
+}
+
+static uint32_t fixTs = 1789556400;
+
+// Fixes per segment at FIX_INTERVAL_S: whole pages, flushed when full
+static size_t fixesPerSegment() {
+  const size_t rec = sizeof(FixRec) + 5;
+  const size_t perPage = TRACK_LOG_PAGE_BYTES / rec;
+  return TRACK_LOG_SEGMENT_BYTES / (perPage * rec) * perPage;
+}
+
+// One sampler step: store a fix and log it, as sampleGPSTick() does
+static void storeFix(uint32_t i, uint32_t intervalS = FIX_INTERVAL_S, uint8_t events = 0) {
+  hostNowMs += intervalS * 1000;
+  FixRec r;
+  memset(&r, 0, sizeof(r));
+  r.ts = fixTs += intervalS;
+  r.latE7 = 523750000 + (int32_t)(i % 5000) * 37;
+  r.lonE7 = 97500000 + (int32_t)(i % 3000) * 53;
+  r.bat = 80;
+  r.flags = FL_GPS_VALID | FL_MOVE_ACTIVE | events;
+  r.dop = 0x92;
+  r.course2 = (uint8_t)(i % 180);
+  r.speedCmS = 1200;
+  r.altDm = 550;
+  if (trackStorePush(r)) trackLogAppend(r);
+}
+
+// Boot: empty store, replay the log
+static void reboot() {
+  initTrackStore(TRACK_CAPACITY);
+  trackLogInit();
+}
+
+static uint32_t newestSeq() {
+  FixRec r;
+  return trackStoreGetLatest(r) ? r.seq : 0;
+}
+
+// ============= WRITE COST =============
+
+static void benchWrites(uint32_t intervalS) {
+  wipeLog();
+  reboot();
+  flashStats = FlashStats();
+
+  const uint32_t fixes = 24 * 3600 / intervalS;
+  const uint32_t serviceEvery = SERVICE_S > intervalS ? SERVICE_S / intervalS : 1;
+  for (uint32_t i = 0; i < fixes; i++) {
+    storeFix(i, intervalS);
+    if (i % serviceEvery == serviceEvery - 1) {
+      trackStoreAckRange(trackStoreGetAckFloor(), newestSeq());   // uploader acked everything sent
+      trackLogService();
+    }
+  }
+
+  size_t segs = 0;
+  size_t onFlash = logBytes(segs);
+  double fixBytes = (double)fixes * sizeof(FixRec);
+  double erasesPerDay = flashStats.erases;
+  double blocks = PARTITION_BYTES / LFS_BLOCK;
+  printf("write cost: %u fixes (one every %u s for 24 h), %u B per fix record, %u B pages\n",
+         (unsigned)fixes, (unsigned)intervalS, (unsigned)sizeof(FixRec), TRACK_LOG_PAGE_BYTES);
+  printf("  appended     %8.2f B per fix byte (%.1f B per fix, ack records included)\n",
+         flashStats.appended / fixBytes, flashStats.appended / (double)fixes);
+  printf("  programmed   %8.2f B per fix byte (model: tail block copy + metadata commit per append)\n",
+         flashStats.programmed / fixBytes);
+  printf("  erases       %8.2f per fix, %.0f per day\n", flashStats.erases / fixes, erasesPerDay);
+  printf("  wear         %8.1f erases per block per day over a %u KB partition, %.1f years to %u cycles\n",
+         erasesPerDay / blocks, PARTITION_BYTES / 1024, FLASH_CYCLES / (erasesPerDay / blocks) / 365, FLASH_CYCLES);
+  printf("  on flash     %8u B in %u segments\n", (unsigned)onFlash, (unsigned)segs);
+  CHECK(segs <= TRACK_LOG_MAX_SEGMENTS, "%u segments on flash", (unsigned)segs);
+}
+
+// ============= RESET =============
+
+static void testReset() {
+  const uint32_t perPage = TRACK_LOG_PAGE_BYTES / (sizeof(FixRec) + 5);
+  const uint32_t perWindow = TRACK_LOG_FLUSH_MS / 1000 / FIX_INTERVAL_S;
+  wipeLog();
+  reboot();
+  for (uint32_t i = 0; i < 100; i++) storeFix(i);
+  trackStoreAckRange(1, 40);
+  trackLogService();
+  for (uint32_t i = 100; i < 137; i++) storeFix(i);
+  uint32_t before = newestSeq();
+
+  // Power lost right after the last push: no flush, no service call
+  reboot();
+  uint32_t lost = before - newestSeq();
+  CHECK(trackStoreSize() == newestSeq(), "reset: gap in the recovered fixes");
+  CHECK(lost <= perPage && lost <= perWindow, "reset: %u fixes lost, more than a page (%u) or %u s (%u)",
+        (unsigned)lost, (unsigned)perPage, (unsigned)(TRACK_LOG_FLUSH_MS / 1000), (unsigned)perWindow);
+  CHECK(trackStoreGetAckFloor() == 41, "reset: ack floor %u, expected 41", (unsigned)trackStoreGetAckFloor());
+  printf("reset: %u of %u fixes recovered without a flush (at most %u are buffered)\n", (unsigned)newestSeq(),
+         (unsigned)before, (unsigned)(perPage < perWindow ? perPage : perWindow));
+
+  // An event fix is on flash at once, with the page before it
+  storeFix(137);
+  storeFix(138, FIX_INTERVAL_S, FL_EVT_MOVE_STOP);
+  before = newestSeq();
+  reboot();
+  CHECK(newestSeq() == before, "reset: event fix %u not on flash (newest %u)", (unsigned)before,
+        (unsigned)newestSeq());
+
+  // Torn write of the newest fix: that one record is lost, the rest replays
+  for (uint32_t i = 139; i < 142; i++) storeFix(i);
+  trackLogFlush();
+  before = newestSeq();
+  std::string seg = newestSegment();
+  FILE* f = fopen(seg.c_str(), "r");
+  fseek(f, 0, SEEK_END);
+  long len = ftell(f);
+  fclose(f);
+  CHECK(truncate(seg.c_str(), len - 7) == 0, "truncate %s", seg.c_str());
+  reboot();
+  CHECK(newestSeq() == before - 1, "torn tail: newest seq %u, expected %u", (unsigned)newestSeq(), (unsigned)(before - 1));
+  printf("reset: an event fix is written at once, a torn last record loses only that fix\n");
+}
+
+// ============= REBOOTS =============
+
+static void testReboots() {
+  const size_t perSeg = fixesPerSegment();
+  wipeLog();
+  reboot();
+  for (uint32_t i = 0; i < 2 * perSeg + perSeg / 2; i++) storeFix(i);
+  trackLogFlush();
+  size_t segs = 0, segsBefore = 0;
+  logBytes(segsBefore);
+  uint32_t before = newestSeq();
+
+  // Reboot loop, one fix per boot: the newest segment is continued
+  for (int boot = 0; boot < 30; boot++) {
+    reboot();
+    storeFix(boot);
+    trackLogFlush();
+  }
+  reboot();
+  logBytes(segs);
+  CHECK(segs == segsBefore, "reboots: %u segments, %u before", (unsigned)segs, (unsigned)segsBefore);
+  CHECK(newestSeq() == before + 30 && trackStoreSize() == newestSeq(), "reboots: %u of %u fixes recovered",
+        (unsigned)trackStoreSize(), (unsigned)(before + 30));
+  printf("reboots: 30 boots, still %u segments, all %u fixes recovered\n", (unsigned)segs, (unsigned)newestSeq());
+
+  // Nothing acked and more written than TRACK_LOG_HARD_SEGMENTS hold: unacked
+  // segments are kept past the soft limit, evicted only at the hard one, and
+  // every fix the store held comes back
+  wipeLog();
+  reboot();
+  for (uint32_t i = 0; i < (TRACK_LOG_HARD_SEGMENTS + 2) * perSeg; i++) storeFix(i);
+  trackLogFlush();
+  before = newestSeq();
+  uint32_t held = trackStoreSize();
+  uint32_t logged = oldestLoggedSeq();
+  logBytes(segs);
+  reboot();
+  CHECK(newestSeq() == before, "full log: newest seq %u, expected %u", (unsigned)newestSeq(), (unsigned)before);
+  CHECK(logged <= before - held + 1, "full log: log starts at seq %u, the store held from %u", (unsigned)logged,
+        (unsigned)(before - held + 1));
+  CHECK(segs == TRACK_LOG_HARD_SEGMENTS, "full log: %u segments, expected %u", (unsigned)segs,
+        TRACK_LOG_HARD_SEGMENTS);
+  printf("full log: %u fixes unacked, %u segments kept (soft limit %u) from seq %u, the store held %u from seq %u\n",
+         (unsigned)before, (unsigned)segs, TRACK_LOG_MAX_SEGMENTS, (unsigned)logged, (unsigned)held,
+         (unsigned)(before - held + 1));
+
+  // Once acked, the next rotation trims the log back to the soft limit
+  trackStoreAckRange(1, before);
+  for (uint32_t i = 0; i < perSeg; i++) storeFix(i);
+  trackLogFlush();
+  logBytes(segs);
+  CHECK(segs <= TRACK_LOG_MAX_SEGMENTS, "acked log: %u segments", (unsigned)segs);
+}
+
+// ============= RECOVERY TIME =============
+
+static void benchRecovery() {
+  static const size_t segCounts[] = { 1, 2, 4, 8, TRACK_LOG_MAX_SEGMENTS };
+  const size_t perSeg = fixesPerSegment();
+  printf("recovery (trackLogInit at boot, host time)\n");
+  printf("  %8s %9s %9s %9s %9s %9s\n", "segments", "log KB", "read KB", "fixes", "ms", "us/KB");
+  for (size_t k = 0; k < sizeof(segCounts) / sizeof(segCounts[0]); k++) {
+    wipeLog();
+    reboot();
+    for (uint32_t i = 0; i < segCounts[k] * perSeg - 2; i++) {
+      storeFix(i);
+      if (i % (SERVICE_S / FIX_INTERVAL_S) == 0) trackLogService();
+    }
+    trackLogFlush();
+    size_t segs = 0;
+    size_t bytes = logBytes(segs);
+
+    const int reps = 20;
+    double ms = 0;
+    for (int r = 0; r < reps; r++) {
+      flashStats.read = 0;
+      initTrackStore(TRACK_CAPACITY);
+      auto t0 = std::chrono::steady_clock::now();
+      trackLogInit();
+      ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    }
+    ms /= reps;
+    printf("  %8u %9.1f %9.1f %9u %9.3f %9.1f\n", (unsigned)segs, bytes / 1024.0, flashStats.read / 1024.0,
+           (unsigned)trackStoreSize(), ms, ms * 1000 / (bytes / 1024.0));
+    CHECK(segs == segCounts[k], "%u segments, expected %u", (unsigned)segs, (unsigned)segCounts[k]);
+  }
+}
+
+int main(int argc, char** argv) {
+  hostVerbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+  char dir[] = "/tmp/log_bench.XXXXXX";
+  if (!mkdtemp(dir)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  LittleFS.root = dir;
+
+  benchWrites(FIX_INTERVAL_S);
+  benchWrites(30);
+  testReset();
+  testReboots();
+  benchRecovery();
+
+  wipeLog();
+  rmdir(dir);
+  if (failures) printf("%d FAILED\n", failures);
+  else printf("all checks passed\n");
+  return failures ? 1 : 0;
+}
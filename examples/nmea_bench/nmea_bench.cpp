@@ -0,0 +1,205 @@
+// Host benchmark: in-tree NMEA parser (src/nmea_parser.cpp) vs TinyGPSPlus
+//
+// Replays corpus.nmea (3 min of 1 Hz GNSS output synthesized in the format of
+// the board's UC6580: GGA/GLL/2xGSA/GSV/RMC/VTG/ZDA/TXT, ~700 B per epoch; not
+// a recording) and reports
+// bytes/s and cycles per sentence for both parsers, plus whether they agree on
+// the positions. The same epochs re-encoded as CASIC NAV-PV + NAV-TIMEUTC
+// frames (GPS_BINARY_PROTOCOL) show the wire bytes and decode time saved.
+//
+// In-tree parser only:
+//   g++ -O2 -std=gnu++11 -Iinclude examples/nmea_bench/nmea_bench.cpp src/nmea_parser.cpp src/gnss_casic.cpp -o nmea_bench
+// With TinyGPSPlus (after `pio run` has fetched it):
+//   TGP=.pio/libdeps/heltec_wifi_lora_32_V4/TinyGPSPlus/src
+//   g++ -O2 -std=gnu++11 -DBENCH_TINYGPS -DARDUINO=100 -Iinclude -Iexamples/nmea_bench/host -I$TGP
+//       examples/nmea_bench/nmea_bench.cpp src/nmea_parser.cpp src/gnss_casic.cpp $TGP/TinyGPS++.cpp -o nmea_bench
+//   ./nmea_bench [examples/nmea_bench/corpus.nmea]
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "nmea_parser.h"
+#include "gnss_casic.h"
+#ifdef BENCH_TINYGPS
+#include <TinyGPS++.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t cycles() { return __rdtsc(); }
+#define HAVE_CYCLES 1
+#else
+static inline uint64_t cycles() { return 0; }
+#define HAVE_CYCLES 0
+#endif
+
+static const int ROUNDS = 200;
+
+struct Result {
+  double seconds;
+  uint64_t cycles;
+  uint32_t fixes;
+  int32_t lastLatE7;
+  int32_t lastLonE7;
+};
+
+static double nowSeconds() {
+  using namespace std::chrono;
+  return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+static Result runInTree(const std::vector<std::string>& lines) {
+  Result r = {};
+  double t0 = nowSeconds();
+  uint64_t c0 = cycles();
+  for (int round = 0; round < ROUNDS; round++) {
+    NmeaParser p;
+    nmeaInit(p);
+    for (const std::string& l : lines) {
+      if (nmeaParse(p, l.data(), l.size()) == NMEA_EV_FIX) {
+        r.fixes++;
+        r.lastLatE7 = p.fix.latE7;
+        r.lastLonE7 = p.fix.lonE7;
+      }
+    }
+  }
+  r.cycles = cycles() - c0;
+  r.seconds = nowSeconds() - t0;
+  return r;
+}
+
+#ifdef BENCH_TINYGPS
+// The firmware's previous path: byte-wise encode, E7 via llround(double * 1e7)
+static Result runTinyGps(const std::vector<std::string>& lines) {
+  Result r = {};
+  double t0 = nowSeconds();
+  uint64_t c0 = cycles();
+  for (int round = 0; round < ROUNDS; round++) {
+    TinyGPSPlus gps;
+    for (const std::string& l : lines) {
+      for (char c : l) gps.encode(c);
+      if (gps.location.isUpdated()) {
+        r.fixes++;
+        r.lastLatE7 = (int32_t)llround(gps.location.lat() * 1e7);
+        r.lastLonE7 = (int32_t)llround(gps.location.lng() * 1e7);
+      }
+    }
+  }
+  r.cycles = cycles() - c0;
+  r.seconds = nowSeconds() - t0;
+  return r;
+}
+#endif
+
+// One NAV-PV + NAV-TIMEUTC pair per RMC epoch of the corpus
+static std::vector<std::string> toBinary(const std::vector<std::string>& lines) {
+  std::vector<std::string> frames;
+  NmeaParser p;
+  nmeaInit(p);
+  for (const std::string& l : lines) {
+    NmeaEvent ev = nmeaParse(p, l.data(), l.size());
+    if (l.compare(3, 3, "RMC") != 0 || (ev != NMEA_EV_FIX && ev != NMEA_EV_NO_FIX)) continue;
+    const NmeaFix& f = p.fix;
+    uint8_t pv[80] = {};
+    pv[4] = f.fixValid ? 7 : 0;
+    pv[5] = f.fixValid ? 7 : 0;
+    pv[7] = f.sats;
+    float pdop = f.pdopX100 / 100.0f, height = f.altCm / 100.0f, speed = f.speedCmS / 100.0f, heading = f.courseCdeg / 100.0f;
+    double lon = f.lonE7 / 1e7, lat = f.latE7 / 1e7;
+    memcpy(pv + 12, &pdop, 4);
+    memcpy(pv + 16, &lon, 8);
+    memcpy(pv + 24, &lat, 8);
+    memcpy(pv + 32, &height, 4);
+    memcpy(pv + 64, &speed, 4);
+    memcpy(pv + 68, &heading, 4);
+    uint8_t tu[24] = {};
+    tu[14] = (uint8_t)f.year;
+    tu[15] = (uint8_t)(f.year >> 8);
+    tu[16] = f.month;
+    tu[17] = f.day;
+    tu[18] = f.hour;
+    tu[19] = f.minute;
+    tu[20] = f.second;
+    tu[21] = 1;
+    uint8_t buf[96];
+    size_t n = casicFrame(CASIC_CLS_NAV, CASIC_ID_NAV_PV, pv, sizeof(pv), buf, sizeof(buf));
+    frames.push_back(std::string((const char*)buf, n));
+    n = casicFrame(CASIC_CLS_NAV, CASIC_ID_NAV_TIMEUTC, tu, sizeof(tu), buf, sizeof(buf));
+    frames.push_back(std::string((const char*)buf, n));
+  }
+  return frames;
+}
+
+static Result runBinary(const std::vector<std::string>& frames) {
+  Result r = {};
+  double t0 = nowSeconds();
+  uint64_t c0 = cycles();
+  for (int round = 0; round < ROUNDS; round++) {
+    NmeaFix fix = {};
+    for (const std::string& f : frames) {
+      if (casicDecode(fix, (const uint8_t*)f.data(), f.size()) == NMEA_EV_FIX) {
+        r.fixes++;
+        r.lastLatE7 = fix.latE7;
+        r.lastLonE7 = fix.lonE7;
+      }
+    }
+  }
+  r.cycles = cycles() - c0;
+  r.seconds = nowSeconds() - t0;
+  return r;
+}
+
+static void report(const char* name, const Result& r, size_t bytes, size_t sentences) {
+  double totalBytes = (double)bytes * ROUNDS;
+  double totalSentences = (double)sentences * ROUNDS;
+  printf("%-12s %8.1f MB/s  %7.0f ns/sentence", name, totalBytes / r.seconds / 1e6, r.seconds * 1e9 / totalSentences);
+  if (HAVE_CYCLES) printf("  %7.0f cycles/sentence", r.cycles / totalSentences);
+  printf("  fixes %u  last %d,%d\n", (unsigned)(r.fixes / ROUNDS), r.lastLatE7, r.lastLonE7);
+}
+
+int main(int argc, char** argv) {
+  const char* path = argc > 1 ? argv[1] : "examples/nmea_bench/corpus.nmea";
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return 1;
+  }
+  std::vector<std::string> lines;
+  std::string cur;
+  size_t bytes = 0;
+  int ch;
+  while ((ch = fgetc(f)) != EOF) {
+    cur.push_back((char)ch);
+    if (ch == '\n') {
+      bytes += cur.size();
+      lines.push_back(cur);
+      cur.clear();
+    }
+  }
+  fclose(f);
+  printf("%s: %zu sentences, %zu bytes, %d rounds\n", path, lines.size(), bytes, ROUNDS);
+
+  Result own = runInTree(lines);
+  report("nmea_parser", own, bytes, lines.size());
+
+  std::vector<std::string> frames = toBinary(lines);
+  size_t binBytes = 0;
+  for (const std::string& f : frames) binBytes += f.size();
+  size_t epochs = frames.size() / 2;
+  Result bin = runBinary(frames);
+  report("casic", bin, binBytes, frames.size());
+  printf("per epoch: NMEA %zu B / %.0f ns, binary %zu B / %.0f ns; wire at 9600 vs 115200 baud: %.1f%% vs %.1f%%\n",
+         bytes / epochs, own.seconds * 1e9 / ROUNDS / epochs, binBytes / epochs, bin.seconds * 1e9 / ROUNDS / epochs,
+         100.0 * bytes / epochs * 10 / 9600, 100.0 * binBytes / epochs * 10 / 115200);
+#ifdef BENCH_TINYGPS
+  Result tiny = runTinyGps(lines);
+  report("TinyGPSPlus", tiny, bytes, lines.size());
+  printf("speedup %.1fx, positions %s\n", tiny.seconds / own.seconds,
+         (tiny.lastLatE7 == own.lastLatE7 && tiny.lastLonE7 == own.lastLonE7) ? "agree" : "DIFFER");
+#endif
+  return 0;
+}
@@ -0,0 +1,55 @@
+// Decodes the shared codec test vectors with the TTN payload formatter
+// (php/payload_formatter.js, FPort 4) and compares with the firmware's decoder
+//
+//   node examples/payload_bench/check_formatter.js examples/payload_bench/vectors.txt
+
+var fs = require("fs");
+var path = require("path");
+var vm = require("vm");
+
+vm.runInThisContext(fs.readFileSync(path.join(__dirname, "../../php/payload_formatter.js"), "utf8"));
+
+// Record the formatter should produce for a decoded fix
+function expected(f) {
+  var out = { ts: f[0], latE7: f[1], lonE7: f[2], bat: f[3], ch: "lora", flags: f[4] };
+  if (f[5] !== 0) out.sats = f[5] >> 4;
+  if ((f[5] & 0x0F) !== 0) out.hdopX10 = (f[5] & 0x0F) * 5;
+  if (f[6] !== 0xFF) out.courseDeg = f[6] * 2;
+  out.speedCmS = f[7];
+  if (f[8] !== -32768) out.altDm = f[8];
+  return out;
+}
+
+function sameRecord(a, b) {
+  var ka = Object.keys(a).sort(), kb = Object.keys(b).sort();
+  if (ka.join() !== kb.join()) return false;
+  return ka.every(function (k) { return a[k] === b[k]; });
+}
+
+var file = process.argv[2] || path.join(__dirname, "vectors.txt");
+var lines = fs.readFileSync(file, "utf8").split("\n");
+var valid = 0, invalid = 0, failures = 0;
+lines.forEach(function (line) {
+  if (line === "" || line[0] === "#") return;
+  var parts = line.split(" ");
+  var bytes = [];
+  for (var i = 0; i < parts[0].length; i += 2) bytes.push(parseInt(parts[0].substr(i, 2), 16));
+  var r = decodeUplink({ bytes: bytes, fPort: 4 });
+  var ok;
+  if (parts[1] === "invalid") {
+    ok = r.errors.length > 0;
+    invalid++;
+  } else {
+    var want = parts[1].split(";").map(function (f) { return expected(f.split(",").map(Number)); });
+    ok = r.errors.length === 0 && r.data.fixes.length === want.length &&
+         want.every(function (w, k) { return sameRecord(w, r.data.fixes[k]); });
+    valid++;
+  }
+  if (!ok) {
+    failures++;
+    console.log("FAIL " + parts[0] + ": " + JSON.stringify(r));
+  }
+});
+console.log("formatter: " + valid + " valid and " + invalid + " invalid frames checked");
+console.log(failures ? failures + " FAILED" : "all checks passed");
+process.exit(failures ? 1 : 0);
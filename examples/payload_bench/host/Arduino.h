@@ -0,0 +1,7 @@
+// Minimal Arduino shim so the payload codec (src/lora_payload.cpp) builds on the host
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
@@ -0,0 +1,572 @@
+// Host tests + airtime comparison: LoRa uplink codec (include/lora_payload.h)
+//
+// Round-trips frames of random and simulated-drive fixes at every coordinate
+// precision and frame size limit, checks that every truncation is rejected,
+// checks when a lone fix takes the single-fix form and how large it is, and
+// fuzzes the decoder with corrupted and random frames: a frame it accepts
+// must be exactly what the encoder makes of the decoded fixes.
+// Then checks the shared test vectors (also decoded by the TTN payload
+// formatter, see check_formatter.js) and compares time on air per fix of
+// the 20-byte v2 uplink with v3 frames on a simulated drive (the corners
+// the LoRa simplifier keeps: 10-40 s and 50-250 m apart).
+//
+//   g++ -O2 -std=gnu++11 -Iexamples/payload_bench/host -Iinclude
+//       examples/payload_bench/payload_bench.cpp src/lora_payload.cpp -o payload_bench
+//   ./payload_bench examples/payload_bench/vectors.txt
+//   node examples/payload_bench/check_formatter.js examples/payload_bench/vectors.txt
+//
+// After a codec change, regenerate the vectors (and bump LORA_FRAME_VERSION):
+//   ./payload_bench --write-vectors examples/payload_bench/vectors.txt
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include "lora_payload.h"
+
+static int failures = 0;
+#define CHECK(cond, ...) do { if (!(cond)) { failures++; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } } while (0)
+
+static uint32_t rngState = 12345;
+static uint32_t rng() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+static int32_t range(int32_t lo, int32_t hi) {
+  return (int32_t)(lo + (int64_t)(rng() % (uint32_t)((int64_t)hi - lo + 1)));
+}
+
+static bool sameFix(const FixRec& a, const FixRec& b) {
+  return a.ts == b.ts && a.latE7 == b.latE7 && a.lonE7 == b.lonE7 && a.bat == b.bat && a.flags == b.flags &&
+         a.dop == b.dop && a.course2 == b.course2 && a.speedCmS == b.speedCmS && a.altDm == b.altDm;
+}
+
+// What a frame of this precision decodes to
+static FixRec quantized(FixRec f, uint8_t precision) {
+  f.seq = 0;
+  f.latE7 = loraQuantizeE7(f.latE7, precision);
+  f.lonE7 = loraQuantizeE7(f.lonE7, precision);
+  return f;
+}
+
+static FixRec randomFix() {
+  FixRec f = {};
+  f.ts = rng();
+  f.latE7 = range(-900000000, 900000000);
+  f.lonE7 = range(-1800000000, 1800000000);
+  f.bat = (uint8_t)rng();
+  f.flags = (uint8_t)rng();
+  f.dop = (uint8_t)rng();
+  f.course2 = (uint8_t)rng();
+  f.speedCmS = (uint16_t)rng();
+  f.altDm = (int16_t)rng();
+  return f;
+}
+
+// Simplified track: corners 10-40 s and 50-250 m apart, slowly changing fields
+static std::vector<FixRec> drive(size_t n) {
+  std::vector<FixRec> v;
+  FixRec f = {};
+  f.seq = 1;
+  f.ts = 1789556556;
+  f.latE7 = 523815728;
+  f.lonE7 = 97252294;
+  f.bat = 87;
+  f.flags = FL_GPS_VALID | FL_MOVE_ACTIVE;
+  f.dop = fixPackDop(90, 11);
+  f.course2 = 80;
+  f.speedCmS = 1200;
+  f.altDm = 552;
+  double brg = 0.3;
+  for (size_t i = 0; i < n; i++) {
+    v.push_back(f);
+    f.seq++;
+    uint32_t dt = (uint32_t)range(10, 40);
+    double m = range(50, 250);
+    brg += range(-60, 60) * M_PI / 180;
+    f.ts += dt;
+    f.latE7 += (int32_t)(m * cos(brg) / 0.0111195);
+    f.lonE7 += (int32_t)(m * sin(brg) / (0.0111195 * 0.61));
+    f.course2 = (uint8_t)(fmod(brg * 180 / M_PI + 720, 360) / 2);
+    f.speedCmS = (uint16_t)(m / dt * 100);
+    f.altDm += (int16_t)range(-30, 30);
+    if (rng() % 4 == 0) f.dop = fixPackDop((uint16_t)range(60, 200), (uint8_t)range(6, 14));
+    if (rng() % 25 == 0) f.bat--;
+    f.flags = FL_GPS_VALID | FL_MOVE_ACTIVE | (rng() % 30 == 0 ? FL_EVT_FENCE : 0);
+  }
+  return v;
+}
+
+// A decoded frame must be the encoder's output for what it decoded to
+static bool canonical(const uint8_t* frame, size_t len, const FixRec* fixes, size_t n) {
+  uint8_t again[256];
+  size_t packed = 0;
+  uint8_t precision = (frame[0] & LORA_FRAME_SINGLE) ? frame[0] >> 5 & 3 : frame[1] & 3;
+  size_t len2 = loraEncodeFrame(fixes, n, precision, again, len, packed);
+  return packed == n && len2 == len && memcmp(again, frame, len) == 0;
+}
+
+// ============= TESTS =============
+
+static void testQuantize() {
+  CHECK(loraQuantizeE7(523815749, 2) == 523815700, "round down");
+  CHECK(loraQuantizeE7(523815750, 2) == 523815800, "half rounds away from zero");
+  CHECK(loraQuantizeE7(-523815750, 2) == -523815800, "negative half rounds away from zero");
+  CHECK(loraQuantizeE7(-523815749, 2) == -523815700, "negative round");
+  CHECK(loraQuantizeE7(1799999999, 3) == 1800000000, "top of range");
+  CHECK(loraQuantizeE7(INT32_MAX, 3) == 1800000000 && loraQuantizeE7(INT32_MIN, 0) == -1800000000, "clamped");
+  for (int i = 0; i < 100000; i++) {
+    int32_t v = range(-1800000000, 1800000000);
+    for (uint8_t p = 0; p < 4; p++) {
+      int32_t q = loraQuantizeE7(v, p);
+      int32_t step = p == 0 ? 1 : p == 1 ? 10 : p == 2 ? 100 : 1000;
+      CHECK(q % step == 0 && 2 * (int64_t)llabs((int64_t)q - v) <= step, "quantize %d at %u: %d", v, p, q);
+    }
+  }
+  printf("quantize: rounding and range checked\n");
+}
+
+static void testRoundTrip() {
+  FixRec in[80], out[LORA_FRAME_MAX_FIXES];
+  uint8_t frame[LORA_FRAME_MAX_BYTES + 1];
+  static const size_t limits[] = {11, 51, 115, 222};
+  size_t frames = 0, cuts = 0;
+  for (int round = 0; round < 20000; round++) {
+    size_t n = 1 + rng() % 80;
+    if (round & 1) {
+      for (size_t i = 0; i < n; i++) in[i] = randomFix();
+    } else {
+      std::vector<FixRec> d = drive(n);
+      for (size_t i = 0; i < n; i++) in[i] = d[i];
+    }
+    uint8_t precision = (uint8_t)(rng() % 4);
+    size_t maxLen = limits[rng() % 4];
+    size_t packed = 0;
+    size_t len = loraEncodeFrame(in, n, precision, frame, maxLen, packed);
+    if (len == 0) {
+      CHECK(packed == 0 && maxLen < 40, "nothing packed into %u bytes", (unsigned)maxLen);
+      continue;
+    }
+    frames++;
+    CHECK(len <= maxLen && packed >= 1 && packed <= n && packed <= LORA_FRAME_MAX_FIXES,
+          "pack %u fixes into %u: %u bytes, %u packed", (unsigned)n, (unsigned)maxLen, (unsigned)len, (unsigned)packed);
+    size_t got = loraDecodeFrame(frame, len, out, LORA_FRAME_MAX_FIXES);
+    CHECK(got == packed, "decode %u of %u", (unsigned)got, (unsigned)packed);
+    for (size_t i = 0; i < got && i < packed; i++) {
+      CHECK(sameFix(quantized(in[i], precision), out[i]), "round trip, fix %u", (unsigned)i);
+    }
+    CHECK(loraDecodeFrame(frame, len, out, packed - 1) == 0, "count larger than maxN accepted");
+    // The next fix did not fit
+    if (packed < n && packed < LORA_FRAME_MAX_FIXES) {
+      size_t more = 0;
+      uint8_t big[1024];
+      size_t bigLen = loraEncodeFrame(in, packed + 1, precision, big, sizeof(big), more);
+      CHECK(more == packed + 1 && bigLen > maxLen, "fix %u would have fit", (unsigned)packed);
+    }
+    for (size_t cut = 0; cut < len; cut++, cuts++) {
+      CHECK(loraDecodeFrame(frame, cut, out, LORA_FRAME_MAX_FIXES) == 0, "truncated to %u of %u accepted",
+            (unsigned)cut, (unsigned)len);
+    }
+    frame[len] = 0;
+    CHECK(loraDecodeFrame(frame, len + 1, out, LORA_FRAME_MAX_FIXES) == 0, "trailing byte accepted");
+  }
+  printf("round trip: %u frames, %u truncations rejected\n", (unsigned)frames, (unsigned)cuts);
+}
+
+static void testFuzz() {
+  FixRec out[LORA_FRAME_MAX_FIXES];
+  uint8_t frame[LORA_FRAME_MAX_BYTES];
+  size_t mutated = 0, random = 0, accepted = 0;
+  for (int round = 0; round < 200000; round++) {
+    size_t len;
+    if (round & 1) {
+      // Valid frame with 1-3 bytes flipped
+      std::vector<FixRec> d = drive(1 + rng() % 20);
+      size_t packed = 0;
+      len = loraEncodeFrame(d.data(), d.size(), (uint8_t)(rng() % 4), frame, sizeof(frame), packed);
+      for (int k = 1 + rng() % 3; k > 0; k--) frame[rng() % len] ^= (uint8_t)(1 + rng() % 255);
+      mutated++;
+    } else if (round & 2) {
+      // Random bytes behind a plausible header
+      len = LORA_FRAME_HEADER_BYTES + rng() % 40;
+      for (size_t i = 0; i < len; i++) frame[i] = (uint8_t)rng();
+      frame[0] = LORA_FRAME_VERSION;
+      frame[1] &= 0x0F;
+      random++;
+    } else {
+      // Random single-fix form
+      len = LORA_SINGLE_HEADER_BYTES + rng() % 13;
+      for (size_t i = 0; i < len; i++) frame[i] = (uint8_t)rng();
+      frame[0] = (uint8_t)((frame[0] & 0x7C) | LORA_FRAME_SINGLE | LORA_FRAME_VERSION);
+      if (frame[0] & LORA_SINGLE_MORE) frame[1] &= 0x0F;
+      random++;
+    }
+    // Exact-size copy so the sanitizers catch any read past the frame
+    std::vector<uint8_t> exact(frame, frame + len);
+    size_t got = loraDecodeFrame(exact.data(), exact.size(), out, LORA_FRAME_MAX_FIXES);
+    if (got == 0) continue;
+    accepted++;
+    CHECK(canonical(exact.data(), len, out, got), "accepted a frame the encoder would not produce");
+  }
+  printf("fuzz: %u corrupted + %u random frames, %u accepted, all canonical\n", (unsigned)mutated,
+         (unsigned)random, (unsigned)accepted);
+}
+
+// Batch form of a lone fix, which the encoder never sends when the
+// single-fix form applies
+static std::vector<uint8_t> batchOfOne(const FixRec& f, uint8_t precision) {
+  const int32_t step = precision == 0 ? 1 : precision == 1 ? 10 : precision == 2 ? 100 : 1000;
+  std::vector<uint8_t> single;
+  single.resize(LORA_FRAME_MAX_BYTES);
+  size_t packed = 0;
+  single.resize(loraEncodeFrame(&f, 1, precision, single.data(), single.size(), packed));
+  const size_t more = (single[0] & LORA_SINGLE_MORE) ? 1 : 0;
+  std::vector<uint8_t> out(single.begin() + 1 + more, single.begin() + 5 + more);
+  out.insert(out.begin(), (uint8_t)precision);
+  out.insert(out.begin(), (uint8_t)LORA_FRAME_VERSION);
+  out.push_back((uint8_t)((single[0] >> 2 & 3) | (more ? single[1] << 2 : 0)));
+  int64_t coords[2] = {loraQuantizeE7(f.latE7, precision) / step, loraQuantizeE7(f.lonE7, precision) / step};
+  for (int k = 0; k < 2; k++) {
+    uint64_t v = ((uint64_t)coords[k] << 1) ^ (uint64_t)(coords[k] >> 63);
+    do {
+      out.push_back((uint8_t)((v & 0x7F) | (v >= 0x80 ? 0x80 : 0)));
+      v >>= 7;
+    } while (v);
+  }
+  out.insert(out.end(), single.begin() + LORA_SINGLE_HEADER_BYTES + more, single.end());
+  return out;
+}
+
+static size_t singleLen(const FixRec& f, uint8_t precision) {
+  uint8_t frame[LORA_FRAME_MAX_BYTES];
+  size_t packed = 0;
+  size_t len = loraEncodeFrame(&f, 1, precision, frame, sizeof(frame), packed);
+  return (frame[0] & (LORA_FRAME_SINGLE | 3)) == (LORA_FRAME_SINGLE | LORA_FRAME_VERSION) ? len : 0;
+}
+
+static void testSingle() {
+  rngState = 99;
+  FixRec f = drive(1)[0];
+  FixRec v1 = {};
+  v1.ts = f.ts;
+  v1.latE7 = f.latE7;
+  v1.lonE7 = f.lonE7;
+  v1.bat = f.bat;
+  v1.course2 = FIX_COURSE_UNKNOWN;
+  v1.altDm = FIX_ALT_UNKNOWN;
+  // Heartbeat: position, battery and flags, no fix quality or motion
+  FixRec beat = v1;
+  beat.flags = FL_GPS_VALID | FL_EVT_HEARTBEAT;
+  // Parked fix with fix quality and altitude, speed 0 and course unknown
+  FixRec parked = beat;
+  parked.dop = f.dop;
+  parked.altDm = f.altDm;
+  printf("single fix at p=2: %u bytes with every field, %u with v1's (ts, lat, lon, bat; v1 13 bytes), "
+         "%u for a heartbeat (+ flags), %u parked (+ dop, altitude)\n",
+         (unsigned)singleLen(f, 2), (unsigned)singleLen(v1, 2), (unsigned)singleLen(beat, 2),
+         (unsigned)singleLen(parked, 2));
+  CHECK(singleLen(v1, 2) != 0 && singleLen(v1, 2) <= 12, "v1 content takes %u bytes", (unsigned)singleLen(v1, 2));
+  CHECK(singleLen(beat, 2) != 0 && singleLen(beat, 2) <= 13, "heartbeat takes %u bytes", (unsigned)singleLen(beat, 2));
+  CHECK(singleLen(f, 2) != 0 && singleLen(f, 2) <= 20, "full fix takes %u bytes", (unsigned)singleLen(f, 2));
+
+  // Where the form applies: 24-bit coordinates, and not longer than the batch form
+  FixRec far = f;
+  far.lonE7 = 1200000000;
+  CHECK(singleLen(far, 2) == 0 && singleLen(far, 3) != 0, "lon 120 degrees: single-fix form at p=3 only");
+  FixRec origin = v1;
+  origin.latE7 = 1000;
+  origin.lonE7 = -1000;
+  CHECK(singleLen(origin, 2) == 0, "near 0,0 the batch form is shorter");
+  FixRec out[2];
+  std::vector<uint8_t> batch = batchOfOne(f, 2);
+  CHECK(loraDecodeFrame(batch.data(), batch.size(), out, 2) == 0, "batch form of a lone fix accepted");
+  for (int i = 0; i < 100000; i++) {
+    FixRec r = randomFix();
+    uint8_t precision = (uint8_t)(rng() % 4);
+    size_t len = singleLen(r, precision);
+    batch = batchOfOne(r, precision);
+    CHECK(len == 0 || len <= batch.size(), "single-fix form %u bytes, batch form %u", (unsigned)len,
+          (unsigned)batch.size());
+  }
+  printf("single fix: form choice and sizes checked\n");
+}
+
+// ============= VECTORS =============
+// One frame per line: hex payload, then the decoded fixes
+// (ts,latE7,lonE7,bat,flags,dop,course2,speedCmS,altDm;...) or "invalid"
+
+static std::string toHex(const uint8_t* p, size_t len) {
+  std::string s;
+  char b[3];
+  for (size_t i = 0; i < len; i++) {
+    snprintf(b, sizeof(b), "%02x", p[i]);
+    s += b;
+  }
+  return s;
+}
+
+static std::string fixesText(const FixRec* f, size_t n) {
+  std::string s;
+  char b[96];
+  for (size_t i = 0; i < n; i++) {
+    snprintf(b, sizeof(b), "%s%u,%d,%d,%u,%u,%u,%u,%u,%d", i ? ";" : "", (unsigned)f[i].ts, (int)f[i].latE7,
+             (int)f[i].lonE7, f[i].bat, f[i].flags, f[i].dop, f[i].course2, f[i].speedCmS, f[i].altDm);
+    s += b;
+  }
+  return s;
+}
+
+static void addVector(FILE* fp, const std::vector<uint8_t>& frame) {
+  FixRec out[LORA_FRAME_MAX_FIXES];
+  size_t n = loraDecodeFrame(frame.data(), frame.size(), out, LORA_FRAME_MAX_FIXES);
+  fprintf(fp, "%s %s\n", toHex(frame.data(), frame.size()).c_str(), n ? fixesText(out, n).c_str() : "invalid");
+}
+
+static std::vector<uint8_t> encode(const std::vector<FixRec>& fixes, uint8_t precision, size_t maxLen = 222) {
+  uint8_t frame[LORA_FRAME_MAX_BYTES];
+  size_t packed = 0;
+  size_t len = loraEncodeFrame(fixes.data(), fixes.size(), precision, frame, maxLen, packed);
+  return std::vector<uint8_t>(frame, frame + len);
+}
+
+static bool writeVectors(const char* path) {
+  FILE* fp = fopen(path, "w");
+  if (!fp) return false;
+  fprintf(fp, "# v3 uplink frames (include/lora_payload.h): hex payload, then the decoded fixes\n");
+  fprintf(fp, "# ts,latE7,lonE7,bat,flags,dop,course2,speedCmS,altDm;... or \"invalid\"\n");
+  fprintf(fp, "# Generated by payload_bench --write-vectors; checked by payload_bench and check_formatter.js\n");
+  rngState = 2024;
+  std::vector<FixRec> d = drive(64);
+  FixRec blank = {};
+  blank.course2 = FIX_COURSE_UNKNOWN;
+  blank.altDm = FIX_ALT_UNKNOWN;
+
+  // Valid: one fix at every precision, all optional fields absent, range edges
+  for (uint8_t p = 0; p < 4; p++) addVector(fp, encode(std::vector<FixRec>(1, d[0]), p));
+  addVector(fp, encode(std::vector<FixRec>(1, blank), 2));
+  FixRec lone = blank;
+  lone.ts = d[0].ts;
+  lone.latE7 = d[0].latE7;
+  lone.lonE7 = d[0].lonE7;
+  lone.bat = d[0].bat;
+  addVector(fp, encode(std::vector<FixRec>(1, lone), 2));
+  FixRec beat = lone;
+  beat.flags = FL_GPS_VALID | FL_EVT_HEARTBEAT;
+  addVector(fp, encode(std::vector<FixRec>(1, beat), 2));              // heartbeat, no v2 fields
+  FixRec south = lone;
+  south.latE7 = -838860700;
+  south.lonE7 = 838860700;
+  addVector(fp, encode(std::vector<FixRec>(1, south), 2));              // int24 edges
+  south.latE7 = -900000000;
+  south.lonE7 = -1800000000;
+  addVector(fp, encode(std::vector<FixRec>(1, south), 3));
+  FixRec edge = blank;
+  edge.latE7 = -900000000;
+  edge.lonE7 = 1800000000;
+  edge.ts = UINT32_MAX;
+  edge.speedCmS = 65535;
+  edge.altDm = -32767;
+  FixRec edge2 = edge;
+  edge2.latE7 = 900000000;
+  edge2.lonE7 = -1800000000;
+  edge2.ts = 0;
+  edge2.speedCmS = 0;
+  edge2.altDm = FIX_ALT_UNKNOWN;
+  edge2.course2 = 179;
+  std::vector<FixRec> edges;
+  edges.push_back(edge);
+  edges.push_back(edge2);
+  edges.push_back(edge);
+  for (uint8_t p = 0; p < 4; p++) addVector(fp, encode(edges, p));
+  // Drives at each precision and data rate limit, and a full 64-fix frame
+  for (uint8_t p = 0; p < 4; p++) {
+    addVector(fp, encode(std::vector<FixRec>(d.begin(), d.begin() + 8), p));
+    addVector(fp, encode(d, p, 51));
+    addVector(fp, encode(d, p, 115));
+  }
+  std::vector<FixRec> parked(64, d[0]);
+  for (size_t i = 0; i < parked.size(); i++) parked[i].ts += (uint32_t)(i * 600);
+  addVector(fp, encode(parked, 2));
+  for (int i = 0; i < 8; i++) {
+    std::vector<FixRec> r;
+    for (int k = 0; k < 1 + i % 4; k++) r.push_back(randomFix());
+    addVector(fp, encode(r, (uint8_t)(i % 4)));
+  }
+
+  // Invalid
+  std::vector<uint8_t> good = encode(std::vector<FixRec>(d.begin(), d.begin() + 3), 2);
+  std::vector<uint8_t> bad;
+  addVector(fp, std::vector<uint8_t>(good.begin(), good.begin() + LORA_FRAME_HEADER_BYTES));
+  addVector(fp, std::vector<uint8_t>(good.begin(), good.end() - 1));       // truncated
+  bad = good; bad.push_back(0); addVector(fp, bad);                        // trailing byte
+  bad = good; bad[0] = 2; addVector(fp, bad);                              // other version
+  bad = good; bad[0] = 4; addVector(fp, bad);
+  bad = good; bad[1] += 4; addVector(fp, bad);                             // one fix more than present
+  bad = good; bad[LORA_FRAME_HEADER_BYTES] |= 0x40; addVector(fp, bad);    // reserved mask bit
+  // Overlong varint: the first fix's latitude with a redundant 0x80 .. 0x00 tail
+  std::vector<uint8_t> one = encode(std::vector<FixRec>(1, blank), 2);
+  bad = one; bad[LORA_FRAME_HEADER_BYTES + 1] |= 0x80; bad.insert(bad.begin() + LORA_FRAME_HEADER_BYTES + 2, 0);
+  addVector(fp, bad);
+  // Present field equal to the previous value (bat 0 before the first fix)
+  bad = one; bad[LORA_FRAME_HEADER_BYTES] = LORA_FIELD_BAT; bad.push_back(0); addVector(fp, bad);
+  // Latitude past 90 degrees: 900000001 E7 at precision 0
+  FixRec north = blank;
+  north.latE7 = 900000000;
+  bad = encode(std::vector<FixRec>(1, north), 0);
+  bad[LORA_FRAME_HEADER_BYTES + 1] += 2;                                   // zigzag +1
+  addVector(fp, bad);
+  // Speed below 0
+  FixRec slow = blank;
+  slow.speedCmS = 1;
+  bad = encode(std::vector<FixRec>(1, slow), 2);
+  bad.back() = 3;                                                          // zigzag -2
+  addVector(fp, bad);
+  bad.back() = 0;                                                          // speed present, unchanged
+  addVector(fp, bad);
+  // Altitude present but still unknown: 0 + (-32768)
+  bad = one;
+  bad[LORA_FRAME_HEADER_BYTES] = LORA_FIELD_ALT;
+  bad.push_back(0xFF); bad.push_back(0xFF); bad.push_back(0x03);
+  addVector(fp, bad);
+  // Single-fix form: truncated, trailing byte, a lone fix in the batch form,
+  // the single-fix form where the batch form is shorter, latitude past 90,
+  // an empty or reserved v2 mask byte, v2 fields without their mask byte
+  good = encode(std::vector<FixRec>(1, d[0]), 2);
+  addVector(fp, std::vector<uint8_t>(good.begin(), good.end() - 1));
+  bad = good; bad.push_back(0); addVector(fp, bad);
+  addVector(fp, batchOfOne(d[0], 2));
+  addVector(fp, batchOfOne(beat, 2));
+  bad = good;
+  for (int k = 6; k < LORA_SINGLE_HEADER_BYTES + 1; k++) bad[k] = 0;
+  addVector(fp, bad);
+  bad = encode(std::vector<FixRec>(1, d[0]), 3);
+  bad[6] = 0x0D; bad[7] = 0xBB; bad[8] = 0xA1;                             // 900001 at precision 3
+  addVector(fp, bad);
+  bad = good; bad[1] = 0; addVector(fp, bad);
+  bad = good; bad[1] |= 0x10; addVector(fp, bad);
+  bad = encode(std::vector<FixRec>(1, beat), 2);
+  bad[0] |= LORA_SINGLE_MORE; bad.insert(bad.begin() + 1, 0); addVector(fp, bad);
+  bad = good; bad[0] &= (uint8_t)~LORA_SINGLE_MORE; bad.erase(bad.begin() + 1); addVector(fp, bad);
+  // Corrupted drive frames, whatever the decoder makes of them
+  for (int i = 0; i < 64; i++) {
+    bad = encode(std::vector<FixRec>(d.begin() + i % 8, d.begin() + i % 8 + 1 + i % 5), (uint8_t)(i % 4));
+    bad[LORA_FRAME_HEADER_BYTES + rng() % (bad.size() - LORA_FRAME_HEADER_BYTES)] ^= (uint8_t)(1 + rng() % 255);
+    addVector(fp, bad);
+  }
+  fclose(fp);
+  return true;
+}
+
+static bool parseHex(const std::string& s, std::vector<uint8_t>& out) {
+  if (s.size() % 2) return false;
+  out.clear();
+  for (size_t i = 0; i < s.size(); i += 2) {
+    unsigned v;
+    if (sscanf(s.c_str() + i, "%2x", &v) != 1) return false;
+    out.push_back((uint8_t)v);
+  }
+  return true;
+}
+
+static void checkVectors(const char* path) {
+  FILE* fp = fopen(path, "r");
+  if (!fp) {
+    failures++;
+    printf("FAIL cannot open %s\n", path);
+    return;
+  }
+  char line[4096];
+  size_t valid = 0, invalid = 0;
+  FixRec out[LORA_FRAME_MAX_FIXES];
+  while (fgets(line, sizeof(line), fp)) {
+    if (line[0] == '#' || line[0] == '\n') continue;
+    std::string s(line);
+    s.erase(s.find_last_not_of("\r\n") + 1);
+    size_t sp = s.find(' ');
+    std::vector<uint8_t> frame;
+    if (sp == std::string::npos || !parseHex(s.substr(0, sp), frame)) {
+      CHECK(false, "bad vector line: %s", s.c_str());
+      continue;
+    }
+    std::string want = s.substr(sp + 1);
+    size_t n = loraDecodeFrame(frame.data(), frame.size(), out, LORA_FRAME_MAX_FIXES);
+    std::string got = n ? fixesText(out, n) : "invalid";
+    CHECK(got == want, "vector %s: decoded %s", s.substr(0, sp).c_str(), got.c_str());
+    if (n) {
+      CHECK(canonical(frame.data(), frame.size(), out, n), "vector %s does not re-encode", s.substr(0, sp).c_str());
+      valid++;
+    } else {
+      invalid++;
+    }
+  }
+  fclose(fp);
+  printf("vectors: %u valid and %u invalid frames checked\n", (unsigned)valid, (unsigned)invalid);
+}
+
+// ============= AIRTIME =============
+
+// LoRa time on air, ms: EU868 125 kHz, CR 4/5, explicit header, CRC, 8 symbol
+// preamble; 13 bytes of LoRaWAN framing (MHDR, FHDR, FPort, MIC)
+static double airtimeMs(int sf, size_t payloadLen) {
+  double tSym = (double)(1 << sf) / 125.0;
+  int de = sf >= 11 ? 1 : 0;
+  double pl = (double)payloadLen + 13;
+  double n = ceil((8 * pl - 4 * sf + 28 + 16) / (4.0 * (sf - 2 * de))) * 5;
+  return (8 + 4.25) * tSym + (8 + (n > 0 ? n : 0)) * tSym;
+}
+
+static void compareAirtime() {
+  std::vector<FixRec> d = drive(10000);
+  struct { int dr, sf; size_t maxLen; } rates[] = {{0, 12, 51}, {2, 10, 51}, {3, 9, 115}, {5, 7, 222}};
+  uint8_t frame[LORA_FRAME_MAX_BYTES];
+  size_t packed = 0;
+  printf("drive: %u simplified fixes; one fix per uplink: v2 20 bytes, v3 %u bytes at p=2\n", (unsigned)d.size(),
+         (unsigned)loraEncodeFrame(d.data() + 1, 1, 2, frame, sizeof(frame), packed));
+  printf("DR SF  max  ms/fix v2 |  p  fixes/frame  bytes/fix  ms/fix  gain\n");
+  for (const auto& r : rates) {
+    double single = airtimeMs(r.sf, 20);
+    for (uint8_t p = 0; p <= 2; p += 2) {
+      size_t at = 0, frames = 0, bytes = 0;
+      double air = 0;
+      while (at < d.size()) {
+        size_t len = loraEncodeFrame(d.data() + at, d.size() - at, p, frame, r.maxLen, packed);
+        bytes += len;
+        air += airtimeMs(r.sf, len);
+        at += packed;
+        frames++;
+      }
+      double batch = air / d.size();
+      printf("%2d %2d  %3u  %9.1f | %2u  %11.1f  %9.1f  %6.1f  %4.1fx\n", r.dr, r.sf, (unsigned)r.maxLen, single,
+             p, (double)d.size() / frames, (double)bytes / d.size(), batch, single / batch);
+      if (p == 2) {
+        CHECK(single / batch > 2.4, "frames gain less than 2.4x at DR%d", r.dr);
+        CHECK(r.maxLen < 222 || (double)bytes / d.size() < 10.5, "more than 10.5 bytes per fix");
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc == 3 && strcmp(argv[1], "--write-vectors") == 0) {
+    if (!writeVectors(argv[2])) {
+      printf("cannot write %s\n", argv[2]);
+      return 1;
+    }
+    printf("wrote %s\n", argv[2]);
+    return 0;
+  }
+  testQuantize();
+  testRoundTrip();
+  testSingle();
+  testFuzz();
+  if (argc > 1) checkVectors(argv[1]);
+  compareAirtime();
+  if (failures) printf("%d FAILED\n", failures);
+  else printf("all checks passed\n");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,124 @@
+// Host harness: PPS-disciplined clock (src/pps_clock.cpp) under synthetic PPS
+// and NMEA jitter
+//
+// A local timer with a crystal error (23.5 ppm plus a slow temperature swing)
+// stands in for esp_timer. PPS edges reach the interrupt 1..15 us late (now
+// and then 60 us), time messages arrive 80..600 ms after their second. Every
+// scenario reads the clock at random moments and compares with the truth,
+// next to the former timebase (TimeLib set from NMEA every 10 min, whole
+// seconds).
+//
+//   g++ -O2 -std=gnu++11 -Iinclude examples/pps_sim/pps_sim.cpp src/pps_clock.cpp -o pps_sim
+//   ./pps_sim
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "pps_clock.h"
+
+static const uint32_t UTC0 = 1791892800;   // 2026-10-13 12:00:00 UTC
+
+// Deterministic noise so runs are comparable
+static uint32_t rngState = 2718;
+static double uniform() {
+  rngState = rngState * 1664525u + 1013904223u;
+  return (rngState >> 8) / 16777216.0;
+}
+
+// Local timer reading at true time t (seconds since start): integrated rate error
+static double localUs(double t) {
+  const double ppm = 23.5, swingPpm = 2.0, period = 3600.0;
+  double integral = ppm * t + swingPpm * period / (2 * M_PI) * (1 - cos(2 * M_PI * t / period));
+  return t * 1e6 + integral + 5e9;          // timer started long before
+}
+
+struct Scenario {
+  const char* name;
+  uint32_t seconds;
+  bool pps;
+  uint32_t outageFrom, outageTo;            // PPS missing (holdover), seconds
+  double missProb;                          // single missed edges
+  double glitchProb;                        // spurious edges between seconds
+};
+
+struct Stats {
+  std::vector<double> err;                  // us, absolute
+  uint32_t byPps = 0, byHoldover = 0, byNmea = 0;
+  double maxClaimRatio = 0;                 // error / claimed uncertainty
+};
+
+static void summarize(const char* name, std::vector<double>& e) {
+  std::sort(e.begin(), e.end());
+  double sum = 0;
+  for (double v : e) sum += v;
+  printf("    %-22s mean %10.1f us  p99 %10.1f us  max %10.1f us\n", name, sum / e.size(),
+         e[(size_t)(0.99 * (e.size() - 1))], e.back());
+}
+
+static void run(const Scenario& s) {
+  PpsClock c;
+  ppsClockReset(c);
+  Stats st, outage;
+  std::vector<double> old;
+  double oldSetLocal = -1;
+  uint32_t oldSetSec = 0;
+
+  for (uint32_t k = 0; k < s.seconds; k++) {
+    double t = k;
+    bool ppsUp = s.pps && !(k >= s.outageFrom && k < s.outageTo) && uniform() >= s.missProb;
+    if (ppsUp) {
+      double late = uniform() < 0.02 ? 60 : 1 + 14 * uniform();
+      ppsClockEdge(c, (int64_t)llround(localUs(t) + late));
+    }
+    if (s.pps && uniform() < s.glitchProb) ppsClockEdge(c, (int64_t)llround(localUs(t + 0.2 + 0.6 * uniform())));
+
+    double arrival = t + 0.08 + 0.52 * uniform();
+    ppsClockLabel(c, UTC0 + k, (int64_t)llround(localUs(arrival)));
+
+    // Former timebase: setTime() with the message's second every 10 min
+    if (k % 600 == 0) {
+      oldSetLocal = localUs(arrival);
+      oldSetSec = UTC0 + k;
+    }
+
+    // A few reads per second at random moments after this message
+    for (int r = 0; r < 3; r++) {
+      double tr = arrival + (1.0 - (arrival - t)) * uniform();
+      int64_t nowUs = (int64_t)llround(localUs(tr));
+      double truth = (UTC0 + t) * 1e6 + (tr - t) * 1e6;
+      ClockTime ct;
+      if (ppsClockRead(c, nowUs, ct)) {
+        double e = fabs((double)ct.utc * 1e6 + ct.us - truth);
+        st.err.push_back(e);
+        if (ct.source == CLOCK_PPS) st.byPps++;
+        else if (ct.source == CLOCK_HOLDOVER) st.byHoldover++;
+        else st.byNmea++;
+        if (ct.uncertaintyUs) st.maxClaimRatio = std::max(st.maxClaimRatio, e / ct.uncertaintyUs);
+        if (k >= s.outageFrom && k < s.outageTo) outage.err.push_back(e);
+      }
+      double oldSec = oldSetSec + floor((nowUs - oldSetLocal) / 1e6);   // now() has whole seconds
+      old.push_back(fabs(oldSec * 1e6 - truth));
+    }
+  }
+
+  printf("%s (%u s): drift %.3f ppm estimated, %u edges, %u glitches rejected, %u relabels\n",
+         s.name, s.seconds, c.driftPpb / 1000.0, c.edges, c.glitches, c.relabels);
+  printf("    reads: %u pps, %u holdover, %u nmea; worst error / claimed uncertainty %.1f\n",
+         st.byPps, st.byHoldover, st.byNmea, st.maxClaimRatio);
+  summarize("disciplined clock", st.err);
+  if (!outage.err.empty()) summarize("... during PPS outage", outage.err);
+  summarize("TimeLib from NMEA", old);
+}
+
+int main() {
+  static const Scenario scenarios[] = {
+    { "PPS + NMEA",                 7200, true,    0,    0, 0.0,   0.0   },
+    { "PPS, missed edges, glitches", 7200, true,    0,    0, 0.02,  0.01  },
+    { "PPS, 20 min outage",         7200, true, 3000, 4200, 0.0,   0.0   },
+    { "NMEA only",                  7200, false,   0,    0, 0.0,   0.0   },
+  };
+  for (const Scenario& s : scenarios) run(s);
+  return 0;
+}
@@ -0,0 +1,226 @@
+// Host simulator: speed-adaptive sampling (src/sample_policy.cpp) vs the former
+// fixed 30 s rate
+//
+// Feeds a 1 Hz track through the policy exactly like gpsSamplerTask does, then
+// rebuilds the track from the stored fixes by linear interpolation in time
+// and measures how far every 1 Hz point is from the rebuilt track.
+//
+//   g++ -O2 -std=gnu++11 -Iinclude examples/sample_sim/sample_sim.cpp src/sample_policy.cpp src/nmea_parser.cpp -o sample_sim
+//   ./sample_sim                     # built-in 2 h drive: parked / city / motorway / rural / parked
+//   ./sample_sim capture.nmea ...    # recorded NMEA tracks (RMC epochs)
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "sample_policy.h"
+#include "nmea_parser.h"
+
+struct Point {
+  uint32_t t;             // seconds
+  int32_t latE7;
+  int32_t lonE7;
+  uint32_t speedCmS;
+  uint16_t courseCdeg;
+  bool hasCourse;
+};
+
+static const double M_PER_DEG = 111319.491;
+
+static double distM(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2) {
+  double kx = cos(lat1 * 1e-7 * M_PI / 180.0);
+  double dx = (lon2 - lon1) * 1e-7 * M_PER_DEG * kx;
+  double dy = (lat2 - lat1) * 1e-7 * M_PER_DEG;
+  return sqrt(dx * dx + dy * dy);
+}
+
+// ============= TRACKS =============
+
+// Deterministic noise so runs are comparable
+static uint32_t rngState = 12345;
+static double uniform() {
+  rngState = rngState * 1664525u + 1013904223u;
+  return (rngState >> 8) / 16777216.0;
+}
+static double gauss() {
+  double u1 = uniform() + 1e-12, u2 = uniform();
+  return sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+struct Leg {
+  const char* name;
+  uint32_t seconds;
+  double speedMs;         // cruise speed, 0 = parked
+  double turnEveryM;      // distance between corners, 0 = none
+  double turnDeg;         // corner size
+  double curveDegPerS;    // slow drift of the heading
+  uint32_t stopEveryS;    // traffic lights: stop for 30 s this often, 0 = never
+};
+
+static std::vector<Point> syntheticDrive() {
+  static const Leg legs[] = {
+    { "parked",   1200,  0.0,   0,  0, 0.0,   0 },
+    { "city",     1500, 11.0, 350, 90, 0.0, 150 },
+    { "motorway", 1500, 33.0,   0,  0, 0.05,  0 },
+    { "rural",     900, 20.0, 900, 40, 0.3,   0 },
+    { "parked",   1200,  0.0,   0,  0, 0.0,   0 },
+  };
+  std::vector<Point> pts;
+  double lat = 52.381461, lon = 9.725351, heading = 30.0, speed = 0;
+  uint32_t t = 0;
+  for (const Leg& leg : legs) {
+    double sinceTurn = 0;
+    double turnSign = 1;
+    for (uint32_t s = 0; s < leg.seconds; s++, t++) {
+      double target = leg.speedMs;
+      if (leg.stopEveryS && (s % leg.stopEveryS) >= leg.stopEveryS - 30) target = 0;
+      speed += std::max(-3.0, std::min(2.0, target - speed));        // accelerate / brake
+      heading += leg.curveDegPerS * sin(t / 120.0);
+      sinceTurn += speed;
+      if (leg.turnEveryM > 0 && sinceTurn >= leg.turnEveryM * (0.6 + 0.8 * uniform())) {
+        heading += turnSign * leg.turnDeg * (0.5 + uniform());
+        turnSign = uniform() < 0.5 ? -1 : 1;
+        sinceTurn = 0;
+      }
+      double rad = heading * M_PI / 180.0;
+      lat += speed * cos(rad) / M_PER_DEG;
+      lon += speed * sin(rad) / (M_PER_DEG * cos(lat * M_PI / 180.0));
+
+      Point p;
+      p.t = t;
+      p.latE7 = (int32_t)llround((lat + 2.0 * gauss() / M_PER_DEG) * 1e7);                    // ~2 m GNSS noise
+      p.lonE7 = (int32_t)llround((lon + 2.0 * gauss() / (M_PER_DEG * cos(lat * M_PI / 180.0))) * 1e7);
+      double measured = std::max(0.0, speed + 0.15 * gauss());
+      p.speedCmS = (uint32_t)(measured * 100);
+      double h = fmod(heading + (measured > 1 ? 2.0 : 60.0) * gauss(), 360.0);
+      p.courseCdeg = (uint16_t)((h < 0 ? h + 360 : h) * 100);
+      p.hasCourse = true;
+      pts.push_back(p);
+    }
+  }
+  return pts;
+}
+
+static std::vector<Point> nmeaTrack(const char* path) {
+  std::vector<Point> pts;
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return pts;
+  }
+  NmeaParser p;
+  nmeaInit(p);
+  char line[256];
+  uint32_t t = 0;
+  while (fgets(line, sizeof(line), f)) {
+    NmeaEvent ev = nmeaParse(p, line, strlen(line));
+    if (ev != NMEA_EV_FIX || strncmp(line + 3, "RMC", 3) != 0) continue;
+    Point pt;
+    pt.t = t++;
+    pt.latE7 = p.fix.latE7;
+    pt.lonE7 = p.fix.lonE7;
+    pt.speedCmS = p.fix.hasSpeed ? p.fix.speedCmS : 0;
+    pt.courseCdeg = p.fix.courseCdeg;
+    pt.hasCourse = p.fix.hasCourse;
+    pts.push_back(pt);
+  }
+  fclose(f);
+  return pts;
+}
+
+// ============= SAMPLERS =============
+
+static std::vector<size_t> sampleAdaptive(const std::vector<Point>& pts) {
+  std::vector<size_t> kept;
+  SamplePolicy policy;
+  samplePolicyReset(policy);
+  for (size_t i = 0; i < pts.size(); i++) {
+    SampleInput in;
+    in.nowS = pts[i].t;
+    in.latE7 = pts[i].latE7;
+    in.lonE7 = pts[i].lonE7;
+    in.speedCmS = pts[i].speedCmS;
+    in.courseCdeg = pts[i].courseCdeg;
+    in.hasCourse = pts[i].hasCourse;
+    if (samplePolicyDue(policy, in) != SAMPLE_NONE) {
+      samplePolicyStored(policy, in);
+      kept.push_back(i);
+    }
+  }
+  return kept;
+}
+
+static std::vector<size_t> sampleFixed(const std::vector<Point>& pts, double everyS) {
+  std::vector<size_t> kept;
+  double next = 0;
+  for (size_t i = 0; i < pts.size(); i++) {
+    if (pts[i].t >= next) {
+      kept.push_back(i);
+      next += everyS;
+    }
+  }
+  return kept;
+}
+
+// ============= RECONSTRUCTION ERROR =============
+
+struct Errors {
+  double mean;
+  double p95;
+  double max;
+};
+
+static Errors reconstruct(const std::vector<Point>& pts, const std::vector<size_t>& kept) {
+  std::vector<double> err;
+  size_t k = 0;
+  for (size_t i = 0; i < pts.size(); i++) {
+    while (k + 1 < kept.size() && kept[k + 1] <= i) k++;
+    const Point& a = pts[kept[k]];
+    const Point& b = pts[k + 1 < kept.size() ? kept[k + 1] : kept[k]];
+    double f = (b.t > a.t && i >= kept[k]) ? (double)(pts[i].t - a.t) / (b.t - a.t) : 0;
+    int32_t lat = (int32_t)(a.latE7 + f * ((double)b.latE7 - a.latE7));
+    int32_t lon = (int32_t)(a.lonE7 + f * ((double)b.lonE7 - a.lonE7));
+    err.push_back(distM(pts[i].latE7, pts[i].lonE7, lat, lon));
+  }
+  std::sort(err.begin(), err.end());
+  Errors e;
+  double sum = 0;
+  for (double v : err) sum += v;
+  e.mean = sum / err.size();
+  e.p95 = err[(size_t)(0.95 * (err.size() - 1))];
+  e.max = err.back();
+  return e;
+}
+
+static void report(const char* name, const std::vector<Point>& pts, const std::vector<size_t>& kept) {
+  double hours = (pts.back().t - pts.front().t + 1) / 3600.0;
+  Errors e = reconstruct(pts, kept);
+  printf("  %-26s %7.0f fixes/h   error mean %6.1f m  p95 %6.1f m  max %7.1f m\n",
+         name, kept.size() / hours, e.mean, e.p95, e.max);
+}
+
+static void run(const char* title, const std::vector<Point>& pts) {
+  if (pts.size() < 2) return;
+  printf("%s: %zu s\n", title, pts.size());
+  std::vector<size_t> adaptive = sampleAdaptive(pts);
+  report("adaptive (sample_policy)", pts, adaptive);
+  report("fixed 30 s", pts, sampleFixed(pts, 30));
+  double equalEvery = (double)pts.size() / adaptive.size();
+  char name[40];
+  snprintf(name, sizeof(name), "fixed %.1f s (same budget)", equalEvery);
+  report(name, pts, sampleFixed(pts, equalEvery));
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    run("synthetic drive", syntheticDrive());
+    return 0;
+  }
+  for (int i = 1; i < argc; i++) {
+    run(argv[i], nmeaTrack(argv[i]));
+  }
+  return 0;
+}
@@ -0,0 +1,7 @@
+// Minimal Arduino shim so the scan kernels (src/track_scan.cpp) build on the host
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
@@ -0,0 +1,197 @@
+// Host benchmark: column scans (src/track_scan.cpp) vs the same loops over FixRec
+//
+// The hot ring used to be an array of FixRec (24 B per record); it is now one
+// array per field, and the scans in track_scan.h read only the columns they
+// need. This runs each kernel over N records in both layouts:
+//  - flag filter (scanFlagsAny)    1 B/rec of columns vs 24 B/rec of records
+//  - in-box test (scanInBox)       8 B/rec vs 24 B/rec
+//  - bounding box (scanBounds)     8 B/rec vs 24 B/rec
+//  - ts count (scanCountTsAtMost)  4 B/rec vs 24 B/rec
+// checks that both layouts give the same answer and reports ns and cycles
+// per record (best of several runs). The FixRec loops are the kernels' own
+// loop bodies and are built at -O3 too, so only the layout differs.
+//
+//   g++ -O2 -std=gnu++11 -Iexamples/scan_bench/host -Iinclude examples/scan_bench/scan_bench.cpp
+//       src/track_scan.cpp -o scan_bench
+//   ./scan_bench [records]     # default 4096, the size measured for the ring rework
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "track_scan.h"
+#include "track_storage.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t cycles() { return __rdtsc(); }
+#define HAVE_CYCLES 1
+#else
+static inline uint64_t cycles() { return 0; }
+#define HAVE_CYCLES 0
+#endif
+
+static int failures = 0;
+#define CHECK(cond, ...) do { if (!(cond)) { failures++; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } } while (0)
+
+static uint32_t rngState = 12345;
+static uint32_t rng() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+// ============= ARRAY OF FIXREC =============
+
+#define AOS __attribute__((noinline, optimize("O3")))
+
+AOS static size_t aosFlagsAny(const FixRec* __restrict r, size_t n, uint8_t mask, uint8_t* __restrict hit) {
+  size_t c = 0;
+  for (size_t i = 0; i < n; i++) {
+    uint8_t h = (r[i].flags & mask) != 0;
+    hit[i] = h;
+    c += h;
+  }
+  return c;
+}
+
+AOS static size_t aosInBox(const FixRec* __restrict r, size_t n, const TrackBox& box, uint8_t* __restrict hit) {
+  const int32_t minLat = box.minLatE7, maxLat = box.maxLatE7;
+  const int32_t minLon = box.minLonE7, maxLon = box.maxLonE7;
+  size_t c = 0;
+  for (size_t i = 0; i < n; i++) {
+    uint8_t h = (r[i].latE7 >= minLat) & (r[i].latE7 <= maxLat) &
+                (r[i].lonE7 >= minLon) & (r[i].lonE7 <= maxLon);
+    hit[i] = h;
+    c += h;
+  }
+  return c;
+}
+
+AOS static void aosBounds(const FixRec* __restrict r, size_t n, TrackBox& box) {
+  int32_t minLat = box.minLatE7, maxLat = box.maxLatE7;
+  int32_t minLon = box.minLonE7, maxLon = box.maxLonE7;
+  for (size_t i = 0; i < n; i++) {
+    minLat = r[i].latE7 < minLat ? r[i].latE7 : minLat;
+    maxLat = r[i].latE7 > maxLat ? r[i].latE7 : maxLat;
+    minLon = r[i].lonE7 < minLon ? r[i].lonE7 : minLon;
+    maxLon = r[i].lonE7 > maxLon ? r[i].lonE7 : maxLon;
+  }
+  box.minLatE7 = minLat;
+  box.maxLatE7 = maxLat;
+  box.minLonE7 = minLon;
+  box.maxLonE7 = maxLon;
+}
+
+AOS static size_t aosCountTsAtMost(const FixRec* __restrict r, size_t n, uint32_t t) {
+  size_t c = 0;
+  for (size_t i = 0; i < n; i++) {
+    c += (r[i].ts <= t);
+  }
+  return c;
+}
+
+// ============= TIMING =============
+
+static volatile size_t sink;
+
+// Best of 7 runs of reps calls, per record
+template <typename F>
+static double timeIt(size_t n, F f, double& cyc) {
+  using namespace std::chrono;
+  size_t reps = (size_t)(20000000 / n) + 1;
+  double best = 1e30;
+  cyc = 1e30;
+  for (int run = 0; run < 7; run++) {
+    steady_clock::time_point t0 = steady_clock::now();
+    uint64_t c0 = cycles();
+    size_t acc = 0;
+    for (size_t k = 0; k < reps; k++) {
+      acc += f();
+      asm volatile("" ::: "memory");   // pure kernels: keep every call
+    }
+    uint64_t c = cycles() - c0;
+    double ns = duration_cast<nanoseconds>(steady_clock::now() - t0).count();
+    sink = acc;
+    if (ns / (reps * n) < best) best = ns / (reps * n);
+    if ((double)c / (reps * n) < cyc) cyc = (double)c / (reps * n);
+  }
+  return best;
+}
+
+static void row(const char* name, double aosNs, double aosCyc, double soaNs, double soaCyc) {
+  if (HAVE_CYCLES) {
+    printf("  %-14s %6.2f ns/rec %6.2f cyc/rec   %6.2f ns/rec %6.2f cyc/rec   %4.1fx\n",
+           name, aosNs, aosCyc, soaNs, soaCyc, aosNs / soaNs);
+  } else {
+    printf("  %-14s %6.2f ns/rec   %6.2f ns/rec   %4.1fx\n", name, aosNs, soaNs, aosNs / soaNs);
+  }
+}
+
+int main(int argc, char** argv) {
+  size_t n = argc > 1 ? (size_t)atoi(argv[1]) : 4096;
+  if (n == 0) n = 4096;
+
+  // A drive around Hannover: ts ascending, a few event flags
+  std::vector<FixRec> recs(n);
+  std::vector<uint32_t> ts(n);
+  std::vector<int32_t> lat(n), lon(n);
+  std::vector<uint8_t> flags(n), hitA(n), hitS(n);
+  int32_t la = 523750000, lo = 97500000;
+  for (size_t i = 0; i < n; i++) {
+    la += (int32_t)(rng() % 2001) - 1000;
+    lo += (int32_t)(rng() % 2001) - 1000;
+    FixRec& r = recs[i];
+    memset(&r, 0, sizeof(r));
+    r.seq = (uint32_t)i + 1;
+    r.ts = 1789556400 + (uint32_t)i * 30;
+    r.latE7 = la;
+    r.lonE7 = lo;
+    r.bat = 80;
+    r.flags = FL_GPS_VALID | (rng() % 50 == 0 ? FL_EVT_MOVE_START : 0);
+    ts[i] = r.ts;
+    lat[i] = r.latE7;
+    lon[i] = r.lonE7;
+    flags[i] = r.flags;
+  }
+  TrackBox box = { 523700000, 523800000, 97450000, 97550000 };
+  uint32_t tMid = recs[n / 2].ts;
+
+  // Same answers from both layouts
+  size_t a = aosFlagsAny(recs.data(), n, FL_EVT_MOVE_START, hitA.data());
+  size_t s = scanFlagsAny(flags.data(), n, FL_EVT_MOVE_START, hitS.data());
+  CHECK(a == s && hitA == hitS, "flag filter: %u vs %u hits", (unsigned)a, (unsigned)s);
+  a = aosInBox(recs.data(), n, box, hitA.data());
+  s = scanInBox(lat.data(), lon.data(), n, box, hitS.data());
+  CHECK(a == s && hitA == hitS, "in-box: %u vs %u hits", (unsigned)a, (unsigned)s);
+  TrackBox ba = trackBoxEmpty(), bs = trackBoxEmpty();
+  aosBounds(recs.data(), n, ba);
+  scanBounds(lat.data(), lon.data(), n, bs);
+  CHECK(memcmp(&ba, &bs, sizeof(ba)) == 0, "bounding box differs");
+  CHECK(aosCountTsAtMost(recs.data(), n, tMid) == scanCountTsAtMost(ts.data(), n, tMid) &&
+        scanCountTsAtMost(ts.data(), n, tMid) == n / 2 + 1, "ts count");
+
+  printf("%u records, FixRec %u B                AoS                           SoA\n",
+         (unsigned)n, (unsigned)sizeof(FixRec));
+  double ac, sc;
+  double an, sn;
+  an = timeIt(n, [&]() { return aosFlagsAny(recs.data(), n, FL_EVT_MOVE_START, hitA.data()); }, ac);
+  sn = timeIt(n, [&]() { return scanFlagsAny(flags.data(), n, FL_EVT_MOVE_START, hitS.data()); }, sc);
+  row("flag filter", an, ac, sn, sc);
+  an = timeIt(n, [&]() { return aosInBox(recs.data(), n, box, hitA.data()); }, ac);
+  sn = timeIt(n, [&]() { return scanInBox(lat.data(), lon.data(), n, box, hitS.data()); }, sc);
+  row("in-box", an, ac, sn, sc);
+  an = timeIt(n, [&]() { TrackBox b = trackBoxEmpty(); aosBounds(recs.data(), n, b); return (size_t)b.maxLatE7; }, ac);
+  sn = timeIt(n, [&]() { TrackBox b = trackBoxEmpty(); scanBounds(lat.data(), lon.data(), n, b); return (size_t)b.maxLatE7; }, sc);
+  row("bounding box", an, ac, sn, sc);
+  an = timeIt(n, [&]() { return aosCountTsAtMost(recs.data(), n, tMid); }, ac);
+  sn = timeIt(n, [&]() { return scanCountTsAtMost(ts.data(), n, tMid); }, sc);
+  row("ts count", an, ac, sn, sc);
+
+  if (failures) printf("%d FAILED\n", failures);
+  else printf("all checks passed\n");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,5 @@
+// Host stand-in for ESP-IDF esp_timer: time_bench provides the function
+#pragma once
+#include <stdint.h>
+
+int64_t esp_timer_get_time();
@@ -0,0 +1,289 @@
+// Host tests + benchmark: time service (src/time_service.cpp)
+//
+// Checks the compile-time DST table against the former date-based
+// gpsIsWinterTime() rules for every hour 2020..2099 and every second around
+// each switch, the local display time across both switches of 2026, and
+// nowUtc() across a resync and the 32-bit fast path limit. Replays the former
+// timestamp pipeline (TimeLib set to UTC + winter hour every 10 min,
+// getTimestampSeconds() subtracting it again) across the same switches, then
+// times one call of each path.
+//
+//   g++ -O2 -std=gnu++11 -Iinclude -Iexamples/time_bench/host examples/time_bench/time_bench.cpp src/time_service.cpp -o time_bench
+//   ./time_bench
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include "time_service.h"
+#include "nmea_parser.h"
+
+// ============= HOST TIMER =============
+
+static bool fakeTimer = true;
+static int64_t fakeUs = 0;
+
+int64_t esp_timer_get_time() {
+  using namespace std::chrono;
+  if (fakeTimer) return fakeUs;
+  static const steady_clock::time_point t0 = steady_clock::now();
+  return duration_cast<microseconds>(steady_clock::now() - t0).count() + 1000000;
+}
+
+static uint32_t hostMillis() {
+  using namespace std::chrono;
+  static const steady_clock::time_point t0 = steady_clock::now();
+  return (uint32_t)duration_cast<milliseconds>(steady_clock::now() - t0).count();
+}
+
+static int failures = 0;
+#define CHECK(cond, ...) do { if (!(cond)) { failures++; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } } while (0)
+
+// ============= REFERENCE =============
+
+struct Civil {
+  uint16_t year;
+  uint8_t month, day, hour, minute, second;
+};
+
+static Civil civilFromUtc(uint32_t t) {
+  int32_t z = (int32_t)(t / 86400) + 719468;
+  int32_t era = z / 146097;
+  int32_t doe = z - era * 146097;
+  int32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  int32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  int32_t mp = (5 * doy + 2) / 153;
+  Civil c;
+  c.day = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+  c.month = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+  c.year = (uint16_t)(yoe + era * 400 + (c.month <= 2 ? 1 : 0));
+  uint32_t s = t % 86400;
+  c.hour = (uint8_t)(s / 3600);
+  c.minute = (uint8_t)(s / 60 % 60);
+  c.second = (uint8_t)(s % 60);
+  return c;
+}
+
+static uint32_t utcFromCivil(uint16_t y, uint8_t mo, uint8_t d, uint8_t h, uint8_t mi, uint8_t s) {
+  int32_t yy = (int32_t)y - (mo <= 2 ? 1 : 0);
+  int32_t era = yy / 400;
+  int32_t yoe = yy - era * 400;
+  int32_t doy = (153 * ((mo + 9) % 12) + 2) / 5 + d - 1;
+  int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return (uint32_t)(era * 146097 + doe - 719468) * 86400UL + h * 3600UL + mi * 60UL + s;
+}
+
+// The former gpsIsWinterTime() rules, from the UTC date (uncached)
+static bool oldIsWinter(uint16_t y, uint8_t m, uint8_t d, uint8_t h) {
+  auto isLeap = [](uint16_t year) { return ((year % 4 == 0) && (year % 100 != 0)) || (year % 400 == 0); };
+  auto daysInMonth = [&](uint16_t year, uint8_t month) {
+    static const uint8_t days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    return month == 2 ? (uint8_t)(isLeap(year) ? 29 : 28) : days[month - 1];
+  };
+  auto calcDayOfWeek = [](uint16_t year, uint8_t month, uint8_t day) {
+    static const uint8_t t[] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+    if (month < 3) year -= 1;
+    return (uint8_t)((year + year / 4 - year / 100 + year / 400 + t[month - 1] + day) % 7);
+  };
+  auto lastSunday = [&](uint16_t year, uint8_t month) {
+    uint8_t dim = daysInMonth(year, month);
+    for (int day = dim; day >= 1; --day) {
+      if (calcDayOfWeek(year, month, (uint8_t)day) == 0) return (uint8_t)day;
+    }
+    return dim;
+  };
+  bool isSummer;
+  if (m < 3 || m > 10) isSummer = false;
+  else if (m > 3 && m < 10) isSummer = true;
+  else if (m == 3) { uint8_t ls = lastSunday(y, 3); isSummer = d > ls || (d == ls && h >= 1); }
+  else { uint8_t ls = lastSunday(y, 10); isSummer = d < ls || (d == ls && h < 1); }
+  return !isSummer;
+}
+
+static bool oldIsWinter(uint32_t utc) {
+  Civil c = civilFromUtc(utc);
+  return oldIsWinter(c.year, c.month, c.day, c.hour);
+}
+
+// ============= TESTS =============
+
+static void testTable() {
+  uint32_t from = utcFromCivil(2020, 1, 1, 0, 0, 0), to = utcFromCivil(2100, 1, 1, 0, 0, 0);
+  uint32_t hours = 0, switches = 0;
+  for (uint32_t t = from; t < to; t += 3600) {
+    hours++;
+    CHECK(isSummerTime(t) == !oldIsWinter(t), "hour %u", t);
+    if (isSummerTime(t) != isSummerTime(t - 3600)) {
+      switches++;
+      for (uint32_t s = t - 7200; s < t + 7200; s++) {
+        if (isSummerTime(s) != !oldIsWinter(s)) { CHECK(false, "second %u", s); break; }
+      }
+    }
+  }
+  CHECK(switches == 2 * TIME_DST_YEARS, "%u switches", switches);
+  CHECK(!isSummerTime(0) && !isSummerTime(utcFromCivil(2019, 7, 1, 0, 0, 0)) &&
+        !isSummerTime(utcFromCivil(2100, 7, 1, 0, 0, 0)), "outside the table");
+  printf("DST table: %u hours 2020..2099 and +-2 h around %u switches match the former rules\n", hours, switches);
+}
+
+static void expectLocal(uint16_t y, uint8_t mo, uint8_t d, uint8_t h, uint8_t mi, uint8_t s,
+                        uint8_t lh, uint8_t lmi, uint8_t ls, bool summer) {
+  LocalTime lt;
+  localTimeOfDay(utcFromCivil(y, mo, d, h, mi, s), lt);
+  CHECK(lt.hour == lh && lt.minute == lmi && lt.second == ls && lt.summer == summer,
+        "%04u-%02u-%02u %02u:%02u:%02u UTC -> %02u:%02u:%02u %s", y, mo, d, h, mi, s,
+        lt.hour, lt.minute, lt.second, lt.summer ? "CEST" : "CET");
+}
+
+static void testLocal() {
+  expectLocal(2026, 3, 29, 0, 59, 59, 1, 59, 59, false);
+  expectLocal(2026, 3, 29, 1, 0, 0, 3, 0, 0, true);
+  expectLocal(2026, 10, 25, 0, 59, 59, 2, 59, 59, true);
+  expectLocal(2026, 10, 25, 1, 0, 0, 2, 0, 0, false);
+  expectLocal(2026, 12, 31, 23, 30, 0, 0, 30, 0, false);     // local date already 2027
+  expectLocal(2026, 6, 30, 22, 15, 0, 0, 15, 0, true);
+  printf("Local time: both 2026 switches and midnight wrap as expected\n");
+}
+
+static void testNow() {
+  fakeTimer = true;
+  timeServiceClear();
+  fakeUs = 5000000;
+  CHECK(nowUtc() == 0 && !timeIsSet(), "unset");
+
+  uint32_t t0 = utcFromCivil(2026, 10, 25, 0, 59, 58);
+  timeServiceSync(t0, 250000, fakeUs);
+  uint16_t ms;
+  CHECK(nowUtcMs(ms) == t0 && ms == 250, "at sync: %u ms", ms);
+  fakeUs += 1750000;                                  // 00:59:59.999 + 1 ms
+  CHECK(nowUtcMs(ms) == t0 + 2 && ms == 0, "second boundary: %u ms", ms);
+
+  // Resync 3 ms behind: follows the clock
+  timeServiceSync(t0 + 2, 997000, fakeUs);
+  CHECK(nowUtcMs(ms) == t0 + 2 && ms == 997, "resync: %u ms", ms);
+
+  // No update for longer than the 32-bit fast path covers
+  int64_t base = fakeUs - 997000 - 1000000;
+  static const int64_t gaps[] = { 4294, 4295, 86400, 40LL * 86400 };
+  for (int64_t dt : gaps) {
+    fakeUs = base + dt * 1000000 + 123456;
+    CHECK(nowUtcMs(ms) == t0 + 1 + (uint32_t)dt && ms == 123, "free-running %lld s: %u ms", (long long)dt, ms);
+  }
+  timeServiceSync(1000, 0, fakeUs);                   // not a GNSS time: ignored
+  CHECK(nowUtc() > t0, "bogus sync ignored");
+  printf("nowUtc: sync, resync and free-running past the 32-bit range as expected\n");
+}
+
+// Former pipeline: TimeLib holds UTC + winter hour, set every 10 min from the
+// fix; getTimestampSeconds() subtracts the winter hour of the current fix
+static void replayOld(uint32_t sw, const char* name) {
+  uint32_t wrong = 0, backwards = 0, newWrong = 0;
+  uint32_t prevOld = 0, prevNew = 0, setLocal = 0, setAt = 0;
+  fakeTimer = true;
+  timeServiceClear();
+  for (uint32_t t = sw - 3600 + 420; t < sw + 3600; t++) {     // last 10 min set before the switch at 00:57
+    fakeUs = (int64_t)(t - (sw - 3600)) * 1000000 + 1000000;
+    if ((t - (sw - 3600 + 420)) % 600 == 0) {
+      setLocal = t + (oldIsWinter(t) ? 3600 : 0);
+      setAt = t;
+    }
+    uint32_t oldTs = setLocal + (t - setAt) - (oldIsWinter(t) ? 3600 : 0);
+    timeServiceSync(t, 0, fakeUs);
+    uint32_t newTs = nowUtc();
+    if (oldTs != t) wrong++;
+    if (prevOld && oldTs < prevOld) backwards++;
+    if (newTs != t || (prevNew && newTs < prevNew)) newWrong++;
+    prevOld = oldTs;
+    prevNew = newTs;
+  }
+  printf("%s switch, 2 h replay: former timestamps %u s off by an hour (%u backward steps), time service %u\n",
+         name, wrong, backwards, newWrong);
+  CHECK(newWrong == 0, "time service wrong around %s switch", name);
+}
+
+// ============= BENCHMARK =============
+
+// Former path: gpsGetFix() seqlock copy + gpsIsWinterTime() (date cache hit)
+// + TimeLib now()
+static NmeaFix sharedFix;
+static std::atomic<uint32_t> fixVersion{0};
+static uint32_t sysTime = 0, prevMillis = 0;
+static uint16_t cachedYear;
+static uint8_t cachedMonth, cachedDay;
+static bool cachedWinter;
+
+static uint32_t timeLibNow() {
+  while (hostMillis() - prevMillis >= 1000) {
+    sysTime++;
+    prevMillis += 1000;
+  }
+  return sysTime;
+}
+
+static uint32_t oldTimestamp() {
+  NmeaFix fix;
+  while (true) {
+    uint32_t v = fixVersion.load(std::memory_order_acquire);
+    if (v & 1) continue;
+    fix = sharedFix;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (fixVersion.load(std::memory_order_relaxed) == v) break;
+  }
+  bool winter;
+  if (fix.year == cachedYear && fix.month == cachedMonth && fix.day == cachedDay) {
+    winter = cachedWinter;
+  } else {
+    winter = oldIsWinter(fix.year, fix.month, fix.day, fix.hour);
+    cachedYear = fix.year;
+    cachedMonth = fix.month;
+    cachedDay = fix.day;
+    cachedWinter = winter;
+  }
+  uint32_t t = timeLibNow();
+  return t > 100000 ? t - (winter ? 3600 : 0) : hostMillis() / 1000;
+}
+
+template <typename F>
+static double nsPerCall(F f, uint32_t n) {
+  using namespace std::chrono;
+  volatile uint32_t sink = 0;
+  steady_clock::time_point a = steady_clock::now();
+  for (uint32_t i = 0; i < n; i++) sink = sink + f(i);
+  return duration_cast<nanoseconds>(steady_clock::now() - a).count() / (double)n;
+}
+
+static void bench() {
+  const uint32_t n = 20000000;
+  uint32_t t0 = utcFromCivil(2026, 10, 13, 12, 0, 0);
+  fakeTimer = false;
+  timeServiceSync(t0, 0, esp_timer_get_time());
+  Civil c = civilFromUtc(t0);
+  sharedFix.hasTime = sharedFix.hasDate = true;
+  sharedFix.year = c.year; sharedFix.month = c.month; sharedFix.day = c.day; sharedFix.hour = c.hour;
+  sysTime = t0 + 3600;
+  prevMillis = hostMillis();
+
+  double tNew = nsPerCall([](uint32_t) { return nowUtc(); }, n);
+  double tOld = nsPerCall([](uint32_t) { return oldTimestamp(); }, n);
+  double tSummer = nsPerCall([t0](uint32_t i) { return (uint32_t)isSummerTime(t0 + i * 1597); }, n);
+  double tOldDate = nsPerCall([t0](uint32_t i) { return (uint32_t)oldIsWinter(t0 + i * 1597); }, n / 4);
+  double tTimer = nsPerCall([](uint32_t) { return (uint32_t)esp_timer_get_time(); }, n);
+  double tMillis = nsPerCall([](uint32_t) { return hostMillis(); }, n);
+  printf("Per call (host): nowUtc %.1f ns, former timestamp path %.1f ns\n", tNew, tOld);
+  printf("    without the timer read: nowUtc %.1f ns, former %.1f ns\n", tNew - tTimer, tOld - tMillis);
+  printf("                 isSummerTime %.1f ns, former winter rule on a date change %.1f ns (incl. calendar split)\n",
+         tSummer, tOldDate);
+}
+
+int main() {
+  testTable();
+  testLocal();
+  testNow();
+  replayOld(utcFromCivil(2026, 3, 29, 1, 0, 0), "March");
+  replayOld(utcFromCivil(2026, 10, 25, 1, 0, 0), "October");
+  bench();
+  if (failures) printf("%d FAILED\n", failures);
+  else printf("all checks passed\n");
+  return failures ? 1 : 0;
+}
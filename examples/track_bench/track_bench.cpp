@@ -0,0 +1,619 @@
+// Host benchmark: track store under contention (include/track_storage.h)
+//
+// Runs N producer and M consumer threads against
+//  - the lock-free store (src/track_storage.cpp): per-slot seqlock hot ring,
+//    readers walk it with a TrackCursor and never block the writer
+//  - a std::mutex ring of the old layout (vector<FixRec>, head/count, one
+//    lock around every call, linear getBatch scan), kept here as reference
+// and reports push/read throughput and latency percentiles per call.
+//
+// Then sweeps the store over capacities from 1k to 100k records (single
+// thread) and reports the cost of push, lease (acquire + release of a batch,
+// in the hot ring and from the archive), ack (trackStoreAckRange of a batch)
+// and trackStoreGetBatch's bisect, plus the heap initTrackStore allocates.
+//
+// Last, feeds recorded NMEA tracks through the store, one fix per epoch (or
+// per --every N epochs), and reports the archive's bytes per fix from
+// trackStoreGetStats(); archived fixes must read back unchanged.
+//
+// The default run also checks trackStoreRange() against a plain scan of what
+// was pushed, for windows in the hot ring, in the archive, across both, and
+// past either end of the store.
+//
+// The lock-free ring has a single producer contract (the sampler task). With
+// more than one producer the pushes are serialized by a producer-side
+// std::mutex, which readers never touch; that is what a second writer on the
+// device would have to do.
+//
+// Producers push back to back, far above the firmware's rate (one fix every
+// 2 s at most), so the numbers show the cost of the synchronization, not of
+// the workload. Push latency includes building the record and, with several
+// producers, waiting for the producer lock; every latency includes two
+// steady_clock reads (~20-40 ns). On a single core the max column is
+// dominated by preemption.
+//
+//   g++ -O2 -std=gnu++11 -pthread -Iexamples/track_bench/host -Iinclude
+//       examples/track_bench/track_bench.cpp src/track_storage.cpp src/track_scan.cpp src/nmea_parser.cpp
+//       -o track_bench
+//   ./track_bench                 # default matrix, 0.5 s per run, archive of corpus.nmea
+//   ./track_bench --every 5 track.nmea ...   # archive of NMEA logs, every 5th epoch
+//   ./track_bench -p 2 -c 3 -s 2  # one run: 2 producers, 3 consumers, 2 s
+//   ./track_bench -v              # -v prints the store's Serial output to stderr
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+#include "track_storage.h"
+#include "gps_sampler.h"
+#include "nmea_parser.h"
+
+bool hostVerbose = false;
+HostSerial Serial;
+
+static int failures = 0;
+#define CHECK(cond, ...) do { if (!(cond)) { failures++; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } } while (0)
+
+typedef std::chrono::steady_clock Clock;
+
+// Heap accounting for the capacity sweep: counts what is allocated while set
+static bool countAlloc = false;
+static size_t allocBytes = 0;
+
+void* operator new(size_t n) {
+  if (countAlloc) allocBytes += n;
+  void* p = malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+  free(p);
+}
+
+static inline uint64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+// ============= OLD LAYOUT: MUTEX RING =============
+
+// The track store before the lock-free rewrite, with the FreeRTOS mutex
+// replaced by std::mutex
+class MutexRing {
+public:
+  void init(size_t capacity) {
+    cap = capacity;
+    ring.assign(capacity, FixRec{});
+    head = 0;
+    count = 0;
+    nextSeq = 1;
+  }
+
+  bool push(FixRec& rec) {
+    std::lock_guard<std::mutex> lock(mtx);
+    rec.seq = nextSeq++;
+    ring[head] = rec;
+    head = (head + 1) % cap;
+    if (count < cap) count++;
+    return true;
+  }
+
+  bool getLatest(FixRec& out) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (count == 0) return false;
+    out = ring[(head + cap - 1) % cap];
+    return true;
+  }
+
+  size_t getBatch(FixRec* outBuf, size_t maxN, uint32_t afterTs) {
+    std::lock_guard<std::mutex> lock(mtx);
+    size_t n = 0;
+    size_t idx = (head + cap - count) % cap;
+    for (size_t i = 0; i < count && n < maxN; i++) {
+      if (ring[idx].ts > afterTs) outBuf[n++] = ring[idx];
+      idx = (idx + 1) % cap;
+    }
+    return n;
+  }
+
+private:
+  std::vector<FixRec> ring;
+  size_t cap = 0;
+  size_t head = 0;
+  size_t count = 0;
+  uint32_t nextSeq = 1;
+  std::mutex mtx;
+};
+
+static MutexRing mutexRing;
+
+// ============= WORKLOAD =============
+
+#define READ_BATCH 16   // records per consumer call, like a LoRa/uploader batch step
+
+struct Stats {
+  std::vector<uint32_t> lat;  // ns per call
+  uint64_t records = 0;       // records pushed or read
+  uint64_t dropped = 0;       // records a reader lost to the writer
+};
+
+static std::atomic<bool> running(false);
+static std::atomic<uint32_t> clockTs(1);  // shared fake epoch, one tick per push
+static std::mutex producerLock;           // serializes producers of the lock-free ring
+
+static FixRec makeFix(uint32_t ts) {
+  FixRec r;
+  memset(&r, 0, sizeof(r));
+  r.ts = ts;
+  r.latE7 = 523750000 + (int32_t)(ts % 1000) * 13;
+  r.lonE7 = 97500000 - (int32_t)(ts % 777) * 17;
+  r.bat = 80;
+  r.flags = FL_GPS_VALID | FL_MOVE_ACTIVE;
+  r.dop = 0x92;
+  r.course2 = (uint8_t)(ts % 180);
+  r.speedCmS = 1200;
+  r.altDm = 550;
+  return r;
+}
+
+static void recordLat(Stats& s, uint64_t t0) {
+  s.lat.push_back((uint32_t)std::min<uint64_t>(nowNs() - t0, UINT32_MAX));
+}
+
+static void producerLockFree(Stats& s, bool serialize) {
+  while (running.load(std::memory_order_relaxed)) {
+    uint64_t t0 = nowNs();
+    if (serialize) {
+      // Take the timestamp under the lock too, or pushes reach the store out of order
+      std::lock_guard<std::mutex> lock(producerLock);
+      FixRec r = makeFix(clockTs.fetch_add(1, std::memory_order_relaxed));
+      trackStorePush(r);
+    } else {
+      FixRec r = makeFix(clockTs.fetch_add(1, std::memory_order_relaxed));
+      trackStorePush(r);
+    }
+    recordLat(s, t0);
+    s.records++;
+  }
+}
+
+static void consumerLockFree(Stats& s) {
+  TrackCursor cur;
+  FixRec buf[READ_BATCH];
+  FixRec latest;
+  while (running.load(std::memory_order_relaxed)) {
+    uint64_t t0 = nowNs();
+    size_t n = trackStoreRead(cur, buf, READ_BATCH);
+    trackStoreGetLatest(latest);
+    recordLat(s, t0);
+    s.records += n;
+    if (n == 0) std::this_thread::yield();
+  }
+  s.dropped = cur.dropped;
+}
+
+static void producerMutex(Stats& s) {
+  while (running.load(std::memory_order_relaxed)) {
+    uint64_t t0 = nowNs();
+    FixRec r = makeFix(clockTs.fetch_add(1, std::memory_order_relaxed));
+    mutexRing.push(r);
+    recordLat(s, t0);
+    s.records++;
+  }
+}
+
+static void consumerMutex(Stats& s) {
+  FixRec buf[READ_BATCH];
+  FixRec latest;
+  uint32_t afterTs = 0;
+  while (running.load(std::memory_order_relaxed)) {
+    uint64_t t0 = nowNs();
+    size_t n = mutexRing.getBatch(buf, READ_BATCH, afterTs);
+    mutexRing.getLatest(latest);
+    recordLat(s, t0);
+    s.records += n;
+    if (n) afterTs = buf[n - 1].ts;
+    else std::this_thread::yield();
+  }
+}
+
+// ============= REPORT =============
+
+static uint32_t pct(const std::vector<uint32_t>& v, double p) {
+  if (v.empty()) return 0;
+  size_t i = (size_t)(p / 100.0 * (v.size() - 1) + 0.5);
+  return v[i];
+}
+
+static void report(const char* ring, const char* role, std::vector<Stats>& st, double secs) {
+  std::vector<uint32_t> all;
+  uint64_t records = 0, dropped = 0;
+  for (size_t i = 0; i < st.size(); i++) {
+    all.insert(all.end(), st[i].lat.begin(), st[i].lat.end());
+    records += st[i].records;
+    dropped += st[i].dropped;
+  }
+  std::sort(all.begin(), all.end());
+  printf("  %-9s %-4s %9.2f Mcall/s %9.2f Mrec/s  p50 %6u  p99 %7u  p99.9 %8u  max %9u ns",
+         ring, role, all.size() / secs / 1e6, records / secs / 1e6,
+         pct(all, 50), pct(all, 99), pct(all, 99.9), all.empty() ? 0 : all.back());
+  if (dropped) printf("  (%llu dropped)", (unsigned long long)dropped);
+  printf("\n");
+}
+
+template <typename P, typename C>
+static void runOne(const char* ring, int producers, int consumers, double secs, P prod, C cons) {
+  std::vector<Stats> ps(producers), cs(consumers);
+  for (size_t i = 0; i < ps.size(); i++) ps[i].lat.reserve(1 << 22);
+  for (size_t i = 0; i < cs.size(); i++) cs[i].lat.reserve(1 << 20);
+  std::vector<std::thread> th;
+  running.store(true);
+  for (int i = 0; i < producers; i++) th.push_back(std::thread(prod, std::ref(ps[i])));
+  for (int i = 0; i < consumers; i++) th.push_back(std::thread(cons, std::ref(cs[i])));
+  std::this_thread::sleep_for(std::chrono::microseconds((long)(secs * 1e6)));
+  running.store(false);
+  for (size_t i = 0; i < th.size(); i++) th[i].join();
+  report(ring, "push", ps, secs);
+  report(ring, "read", cs, secs);
+}
+
+static void run(int producers, int consumers, double secs) {
+  printf("%d producer(s), %d consumer(s), %.1f s, capacity %u\n", producers, consumers, secs, (unsigned)TRACK_CAPACITY);
+
+  initTrackStore(TRACK_CAPACITY);
+  clockTs.store(1);
+  bool serialize = producers > 1;
+  runOne("lock-free", producers, consumers, secs,
+         [serialize](Stats& s) { producerLockFree(s, serialize); }, consumerLockFree);
+
+  // Every record the store handed out must be one that was pushed, in order
+  TrackCursor cur;
+  FixRec buf[READ_BATCH];
+  uint32_t prevSeq = 0;
+  uint32_t prevTs = 0;
+  bool ordered = true;
+  size_t n;
+  while ((n = trackStoreRead(cur, buf, READ_BATCH)) > 0) {
+    for (size_t i = 0; i < n; i++) {
+      FixRec want = makeFix(buf[i].ts);
+      want.seq = buf[i].seq;
+      ordered &= buf[i].seq > prevSeq && buf[i].ts >= prevTs && buf[i].latE7 == want.latE7 && buf[i].lonE7 == want.lonE7;
+      prevSeq = buf[i].seq;
+      prevTs = buf[i].ts;
+    }
+  }
+  CHECK(ordered, "lock-free store returned torn or out-of-order records");
+
+  mutexRing.init(TRACK_CAPACITY);
+  clockTs.store(1);
+  runOne("mutex", producers, consumers, secs, producerMutex, consumerMutex);
+}
+
+// ============= CAPACITY SWEEP =============
+
+#define SWEEP_OPS   100000
+#define SWEEP_BATCH 32      // records per lease/ack/batch, like an upload step
+
+static uint32_t rngState = 12345;
+static uint32_t rng() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+template <typename F>
+static double nsPerOp(F f, size_t n) {
+  uint64_t t0 = nowNs();
+  size_t acc = 0;
+  for (size_t i = 0; i < n; i++) acc += f(i);
+  double ns = (double)(nowNs() - t0) / n;
+  volatile size_t sink = acc;
+  (void)sink;
+  return ns;
+}
+
+static void sweep() {
+  static const size_t caps[] = { 1000, 4000, 16000, 50000, 100000 };
+  printf("\ncapacity sweep (%u records per lease/ack/batch, ns per call)\n", (unsigned)SWEEP_BATCH);
+  printf("  %7s %7s %9s %9s %9s %9s %9s %9s %9s\n",
+         "asked", "ring", "heap KB", "B/rec", "push", "lease", "lease-arc", "ack", "getBatch");
+  size_t prevHeap = 0, prevCap = 0;
+  for (size_t k = 0; k < sizeof(caps) / sizeof(caps[0]); k++) {
+    size_t ring = 1;
+    while (ring < caps[k]) ring <<= 1;    // initTrackStore rounds up to a power of two
+    countAlloc = true;
+    allocBytes = 0;
+    initTrackStore(caps[k]);
+    countAlloc = false;
+    size_t heap = allocBytes;
+
+    // Fill the ring twice, so pushes wrap and seal archive blocks as on the device
+    size_t pushes = 2 * caps[k] + 2 * TRACK_ARCHIVE_BLOCKS * TRACK_BLOCK_MAX_FIXES;
+    double push = nsPerOp([](size_t i) { FixRec r = makeFix((uint32_t)i + 1); return (size_t)trackStorePush(r); }, pushes);
+
+    FixRec latest;
+    trackStoreGetLatest(latest);
+    uint32_t newest = latest.seq;
+    uint32_t oldest = trackStoreGetOldestTs();   // ts == seq here
+    uint32_t hotOldest = newest - (uint32_t)ring / 2;   // newest half of the hot ring
+    bool archived = newest - oldest + 1 > ring;        // archive reaches past the hot ring
+
+    double lease = nsPerOp([&](size_t) {
+      TrackLease l;
+      uint32_t from = hotOldest + rng() % (newest - hotOldest - SWEEP_BATCH);
+      bool ok = trackStoreAcquire(from, SWEEP_BATCH, l);
+      size_t n = l.count;
+      trackStoreRelease(l);
+      return ok ? n : 0;
+    }, SWEEP_OPS);
+
+    double leaseArc = !archived ? 0 : nsPerOp([&](size_t) {
+      TrackLease l;
+      uint32_t from = oldest + rng() % (newest - oldest + 1 - ring);
+      trackStoreAcquire(from, SWEEP_BATCH, l);
+      size_t n = l.count;
+      trackStoreRelease(l);
+      return n;
+    }, SWEEP_OPS / 10);
+
+    // Ack batches in the newest part of the store, every other one left out
+    // so the floor stops at the first hole like after a lossy upload
+    uint32_t ackFrom = newest - TRACK_ACK_WORDS * 32 / 2;
+    double ack = nsPerOp([&](size_t i) {
+      uint32_t from = ackFrom + (uint32_t)(2 * i % (TRACK_ACK_WORDS * 32 / 2 / SWEEP_BATCH)) * SWEEP_BATCH;
+      trackStoreAckRange(from, from + SWEEP_BATCH - 1);
+      return (size_t)trackStoreIsAcked(from);
+    }, SWEEP_OPS);
+
+    FixRec buf[SWEEP_BATCH];
+    double batch = nsPerOp([&](size_t) {
+      uint32_t afterTs = hotOldest + rng() % (newest - hotOldest);   // ts == seq here
+      return trackStoreGetBatch(buf, SWEEP_BATCH, afterTs);
+    }, SWEEP_OPS);
+
+    CHECK(trackStoreSize() == newest - oldest + 1 && trackStoreSize() >= ring, "store size %u, oldest %u, newest %u",
+          (unsigned)trackStoreSize(), (unsigned)oldest, (unsigned)newest);
+
+    char perRec[16] = "-";
+    if (prevCap) snprintf(perRec, sizeof(perRec), "%.1f", (double)(heap - prevHeap) / (ring - prevCap));
+    char arc[16] = "-";
+    if (archived) snprintf(arc, sizeof(arc), "%.1f", leaseArc);
+    printf("  %7u %7u %9.1f %9s %9.1f %9.1f %9s %9.1f %9.1f\n", (unsigned)caps[k], (unsigned)ring,
+           heap / 1024.0, perRec, push, lease, arc, ack, batch);
+    prevHeap = heap;
+    prevCap = ring;
+  }
+  printf("  (heap includes the %u-block archive; B/rec is the marginal heap per hot ring record;\n"
+         "   lease-arc decodes an archived block and only applies while the archive reaches past the ring)\n",
+         (unsigned)TRACK_ARCHIVE_BLOCKS);
+}
+
+// ============= ARCHIVE SIZE ON RECORDED TRACKS =============
+
+static uint32_t epochOf(const NmeaFix& f) {
+  // days from civil (proleptic Gregorian), then seconds
+  int y = f.year - (f.month <= 2);
+  int era = y / 400;
+  int yoe = y - era * 400;
+  int doy = (153 * (f.month + (f.month > 2 ? -3 : 9)) + 2) / 5 + f.day - 1;
+  int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  long days = (long)era * 146097 + doe - 719468;
+  return (uint32_t)(days * 86400 + f.hour * 3600 + f.minute * 60 + f.second);
+}
+
+// Push one stored fix per 'every' RMC epochs, built the way the sampler does
+static size_t loadNmea(const char* path, int every, std::vector<FixRec>& pushed) {
+  FILE* in = fopen(path, "r");
+  if (!in) return 0;
+  NmeaParser p;
+  nmeaInit(p);
+  char line[256];
+  int epoch = 0;
+  size_t n = 0;
+  while (fgets(line, sizeof(line), in)) {
+    NmeaEvent ev = nmeaParse(p, line, strlen(line));
+    if (ev != NMEA_EV_FIX || strncmp(line + 3, "RMC", 3) != 0 || !p.fix.hasDate) continue;
+    if (epoch++ % every) continue;
+    const NmeaFix& f = p.fix;
+    FixRec r;
+    memset(&r, 0, sizeof(r));
+    r.ts = epochOf(f);
+    r.latE7 = f.latE7;
+    r.lonE7 = f.lonE7;
+    r.bat = 100;
+    r.flags = FL_GPS_VALID | (f.speedCmS > 100 ? FL_MOVE_ACTIVE : 0);
+    r.dop = fixPackDop(f.hdopX100, f.sats);
+    r.speedCmS = (uint16_t)(f.speedCmS > 0xFFFF ? 0xFFFF : f.speedCmS);
+    r.course2 = f.hasCourse ? fixPackCourse(f.courseCdeg) : FIX_COURSE_UNKNOWN;
+    r.altDm = f.hasAltitude ? fixPackAlt(f.altCm) : FIX_ALT_UNKNOWN;
+    trackStorePush(r);
+    pushed.push_back(r);
+    n++;
+  }
+  fclose(in);
+  return n;
+}
+
+// RAM budget: the uncompressed ring before the archive, 1440 x 20 B FixRec (v1)
+static const size_t BASELINE_FIXES = 1440;
+static const size_t BASELINE_RAM = BASELINE_FIXES * 20;
+
+static void archive(const std::vector<const char*>& files, int every) {
+  printf("\narchive on recorded tracks (one fix per %d epoch(s))\n", every);
+  for (size_t k = 0; k < files.size(); k++) {
+    initTrackStore(TRACK_CAPACITY);
+    std::vector<FixRec> pushed;
+    size_t n = loadNmea(files[k], every, pushed);
+    if (n == 0) {
+      printf("  %s: no fixes\n", files[k]);
+      continue;
+    }
+    TrackStoreStats st;
+    trackStoreGetStats(st);
+    if (st.archivedFixes == 0) {
+      printf("  %s: %u fixes, no block sealed yet (%u fixes per block)\n", files[k], (unsigned)n,
+             (unsigned)TRACK_BLOCK_MAX_FIXES);
+      continue;
+    }
+    printf("  %s: %u fixes, %u blocks sealed holding %u fixes in %u B: %.2f B/fix (FixRec %u B, %.1fx)\n",
+           files[k], (unsigned)n, (unsigned)st.sealedBlocks, (unsigned)st.archivedFixes, (unsigned)st.archivedBytes,
+           (double)st.archivedBytes / st.archivedFixes, (unsigned)sizeof(FixRec),
+           sizeof(FixRec) * (double)st.archivedFixes / st.archivedBytes);
+
+    // What the whole store holds at this rate once the archive is full, against
+    // the RAM of the ring it replaced (TRACK_CAPACITY 1440 x 20 B FixRec)
+    double perBlock = (double)st.archivedFixes / st.sealedBlocks;
+    double held = TRACK_CAPACITY + TRACK_ARCHIVE_BLOCKS * perBlock;
+    printf("  store RAM %.1f KB holds ~%.0f fixes (%u hot + %u blocks of ~%.0f): %.0f fixes/KB, "
+           "%.0f before the archive\n",
+           st.ramBytes / 1024.0, held, (unsigned)TRACK_CAPACITY, (unsigned)TRACK_ARCHIVE_BLOCKS, perBlock,
+           held * 1024 / st.ramBytes, BASELINE_FIXES * 1024.0 / BASELINE_RAM);
+    CHECK(st.ramBytes <= BASELINE_RAM, "store RAM %u B over the %u B budget", (unsigned)st.ramBytes,
+          (unsigned)BASELINE_RAM);
+
+    // Everything still stored, archive included, must decode to what was pushed
+    TrackCursor cur;
+    FixRec buf[READ_BATCH];
+    size_t got, same = 0, total = 0;
+    while ((got = trackStoreRead(cur, buf, READ_BATCH)) > 0) {
+      for (size_t i = 0; i < got; i++, total++) {
+        const FixRec& w = pushed[buf[i].seq - 1];
+        same += memcmp(&w, &buf[i], sizeof(FixRec)) == 0;
+      }
+    }
+    CHECK(same == total && total == trackStoreSize(), "%s: %u of %u fixes read back unchanged", files[k],
+          (unsigned)same, (unsigned)total);
+  }
+}
+
+// ============= TIME RANGE =============
+
+struct RangeOut {
+  std::vector<FixRec> recs;
+  size_t stopAfter;           // callback returns false on this record (0 = never)
+};
+
+static bool collectRange(const FixRec& rec, void* ctx) {
+  RangeOut& out = *(RangeOut*)ctx;
+  out.recs.push_back(rec);
+  return out.recs.size() != out.stopAfter;
+}
+
+// trackStoreRange(fromTs, toTs) against the records of 'pushed' still stored
+static void checkRange(const char* what, const std::vector<FixRec>& pushed, uint32_t oldest, uint32_t fromTs,
+                       uint32_t toTs, size_t stopAfter = 0) {
+  std::vector<FixRec> want;
+  for (size_t i = oldest - 1; i < pushed.size(); i++) {
+    if (pushed[i].ts >= fromTs && pushed[i].ts <= toTs) want.push_back(pushed[i]);
+  }
+  if (stopAfter && want.size() > stopAfter) want.resize(stopAfter);
+
+  RangeOut out;
+  out.stopAfter = stopAfter;
+  size_t n = trackStoreRange(fromTs, toTs, collectRange, &out);
+  bool same = n == want.size() && out.recs.size() == want.size();
+  for (size_t i = 0; same && i < want.size(); i++) same = memcmp(&want[i], &out.recs[i], sizeof(FixRec)) == 0;
+  CHECK(same, "range %s [%u, %u]: %u records (%u streamed), expected %u from seq %u", what, (unsigned)fromTs,
+        (unsigned)toTs, (unsigned)out.recs.size(), (unsigned)n, (unsigned)want.size(),
+        want.empty() ? 0u : (unsigned)want[0].seq);
+}
+
+static void testRange() {
+  // Three archives' worth, so the oldest blocks have been overwritten. Two
+  // fixes out of seven repeat the previous ts (as after a backward clock
+  // step) and every 50th leaves a gap, so windows can start between records
+  // and inside runs of equal ts.
+  initTrackStore(TRACK_CAPACITY);
+  std::vector<FixRec> pushed;
+  size_t total = 3 * TRACK_ARCHIVE_BLOCKS * TRACK_BLOCK_MAX_FIXES;
+  uint32_t ts = 1700000000;
+  for (size_t i = 0; i < total; i++) {
+    if (i % 7 >= 2) ts += 2;
+    if (i % 50 == 0) ts += 60;
+    FixRec r = makeFix(ts);
+    trackStorePush(r);
+    pushed.push_back(r);
+  }
+  uint32_t newest = (uint32_t)pushed.size();
+  uint32_t oldest = newest - (uint32_t)trackStoreSize() + 1;
+  uint32_t hot = newest - TRACK_CAPACITY + 1;     // oldest record of the hot ring
+  TrackStoreStats st;
+  trackStoreGetStats(st);
+  uint32_t perBlock = st.archivedFixes / st.sealedBlocks;
+  printf("\ntime range: %u fixes pushed, seq %u-%u stored, hot ring from %u, ~%u fixes per block\n",
+         (unsigned)total, (unsigned)oldest, (unsigned)newest, (unsigned)hot, (unsigned)perBlock);
+  CHECK(oldest > 1 && oldest < hot, "store holds seq %u-%u, expected the archive to have wrapped", (unsigned)oldest,
+        (unsigned)newest);
+  auto tsOf = [&](uint32_t seq) { return pushed[seq - 1].ts; };
+
+  checkRange("in hot ring", pushed, oldest, tsOf(hot + 40), tsOf(newest - 30));
+  checkRange("in archive", pushed, oldest, tsOf(oldest + 10), tsOf(oldest + 5 * perBlock));
+  checkRange("across archive and hot ring", pushed, oldest, tsOf(hot - 3 * perBlock / 2), tsOf(hot + 40));
+  checkRange("to past newest", pushed, oldest, tsOf(newest - 70), tsOf(newest) + 3600);
+  checkRange("to UINT32_MAX", pushed, oldest, tsOf(hot - 10), UINT32_MAX);
+  checkRange("everything", pushed, oldest, 0, UINT32_MAX);
+  checkRange("older than the store", pushed, oldest, tsOf(1), tsOf(oldest) - 1);
+  checkRange("from before the store", pushed, oldest, tsOf(1), tsOf(oldest + 20));
+  checkRange("newer than the store", pushed, oldest, tsOf(newest) + 1, tsOf(newest) + 100);
+  checkRange("single ts", pushed, oldest, tsOf(hot - 100), tsOf(hot - 100));
+  checkRange("inside a gap", pushed, oldest, tsOf(oldest + 150) + 1, tsOf(oldest + 150) + 30);
+  checkRange("empty (from > to)", pushed, oldest, tsOf(hot), tsOf(hot) - 1);
+
+  // fromTs at every offset of a few archived blocks, including mid-block
+  for (uint32_t seq = oldest + perBlock; seq < oldest + 4 * perBlock; seq += 3) {
+    checkRange("from mid-block", pushed, oldest, tsOf(seq), tsOf(seq + perBlock / 2));
+  }
+  // Random windows over the whole store and a little past both ends
+  rngState = 2024;
+  uint32_t lo = tsOf(oldest) - 200, span = tsOf(newest) + 200 - lo;
+  for (int k = 0; k < 200; k++) {
+    uint32_t a = lo + rng() % span, b = lo + rng() % span;
+    checkRange("random", pushed, oldest, std::min(a, b), std::max(a, b));
+  }
+
+  // A callback returning false stops the stream after that record
+  checkRange("stop after 1", pushed, oldest, tsOf(oldest), UINT32_MAX, 1);
+  checkRange("stop in archive", pushed, oldest, tsOf(oldest + 5), UINT32_MAX, perBlock + 7);
+  checkRange("stop across archive and hot ring", pushed, oldest, tsOf(hot - 20), UINT32_MAX, 45);
+}
+
+int main(int argc, char** argv) {
+  int producers = 0, consumers = 0;
+  double secs = 0.5;
+  int every = 1;
+  std::vector<const char*> files;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-v") == 0) hostVerbose = true;
+    else if (strcmp(argv[i], "--every") == 0 && i + 1 < argc) every = std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) producers = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) consumers = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) secs = atof(argv[++i]);
+    else files.push_back(argv[i]);
+  }
+  if (!files.empty()) {
+    archive(files, every);
+  } else if (producers > 0 || consumers > 0) {
+    printf("%u hardware thread(s)\n", std::thread::hardware_concurrency());
+    run(std::max(producers, 1), consumers, secs);
+  } else {
+    printf("%u hardware thread(s)\n", std::thread::hardware_concurrency());
+    // Firmware shape: sampler + uploader/LoRa/UI, then a second writer
+    run(1, 1, secs);
+    run(1, 3, secs);
+    run(2, 3, secs);
+    sweep();
+    archive(std::vector<const char*>(1, "examples/nmea_bench/corpus.nmea"), every);
+    testRange();
+  }
+  if (failures) printf("%d FAILED\n", failures);
+  else printf("all checks passed\n");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,427 @@
+// Host simulation: WiFi upload acks over a flaky link (src/upload_manager.cpp)
+//
+// Drives the real track store through the uploader's round, step for step as
+// uploadBatchOverWiFi() does it (channel lease, skip acked records, channel
+// sent/acked/rewind), minus HTTP and JSON: a simulated server writes the batch
+// and answers. A day of fixes (one every 30 s, an upload round every 60 s) is
+// uploaded while WiFi is in reach for 30 min of every 2 h (so a backlog
+// builds up and goes out in full batches), through sessions that fail in
+// three ways:
+//  - the connection fails before the server sees anything
+//  - the server writes the batch but the response is lost
+//  - the server fails to write single records of a batch
+// under three ack schemes:
+//  - ranges:   per-record seq ranges ("acks", the current server)
+//  - ts-max:   the old server's watermark, the newest ts written
+//  - ts-safe:  a watermark that stops before the first record not written
+// and reports the bytes uploaded, the bytes re-sent for records the server
+// already had, and records lost (acked on the device, never written).
+//
+// Then runs the same rounds with the simplifier (src/track_simplify.cpp) in
+// front, as the uploader does, over a synthetic day of driving, winding roads
+// and parking (30 s sampling, 2.5 m noise), on a good and on the flaky link.
+// Reports the share of fixes uploaded and checks, against the uploaded track
+// recomputed in double precision, that no dropped fix is further than
+// SIMPLIFY_TOLERANCE_M from it, that every event fix is uploaded and that
+// kept fixes are at most SIMPLIFY_MAX_SPAN_S (plus one sample) apart.
+//
+//   g++ -O2 -std=gnu++11 -Iexamples/upload_sim/host -Iinclude examples/upload_sim/upload_sim.cpp
+//       src/track_storage.cpp src/track_scan.cpp src/track_simplify.cpp -o upload_sim
+//   ./upload_sim             # -v prints the store's Serial output to stderr
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "track_storage.h"
+#include "track_simplify.h"
+#include "gps_sampler.h"
+
+bool hostVerbose = false;
+HostSerial Serial;
+
+static int failures = 0;
+#define CHECK(cond, ...) do { if (!(cond)) { failures++; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } } while (0)
+
+// Same values as upload_manager.h (which pulls in secrets.h)
+#define MAX_UPLOAD_BATCH_SIZE 60
+#define MAX_ACK_RANGES 16
+
+#define DAY_FIXES        2880   // 24 h at 30 s
+#define FIXES_PER_ROUND  2      // UPLOAD_INTERVAL_MS / 30 s
+#define LINK_PERIOD      240    // fixes per away + home cycle (2 h) ...
+#define LINK_UP          60     // ... of which WiFi is in reach for the last 30 min
+#define P_CONNECT_FAIL   0.15   // per round: nothing reaches the server
+#define P_RESPONSE_LOST  0.10   // per round: written, but the device sees an error
+#define P_RECORD_FAIL    0.05   // per record: the server fails to write it
+
+static uint32_t rngState = 12345;
+static uint32_t rng() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+static bool chance(double p) {
+  return rng() < p * 4294967296.0;
+}
+
+// ============= FIXES =============
+
+static FixRec makeFix(uint32_t i) {
+  FixRec r;
+  memset(&r, 0, sizeof(r));
+  r.ts = 1789556400 + i * 30;
+  r.latE7 = 523750000 + (int32_t)(rng() % 20001) - 10000;
+  r.lonE7 = 97500000 + (int32_t)(rng() % 20001) - 10000;
+  r.bat = 80;
+  r.flags = FL_GPS_VALID | FL_MOVE_ACTIVE;
+  r.dop = 0x92;
+  r.course2 = (uint8_t)(rng() % 180);
+  r.speedCmS = (uint16_t)(rng() % 3000);
+  r.altDm = 550;
+  return r;
+}
+
+// Size of the record in the upload body, formatted as buildJSONBatch() does
+static size_t jsonBytes(const FixRec& r) {
+  char buf[256];
+  int n = snprintf(buf, sizeof(buf),
+                   "{\"seq\":%lu,\"ts\":%lu,\"latE7\":%ld,\"lonE7\":%ld,\"net\":\"HomeWiFi\",\"ch\":\"wifi\","
+                   "\"bat\":%u,\"flags\":%u,\"sats\":%u,\"hdopX10\":%u,\"speedCmS\":%u,\"courseDeg\":%u,\"altDm\":%d},",
+                   (unsigned long)r.seq, (unsigned long)r.ts, (long)r.latE7, (long)r.lonE7, r.bat, r.flags,
+                   fixSats(r.dop), fixHdopX10(r.dop), r.speedCmS, r.course2 * 2u, r.altDm);
+  return (size_t)n;
+}
+
+// ============= SERVER =============
+
+enum AckScheme { ACK_RANGES, ACK_TS_MAX, ACK_TS_SAFE };
+static const char* const schemeNames[] = { "ranges", "ts-max", "ts-safe" };
+
+struct Server {
+  std::vector<bool> have;     // by seq
+  uint32_t ackedTs = 0;       // watermark schemes
+  size_t bytes = 0;           // record bytes received
+  size_t resentBytes = 0;     // record bytes for records already written
+};
+
+// Write a batch and build the reply the device would parse
+static void serve(Server& srv, AckScheme scheme, const std::vector<FixRec>& batch, uint32_t ranges[][2],
+                  size_t& nRanges, uint32_t& ackedTs) {
+  nRanges = 0;
+  bool hole = false;
+  for (size_t i = 0; i < batch.size(); i++) {
+    const FixRec& r = batch[i];
+    size_t b = jsonBytes(r);
+    srv.bytes += b;
+    if (srv.have.size() <= r.seq) srv.have.resize(r.seq + 1, false);
+    bool written = srv.have[r.seq];
+    if (written) srv.resentBytes += b;
+    else if (!chance(P_RECORD_FAIL)) written = srv.have[r.seq] = true;
+
+    if (scheme == ACK_RANGES && written) {
+      if (nRanges > 0 && ranges[nRanges - 1][1] + 1 == r.seq) ranges[nRanges - 1][1] = r.seq;
+      else if (nRanges < MAX_ACK_RANGES) { ranges[nRanges][0] = ranges[nRanges][1] = r.seq; nRanges++; }
+    } else if (scheme == ACK_TS_MAX && written) {
+      if (r.ts > srv.ackedTs) srv.ackedTs = r.ts;
+    } else if (scheme == ACK_TS_SAFE) {
+      hole |= !written;
+      if (!hole && r.ts > srv.ackedTs) srv.ackedTs = r.ts;
+    }
+  }
+  ackedTs = srv.ackedTs;
+}
+
+// ============= UPLOADER ROUND =============
+
+// Fixes the simplifier dropped are remembered, never acked, as in upload_manager.cpp
+#define DROPPED_SLOTS (2 * MAX_UPLOAD_BATCH_SIZE)
+static uint32_t droppedSeqs[DROPPED_SLOTS];
+
+static bool wasDropped(uint32_t seq) {
+  return droppedSeqs[seq % DROPPED_SLOTS] == seq;
+}
+
+static size_t markDropped(const TrackLease& lease, uint8_t* keep, size_t decided) {
+  size_t dropped = 0;
+  for (size_t i = 0; i < decided; i++) {
+    uint32_t seq = lease.firstSeq + (uint32_t)i;
+    if (!keep[i]) droppedSeqs[seq % DROPPED_SLOTS] = seq;
+    else if (wasDropped(seq)) keep[i] = 0;
+    dropped += !keep[i];
+  }
+  return dropped;
+}
+
+static bool allDelivered(uint32_t firstSeq, uint32_t lastSeq) {
+  for (uint32_t seq = firstSeq; seq <= lastSeq; seq++) {
+    if (!trackStoreIsAcked(seq) && !wasDropped(seq)) return false;
+  }
+  return true;
+}
+
+// uploadBatchOverWiFi(), with the simplifier when shape is set; returns records sent
+static size_t uploadRound(Server& srv, AckScheme scheme, bool flaky, SimplifyState* shape = nullptr) {
+  uint32_t ackedTs = trackStoreGetAckedTs();
+  TrackLease lease;
+  if (!trackStoreChannelAcquire(TRACK_CH_WIFI, MAX_UPLOAD_BATCH_SIZE, lease)) {
+    trackStoreRelease(lease);
+    return 0;
+  }
+  size_t decided = lease.count;
+  uint8_t keep[MAX_UPLOAD_BATCH_SIZE];
+  memset(keep, 1, sizeof(keep));
+  if (shape) {
+    decided = simplifyRun(*shape, lease, keep);
+    markDropped(lease, keep, decided);
+    if (decided == 0) {
+      trackStoreRelease(lease);
+      return 0;
+    }
+  }
+  std::vector<FixRec> batch;
+  for (size_t i = 0; i < decided; i++) {
+    FixRec rec = lease.at(i);
+    if (keep[i] && !trackStoreIsAcked(rec.seq)) batch.push_back(rec);
+  }
+  uint32_t firstSeq = lease.firstSeq;
+  uint32_t lastSeq = lease.firstSeq + (uint32_t)decided - 1;
+  if (!trackStoreRelease(lease)) return 0;
+  if (batch.empty()) {
+    trackStoreChannelAcked(TRACK_CH_WIFI, lastSeq);
+    return 0;
+  }
+  trackStoreChannelSent(TRACK_CH_WIFI, lastSeq);
+
+  if (flaky && chance(P_CONNECT_FAIL)) {
+    trackStoreChannelRewind(TRACK_CH_WIFI);
+    return batch.size();
+  }
+  uint32_t ranges[MAX_ACK_RANGES][2];
+  size_t nRanges = 0;
+  uint32_t replyTs = 0;
+  serve(srv, scheme, batch, ranges, nRanges, replyTs);
+  if (flaky && chance(P_RESPONSE_LOST)) {
+    trackStoreChannelRewind(TRACK_CH_WIFI);
+    return batch.size();
+  }
+
+  if (nRanges > 0) {
+    for (size_t i = 0; i < nRanges; i++) trackStoreAckRange(ranges[i][0], ranges[i][1]);
+  } else if (replyTs > ackedTs) {
+    trackStoreSetAckedTs(replyTs);
+  }
+  if (trackStoreGetAckFloor() > lastSeq || allDelivered(firstSeq, lastSeq)) {
+    trackStoreChannelAcked(TRACK_CH_WIFI, lastSeq);
+  } else {
+    trackStoreChannelRewind(TRACK_CH_WIFI);
+  }
+  return batch.size();
+}
+
+// ============= RUN =============
+
+struct Result {
+  size_t bytes;
+  size_t resentBytes;
+  size_t lost;        // acked on the device, never written
+  size_t missing;     // not written at the end
+};
+
+// Without the simplifier, so every record counts
+static Result simulate(AckScheme scheme) {
+  initTrackStore(TRACK_CAPACITY);
+  rngState = 12345;
+  Server srv;
+  for (uint32_t i = 0; i < DAY_FIXES; i++) {
+    FixRec r = makeFix(i);
+    trackStorePush(r);
+    bool home = i % LINK_PERIOD >= LINK_PERIOD - LINK_UP;
+    if (home && i % FIXES_PER_ROUND == FIXES_PER_ROUND - 1) uploadRound(srv, scheme, true);
+  }
+  // Good link at the end: drain whatever the device still offers
+  for (int k = 0; k < 1000 && uploadRound(srv, scheme, false) > 0; k++) {
+  }
+
+  Result res = { srv.bytes, srv.resentBytes, 0, 0 };
+  srv.have.resize(DAY_FIXES + 1, false);
+  for (uint32_t seq = 1; seq <= DAY_FIXES; seq++) {
+    if (srv.have[seq]) continue;
+    res.missing++;
+    if (trackStoreIsAcked(seq)) res.lost++;
+  }
+  printf("  %-8s %8u B uploaded, %7u B re-sent (%4.1f%%), %3u fixes lost, %3u not delivered\n",
+         schemeNames[scheme], (unsigned)res.bytes, (unsigned)res.resentBytes, 100.0 * res.resentBytes / res.bytes,
+         (unsigned)res.lost, (unsigned)res.missing);
+  return res;
+}
+
+static void testAcks() {
+  printf("acks: %u fixes, rounds fail to connect %.0f%%, lose the reply %.0f%%, records fail to write %.0f%%\n",
+         DAY_FIXES, P_CONNECT_FAIL * 100, P_RESPONSE_LOST * 100, P_RECORD_FAIL * 100);
+  Result ranges = simulate(ACK_RANGES);
+  Result tsMax = simulate(ACK_TS_MAX);
+  Result tsSafe = simulate(ACK_TS_SAFE);
+
+  CHECK(ranges.missing == 0 && ranges.lost == 0, "ranges: %u fixes not delivered", (unsigned)ranges.missing);
+  CHECK(tsSafe.missing == 0 && tsSafe.lost == 0, "ts-safe: %u fixes not delivered", (unsigned)tsSafe.missing);
+  CHECK(tsMax.lost > 0, "ts-max should ack past records the server failed to write");
+  // Per-record acks only re-send what was lost with a reply; the safe
+  // watermark also re-sends everything behind a failed record
+  CHECK(ranges.resentBytes * 3 < tsSafe.resentBytes, "ranges re-sent %u B, ts-safe %u B",
+        (unsigned)ranges.resentBytes, (unsigned)tsSafe.resentBytes);
+  printf("  ranges re-send %.0f%% fewer bytes than ts-safe and lose nothing, unlike ts-max\n",
+         100.0 - 100.0 * ranges.resentBytes / tsSafe.resentBytes);
+}
+
+// ============= SIMPLIFIER =============
+
+// A day in 30 s steps: drives on straight and winding roads between parked
+// stretches, 2.5 m of position noise, events where the motion state changes
+// and an hourly heartbeat while parked
+static std::vector<FixRec> syntheticDay() {
+  std::vector<FixRec> out;
+  double north = 0, east = 0, heading = 0;
+  int mode = 0;           // 0 parked, 1 straight, 2 winding
+  int left = 0;
+  uint32_t sinceBeat = 0;
+  for (uint32_t i = 0; i < DAY_FIXES; i++) {
+    uint8_t ev = 0;
+    if (left-- <= 0) {
+      int next = (mode == 0) ? 1 + (int)(rng() % 2) : (rng() % 3 == 0 ? 0 : 3 - mode);
+      if (mode == 0 && next != 0) ev = FL_EVT_MOVE_START;
+      if (mode != 0 && next == 0) ev = FL_EVT_MOVE_STOP;
+      mode = next;
+      left = (mode == 0) ? 20 + (int)(rng() % 200) : 10 + (int)(rng() % 60);
+      heading = (rng() % 360) * M_PI / 180;
+    }
+    double speed = 0;
+    if (mode == 1) {
+      speed = 20;
+      heading += ((int)(rng() % 5) - 2) * 0.002;
+    } else if (mode == 2) {
+      speed = 9;
+      heading += ((int)(rng() % 61) - 30) * M_PI / 180;
+    }
+    north += speed * 30 * cos(heading);
+    east += speed * 30 * sin(heading);
+    if (mode == 0 && ++sinceBeat >= 120) {
+      ev |= FL_EVT_HEARTBEAT;
+      sinceBeat = 0;
+    }
+
+    // Box-Muller noise, 2.5 m standard deviation per axis
+    double u1 = (rng() + 1.0) / 4294967297.0, u2 = rng() / 4294967296.0;
+    double r = 2.5 * sqrt(-2 * log(u1));
+    double nN = north + r * cos(2 * M_PI * u2), nE = east + r * sin(2 * M_PI * u2);
+
+    FixRec f;
+    memset(&f, 0, sizeof(f));
+    f.ts = 1789556400 + i * 30;
+    f.latE7 = 523750000 + (int32_t)lround(nN / 111319.49 * 1e7);
+    f.lonE7 = 97500000 + (int32_t)lround(nE / (111319.49 * cos(52.375 * M_PI / 180)) * 1e7);
+    f.bat = 80;
+    f.flags = FL_GPS_VALID | (mode ? FL_MOVE_ACTIVE : 0) | ev;
+    f.dop = 0x92;
+    f.course2 = FIX_COURSE_UNKNOWN;
+    f.speedCmS = (uint16_t)(speed * 100);
+    f.altDm = FIX_ALT_UNKNOWN;
+    out.push_back(f);
+  }
+  return out;
+}
+
+// Distance in metres of p from the segment a -> b (local flat frame, double)
+static double segmentDistance(const FixRec& a, const FixRec& b, const FixRec& p) {
+  const double mLat = 111319.49 / 1e7;
+  const double mLon = mLat * cos(a.latE7 / 1e7 * M_PI / 180);
+  double ex = (b.lonE7 - (double)a.lonE7) * mLon, ey = (b.latE7 - (double)a.latE7) * mLat;
+  double px = (p.lonE7 - (double)a.lonE7) * mLon, py = (p.latE7 - (double)a.latE7) * mLat;
+  double len2 = ex * ex + ey * ey;
+  double t = len2 > 0 ? (px * ex + py * ey) / len2 : 0;
+  t = t < 0 ? 0 : (t > 1 ? 1 : t);
+  return hypot(px - t * ex, py - t * ey);
+}
+
+static void simplifyDay(const std::vector<FixRec>& day, bool flaky) {
+  initTrackStore(TRACK_CAPACITY);
+  memset(droppedSeqs, 0, sizeof(droppedSeqs));
+  rngState = 777;
+  Server srv;
+  SimplifyState shape;
+  for (uint32_t i = 0; i < day.size(); i++) {
+    FixRec r = day[i];
+    trackStorePush(r);
+    if (i % FIXES_PER_ROUND == FIXES_PER_ROUND - 1) uploadRound(srv, ACK_RANGES, flaky, &shape);
+  }
+  for (int k = 0; k < 1000 && uploadRound(srv, ACK_RANGES, false, &shape) > 0; k++) {
+  }
+
+  // The uploaded track, as the server has it
+  srv.have.resize(day.size() + 1, false);
+  std::vector<size_t> kept;
+  size_t events = 0, eventsKept = 0;
+  for (size_t i = 0; i < day.size(); i++) {
+    if (srv.have[i + 1]) kept.push_back(i);
+    if (day[i].flags & SIMPLIFY_KEEP_FLAGS) {
+      events++;
+      eventsKept += srv.have[i + 1];
+    }
+  }
+
+  double maxDev = 0;
+  uint32_t maxGap = 0;
+  for (size_t k = 1; k < kept.size(); k++) {
+    const FixRec& a = day[kept[k - 1]];
+    const FixRec& b = day[kept[k]];
+    for (size_t i = kept[k - 1] + 1; i < kept[k]; i++) maxDev = std::max(maxDev, segmentDistance(a, b, day[i]));
+    maxGap = std::max(maxGap, b.ts - a.ts);
+  }
+  size_t undecided = day.size() - 1 - kept.back();   // still in the open window at the end
+
+  printf("  %-6s link: %4u of %u fixes uploaded (%.1f%%), max deviation %.1f m (simplifier says %.1f m), "
+         "%u/%u events, longest gap %u s, %u fixes still open\n",
+         flaky ? "flaky" : "good", (unsigned)kept.size(), (unsigned)day.size(), 100.0 * kept.size() / day.size(),
+         maxDev, shape.maxDeviationM, (unsigned)eventsKept, (unsigned)events, (unsigned)maxGap, (unsigned)undecided);
+  CHECK(maxDev <= SIMPLIFY_TOLERANCE_M + 0.5, "max deviation %.2f m over the %.0f m tolerance", maxDev,
+        (double)SIMPLIFY_TOLERANCE_M);
+  CHECK(shape.maxDeviationM <= SIMPLIFY_TOLERANCE_M, "simplifier reports %.2f m", shape.maxDeviationM);
+  CHECK(eventsKept == events, "%u of %u event fixes uploaded", (unsigned)eventsKept, (unsigned)events);
+  CHECK(maxGap <= SIMPLIFY_MAX_SPAN_S + 30, "kept fixes %u s apart", (unsigned)maxGap);
+  CHECK(kept.size() * 100 <= day.size() * 35, "%u of %u fixes uploaded, expected at most 35%%",
+        (unsigned)kept.size(), (unsigned)day.size());
+  CHECK(undecided < SIMPLIFY_MAX_WINDOW, "%u fixes never decided", (unsigned)undecided);
+
+  // Only what the server confirmed is acked in the store; dropped fixes only
+  // moved the WiFi channel on
+  size_t ackedNotUploaded = 0;
+  for (uint32_t seq = (uint32_t)(day.size() - trackStoreSize() + 1); seq <= day.size(); seq++) {
+    ackedNotUploaded += trackStoreIsAcked(seq) && !srv.have[seq];
+  }
+  CHECK(ackedNotUploaded == 0, "%u fixes acked in the store but never uploaded", (unsigned)ackedNotUploaded);
+  CHECK(trackStoreChannelLag(TRACK_CH_WIFI) == undecided, "WiFi channel %u fixes behind, %u undecided",
+        (unsigned)trackStoreChannelLag(TRACK_CH_WIFI), (unsigned)undecided);
+}
+
+static void testSimplify() {
+  rngState = 4242;
+  std::vector<FixRec> day = syntheticDay();
+  printf("simplifier: %u fixes in 24 h, tolerance %.0f m, max span %u s\n", (unsigned)day.size(),
+         (double)SIMPLIFY_TOLERANCE_M, (unsigned)SIMPLIFY_MAX_SPAN_S);
+  simplifyDay(day, false);
+  simplifyDay(day, true);
+}
+
+int main(int argc, char** argv) {
+  hostVerbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+  testAcks();
+  testSimplify();
+  if (failures) printf("%d FAILED\n", failures);
+  else printf("all checks passed\n");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,174 @@
+#ifndef GEO_DISTANCE_H
+#define GEO_DISTANCE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+// Fixed-point distance kernel on E7 coordinates (header only).
+//
+// Equirectangular (local tangent plane) approximation: the longitude
+// difference is scaled by cos(latitude) from a table of 2^23 E7 (~0.84 deg)
+// latitude bands with quadratic interpolation, everything up to the sum of
+// squares is integer math. Against a double-precision haversine on the same
+// sphere the error stays below 1 cm + 1e-4 of the distance up to 10 km
+// (about 1 cm at DIST_TRIGGER_M); checked by examples/geo_bench.
+// Points further apart than GEO_FLAT_MAX_E7 in either axis fall back to the
+// float haversine.
+
+#define GEO_EARTH_RADIUS_M  6371000.0f        // mean radius, same sphere as the former haversine
+#define GEO_M_PER_E7        0.0111194927f     // metres per 1e-7 degree of latitude on that sphere
+#define GEO_FLAT_MAX_E7     10000000          // 1 deg (~110 km): beyond, use the haversine
+#define GEO_BAND_SHIFT      23                // latitude band = 2^23 E7 (~0.84 deg)
+
+// cos(band * 2^23 E7) in Q30 for bands 0..109 (107 holds 90 deg; 108 and
+// 109 are the interpolation neighbours past it)
+static const int32_t GEO_COS_Q30[110] = {
+   1073741824,  1073626745,  1073281532,  1072706260,  1071901051,  1070866078,  1069601564,  1068107779,
+   1066385043,  1064433726,  1062254245,  1059847069,  1057212713,  1054351742,  1051264768,  1047952454,
+   1044415510,  1040654694,  1036670812,  1032464718,  1028037313,  1023389547,  1018522415,  1013436962,
+   1008134276,  1002615496,   996881803,   990934427,   984774643,   978403770,   971823176,   965034269,
+    958038505,   950837385,   943432451,   935825290,   928017534,   920010856,   911806973,   903407641,
+    894814663,   886029880,   877055175,   867892472,   858543735,   849010967,   839296212,   829401553,
+    819329111,   809081044,   798659549,   788066860,   777305248,   766377019,   755284516,   744030116,
+    732616232,   721045311,   709319833,   697442311,   685415291,   673241351,   660923100,   648463180,
+    635864261,   623129043,   610260256,   597260659,   584133038,   570880208,   557505008,   544010306,
+    530398995,   516673991,   502838238,   488894701,   474846368,   460696252,   446447384,   432102819,
+    417665633,   403138919,   388525792,   373829384,   359052844,   344199342,   329272059,   314274196,
+    299208969,   284079605,   268889349,   253641455,   238339193,   222985843,   207584695,   192139051,
+    176652222,   161127528,   145568295,   129977859,   114359563,    98716753,    83052783,    67371011,
+     51674798,    35967508,    20252508,     4533167,   -11187145,   -26905059
+};
+
+/**
+ * cos(latitude) in Q30 (2^30 = 1), quadratic interpolation between bands
+ * (error below 3e-7)
+ * @param latE7 Latitude in E7 degrees
+ */
+inline int32_t geoCosQ30(int32_t latE7) {
+  uint32_t a = (uint32_t)(latE7 < 0 ? -(int64_t)latE7 : latE7);
+  if (a > 900000000UL) a = 900000000UL;
+  uint32_t band = a >> GEO_BAND_SHIFT;
+  int64_t t = a & ((1UL << GEO_BAND_SHIFT) - 1);           // position in the band, Q23
+  int64_t c0 = GEO_COS_Q30[band];
+  int64_t d1 = GEO_COS_Q30[band + 1] - c0;
+  int64_t d2 = GEO_COS_Q30[band + 2] - 2 * GEO_COS_Q30[band + 1] + c0;
+  int64_t tt = (t * (t - (1LL << GEO_BAND_SHIFT))) >> (GEO_BAND_SHIFT + 1);  // t(t-1)/2, Q23
+  return (int32_t)(c0 + ((d1 * t + d2 * tt) >> GEO_BAND_SHIFT));
+}
+
+/**
+ * Great-circle distance in metres (float haversine), for points too far apart
+ * for the flat approximation
+ */
+inline float geoHaversineM(int32_t lat1E7, int32_t lon1E7, int32_t lat2E7, int32_t lon2E7) {
+  const float k = 1e-7f * 0.017453292f;
+  float lat1 = lat1E7 * k;
+  float lat2 = lat2E7 * k;
+  float sLat = sinf((lat2 - lat1) / 2);
+  float sLon = sinf((float)((int64_t)lon2E7 - lon1E7) * k / 2);
+  float a = sLat * sLat + cosf(lat1) * cosf(lat2) * sLon * sLon;
+  return 2 * GEO_EARTH_RADIUS_M * atan2f(sqrtf(a), sqrtf(1 - a));
+}
+
+// Longitude difference wrapped into [-180, 180) degrees
+inline int64_t geoDeltaLonE7(int32_t lon1E7, int32_t lon2E7) {
+  int64_t d = (int64_t)lon2E7 - lon1E7;
+  if (d >= 1800000000LL) d -= 3600000000LL;
+  else if (d < -1800000000LL) d += 3600000000LL;
+  return d;
+}
+
+// Planar distance in metres of an offset (dLon scaled by cosQ30),
+// |dLatE7|, |dLonE7| <= GEO_FLAT_MAX_E7. Components are kept in 1/16 E7 so the
+// squares fit 64 bits.
+inline float geoPlanarM(int64_t dLatE7, int64_t dLonE7, int32_t cosQ30) {
+  int64_t dy = dLatE7 * 16;
+  int64_t dx = (dLonE7 * cosQ30) >> 26;
+  uint64_t sum = (uint64_t)(dy * dy) + (uint64_t)(dx * dx);
+  return sqrtf((float)sum) * (GEO_M_PER_E7 / 16);
+}
+
+/**
+ * Distance between two points in metres
+ * @param lat1E7 First latitude, E7 degrees
+ * @param lon1E7 First longitude, E7 degrees
+ * @param lat2E7 Second latitude, E7 degrees
+ * @param lon2E7 Second longitude, E7 degrees
+ * @return Distance in metres (cos taken at the mean latitude)
+ */
+inline float geoDistanceM(int32_t lat1E7, int32_t lon1E7, int32_t lat2E7, int32_t lon2E7) {
+  int64_t dLat = (int64_t)lat2E7 - lat1E7;
+  int64_t dLon = geoDeltaLonE7(lon1E7, lon2E7);
+  if (dLat > GEO_FLAT_MAX_E7 || dLat < -GEO_FLAT_MAX_E7 || dLon > GEO_FLAT_MAX_E7 || dLon < -GEO_FLAT_MAX_E7) {
+    return geoHaversineM(lat1E7, lon1E7, lat2E7, lon2E7);
+  }
+  return geoPlanarM(dLat, dLon, geoCosQ30((int32_t)(((int64_t)lat1E7 + lat2E7) / 2)));
+}
+
+/**
+ * Origin for repeated distances (cos looked up once)
+ */
+struct GeoFrame {
+  int32_t latE7;
+  int32_t lonE7;
+  int32_t cosQ30;
+};
+
+/**
+ * Frame at a point
+ * @param latE7 Latitude, E7 degrees
+ * @param lonE7 Longitude, E7 degrees
+ */
+inline GeoFrame geoFrameAt(int32_t latE7, int32_t lonE7) {
+  GeoFrame f;
+  f.latE7 = latE7;
+  f.lonE7 = lonE7;
+  f.cosQ30 = geoCosQ30(latE7);
+  return f;
+}
+
+/**
+ * Distance from the frame origin in metres. Uses cos at the origin, so meant
+ * for points within a few km (10 cm at 1 km north of 52 deg)
+ */
+inline float geoFrameDistanceM(const GeoFrame& f, int32_t latE7, int32_t lonE7) {
+  int64_t dLat = (int64_t)latE7 - f.latE7;
+  int64_t dLon = geoDeltaLonE7(f.lonE7, lonE7);
+  if (dLat > GEO_FLAT_MAX_E7 || dLat < -GEO_FLAT_MAX_E7 || dLon > GEO_FLAT_MAX_E7 || dLon < -GEO_FLAT_MAX_E7) {
+    return geoHaversineM(f.latE7, f.lonE7, latE7, lonE7);
+  }
+  return geoPlanarM(dLat, dLon, f.cosQ30);
+}
+
+/**
+ * Distances from the frame origin for a batch of points (column layout,
+ * e.g. a TrackSpan)
+ * @param f Origin
+ * @param latE7 Latitude column
+ * @param lonE7 Longitude column
+ * @param n Number of points
+ * @param outM Output: n distances in metres
+ */
+inline void geoFrameDistancesM(const GeoFrame& f, const int32_t* latE7, const int32_t* lonE7, size_t n, float* outM) {
+  for (size_t i = 0; i < n; i++) {
+    outM[i] = geoFrameDistanceM(f, latE7[i], lonE7[i]);
+  }
+}
+
+/**
+ * Length of a path in metres
+ * @param latE7 Latitude column
+ * @param lonE7 Longitude column
+ * @param n Number of points
+ * @return Sum of the n - 1 segment distances
+ */
+inline float geoPathLengthM(const int32_t* latE7, const int32_t* lonE7, size_t n) {
+  float sum = 0;
+  for (size_t i = 1; i < n; i++) {
+    sum += geoDistanceM(latE7[i - 1], lonE7[i - 1], latE7[i], lonE7[i]);
+  }
+  return sum;
+}
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef GEOFENCE_H
+#define GEOFENCE_H
+
+#include <Arduino.h>
+#include <stddef.h>
+
+// Geofences (depots, customer sites, no-go zones) with enter/exit events.
+//
+// Circles and polygons are loaded once from a text file on LittleFS, one
+// fence per line ('#' starts a comment, coordinates in decimal degrees):
+//   circle <id> <lat> <lon> <radius m>
+//   poly   <id> <lat> <lon> <lat> <lon> <lat> <lon> ...   (3 or more vertices)
+// Ids are the server's (what a fence means lives there); polygons must not
+// cross the antimeridian.
+//
+// A uniform grid of 2^k E7 cells, sized from the median fence, indexes the
+// fences by bounding box: a cell is one hash lookup, so a fix is checked
+// against the handful of fences near it however many are loaded. Fences
+// covering more than GEOFENCE_MAX_CELLS_PER_FENCE cells (a whole city as a
+// no-go zone) are kept in a short list checked by bounding box instead.
+// Leaving a fence takes GEOFENCE_HYSTERESIS_M beyond its edge, so position
+// noise on a boundary does not produce enter/exit pairs.
+#define GEOFENCE_FILE                 "/geofences.txt"
+#define GEOFENCE_MAX_FENCES           1024
+#define GEOFENCE_MAX_VERTICES         64        // per polygon
+#define GEOFENCE_MAX_CELLS_PER_FENCE  64
+#define GEOFENCE_MAX_INSIDE           16        // fences the device can be inside at once
+#define GEOFENCE_HYSTERESIS_M         10.0f
+#define GEOFENCE_EVENT_LOG            32        // recent events kept for the uplinks
+
+/**
+ * Enter or exit of one fence
+ */
+struct GeofenceEvent {
+  uint32_t seq;       // stored fix carrying the event (0 until logged)
+  uint16_t id;        // fence id from the file
+  bool enter;         // true = entered, false = left
+};
+
+/**
+ * Load GEOFENCE_FILE and build the index (sampler task, LittleFS mounted)
+ * A missing file leaves geofencing off.
+ * @return Number of fences loaded
+ */
+size_t geofenceInit();
+
+/**
+ * Parse fences from text (file format above) and build the index, replacing
+ * any loaded fences and the inside state
+ * @param text File contents
+ * @param len Length of text
+ * @return Number of fences loaded (invalid lines are skipped)
+ */
+size_t geofenceLoad(const char* text, size_t len);
+
+/**
+ * Number of loaded fences
+ */
+size_t geofenceCount();
+
+/**
+ * Check a position against the fences and update the inside state
+ * (single caller: the sampler task, on every fix)
+ * @param latE7 Latitude, E7 degrees
+ * @param lonE7 Longitude, E7 degrees
+ * @param out Output: events since the previous call (seq 0)
+ * @param maxN Size of out; further events are reported on the next call
+ * @return Number of events written to out
+ */
+size_t geofenceEvaluate(int32_t latE7, int32_t lonE7, GeofenceEvent* out, size_t maxN);
+
+/**
+ * Stateless query: fences containing a position (no hysteresis)
+ * @param latE7 Latitude, E7 degrees
+ * @param lonE7 Longitude, E7 degrees
+ * @param outIds Output: fence ids
+ * @param maxN Size of outIds
+ * @return Number of fences containing the position (may exceed maxN)
+ */
+size_t geofenceQuery(int32_t latE7, int32_t lonE7, uint16_t* outIds, size_t maxN);
+
+/**
+ * Same as geofenceQuery() by testing every fence, without the index
+ * (reference for host benchmarks)
+ */
+size_t geofenceQueryLinear(int32_t latE7, int32_t lonE7, uint16_t* outIds, size_t maxN);
+
+/**
+ * Remember the events of a stored fix for the uplinks (sampler task)
+ * @param seq Seq of the stored fix
+ * @param ev Events from geofenceEvaluate()
+ * @param n Number of events
+ */
+void geofenceLogEvents(uint32_t seq, const GeofenceEvent* ev, size_t n);
+
+/**
+ * Events carried by a stored fix (any task, lock-free)
+ * Only the last GEOFENCE_EVENT_LOG events are kept.
+ * @param seq Seq of a fix with FL_EVT_FENCE set
+ * @param out Output: events
+ * @param maxN Size of out
+ * @return Number of events written to out
+ */
+size_t geofenceEventsAt(uint32_t seq, GeofenceEvent* out, size_t maxN);
+
+#endif // GEOFENCE_H
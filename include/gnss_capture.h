@@ -0,0 +1,60 @@
+#ifndef GNSS_CAPTURE_H
+#define GNSS_CAPTURE_H
+
+#include <Arduino.h>
+
+// Optional raw capture of the GNSS receive path, for replaying field problems
+// on the host (examples/gnss_replay). The UART reader appends every byte it
+// reads and the GPS task every PPS edge, each with its micros() timestamp, to
+// a RAM ring; the sampler task moves it to LittleFS segment files, deleting
+// the oldest segment beyond GNSS_CAPTURE_MAX_SEGMENTS (a flash ring like the
+// track log). Each boot starts a new segment with a BOOT record.
+//
+// Record layout (little endian):
+//   [0xC5][type][len: U2][micros(): U4][payload: len bytes][crc16 hi][crc16 lo]
+// crc16 (CCITT) covers type, len, time and payload.
+#define GNSS_CAPTURE                0         // 1: capture from boot
+#define GNSS_CAPTURE_DIR            "/gnsscap"
+#define GNSS_CAPTURE_SEGMENT_BYTES  32768
+#define GNSS_CAPTURE_MAX_SEGMENTS   12        // 384 KB: ~9 min of NMEA at 9600 baud, ~50 min binary
+#define GNSS_CAPTURE_RAM_BYTES      8192      // absorbs flash stalls between services
+#define GNSS_CAPTURE_PAGE_BYTES     1024      // written when this much is buffered ...
+#define GNSS_CAPTURE_FLUSH_MS       10000     // ... or the oldest byte is this old
+
+#define GNSS_CAP_MAGIC      0xC5
+#define GNSS_CAP_OVERHEAD   10                // magic + type + len + time + crc16
+#define GNSS_CAP_VERSION    1
+
+enum GnssCapType : uint8_t {
+  GNSS_CAP_BOOT = 1,        // payload: version, binary protocol, duty cycle (U1 each)
+  GNSS_CAP_RX,              // payload: bytes read from the UART
+  GNSS_CAP_PPS,             // no payload, time = edge
+  GNSS_CAP_LOST,            // payload: U4 bytes dropped because the RAM ring was full
+};
+
+/**
+ * Start capturing: BOOT record, then everything the receive path sees
+ * Call from gpsInit() before the UART starts.
+ */
+void gnssCaptureBegin();
+
+/**
+ * Append bytes read from the UART (reader task)
+ * @param data Bytes as read
+ * @param len Number of bytes
+ * @param us micros() when they were read
+ */
+void gnssCaptureRx(const void* data, size_t len, uint32_t us);
+
+/**
+ * Append a PPS edge (GPS task)
+ * @param us Edge time, low 32 bits of esp_timer (= micros())
+ */
+void gnssCapturePps(uint32_t us);
+
+/**
+ * Move buffered records to flash (sampler task, LittleFS mounted)
+ */
+void gnssCaptureService();
+
+#endif // GNSS_CAPTURE_H
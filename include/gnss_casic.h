@@ -0,0 +1,95 @@
+#ifndef GNSS_CASIC_H
+#define GNSS_CASIC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "nmea_parser.h"
+
+// CASIC binary protocol of the AT6558-based GNSS module (L76K class).
+// Frame: 0xBA 0xCE | len (U2, LE) | class | id | payload (len bytes, multiple
+// of 4) | checksum (U4, LE) = (id << 24) + (class << 16) + len + sum of the
+// payload as LE U4 words. Text configuration commands ($PCASxx) are NMEA framed.
+#define CASIC_SYNC1            0xBA
+#define CASIC_SYNC2            0xCE
+#define CASIC_HEADER_LEN       6
+#define CASIC_CHECKSUM_LEN     4
+#define CASIC_MAX_PAYLOAD      80     // NAV-PV, the largest message we enable
+
+#define CASIC_CLS_NAV          0x01
+#define CASIC_ID_NAV_PV        0x03   // position / velocity, 80 B
+#define CASIC_ID_NAV_TIMEUTC   0x10   // UTC time, 24 B
+#define CASIC_CLS_ACK          0x05
+#define CASIC_ID_ACK_NAK       0x00
+#define CASIC_ID_ACK_ACK       0x01
+#define CASIC_CLS_CFG          0x06
+#define CASIC_ID_CFG_MSG       0x01   // message output rate
+
+// $PCAS01 baud rate codes
+#define CASIC_BAUD_9600        1
+#define CASIC_BAUD_115200      5
+
+enum CasicAck : uint8_t {
+  CASIC_ACK_NONE = 0,     // not an ACK for the given message
+  CASIC_ACK_OK,
+  CASIC_ACK_NAK,
+};
+
+/**
+ * Build a binary frame
+ * @param cls Message class
+ * @param id Message id
+ * @param payload Payload bytes (len must be a multiple of 4)
+ * @param len Payload length
+ * @param out Output buffer
+ * @param cap Size of out
+ * @return Frame length, 0 if it does not fit
+ */
+size_t casicFrame(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t len, uint8_t* out, size_t cap);
+
+/**
+ * Build a CFG-MSG frame that sets the output rate of a message
+ * @param cls Class of the message to configure
+ * @param id Id of the message to configure
+ * @param rate Output every rate fixes, 0 = off
+ * @param out Output buffer (at least 14 bytes)
+ * @return Frame length
+ */
+size_t casicCfgMsg(uint8_t cls, uint8_t id, uint16_t rate, uint8_t* out);
+
+/**
+ * Build a NMEA-framed text command: "$" body "*" checksum "\r\n"
+ * @param body Command without '$' and checksum, e.g. "PCAS01,5"
+ * @param out Output buffer
+ * @param cap Size of out
+ * @return Command length, 0 if it does not fit
+ */
+size_t casicCommand(const char* body, char* out, size_t cap);
+
+/**
+ * Check framing, length and checksum of a complete binary frame
+ * @param frame Frame bytes starting at the sync bytes
+ * @param n Number of bytes
+ * @return true if the frame is intact
+ */
+bool casicValid(const uint8_t* frame, size_t n);
+
+/**
+ * Classify a frame as the ACK/NAK for a configuration message
+ * @param frame Complete, valid frame
+ * @param n Number of bytes
+ * @param cls Class of the acknowledged message
+ * @param id Id of the acknowledged message
+ */
+CasicAck casicAckFor(const uint8_t* frame, size_t n, uint8_t cls, uint8_t id);
+
+/**
+ * Decode a NAV-PV or NAV-TIMEUTC frame straight into the fix
+ * @param fix Navigation state to update
+ * @param frame Complete frame (checksum verified here)
+ * @param n Number of bytes
+ * @return NMEA_EV_FIX / NMEA_EV_NO_FIX for NAV-PV, NMEA_EV_STATUS for time,
+ *         NMEA_EV_NONE for other messages, NMEA_EV_BAD for a damaged frame
+ */
+NmeaEvent casicDecode(NmeaFix& fix, const uint8_t* frame, size_t n);
+
+#endif // GNSS_CASIC_H
@@ -0,0 +1,95 @@
+#ifndef GNSS_DUTY_H
+#define GNSS_DUTY_H
+
+#include <stdint.h>
+#include "nmea_parser.h"
+
+// Duty cycling of the GNSS receiver while the device stands still. Moving, the
+// receiver runs continuously (the sampler wants a position every second to
+// spot corners). Once it has been stationary for GNSS_DUTY_STILL_S the
+// receiver sleeps between fixes:
+//   OFF (GNSS_WAKE low: standby, ephemeris and RTC kept)
+//   → ACQUIRE (awake until the first valid fix: the measured TTFF)
+//   → HOLD (a few more epochs so the sampler sees a fresh fix)
+//   → OFF again, or CONTINUOUS as soon as the fix shows movement.
+// The off time adapts to the observed TTFF: a hot start lengthens it, a slow
+// start (ephemeris no longer usable) shortens it, and it never drops below
+// GNSS_DUTY_OFF_PER_TTFF times the average TTFF, where cycling would cost
+// more than it saves.
+#define GNSS_DUTY_STILL_S        120     // stationary this long before cycling starts
+#define GNSS_DUTY_HOLD_MS        3000    // stay awake after the first fix
+#define GNSS_DUTY_ACQUIRE_MAX_S  60      // give up on a wake without a fix after this
+#define GNSS_DUTY_OFF_MIN_S      20
+#define GNSS_DUTY_OFF_START_S    60
+#define GNSS_DUTY_OFF_MAX_S      240     // below SAMPLE_PARKED_MAX_S: one fresh fix per parked sample
+#define GNSS_DUTY_HOT_TTFF_MS    5000    // TTFF up to this counts as a hot start
+#define GNSS_DUTY_OFF_PER_TTFF   10      // off time >= this many average TTFFs
+
+enum GnssDutyState : uint8_t {
+  GNSS_DUTY_CONTINUOUS = 0,   // receiver on, watching for stillness
+  GNSS_DUTY_ACQUIRE,          // woken, waiting for the first valid fix
+  GNSS_DUTY_HOLD,             // fix found, awake for GNSS_DUTY_HOLD_MS
+  GNSS_DUTY_OFF,              // receiver in standby
+};
+
+enum GnssDutyAction : uint8_t {
+  GNSS_DUTY_NONE = 0,
+  GNSS_DUTY_SLEEP,            // put the receiver to sleep now
+  GNSS_DUTY_WAKE,             // wake the receiver now
+};
+
+/**
+ * Duty cycle state and TTFF / on-time bookkeeping
+ */
+struct GnssDuty {
+  GnssDutyState state;
+  uint32_t stateSinceMs;      // entered the current state
+  uint32_t stillSinceMs;      // continuous: stationary since
+  uint32_t offMs;             // current (adapted) off time
+  bool hasAnchor;             // position of the last fix before sleeping
+  int32_t anchorLatE7;
+  int32_t anchorLonE7;
+
+  // Metrics
+  uint32_t startMs;           // gnssDutyInit()
+  uint32_t awakeSinceMs;      // last wake
+  uint64_t onMs;              // receiver awake, finished intervals
+  uint32_t wakes;
+  uint32_t hotStarts;         // TTFF <= GNSS_DUTY_HOT_TTFF_MS
+  uint32_t timeouts;          // wakes without a fix
+  uint32_t ttffLastMs;
+  uint32_t ttffMaxMs;
+  uint32_t ttffAvgMs;         // moving average (1/4 weight per wake)
+};
+
+/**
+ * Start in continuous mode with the receiver on
+ * @param d Duty cycle state
+ * @param nowMs millis()
+ */
+void gnssDutyInit(GnssDuty& d, uint32_t nowMs);
+
+/**
+ * Advance the duty cycle; call after every decoded batch and at least once per second
+ * @param d Duty cycle state
+ * @param nowMs millis()
+ * @param fix Current parser state
+ * @param freshFix A valid position was decoded since the last call
+ * @return What to do with the receiver
+ */
+GnssDutyAction gnssDutyStep(GnssDuty& d, uint32_t nowMs, const NmeaFix& fix, bool freshFix);
+
+/**
+ * Time the receiver has been awake, extrapolated to one hour
+ * @param d Duty cycle state
+ * @param nowMs millis()
+ * @return Seconds awake per hour (3600 = always on)
+ */
+uint32_t gnssDutyOnSecPerHour(const GnssDuty& d, uint32_t nowMs);
+
+/**
+ * Short name of a state for logs
+ */
+const char* gnssDutyStateName(GnssDutyState s);
+
+#endif // GNSS_DUTY_H
@@ -0,0 +1,39 @@
+#ifndef GNSS_FRAMER_H
+#define GNSS_FRAMER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "gnss_uart.h"
+
+// Byte framer for the mixed NMEA / CASIC binary stream: '$' ... '\n' is a NMEA
+// line, 0xBA 0xCE len(2) ... is a binary frame of CASIC_HEADER_LEN + len +
+// CASIC_CHECKSUM_LEN bytes. Checksums are left to the decoders. Runs in the
+// UART reader task in mixed mode, and on the host in the capture replay.
+
+/**
+ * Framer state
+ */
+struct GnssFramer {
+  uint8_t cur[GNSS_FRAME_MAX + 1];
+  size_t len;                 // bytes in cur
+  size_t need;                // binary: total frame length once the header is in
+  uint8_t state;
+  uint32_t truncated;         // frames longer than GNSS_FRAME_MAX, dropped
+};
+
+/**
+ * Drop any partial frame and wait for the next sync
+ * @param fr Framer state
+ */
+void gnssFramerReset(GnssFramer& fr);
+
+/**
+ * Feed one byte
+ * @param fr Framer state
+ * @param b Byte from the UART
+ * @param kind Receives the kind of a completed frame
+ * @return true if the byte completed a frame: fr.cur / fr.len hold it until the next call
+ */
+bool gnssFramerByte(GnssFramer& fr, uint8_t b, GnssFrameKind& kind);
+
+#endif // GNSS_FRAMER_H
@@ -0,0 +1,104 @@
+#ifndef GNSS_UART_H
+#define GNSS_UART_H
+
+#include <Arduino.h>
+
+// Interrupt-driven GNSS receive path. In line mode the ESP-IDF UART driver
+// detects the '\n' that ends every NMEA sentence in hardware and posts an
+// event; in mixed mode (binary protocol) a byte framer splits the stream into
+// NMEA lines and CASIC binary frames. Either way a small reader task copies
+// each complete frame into a ring and notifies the consumer task, which
+// sleeps until then instead of polling the FIFO.
+#define GNSS_UART_NUM          UART_NUM_1
+#define GNSS_UART_BAUD         9600    // module default
+#define GNSS_UART_RX_BUF       2048    // driver ring, ~2 s of NMEA at 9600 baud
+#define GNSS_UART_QUEUE_LEN    20      // driver event queue
+#define GNSS_UART_RX_TIMEOUT   4       // mixed mode: UART_DATA after this many idle symbols
+#define GNSS_FRAME_MAX         96      // NMEA allows 82 chars; NAV-PV is 90 bytes
+#define GNSS_FRAME_SLOTS       16      // power of two
+#define GNSS_READER_PRIORITY   3       // above the application tasks: keeps the driver buffer drained
+#define GNSS_FRAMING_POLL_MS   50      // longest a framing request waits on an idle UART
+
+enum GnssFrameKind : uint8_t {
+  GNSS_FRAME_NMEA = 0,        // text line including the trailing "\r\n"
+  GNSS_FRAME_BINARY,          // CASIC frame, sync bytes to checksum
+};
+
+enum GnssFraming : uint8_t {
+  GNSS_FRAMING_LINES = 0,     // NMEA only, line ends found by the UART pattern detector
+  GNSS_FRAMING_MIXED,         // NMEA lines and binary frames, framed in software
+};
+
+/**
+ * One complete frame from the module
+ */
+struct GnssFrame {
+  uint32_t arrivalUs;         // micros() when the frame end was seen
+  GnssFrameKind kind;
+  uint8_t len;
+  char data[GNSS_FRAME_MAX + 1];   // NMEA lines are NUL-terminated
+};
+
+/**
+ * Receive path counters since gnssUartBegin()
+ */
+struct GnssUartStats {
+  uint32_t frames;            // delivered into the ring
+  uint32_t rxBytes;           // bytes read from the UART
+  uint32_t ringDrops;         // lost because the consumer fell behind
+  uint32_t truncated;         // longer than GNSS_FRAME_MAX, cut off or dropped
+  uint32_t overflows;         // driver FIFO/buffer overflows (input flushed)
+  uint64_t readerBusyUs;      // time spent in the reader task
+};
+
+/**
+ * Install the UART driver with '\n' pattern detection and start the reader task
+ * @param rxPin UART RX GPIO (module TX)
+ * @param txPin UART TX GPIO (module RX)
+ * @param consumer Task to notify (xTaskNotifyGive) per complete frame
+ * @return true on success
+ */
+bool gnssUartBegin(int rxPin, int txPin, TaskHandle_t consumer);
+
+/**
+ * Switch between line mode and mixed NMEA/binary framing
+ * Applied by the reader task after the UART event it is handling, or within
+ * GNSS_FRAMING_POLL_MS when the UART is idle.
+ * @param framing New framing
+ */
+void gnssUartSetFraming(GnssFraming framing);
+
+/**
+ * Change the UART baud rate (after the module has been told to switch)
+ * @param baud New baud rate
+ * @return true on success
+ */
+bool gnssUartSetBaud(uint32_t baud);
+
+/**
+ * Send bytes to the module and wait until they are on the wire
+ * @param data Bytes to send
+ * @param len Number of bytes
+ * @return true if everything was sent
+ */
+bool gnssUartWrite(const void* data, size_t len);
+
+/**
+ * Take the oldest complete frame out of the ring (consumer task only)
+ * @param out Receives the frame
+ * @return true if a frame was available
+ */
+bool gnssUartPop(GnssFrame& out);
+
+/**
+ * Drop everything received so far (consumer task only)
+ */
+void gnssUartDiscard();
+
+/**
+ * Copy the receive path counters
+ * @param out Receives the counters
+ */
+void gnssUartGetStats(GnssUartStats& out);
+
+#endif // GNSS_UART_H
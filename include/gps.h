@@ -2,7 +2,10 @@
 #define GPS_H
 
 #include <Arduino.h>
-#include <TinyGPSPlus.h>
+#include "nmea_parser.h"
+#include "gnss_duty.h"
+#include "kalman_filter.h"
+#include "pps_clock.h"
 
 
 // UART Pins (RX/TX communication with GPS module)
@@ -12,26 +15,129 @@
 #define VGNSS_CTRL 34   // active LOW
 #define GNSS_WAKE 40    // active HIGH
 #define GNSS_RST 42     // active LOW
-#define GNSS_PPS 41     // optional, not used in this code. Needed for precise timing applications
+#define GNSS_PPS 41     // 1 pulse per second at the start of each UTC second (pps_clock.h)
 
-// External GPS object (defined in gps.cpp)
-extern TinyGPSPlus GPS;
 
 // External antenna status variables (defined in gps.cpp)
 extern bool antennaOpen;
 extern uint32_t lastAntennaMsg;
 
+#define GPS_STATS_LOG_MS (10UL * 60UL * 1000UL)   // receive path stats to Serial every 10 min
+
+// Binary protocol: at init the module is asked (CASIC CFG-MSG, must be ACKed)
+// to send NAV-PV + NAV-TIMEUTC only, at GPS_BINARY_BAUD. Falls back to NMEA
+// @9600 if the module does not answer.
+#define GPS_BINARY_PROTOCOL 1
+#define GPS_BINARY_BAUD     115200
+#define GPS_HANDSHAKE_MS    1500      // per ACK
+
+// Duty cycling while stationary (gnss_duty.h). The receiver sleeps in standby
+// (GNSS_WAKE low): ephemeris, RTC and configuration survive, so wakes are hot
+// starts. GPS_DUTY_POWER_OFF cuts VGNSS_CTRL instead: lowest current, but the
+// module forgets everything and the protocol handshake runs on every wake.
+#define GPS_DUTY_CYCLE      1
+#define GPS_DUTY_POWER_OFF  0
+#define GPS_IDLE_WAKE_MS    1000      // GPS task runs at least this often when no frames arrive
+
+/**
+ * Receive path measurements since gpsInit()
+ */
+struct GpsStats {
+  bool binaryProtocol;        // CASIC binary in use (else NMEA)
+  uint32_t rxBytesPerSec;     // bytes on the wire from the module
+  uint32_t frames;            // complete sentences / binary frames received
+  uint32_t ringDrops;         // frames lost because the GPS task fell behind
+  uint32_t overflows;         // UART driver overflows
+  uint32_t fixLatencyAvgUs;   // frame end seen by the UART reader -> position committed
+  uint32_t fixLatencyMaxUs;
+  uint32_t cpuMsPerHour;      // reader + parser CPU time, extrapolated to one hour
+  uint32_t parseMsPerHour;    // parser/decoder and Kalman stage
+  uint32_t filterEpochs;      // Kalman steps
+  uint32_t filterGated;       // positions rejected as outliers
+
+  // Disciplined clock
+  ClockSource clockSource;
+  int32_t clockDriftPpb;      // esp_timer rate error, > 0 runs fast
+  uint32_t clockUncertaintyUs;
+  uint32_t ppsEdges;          // accepted PPS edges
+  uint32_t ppsGlitches;       // edges rejected as noise
+
+  // Duty cycling
+  GnssDutyState dutyState;
+  uint32_t onSecPerHour;      // receiver awake, extrapolated to one hour
+  uint32_t offTimeS;          // current adapted off time
+  uint32_t wakes;
+  uint32_t hotStarts;         // wakes with TTFF <= GNSS_DUTY_HOT_TTFF_MS
+  uint32_t wakeTimeouts;      // wakes without a fix
+  uint32_t ttffLastMs;        // time to first fix after a wake
+  uint32_t ttffAvgMs;
+  uint32_t ttffMaxMs;
+};
+
 /**
- * Initialize GPS module and UART serial communication
+ * Initialize GPS module and the interrupt-driven UART receive path
+ * Switches the module to the binary protocol when GPS_BINARY_PROTOCOL is set.
+ * Must run in the task that calls gpsUpdate(): that task is notified per frame.
  */
 void gpsInit();
 
 /**
- * Read and parse incoming GPS data from UART
- * Call this regularly in loop() to process GPS sentences
+ * Decode all complete sentences / binary frames received so far and run the
+ * duty cycle. Call after ulTaskNotifyTake() wakes the GPS task, and at least
+ * every GPS_IDLE_WAKE_MS while no frames arrive (receiver asleep).
  */
 void gpsUpdate();
 
+/**
+ * Get a consistent copy of the latest navigation state (any task)
+ * @param out Receives the fix
+ */
+void gpsGetFix(NmeaFix& out);
+
+/**
+ * Get a consistent copy of the Kalman-filtered position, speed and course (any task)
+ * One step per epoch with a valid position; valid is cleared while there is no fix.
+ * @param out Receives the filtered state
+ */
+void gpsGetFiltered(KalmanOutput& out);
+
+/**
+ * Time of the newest fix epoch
+ */
+struct GpsFixTime {
+  bool valid;
+  uint32_t utc;               // seconds since 1970-01-01 UTC
+  uint16_t ms;                // into that second: epochs finer than 1 s
+  ClockSource source;         // clock quality when the epoch was stamped
+};
+
+/**
+ * Get the stamp of the newest fix epoch (any task)
+ * The disciplined clock read when the fix arrived, floored to the receiver's
+ * epoch grid (KALMAN_EPOCH_MS); the fix's own time fields before the clock runs.
+ * @param out Receives the stamp; valid is false until some UTC is known
+ */
+void gpsGetFixTime(GpsFixTime& out);
+
+/**
+ * Read the PPS-disciplined UTC clock (any task)
+ * @param out Receives UTC with microseconds, source, uncertainty and drift
+ * @return false while no time message has been received
+ */
+bool gpsClockNow(ClockTime& out);
+
+/**
+ * Get receive path measurements
+ * @param out Receives the measurements
+ */
+void gpsGetStats(GpsStats& out);
+
+/**
+ * Check if the receiver is duty cycling (asleep, or awake only for a fix)
+ * While true, a fix without fixValid is the last one before the receiver slept.
+ */
+bool gpsIsDutyCycling();
+
 /**
  * Check if GPS has valid time data
  */
@@ -47,9 +153,4 @@ bool gpsHasLocation();
  */
 bool gpsAntennaStatusValid();
 
-/**
- * Return true for winter time and false for summer time (EU DST rules).
- */
-bool gpsIsWinterTime();
-
 #endif
@@ -4,15 +4,19 @@
 #include <Arduino.h>
 #include <stdint.h>
 
-#define TRACK_CAPACITY 1440 // 1 day @ 1 minute per fix (ring buffer capacity)
+#define TRACK_CAPACITY 256 // hot ring, uncompressed (power of two); ~2000 fixes with the compressed archive behind it
 
 /**
  * Get current timestamp in seconds
- * Uses GPS time if available and valid, otherwise falls back to millis()
- * @return Timestamp in seconds (either epoch or ms-based)
+ * UTC from the time service (time_service.h) if set, otherwise falls back to millis()
+ * @return Timestamp in seconds (either UTC epoch or ms-based)
  */
 uint32_t getTimestampSeconds();
 
-void sampleGPSFix();
+/**
+ * Offer the newest fix to the sampling policy (sample_policy.h) and store it
+ * when due. Call every SAMPLE_TICK_MS.
+ */
+void sampleGPSTick();
 
 #endif // GPS_SAMPLER_H
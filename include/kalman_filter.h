@@ -0,0 +1,86 @@
+#ifndef KALMAN_FILTER_H
+#define KALMAN_FILTER_H
+
+#include <stdint.h>
+#include "nmea_parser.h"
+
+// Constant-velocity Kalman filter over the GNSS fixes, integer arithmetic per
+// fix. Two independent axes (north, east) in a local tangent plane around an
+// origin near the track, position in mm and velocity in mm/s. Each epoch:
+//  - predict with white acceleration noise (KALMAN_ACCEL_MMS2, or the much
+//    smaller KALMAN_ACCEL_STILL_MMS2 while the filter is standing still)
+//  - update with the position, sigma = KALMAN_UERE_MM * HDOP (PDOP in binary
+//    mode); innovations beyond KALMAN_GATE_SIGMA are rejected as multipath
+//  - update with the Doppler velocity (speed + course) when the fix has one
+// Standing still, the velocity update pins the speed near zero and the
+// position settles on the average of the jitter instead of following it.
+#define KALMAN_UERE_MM          3000    // range error per unit of DOP
+#define KALMAN_DOP_DEFAULT      200     // HDOP * 100 when the fix has none
+#define KALMAN_VEL_SIGMA_MMS    300     // Doppler speed error
+#define KALMAN_ACCEL_MMS2       1500    // process noise: vehicle acceleration
+#define KALMAN_ACCEL_STILL_MMS2 150     // ... while the filter is below KALMAN_STILL_MMS
+#define KALMAN_GATE_SIGMA       5       // reject position innovations beyond this
+#define KALMAN_MAX_REJECTS      10      // ... unless this many in a row: restart there
+#define KALMAN_MAX_GAP_MS       10000   // longer gap between epochs: restart
+#define KALMAN_EPOCH_MS         1000    // receiver epoch: dt snaps to multiples of it
+#define KALMAN_ORIGIN_MAX_MM    20000000 // move the origin when the track is 20 km away
+#define KALMAN_STILL_MMS        500     // speed below which the device counts as stationary
+
+/**
+ * One axis: position, velocity and their covariance
+ */
+struct KalmanAxis {
+  int32_t pos;            // mm from the origin
+  int32_t vel;            // mm/s
+  int64_t p00;            // mm^2
+  int64_t p01;            // mm^2/s
+  int64_t p11;            // mm^2/s^2
+};
+
+/**
+ * Filter state
+ */
+struct KalmanFilter {
+  bool running;
+  int32_t originLatE7;
+  int32_t originLonE7;
+  int64_t mmPerDegLon;    // east scale at the origin latitude, mm per degree
+  uint32_t lastMs;        // time of the last epoch
+  KalmanAxis north;
+  KalmanAxis east;
+  uint8_t rejects;        // position innovations rejected in a row
+  uint16_t courseCdeg;    // last course while moving
+  uint32_t epochs;
+  uint32_t rejected;      // position updates gated out since start
+};
+
+/**
+ * Filtered state for consumers
+ */
+struct KalmanOutput {
+  bool valid;
+  int32_t latE7;
+  int32_t lonE7;
+  uint32_t speedCmS;
+  uint16_t courseCdeg;    // held while stationary
+  uint8_t stationaryPct;  // confidence that the true speed is below KALMAN_STILL_MMS
+  uint32_t sigmaCm;       // 1-sigma horizontal position uncertainty
+};
+
+/**
+ * Forget everything; the next fix starts the filter
+ * @param kf Filter state
+ */
+void kalmanReset(KalmanFilter& kf);
+
+/**
+ * Run one epoch
+ * @param kf Filter state
+ * @param nowMs Arrival time of the epoch (ms, monotonic)
+ * @param fix Fix of this epoch, fixValid must be set
+ * @param out Receives the filtered state
+ * @return false if the position was gated out (out holds the prediction)
+ */
+bool kalmanUpdate(KalmanFilter& kf, uint32_t nowMs, const NmeaFix& fix, KalmanOutput& out);
+
+#endif // KALMAN_FILTER_H
@@ -2,6 +2,7 @@
 #define LORA_MANAGER_H
 
 #include <Arduino.h>
+#include "track_storage.h"
 
 /**
  * Initialize LoRa radio and start transmission
@@ -16,9 +17,21 @@ void loraInit();
 void loraUpdate();
 
 /**
- * Send test payload with GPS data
+ * Send one fix as a one-fix v3 frame (FPort 4, see lora_payload.h)
+ * @param fix Stored fix, including quality and motion fields
+ * @return true if the uplink went out (unconfirmed: no delivery guarantee)
  */
-void sendPayload(int32_t ts, int32_t latE7, int32_t lonE7, uint8_t bat);
+bool sendPayload(const FixRec& fix);
+
+/**
+ * Send fixes as one v3 frame (FPort 4), as many as the current data
+ * rate's maximum payload holds, coordinates at LORA_COORD_PRECISION
+ * @param fixes Fixes in seq order
+ * @param n Number of fixes
+ * @param packed Output: number of fixes in the uplink (from the start of fixes)
+ * @return true if the uplink went out (unconfirmed: no delivery guarantee)
+ */
+bool sendBatch(const FixRec* fixes, size_t n, size_t& packed);
 
 void checkAndSend();
 
@@ -0,0 +1,102 @@
+#ifndef LORA_PAYLOAD_H
+#define LORA_PAYLOAD_H
+
+#include <Arduino.h>
+#include "track_storage.h"
+
+// Uplink payload codec, v3 (FPort 4): one frame carries one or more fixes in
+// seq order. Fixed fields are big-endian, the rest LEB128 varints (zigzag
+// for signed values).
+//
+//   0     version (LORA_FRAME_VERSION)
+//   1     (number of fixes - 1) << 2 | coordinate precision p
+//   2-5   frame epoch: ts of the first fix
+//   per fix:
+//     presence mask (LORA_FIELD_*): optional fields carried by this fix
+//     ts - previous ts         (zigzag; not for the first fix)
+//     lat, lon in 10^p E7 units: the first fix absolute, then the change
+//     present fields: bat, flags, dop, course as bytes, speed and altitude as
+//     zigzag changes (altitude from 0 when the previous one is unknown)
+// An absent field keeps the previous fix's value; before the first fix that
+// is bat 0, flags 0, dop 0, course and altitude unknown, speed 0.
+//
+// A frame of one fix has a shorter single-fix form with fixed-width
+// coordinates, marked by LORA_FRAME_SINGLE in the version byte:
+//
+//   0     LORA_FRAME_SINGLE | p << 5 | LORA_SINGLE_MORE if byte 1 is there
+//         | bat and flags presence (mask & 3) << 2 | version (low two bits)
+//   1     only with LORA_SINGLE_MORE: presence mask >> 2 (dop, course,
+//         speed, altitude; not 0)
+//   +4    ts
+//   +3    lat in 10^p E7 units (int24)
+//   +3    lon in 10^p E7 units (int24)
+//   present fields as for the first fix of a frame
+//
+// It is used whenever both coordinates fit 24 bits and it is no longer than
+// the frame would be, and only then (at p = 2 that is within 83.8 degrees of
+// the equator and the prime meridian, at p = 3 everywhere).
+//
+// Precision p quantizes coordinates to 10^p E7 (p = 2: 1e-5 degrees, 1.1 m),
+// rounded half away from zero. Decoding is strict: a frame is either the
+// encoder's exact output for the fixes it decodes to (minimal varints,
+// present fields differ from the previous value, coordinates in range) or
+// rejected, so a new layout needs a new version.
+//
+// A moving fix 30 s / 200 m after the previous one takes about 10 bytes at
+// p = 2 with every field changing, a parked one 5; the frame adds 6. A lone
+// fix with every field takes 20 bytes, one with battery level and flags but
+// unknown or default v2 fields (a heartbeat without fix quality) 13.
+// Older firmware sent v2 (20 bytes, FPort 2), v1
+// (13 bytes, FPort 1) and an unversioned E7 batch (FPort 3); the TTN payload
+// formatter still decodes them.
+#define LORA_FPORT_FRAME        4
+#define LORA_FRAME_VERSION      3
+#define LORA_FRAME_HEADER_BYTES 6
+#define LORA_FRAME_SINGLE       0x80    // version byte flag: single-fix form
+#define LORA_SINGLE_MORE        0x10    // single-fix form: mask byte for the v2 fields follows
+#define LORA_SINGLE_HEADER_BYTES 11     // single-fix form up to the fields, without the v2 mask byte
+#define LORA_FRAME_MAX_FIXES    64
+#define LORA_FRAME_MAX_BYTES    222     // largest EU868 payload (DR4 and up); the data rate's limit applies
+#define LORA_COORD_PRECISION    2       // uplink coordinates in 1e-5 degrees (1.1 m, below GPS noise)
+
+#define LORA_FIELD_BAT          0x01
+#define LORA_FIELD_FLAGS        0x02
+#define LORA_FIELD_DOP          0x04
+#define LORA_FIELD_COURSE       0x08
+#define LORA_FIELD_SPEED        0x10
+#define LORA_FIELD_ALT          0x20
+
+/**
+ * Coordinate as it decodes from a frame of a given precision
+ * @param e7 Latitude or longitude, E7 degrees
+ * @param precision Coordinate precision p (0-3)
+ * @return e7 rounded to a multiple of 10^p
+ */
+int32_t loraQuantizeE7(int32_t e7, uint8_t precision);
+
+/**
+ * Encode as many fixes as fit into one frame, oldest first
+ * Coordinates outside +-90 / +-180 degrees are clamped.
+ * @param fixes Fixes in seq order
+ * @param n Number of fixes
+ * @param precision Coordinate precision p (0-3)
+ * @param out Output buffer
+ * @param maxLen Frame size limit (maximum payload of the current data rate)
+ * @param packed Output: number of fixes encoded (from the start of fixes)
+ * @return Frame length in bytes, 0 if not even one fix fits
+ */
+size_t loraEncodeFrame(const FixRec* fixes, size_t n, uint8_t precision, uint8_t* out, size_t maxLen,
+                       size_t& packed);
+
+/**
+ * Decode a frame (seqs are set to 0)
+ * @param p Payload
+ * @param len Payload length
+ * @param out Decoded fixes
+ * @param maxN Size of out
+ * @return Number of fixes decoded, 0 if the frame is malformed, of another
+ *         version or larger than maxN
+ */
+size_t loraDecodeFrame(const uint8_t* p, size_t len, FixRec* out, size_t maxN);
+
+#endif // LORA_PAYLOAD_H
@@ -0,0 +1,68 @@
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <stdint.h>
+
+// Motion state of the device, the one notion of "moving" behind the
+// FL_MOVE_ACTIVE / FL_EVT_MOVE_START / FL_EVT_MOVE_STOP flags of every stored
+// fix. The sampler feeds it every valid fix (filtered position and speed):
+//   STILL  → MOVING: speed >= MOTION_START_CMS for MOTION_START_S seconds, or
+//                    MOTION_START_M away from where it stopped (a duty-cycled
+//                    receiver waking up elsewhere)
+//   MOVING → STILL:  speed <= MOTION_STOP_CMS after staying within
+//                    MOTION_DWELL_M for MOTION_DWELL_S seconds (a red light
+//                    is not a stop)
+// Each transition leaves an edge flag pending until a stored fix carries it.
+#define MOTION_START_CMS   150     // = SAMPLE_MOVING_CMS (5.4 km/h)
+#define MOTION_START_S     3       // start speed held this long (Doppler spikes while parked)
+#define MOTION_START_M     50      // = SAMPLE_PARKED_MOVE_M
+#define MOTION_STOP_CMS    60      // ~2 km/h
+#define MOTION_DWELL_M     25      // radius of a stop
+#define MOTION_DWELL_S     60      // time within it that makes a stop
+
+/**
+ * Motion state
+ */
+struct MotionState {
+  bool moving;
+  bool fast;                  // at or above MOTION_START_CMS, since fastSinceS
+  uint32_t fastSinceS;
+  bool hasAnchor;             // still: where it stopped; moving: start of the current dwell
+  int32_t anchorLatE7;
+  int32_t anchorLonE7;
+  uint32_t anchorSinceS;
+  uint8_t pending;            // FL_EVT_MOVE_START / FL_EVT_MOVE_STOP not stored yet
+  uint32_t starts;            // transitions since reset
+  uint32_t stops;
+};
+
+/**
+ * Start still, with no position
+ * @param m Motion state
+ */
+void motionReset(MotionState& m);
+
+/**
+ * Feed one valid fix
+ * @param m Motion state
+ * @param nowS Monotonic seconds
+ * @param latE7 Latitude, E7 degrees
+ * @param lonE7 Longitude, E7 degrees
+ * @param speedCmS Speed over ground, cm/s
+ * @return true if the state changed (an edge is now pending)
+ */
+bool motionUpdate(MotionState& m, uint32_t nowS, int32_t latE7, int32_t lonE7, uint32_t speedCmS);
+
+/**
+ * Flags for the next stored fix: FL_MOVE_ACTIVE plus pending edges
+ * @param m Motion state
+ */
+uint8_t motionFlags(const MotionState& m);
+
+/**
+ * Record that a fix carrying motionFlags() was stored (clears the edges)
+ * @param m Motion state
+ */
+void motionStored(MotionState& m);
+
+#endif // MOTION_H
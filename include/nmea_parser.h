@@ -0,0 +1,100 @@
+#ifndef NMEA_PARSER_H
+#define NMEA_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Table-driven NMEA 0183 parser for complete sentences. One pass over the
+// line checks the checksum and converts the fields of RMC/GGA/GSA/VTG/TXT
+// straight into fixed-point integers (coordinates in E7 degrees); nothing is
+// allocated and no floating point is involved. Values are committed only when
+// the checksum matches.
+#define NMEA_MAX_FIELDS   20      // highest field index looked at (GSA VDOP = 17)
+#define NMEA_TEXT_MAX     64      // TXT message text kept
+
+/**
+ * Sentence types the parser understands (any talker: GP, GN, GL, BD, ...)
+ */
+enum NmeaSentenceType : uint8_t {
+  NMEA_UNKNOWN = 0,
+  NMEA_RMC,
+  NMEA_GGA,
+  NMEA_GSA,
+  NMEA_VTG,
+  NMEA_TXT,
+};
+
+/**
+ * What a sentence changed
+ */
+enum NmeaEvent : uint8_t {
+  NMEA_EV_NONE = 0,       // sentence type not handled, skipped
+  NMEA_EV_BAD,            // malformed or checksum mismatch, nothing committed
+  NMEA_EV_FIX,            // RMC/GGA with a position: fix updated
+  NMEA_EV_NO_FIX,         // RMC/GGA without a position (time may have been updated)
+  NMEA_EV_STATUS,         // GSA/VTG: fix mode, DOP, speed or course updated
+  NMEA_EV_TEXT,           // TXT: message in NmeaParser::text
+};
+
+/**
+ * Latest navigation state assembled from the sentences seen so far
+ */
+struct NmeaFix {
+  bool hasLocation;       // a position has been received at least once
+  bool fixValid;          // the newest RMC/GGA carried a position
+  int32_t latE7;          // degrees * 1e7
+  int32_t lonE7;
+  int32_t altCm;          // altitude above mean sea level (GGA)
+  bool hasAltitude;
+
+  bool hasTime;           // UTC
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t second;
+  uint8_t centisecond;
+  bool hasDate;
+  uint8_t day;
+  uint8_t month;
+  uint16_t year;
+
+  bool hasSpeed;
+  uint32_t speedCmS;      // ground speed, cm/s
+  bool hasCourse;
+  uint16_t courseCdeg;    // course over ground, 1/100 degree
+
+  uint8_t quality;        // GGA fix quality (0 = invalid)
+  uint8_t fixMode;        // GSA: 1 = no fix, 2 = 2D, 3 = 3D
+  uint8_t sats;           // satellites used (GGA)
+  uint16_t hdopX100;      // dilution of precision * 100 (0 = unknown)
+  uint16_t pdopX100;
+  uint16_t vdopX100;
+};
+
+/**
+ * Parser state: the assembled fix plus counters
+ */
+struct NmeaParser {
+  NmeaFix fix;
+  char text[NMEA_TEXT_MAX + 1];   // newest TXT message, NUL-terminated
+  uint32_t parsed;                // sentences committed
+  uint32_t badChecksum;           // checksum missing or wrong
+  uint32_t skipped;               // sentence types not handled
+};
+
+/**
+ * Reset a parser to "nothing received"
+ * @param p Parser
+ */
+void nmeaInit(NmeaParser& p);
+
+/**
+ * Parse one complete sentence
+ * Leading bytes before '$' and the trailing "\r\n" are ignored.
+ * @param p Parser; p.fix / p.text are updated when the checksum matches
+ * @param line Sentence text (need not be NUL-terminated)
+ * @param len Number of bytes in line
+ * @return What the sentence changed
+ */
+NmeaEvent nmeaParse(NmeaParser& p, const char* line, size_t len);
+
+#endif // NMEA_PARSER_H
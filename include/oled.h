@@ -7,7 +7,7 @@
 #include "HT_SSD1306Wire.h"
 #include "HT_DisplayUi.h"
 #include "images.h"
-#include <TimeLib.h>    // for clock display
+#include "time_service.h" // for clock display
 #include "gps.h"        // for GPS data access
 #include "button.h"     // for button state access
 #include <WiFi.h>       // for WiFi status access
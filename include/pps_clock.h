@@ -0,0 +1,105 @@
+#ifndef PPS_CLOCK_H
+#define PPS_CLOCK_H
+
+#include <stdint.h>
+
+// UTC clock disciplined by the receiver's PPS output. Each PPS edge is
+// timestamped against esp_timer (us, from the GPIO interrupt); the time
+// message that follows names the second the edge started. A PI loop on the
+// phase error between each edge and the clock's own prediction for it keeps
+// the anchor on the edges and learns the rate error of the local oscillator
+// (drift); between edges, and through PPS outages, the clock extrapolates with
+// that drift.
+// Without PPS it falls back to the NMEA/binary time messages: their arrival
+// is late by the receiver's output delay, so the earliest arrival seen is the
+// best bound on the start of a second (a min filter that slowly leaks later).
+#define PPS_EDGE_TOLERANCE_US   1000    // interval error beyond this (1000 ppm) is a glitch, not drift
+#define PPS_PHASE_CLIP_US       20      // phase error the loop reacts to, plus 2x jitter (late interrupts)
+#define PPS_LOOP_P              8       // phase correction 1/P per edge
+#define PPS_LOOP_I              256     // drift correction 1/I of the phase error per second
+#define PPS_MAX_GAP_S           10      // missed edges bridged by counting seconds
+#define PPS_LOST_US             1500000 // no edge for this long: holdover
+#define PPS_HOLDOVER_PPB        2000    // drift error assumed in holdover (crystal over temperature)
+#define PPS_ISR_LATENCY_US      5       // typical edge -> esp_timer_get_time() in the interrupt
+#define PPS_NMEA_CREEP_US       20      // NMEA min filter leak per label (20 ppm)
+#define PPS_NMEA_BIAS_US        100000  // unknown output delay of the receiver in NMEA mode
+
+enum ClockSource : uint8_t {
+  CLOCK_NONE = 0,         // no time yet
+  CLOCK_NMEA,             // from message arrival times, ~100 ms
+  CLOCK_PPS,              // PPS edges, a few us
+  CLOCK_HOLDOVER,         // PPS lost, extrapolating with the last drift
+};
+
+/**
+ * Clock state (owned by the GPS task; copied out for other tasks)
+ */
+struct PpsClock {
+  ClockSource anchorSource;   // what set the anchor
+  int64_t anchorUs;           // esp_timer at the start of second anchorUtc
+  uint32_t anchorUtc;         // seconds since 1970-01-01 UTC
+  bool anchorOnEdge;          // anchor follows the PPS edge chain
+
+  int64_t lastEdgeUs;         // newest PPS edge
+  int32_t driftPpb;           // local timer rate error: > 0 runs fast
+  uint32_t jitterNs;          // moving average of the loop's |phase error|
+  uint32_t nmeaSpreadUs;      // moving average of NMEA arrival lag above the bound
+
+  uint32_t edges;             // accepted PPS edges
+  uint32_t glitches;          // edges rejected as noise
+  uint32_t labels;            // time messages seen
+  uint32_t relabels;          // message disagreed with the counted second
+};
+
+/**
+ * Time read from the clock
+ */
+struct ClockTime {
+  uint32_t utc;               // seconds since 1970-01-01 UTC
+  uint32_t us;                // 0..999999 into that second
+  ClockSource source;
+  uint32_t uncertaintyUs;     // rough 1-sigma
+  int32_t driftPpb;
+};
+
+/**
+ * Forget everything
+ * @param c Clock state
+ */
+void ppsClockReset(PpsClock& c);
+
+/**
+ * Feed one PPS edge
+ * @param c Clock state
+ * @param edgeUs esp_timer_get_time() taken in the interrupt
+ */
+void ppsClockEdge(PpsClock& c, int64_t edgeUs);
+
+/**
+ * Feed a time message of a new epoch
+ * @param c Clock state
+ * @param utc The second the message reports (seconds since 1970, whole epoch)
+ * @param msgUs esp_timer when the message arrived
+ */
+void ppsClockLabel(PpsClock& c, uint32_t utc, int64_t msgUs);
+
+/**
+ * Read the clock
+ * @param c Clock state
+ * @param nowUs esp_timer_get_time()
+ * @param out Receives UTC, source and uncertainty
+ * @return false while the clock has no time
+ */
+bool ppsClockRead(const PpsClock& c, int64_t nowUs, ClockTime& out);
+
+/**
+ * Seconds since 1970-01-01 for a UTC calendar date and time
+ */
+uint32_t utcFromCivil(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second);
+
+/**
+ * Short name of a clock source for logs
+ */
+const char* clockSourceName(ClockSource s);
+
+#endif // PPS_CLOCK_H
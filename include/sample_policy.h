@@ -0,0 +1,82 @@
+#ifndef SAMPLE_POLICY_H
+#define SAMPLE_POLICY_H
+
+#include <stdint.h>
+
+// Speed/heading/distance driven sampling. The sampler offers the newest fix
+// once per SAMPLE_TICK_MS; the policy stores it when the track since the last
+// stored fix could no longer be drawn as a straight line at the wanted density:
+//  - moving: after SAMPLE_MAX_GAP_M, on a heading change of SAMPLE_TURN_DEG,
+//    at the latest every SAMPLE_MOVING_MAX_S
+//  - stationary: every SAMPLE_PARKED_MAX_S, or once it has drifted SAMPLE_PARKED_MOVE_M
+// Never more often than SAMPLE_MIN_INTERVAL_S.
+#define SAMPLE_TICK_MS          1000
+#define SAMPLE_MIN_INTERVAL_S   2       // lower bound between stored fixes
+#define SAMPLE_MOVING_MAX_S     30      // upper bound while moving (the former fixed rate)
+#define SAMPLE_PARKED_MAX_S     300     // upper bound while stationary
+#define SAMPLE_MAX_GAP_M        200     // distance between stored fixes at speed
+#define SAMPLE_TURN_DEG         25      // heading change that marks a corner
+#define SAMPLE_TURN_MIN_M       15      // ... once the fix has moved at least this far
+#define SAMPLE_MOVING_CMS       150     // speed above which the device counts as moving (5.4 km/h)
+#define SAMPLE_PARKED_MOVE_M    50      // drift that ends "stationary" even without speed
+
+enum SampleReason : uint8_t {
+  SAMPLE_NONE = 0,
+  SAMPLE_FIRST,           // nothing stored yet
+  SAMPLE_DISTANCE,
+  SAMPLE_TURN,
+  SAMPLE_MOVING_MAX,
+  SAMPLE_PARKED_MAX,
+  SAMPLE_PARKED_MOVE,
+  SAMPLE_FENCE,           // geofence enter/exit (decided by the sampler, not the policy)
+  SAMPLE_MOTION,          // started or stopped moving (motion.h)
+};
+
+/**
+ * The fix offered to the policy
+ */
+struct SampleInput {
+  uint32_t nowS;          // monotonic seconds
+  int32_t latE7;
+  int32_t lonE7;
+  uint32_t speedCmS;
+  uint16_t courseCdeg;
+  bool hasCourse;
+};
+
+/**
+ * Policy state: the last stored fix
+ */
+struct SamplePolicy {
+  bool hasLast;
+  SampleInput last;
+  uint32_t stored;        // fixes stored since start
+};
+
+/**
+ * Forget the last stored fix (the next offer is stored)
+ * @param p Policy state
+ */
+void samplePolicyReset(SamplePolicy& p);
+
+/**
+ * Decide whether to store a fix
+ * @param p Policy state
+ * @param in Newest fix
+ * @return Why the fix should be stored, SAMPLE_NONE to skip it
+ */
+SampleReason samplePolicyDue(const SamplePolicy& p, const SampleInput& in);
+
+/**
+ * Record that a fix was stored
+ * @param p Policy state
+ * @param in The stored fix
+ */
+void samplePolicyStored(SamplePolicy& p, const SampleInput& in);
+
+/**
+ * Short name of a reason for logs
+ */
+const char* sampleReasonName(SampleReason r);
+
+#endif // SAMPLE_POLICY_H
@@ -0,0 +1,80 @@
+#ifndef TIME_SERVICE_H
+#define TIME_SERVICE_H
+
+#include <stdint.h>
+
+// One place for wall-clock time. The service keeps the UTC second that
+// started at a given esp_timer instant (the monotonic clock); the GPS task
+// moves that base along with the PPS-disciplined clock (pps_clock.h).
+// nowUtc() is two loads and a 32-bit division, from any task, without
+// touching the fix. Everything stored or sent is UTC; local time exists for
+// the display only, from a DST table computed at compile time.
+#define TIME_ZONE_STD_S     3600    // CET: UTC+1
+#define TIME_ZONE_DST_S     3600    // CEST adds one hour (EU rules)
+#define TIME_DST_FIRST_YEAR 2020
+#define TIME_DST_YEARS      80      // table covers 2020..2099; outside it: standard time
+#define TIME_VALID_UTC      1577836800UL  // 2020-01-01: anything earlier is not a GNSS time
+
+/**
+ * Local wall-clock time for display
+ */
+struct LocalTime {
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t second;
+  bool summer;            // DST in effect
+};
+
+/**
+ * Move the UTC base (GPS task, after each clock update)
+ * @param utc Current UTC second
+ * @param us Microseconds into that second
+ * @param monoUs esp_timer_get_time() the reading belongs to
+ */
+void timeServiceSync(uint32_t utc, uint32_t us, int64_t monoUs);
+
+/**
+ * Forget the UTC base (e.g. the clock reports no time any more)
+ */
+void timeServiceClear();
+
+/**
+ * Check if UTC is known
+ */
+bool timeIsSet();
+
+/**
+ * Current UTC
+ * @return Seconds since 1970-01-01 UTC, 0 while unknown
+ */
+uint32_t nowUtc();
+
+/**
+ * Current UTC with milliseconds
+ * @param ms Receives milliseconds into the second
+ * @return Seconds since 1970-01-01 UTC, 0 while unknown
+ */
+uint32_t nowUtcMs(uint16_t& ms);
+
+/**
+ * Check if EU summer time is in effect (last Sunday of March 01:00 UTC to
+ * last Sunday of October 01:00 UTC)
+ * @param utc Seconds since 1970-01-01 UTC
+ */
+bool isSummerTime(uint32_t utc);
+
+/**
+ * Offset of the display time zone from UTC
+ * @param utc Seconds since 1970-01-01 UTC
+ * @return TIME_ZONE_STD_S, plus TIME_ZONE_DST_S during summer time
+ */
+int32_t localOffsetS(uint32_t utc);
+
+/**
+ * Local time of day for display
+ * @param utc Seconds since 1970-01-01 UTC
+ * @param out Receives hour, minute, second and the DST flag
+ */
+void localTimeOfDay(uint32_t utc, LocalTime& out);
+
+#endif // TIME_SERVICE_H
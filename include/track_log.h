@@ -0,0 +1,46 @@
+#ifndef TRACK_LOG_H
+#define TRACK_LOG_H
+
+#include <Arduino.h>
+#include "track_storage.h"
+
+// Persistent append-only log behind the track store (LittleFS, "spiffs" partition).
+// Every stored fix and every ack watermark/floor change is appended as a CRC-protected
+// record, so unacked fixes survive resets, brownouts and watchdog reboots (all but
+// the last TRACK_LOG_FLUSH_MS of them, which are still in the RAM page).
+#define TRACK_LOG_DIR           "/track"
+#define TRACK_LOG_SEGMENT_BYTES 16384   // rotate to a new segment file at this size
+#define TRACK_LOG_MAX_SEGMENTS  12      // oldest segment is deleted beyond this once fully acked (~190 KB)
+#define TRACK_LOG_HARD_SEGMENTS 24      // beyond this the oldest goes even with unacked fixes (~390 KB)
+#define TRACK_LOG_PAGE_BYTES    512     // records are batched in RAM and written a page at a time
+#define TRACK_LOG_FLUSH_MS      60000   // max age of a buffered record before it is forced to flash
+
+/**
+ * Mount the filesystem and replay the log into the (already initialized) track store.
+ * Rebuilds the ring contents, next seq, acked timestamp and ack floor.
+ * Selective acks above the floor are not persisted; those records are re-sent once.
+ * Call from the GPS sampler task right after initTrackStore().
+ * @return true if the log is usable, false if storage stays RAM-only
+ */
+bool trackLogInit();
+
+/**
+ * Append a stored fix to the log (buffered; single writer = GPS sampler task).
+ * The page goes to flash when it is full, TRACK_LOG_FLUSH_MS old, or at once
+ * for an event fix (FL_EVT_IMMEDIATE).
+ * @param rec Fix record as pushed into the track store (seq assigned)
+ */
+void trackLogAppend(const FixRec& rec);
+
+/**
+ * Periodic housekeeping from the sampler task: records ack watermark/floor changes
+ * and flushes buffered records older than TRACK_LOG_FLUSH_MS.
+ */
+void trackLogService();
+
+/**
+ * Write all buffered records to flash now
+ */
+void trackLogFlush();
+
+#endif // TRACK_LOG_H
@@ -0,0 +1,68 @@
+#ifndef TRACK_SCAN_H
+#define TRACK_SCAN_H
+
+#include <Arduino.h>
+#include <stddef.h>
+
+// Batch kernels over single track store columns (structure of arrays).
+// Every kernel is a straight branch-free loop over one or two columns, so the
+// compiler can unroll/vectorize it and a scan only touches the bytes it needs
+// (1 byte per record for flags, 4 for ts, 8 for a position).
+
+/**
+ * Bounding box in E7 degrees (inclusive)
+ */
+struct TrackBox {
+  int32_t minLatE7;
+  int32_t maxLatE7;
+  int32_t minLonE7;
+  int32_t maxLonE7;
+};
+
+/**
+ * Count timestamps <= t. On a non-decreasing ts column this is the index of
+ * the first record with ts > t.
+ * @param ts Timestamp column
+ * @param n Number of records
+ * @param t Timestamp to compare against
+ * @return Number of records with ts <= t
+ */
+size_t scanCountTsAtMost(const uint32_t* ts, size_t n, uint32_t t);
+
+/**
+ * Mark records with any of the given flags set
+ * @param flags Flags column
+ * @param n Number of records
+ * @param mask Flags to look for
+ * @param hit Output: 1 for a match, 0 otherwise (n entries)
+ * @return Number of matches
+ */
+size_t scanFlagsAny(const uint8_t* flags, size_t n, uint8_t mask, uint8_t* hit);
+
+/**
+ * Mark records inside a bounding box
+ * @param latE7 Latitude column
+ * @param lonE7 Longitude column
+ * @param n Number of records
+ * @param box Box to test against
+ * @param hit Output: 1 inside, 0 outside (n entries)
+ * @return Number of records inside
+ */
+size_t scanInBox(const int32_t* latE7, const int32_t* lonE7, size_t n, const TrackBox& box, uint8_t* hit);
+
+/**
+ * Grow a bounding box over records
+ * Start from trackBoxEmpty() to get the bounds of the records alone.
+ * @param latE7 Latitude column
+ * @param lonE7 Longitude column
+ * @param n Number of records
+ * @param box Box to extend
+ */
+void scanBounds(const int32_t* latE7, const int32_t* lonE7, size_t n, TrackBox& box);
+
+/**
+ * Empty box (min > max), the identity for scanBounds()
+ */
+TrackBox trackBoxEmpty();
+
+#endif // TRACK_SCAN_H
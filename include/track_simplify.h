@@ -0,0 +1,50 @@
+#ifndef TRACK_SIMPLIFY_H
+#define TRACK_SIMPLIFY_H
+
+#include <Arduino.h>
+#include "track_storage.h"
+
+// Streaming line simplification between the track store and the uplinks.
+// Opening-window variant of Douglas-Peucker: a fix is dropped when it lies
+// within SIMPLIFY_TOLERANCE_M of the straight line between the fixes kept
+// around it. Event fixes are always kept.
+#define SIMPLIFY_TOLERANCE_M  15.0f   // max distance of a dropped fix from the simplified track
+#define SIMPLIFY_MAX_WINDOW   60      // fixes held undecided at most (= MAX_UPLOAD_BATCH_SIZE)
+#define SIMPLIFY_MAX_SPAN_S   300     // a straight stretch still gets a fix at least this often
+#define SIMPLIFY_KEEP_FLAGS   (FL_EVT_MOVE_START | FL_EVT_MOVE_STOP | FL_EVT_HEARTBEAT | FL_EVT_FENCE)
+
+/**
+ * Simplifier state of one uplink. The anchor is the last fix kept; fixes up
+ * to it are decided, later ones are fed again until their window closes.
+ */
+struct SimplifyState {
+  float toleranceM = SIMPLIFY_TOLERANCE_M;
+  bool hasAnchor = false;
+  FixRec anchor;
+  // Statistics since boot
+  uint32_t seen = 0;          // fixes decided
+  uint32_t kept = 0;          // fixes kept
+  float maxDeviationM = 0;    // largest distance of a dropped fix from the simplified track
+};
+
+/**
+ * Run the simplifier over consecutive leased fixes
+ * Decides a prefix of the lease: keep[i] = 1 for fixes that stay in the track,
+ * 0 for dropped ones. Fixes after the prefix are still inside the open window;
+ * lease them again (with newer fixes) on the next call. Fixes at or before the
+ * anchor were decided earlier and come back with keep[i] = 1.
+ * @param st Simplifier state of the uplink
+ * @param lease Consecutive fixes, oldest first
+ * @param keep Output: keep flag per leased fix (lease.count entries)
+ * @return Number of decided fixes at the start of the lease
+ */
+size_t simplifyRun(SimplifyState& st, const TrackLease& lease, uint8_t* keep);
+
+/**
+ * Restart the simplified track at a fix that was sent on its own
+ * @param st Simplifier state of the uplink
+ * @param rec New anchor
+ */
+void simplifyReset(SimplifyState& st, const FixRec& rec);
+
+#endif // TRACK_SIMPLIFY_H
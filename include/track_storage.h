@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include <stddef.h>
+#include "track_scan.h"
 
 // Flags bitfield for FixRec
 static constexpr uint8_t FL_CHARGING       = 1u << 0;  // 1 = charging
@@ -12,9 +13,25 @@ static constexpr uint8_t FL_EVT_MOVE_START = 1u << 3;  // edge: start moving
 static constexpr uint8_t FL_EVT_MOVE_STOP  = 1u << 4;  // edge: stop moving
 static constexpr uint8_t FL_EVT_HEARTBEAT  = 1u << 5;  // heartbeat uplink
 static constexpr uint8_t FL_LOW_BATTERY    = 1u << 6;  // bat <= 15%
-// bit 7 reserved for future
+static constexpr uint8_t FL_EVT_FENCE      = 1u << 7;  // edge: entered or left a geofence (details: geofenceEventsAt)
+// Events stored at once and sent on both uplinks without waiting for their intervals
+static constexpr uint8_t FL_EVT_IMMEDIATE  = FL_EVT_MOVE_START | FL_EVT_MOVE_STOP | FL_EVT_FENCE;
 
-// GPS fix record
+// Compressed archive behind the hot ring. Records older than the hot ring
+// (TRACK_CAPACITY) are kept delta/varint coded in fixed-size blocks,
+// 9.5 bytes per fix on the track_bench corpus instead of 24 in the ring.
+#define TRACK_BLOCK_MAX_FIXES 64    // records per block (keyframe + deltas)
+#define TRACK_BLOCK_BYTES     512   // coded payload per block
+#define TRACK_ARCHIVE_BLOCKS  30    // whole store 27.7 KB, ~2000 fixes (old 1440-fix ring: 28 KB)
+
+// Record format version. v1 ended at flags; v2 adds the quality and motion
+// fields behind it. Older records read back with those fields unknown.
+#define FIX_REC_VERSION 2
+
+#define FIX_COURSE_UNKNOWN 0xFF     // FixRec::course2
+#define FIX_ALT_UNKNOWN    INT16_MIN  // FixRec::altDm
+
+// GPS fix record (24 bytes)
 struct FixRec {
   uint32_t seq;     // sequence number
   uint32_t ts;      // epoch seconds if we have it, else millis()/1000
@@ -22,21 +39,220 @@ struct FixRec {
   int32_t  lonE7;   // longitude in microdegrees
   uint8_t  bat;     // battery percentage (0-100), 0 if unknown
   uint8_t  flags;   // bitfield: charging, gps_valid, move_active, events, low_bat
+  // v2
+  uint8_t  dop;     // packed: satellites used (high nibble, 15 = 15 or more), HDOP in 0.5 steps (low nibble, 15 = 7.5 or worse); 0 = unknown
+  uint8_t  course2; // course over ground in 2 degree steps (0-179), FIX_COURSE_UNKNOWN
+  uint16_t speedCmS;  // ground speed, cm/s
+  int16_t  altDm;   // altitude above mean sea level, dm (+-3276 m), FIX_ALT_UNKNOWN
+};
+
+static_assert(sizeof(FixRec) == 24, "FixRec must stay within 24 bytes");
+
+/**
+ * Pack HDOP and satellite count into FixRec::dop
+ * @param hdopX100 HDOP * 100, 0 if unknown
+ * @param sats Satellites used
+ */
+inline uint8_t fixPackDop(uint16_t hdopX100, uint8_t sats) {
+  uint8_t h = hdopX100 ? (uint8_t)(hdopX100 >= 750 ? 15 : (hdopX100 + 49) / 50) : 0;   // rounded up: never better than measured
+  return (uint8_t)((sats > 15 ? 15 : sats) << 4 | h);
+}
+
+/**
+ * HDOP * 10 from FixRec::dop (0 = unknown)
+ */
+inline uint8_t fixHdopX10(uint8_t dop) {
+  return (uint8_t)((dop & 0x0F) * 5);
+}
+
+/**
+ * Satellites used from FixRec::dop
+ */
+inline uint8_t fixSats(uint8_t dop) {
+  return dop >> 4;
+}
+
+/**
+ * Course over ground for FixRec::course2
+ * @param courseCdeg Course in 1/100 degree (0-35999)
+ */
+inline uint8_t fixPackCourse(uint16_t courseCdeg) {
+  return (uint8_t)((courseCdeg + 100) / 200 % 180);
+}
+
+/**
+ * Altitude for FixRec::altDm, clamped to the representable range
+ * @param altCm Altitude above mean sea level in cm
+ */
+inline int16_t fixPackAlt(int32_t altCm) {
+  int32_t dm = altCm / 10;
+  if (dm > INT16_MAX) return INT16_MAX;
+  if (dm <= INT16_MIN) return INT16_MIN + 1;  // INT16_MIN is FIX_ALT_UNKNOWN
+  return (int16_t)dm;
+}
+
+// Selective acks: one 32-bit bitmap word per 32 consecutive seqs, enough
+// words to cover hot ring + archive (power of two)
+#define TRACK_ACK_WORDS 256         // 8192 seqs, 2 KB RAM
+
+// Zero-copy read leases (see trackStoreAcquire)
+#define TRACK_MAX_LEASES     2      // leases held at the same time (uploader, LoRa)
+#define TRACK_LEASE_HEADROOM 32     // leases stay this many records clear of the ring's oldest slot
+
+/**
+ * Contiguous run of records inside the track store, one pointer per column
+ * (the store keeps records as structure of arrays). Seqs are consecutive.
+ */
+struct TrackSpan {
+  const uint32_t* ts = nullptr;
+  const int32_t*  latE7 = nullptr;
+  const int32_t*  lonE7 = nullptr;
+  const uint8_t*  bat = nullptr;
+  const uint8_t*  flags = nullptr;
+  const uint8_t*  dop = nullptr;
+  const uint8_t*  course2 = nullptr;
+  const uint16_t* speedCmS = nullptr;
+  const int16_t*  altDm = nullptr;
+  size_t n = 0;
+};
+
+/**
+ * Read lease: up to two spans of records read in place (the second one
+ * after the ring wraps). Valid until trackStoreRelease().
+ */
+struct TrackLease {
+  TrackSpan span[2];
+  size_t count = 0;         // span[0].n + span[1].n
+  uint32_t firstSeq = 0;    // seq of the first leased record (seqs are consecutive)
+  uint8_t slot = 0xFF;      // internal lease slot, 0xFF = not acquired
+
+  FixRec at(size_t i) const {
+    const TrackSpan& s = (i < span[0].n) ? span[0] : span[1];
+    size_t k = (i < span[0].n) ? i : i - span[0].n;
+    FixRec rec;
+    rec.seq = firstSeq + (uint32_t)i;
+    rec.ts = s.ts[k];
+    rec.latE7 = s.latE7[k];
+    rec.lonE7 = s.lonE7[k];
+    rec.bat = s.bat[k];
+    rec.flags = s.flags[k];
+    rec.dop = s.dop[k];
+    rec.course2 = s.course2[k];
+    rec.speedCmS = s.speedCmS[k];
+    rec.altDm = s.altDm[k];
+    return rec;
+  }
+};
+
+/**
+ * Per-reader position in the track ring.
+ * Every consuming task keeps its own cursor, so readers never share state
+ * with each other or with the sampler (the single producer).
+ */
+struct TrackCursor {
+  uint32_t nextSeq = 0;   // seq of the next record to read (0 = start at oldest)
+  uint32_t dropped = 0;   // records overwritten before this reader got to them
+};
+
+/**
+ * Delivery channels (uplinks) with their own cursor in the track store.
+ * Add new sinks before TRACK_CH_COUNT and give them a name in track_storage.cpp.
+ */
+enum TrackChannel : uint8_t {
+  TRACK_CH_WIFI = 0,
+  TRACK_CH_LORA,
+  TRACK_CH_COUNT
 };
 
 /**
  * Initialize track storage with given capacity
- * @param capacity Maximum number of FixRec to store
+ * The ring is lock-free: trackStorePush() must only be called from one task
+ * (the GPS sampler), any number of tasks may read concurrently.
+ * @param capacity Number of uncompressed FixRec in the hot ring (rounded up to a
+ *                 power of two, at least TRACK_BLOCK_MAX_FIXES); older fixes
+ *                 move to the compressed archive
  */
 void initTrackStore(size_t capacity);
 
 /**
- * Push a new GPS fix into the ring buffer
+ * Push a new GPS fix into the ring buffer (wait-free, single producer only)
+ * ts is clamped to be non-decreasing so the ring stays sorted by ts.
  * @param recIn Fix record to push (seq will be auto-assigned)
- * @return true on success, false on mutex failure
+ * @return true on success, false if the store is not initialized
  */
 bool trackStorePush(FixRec& recIn);
 
+/**
+ * Re-insert a record recovered from the persistent log, keeping its seq.
+ * Producer task only, before regular pushes start; records must arrive in
+ * increasing seq order. Seqs lost in the log stay as holes that readers skip.
+ * @param rec Recovered record (seq must be >= the next seq to assign)
+ * @return true if stored, false if out of order or store not initialized
+ */
+bool trackStoreRestore(const FixRec& rec);
+
+/**
+ * Read records in seq order starting at the cursor position and advance it.
+ * Never blocks; records overwritten under the reader (or lost holes) are
+ * skipped and counted in cur.dropped.
+ * @param cur Reader cursor (advanced past the last record returned)
+ * @param outBuf Output buffer for records
+ * @param maxN Maximum number of records to retrieve
+ * @return Number of records copied to outBuf
+ */
+size_t trackStoreRead(TrackCursor& cur, FixRec* outBuf, size_t maxN);
+
+/**
+ * Lease up to maxN records starting at fromSeq for reading in place.
+ * Records in the hot ring are returned as spans into the ring itself and
+ * pinned until release; the sampler never waits for a lease, so one held
+ * across TRACK_LEASE_HEADROOM pushes is reported as overrun on release.
+ * Records that only exist in the compressed archive are decoded into a
+ * per-lease scratch buffer (at most one block per lease).
+ * Release a lease quickly - build the payload, then release before sending.
+ * @param fromSeq First seq wanted (clamped to the oldest record, holes skipped)
+ * @param maxN Maximum number of records to lease
+ * @param lease Output lease
+ * @return true if at least one record is leased; release the lease either way
+ */
+bool trackStoreAcquire(uint32_t fromSeq, size_t maxN, TrackLease& lease);
+
+/**
+ * Release a lease obtained by trackStoreAcquire()
+ * @param lease Lease to release (reset on return)
+ * @return true if the leased records stayed intact, false if the sampler
+ *         overran the lease (discard anything built from it)
+ */
+bool trackStoreRelease(TrackLease& lease);
+
+/**
+ * Find the first stored record with ts > afterTs (binary search, O(log n))
+ * @param afterTs Timestamp to search past (typically ackedTs)
+ * @return seq of that record, or newest seq + 1 if there is none
+ */
+uint32_t trackStoreSeqAfterTs(uint32_t afterTs);
+
+/**
+ * Cursor positioned at the first record with ts > afterTs
+ * @param afterTs Timestamp to search past (typically ackedTs)
+ * @return Cursor ready for trackStoreRead()
+ */
+TrackCursor trackStoreCursorAfterTs(uint32_t afterTs);
+
+/**
+ * Cursor positioned directly at a sequence number (O(1))
+ * @param seq First seq to read; clamped to the oldest record on read
+ * @return Cursor ready for trackStoreRead()
+ */
+TrackCursor trackStoreCursorAtSeq(uint32_t seq);
+
+/**
+ * Number of records from the cursor position up to the newest one, without copying
+ * @param cur Reader cursor
+ * @return Length of the contiguous seq range still readable from cur
+ */
+size_t trackStoreAvailable(const TrackCursor& cur);
+
 /**
  * Get the latest (most recent) FixRec in storage
  * @param out Output reference to fill with latest record
@@ -52,11 +268,139 @@ uint32_t trackStoreGetAckedTs();
 
 /**
  * Set the acked timestamp (server confirmed up to this time)
+ * Legacy watermark: also acks every stored record with ts <= ts.
  * @param ts New acked timestamp
- * @return true on success, false on mutex failure
+ * @return true on success
  */
 bool trackStoreSetAckedTs(uint32_t ts);
 
+/**
+ * Mark an inclusive seq range as acknowledged by the server
+ * Safe to call from any task; seqs no longer stored are ignored.
+ * @param fromSeq First acked seq
+ * @param toSeq Last acked seq (inclusive)
+ */
+void trackStoreAckRange(uint32_t fromSeq, uint32_t toSeq);
+
+/**
+ * Check whether a record has been acknowledged
+ * @param seq Record seq
+ * @return true if acked (below the ack floor or its bit is set)
+ */
+bool trackStoreIsAcked(uint32_t seq);
+
+/**
+ * Get the ack floor: every seq below it is acknowledged
+ * @return First seq that may still be unacked
+ */
+uint32_t trackStoreGetAckFloor();
+
+/**
+ * Raise the ack floor (restore from the persistent log)
+ * @param seq New floor; every seq below it counts as acked
+ */
+void trackStoreSetAckFloor(uint32_t seq);
+
+/**
+ * Get a channel's name (for logs and the OLED)
+ * @param ch Channel
+ * @return Short name, e.g. "WiFi"
+ */
+const char* trackStoreChannelName(TrackChannel ch);
+
+/**
+ * Get the seq a channel continues from: the record after the last one it was
+ * handed, never below the ack floor (other channels' deliveries count)
+ * @param ch Channel
+ * @return Next seq to deliver on this channel
+ */
+uint32_t trackStoreChannelNextSeq(TrackChannel ch);
+
+/**
+ * Lease the next records to deliver on a channel (see trackStoreAcquire)
+ * @param ch Channel
+ * @param maxN Maximum number of records to lease
+ * @param lease Output lease, release with trackStoreRelease()
+ * @return true if at least one record was leased
+ */
+bool trackStoreChannelAcquire(TrackChannel ch, size_t maxN, TrackLease& lease);
+
+/**
+ * Record that a channel has sent everything up to seq
+ * @param ch Channel
+ * @param seq Last seq handed to the uplink
+ */
+void trackStoreChannelSent(TrackChannel ch, uint32_t seq);
+
+/**
+ * Record that a channel's uplink confirmed everything up to seq
+ * @param ch Channel
+ * @param seq Last seq confirmed on this channel
+ */
+void trackStoreChannelAcked(TrackChannel ch, uint32_t seq);
+
+/**
+ * Move a channel back to its last confirmed seq (or the ack floor, if that is
+ * further on) so every record it has not delivered is offered again (after a
+ * failed or partially acked delivery)
+ * @param ch Channel
+ */
+void trackStoreChannelRewind(TrackChannel ch);
+
+/**
+ * Get a channel's backlog: stored records it has not sent yet
+ * @param ch Channel
+ * @return Number of records after the channel's sent position
+ */
+size_t trackStoreChannelBacklog(TrackChannel ch);
+
+/**
+ * Get a channel's lag: stored records it has not seen confirmed yet
+ * @param ch Channel
+ * @return Number of records after the channel's acked position
+ */
+size_t trackStoreChannelLag(TrackChannel ch);
+
+/**
+ * Callback for trackStoreRange()
+ * @param rec Record in the requested time range
+ * @param ctx Caller context passed through trackStoreRange()
+ * @return true to continue, false to stop streaming
+ */
+typedef bool (*TrackRangeCallback)(const FixRec& rec, void* ctx);
+
+/**
+ * Stream all stored records with fromTs <= ts <= toTs, oldest first
+ * The start is located in O(log n) through the hot ring and the sparse block
+ * index; only the matching records are read (archived ones are decoded).
+ * @param fromTs First timestamp (inclusive)
+ * @param toTs Last timestamp (inclusive)
+ * @param cb Called once per record
+ * @param ctx Passed to cb
+ * @return Number of records handed to cb
+ */
+size_t trackStoreRange(uint32_t fromTs, uint32_t toTs, TrackRangeCallback cb, void* ctx = nullptr);
+
+/**
+ * Find records with any of the given flags set (scans the flags column only)
+ * Covers the uncompressed hot ring; older records are not searched.
+ * @param fromSeq First seq to look at
+ * @param flagMask Flags to look for (e.g. FL_EVT_MOVE_START | FL_EVT_MOVE_STOP)
+ * @param outSeq Output buffer for the seqs of matching records, oldest first
+ * @param maxN Maximum number of seqs to return
+ * @return Number of seqs written to outSeq
+ */
+size_t trackStoreFindFlags(uint32_t fromSeq, uint8_t flagMask, uint32_t* outSeq, size_t maxN);
+
+/**
+ * Bounding box of the records from fromSeq to the newest one (lat/lon columns only)
+ * Covers the uncompressed hot ring; older records are not included.
+ * @param fromSeq First seq to include
+ * @param box Output bounding box
+ * @return true if at least one record was included
+ */
+bool trackStoreBounds(uint32_t fromSeq, TrackBox& box);
+
 /**
  * Get the oldest timestamp currently in storage
  * @return Oldest timestamp in buffer (0 if empty)
@@ -78,4 +422,20 @@ size_t trackStoreGetBatch(FixRec* outBuf, size_t maxN, uint32_t afterTs);
  */
 size_t trackStoreSize();
 
+/**
+ * Archive counters since initTrackStore()
+ */
+struct TrackStoreStats {
+  uint32_t sealedBlocks;      // compressed blocks sealed (older ones are overwritten)
+  uint32_t archivedFixes;     // fixes in those blocks
+  uint32_t archivedBytes;     // coded bytes of those blocks, block header included
+  uint32_t ramBytes;          // RAM held by the store: hot ring, archive, index, lease scratch, ack bitmap
+};
+
+/**
+ * Copy the archive counters
+ * @param out Receives the counters
+ */
+void trackStoreGetStats(TrackStoreStats& out);
+
 #endif // TRACK_STORAGE_H
@@ -6,32 +6,58 @@
 #include "secrets.h"
 
 #define UPLOAD_INTERVAL_MS 60000 // 60 seconds
-#define MAX_UPLOAD_BATCH_SIZE 60
+#define MAX_UPLOAD_BATCH_SIZE 60          // also the simplifier window (SIMPLIFY_MAX_WINDOW)
+#define MAX_ACK_RANGES 16         // seq ranges accepted from one server reply
 
 /**
- * Build a JSON array string from GPS fix records
- * @param recs Array of FixRec records
- * @param n Number of records
+ * Server acknowledgement of one upload
+ * ranges holds inclusive [from, to] seq ranges; when the server only sends the
+ * legacy timestamp watermark, nRanges is 0 and ackedTs is used instead.
+ */
+struct AckSet {
+  uint32_t ackedTs = 0;
+  size_t nRanges = 0;
+  uint32_t ranges[MAX_ACK_RANGES][2];
+};
+
+/**
+ * Build a JSON array string from GPS fix records, read in place from the track store
+ * Records the server already acknowledged or the simplifier dropped are left out.
+ * @param lease Leased records (see trackStoreAcquire)
+ * @param limit Serialize at most the first limit leased records
+ * @param keep Simplifier verdict per leased record (0 = dropped), nullptr to keep all
+ * @param count Output parameter for the number of records serialized
  * @return JSON string representation of the batch
  */
-String buildJSONBatch(FixRec* recs, size_t n);
+String buildJSONBatch(const TrackLease& lease, size_t limit, const uint8_t* keep, size_t& count);
 
 /**
  * Parse ACK response using ArduinoJson
- * Expected format: {"ackedTs": 123}
+ * Expected format: {"acks": [[from, to], ...], "ackedTs": 123}
+ * "acks" (inclusive seq ranges) is optional; older servers only send "ackedTs".
  * @param response Server response string
- * @param ackedTs Output parameter for acknowledged timestamp
+ * @param acks Output parameter for acknowledged seq ranges / timestamp
  * @return true if parsing succeeded, false otherwise
  */
-bool parseACKResponse(const String& response, uint32_t& ackedTs);
+bool parseACKResponse(const String& response, AckSet& acks);
 
 /**
  * Upload a batch of GPS fixes to the server via WiFi
- * Retrieves unacked records from track storage, sends to server, updates acked timestamp
- * @param batch Pre-allocated buffer for holding batch records
- * @return true on successful upload attempt, false if upload skipped or failed
+ * Leases records from the ack floor, sends the unacked ones, applies the
+ * server's per-record acks (or the legacy acked timestamp)
+ */
+void uploadBatchOverWiFi();
+
+/**
+ * Register the task that runs uploadBatchOverWiFi() (woken by uploadKick)
+ * @param task Upload task handle
+ */
+void uploadSetTask(TaskHandle_t task);
+
+/**
+ * Upload now instead of at the next interval (event fixes; any task)
  */
-void uploadBatchOverWiFi(FixRec batch[MAX_UPLOAD_BATCH_SIZE]);
+void uploadKick();
 
 /**
  * Get last WiFi upload timestamp (milliseconds)
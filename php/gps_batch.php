@@ -1,11 +1,17 @@
 <?php
 // gps_batch.php
-// Receives JSON array of GPS records, dedupes by timestamp+coords (NOT seq), writes daily CSVs (UTC),
-// rotates > RETENTION_DAYS.
+// Receives JSON array of GPS records, dedupes by timestamp plus seq or position, writes daily CSVs (UTC),
+// rotates > RETENTION_DAYS. Replies with per-record acks as seq ranges ("acks") plus the legacy
+// "ackedTs" watermark.
 // Auth: X-API-Token
 // Device ID: ?device=... or header X-Device-Id
 // Record fields:
-//   seq (optional), ts (required), latE7 (required), lonE7 (required), ch ("wifi"|"lora", optional), net (optional), bat (optional, 0-100), flags (optional, 0-255)
+//   seq (optional), ts (required), latE7 (required), lonE7 (required), ch ("wifi"|"lora", optional), net (optional), bat (optional, 0-100), flags (optional, 0-255),
+//   sats (optional), hdopX10 (optional), speedCmS (optional), courseDeg (optional, 0-359), altDm (optional),
+//   fences (optional, [{"id": 12, "ev": "enter"|"exit"}, ...])
+// CSV columns: seq,ts_iso,ts_epoch,latE7,lonE7,lat,lon,ch,net,bat,flags,sats,hdop,speedCmS,courseDeg,altDm,fences
+// fences is space separated, +id entered / -id left (e.g. "+12 -3")
+// (files written with fewer columns get their header upgraded on the next append)
 
 declare(strict_types=1);
 
@@ -16,9 +22,17 @@ $BASE_DIR = __DIR__ . '/data';
 $RETENTION_DAYS = 7;
 
 // Keep a rolling set of recent keys to dedupe HTTP retries across requests.
-// Keys are stored per device in recent_keys.txt (one per line).
+// Keys are stored per device in recent_keys.txt (one per line):
+// "ts,seq,latE7,lonE7"; older files hold "ts,latE7,lonE7" or just "ts".
 $RECENT_KEYS_MAX = 5000;
 
+// Two records with the same ts are one fix when their seqs match or, if either
+// has no seq (LoRa), their coordinates are this close. LoRa frames round to at
+// most 10^3 E7 units (lora_payload.h), so a WiFi and a LoRa copy differ by
+// less than that. The device clamps ts to be non-decreasing across a backward
+// clock step, so distinct fixes can share a ts.
+$DEDUPE_TOL_E7 = 1000;  // 1e-4 degrees, ~11 m
+
 // Accept timestamps not too far in the future (seconds)
 $MAX_FUTURE_SKEW = 86400; // 24h
 
@@ -107,8 +121,9 @@ if (isset($decoded['uplink_message']) && is_array($decoded['uplink_message'])) {
   $payload = $decoded['uplink_message']['decoded_payload'] ?? null;
   
   if (is_array($payload)) {
-    // TTN sends a single uplink, wrap in array for consistent processing
-    $data = [$payload];
+    // TTN sends a single uplink: one fix (FPort 1/2) or a batch (FPort 3,
+    // decoded to 'fixes'); wrap in array for consistent processing
+    $data = (isset($payload['fixes']) && is_array($payload['fixes'])) ? $payload['fixes'] : [$payload];
     
     // Try to extract device ID from TTN if not provided in parameters
     if (!$DEVICE_ID || $DEVICE_ID === 'default') {
@@ -158,6 +173,48 @@ function toInt($v): int {
   return (int)$v;
 }
 
+// Optional integer field clamped to [min, max], '' if missing or invalid
+function optInt($v, int $min, int $max) {
+  if (!isIntLike($v)) return '';
+  $i = toInt($v);
+  if ($i < $min) $i = $min;
+  if ($i > $max) $i = $max;
+  return $i;
+}
+
+// Geofence events as "+12 -3", '' if missing or invalid
+function fenceEvents($v): string {
+  if (!is_array($v)) return '';
+  $out = [];
+  foreach ($v as $e) {
+    if (!is_array($e) || !isIntLike($e['id'] ?? null)) continue;
+    $id = toInt($e['id']);
+    $ev = $e['ev'] ?? '';
+    if ($id < 0 || $id > 65535 || ($ev !== 'enter' && $ev !== 'exit')) continue;
+    $out[] = ($ev === 'enter' ? '+' : '-') . $id;
+  }
+  return implode(' ', $out);
+}
+
+$CSV_HEADER = "seq,ts_iso,ts_epoch,latE7,lonE7,lat,lon,ch,net,bat,flags,sats,hdop,speedCmS,courseDeg,altDm,fences\n";
+
+// Write the header into an empty file, or upgrade an older header (a prefix
+// of the current one) in place (caller holds the lock). Leaves the position
+// at the end of the file.
+function ensureCsvHeader($fp, string $hdr): bool {
+  rewind($fp);
+  $first = fgets($fp);
+  if ($first === false) {
+    if (fwrite($fp, $hdr) !== strlen($hdr)) return false;
+  } elseif ($first !== $hdr && strpos($hdr, rtrim($first, "\r\n") . ',') === 0) {
+    $rest = (string)stream_get_contents($fp);
+    if (!ftruncate($fp, 0)) return false;
+    rewind($fp);
+    if (fwrite($fp, $hdr . $rest) !== strlen($hdr) + strlen($rest)) return false;
+  }
+  return fseek($fp, 0, SEEK_END) === 0;
+}
+
 function normalizeEpochSeconds(int $ts): int {
   // If milliseconds (or bigger), convert to seconds.
   // 20,000,000,000 seconds ~ year 2600, safely beyond expected device timestamps.
@@ -174,6 +231,8 @@ function atomicWrite(string $path, string $content): bool {
   return @rename($tmp, $path);
 }
 
+// Recent keys: $set maps ts to its entries [seq, latE7, lonE7] (seq 0 = none,
+// null coordinates = legacy ts-only key), $list holds them oldest first
 function loadRecentKeysFromLines(array $lines, int $max): array {
   $set = [];
   $list = [];
@@ -183,23 +242,59 @@ function loadRecentKeysFromLines(array $lines, int $max): array {
   if ($count > $max) $lines = array_slice($lines, $count - $max);
 
   foreach ($lines as $ln) {
-    $ln = trim((string)$ln);
-    if ($ln === '') continue;
-    if (!isset($set[$ln])) {
-      $set[$ln] = true;
-      $list[] = $ln;
+    $f = explode(',', trim((string)$ln));
+    if ($f[0] === '' || !isIntLike($f[0])) continue;
+    $ts = toInt($f[0]);
+    if (count($f) >= 4) {
+      $e = [toInt($f[1]), toInt($f[2]), toInt($f[3])];
+    } elseif (count($f) === 3) {
+      $e = [0, toInt($f[1]), toInt($f[2])];
+    } else {
+      $e = [0, null, null];
     }
+    $set[$ts][] = $e;
+    $list[] = [$ts, $e];
   }
   return [$set, $list];
 }
 
-function appendRecentKey(array &$set, array &$list, string $key, int $max): void {
-  if (isset($set[$key])) return;
-  $set[$key] = true;
-  $list[] = $key;
+// True if $set already holds the fix (see $DEDUPE_TOL_E7)
+function isDuplicateFix(array $set, int $ts, int $seq, int $latE7, int $lonE7, int $tol): bool {
+  foreach ($set[$ts] ?? [] as $e) {
+    if ($e[1] === null) return true;  // legacy key: ts only
+    if ($seq > 0 && $e[0] > 0) {
+      if ($e[0] === $seq) return true;
+      continue;
+    }
+    if (abs($e[1] - $latE7) <= $tol && abs($e[2] - $lonE7) <= $tol) return true;
+  }
+  return false;
+}
+
+// Compress a list of seqs into sorted inclusive [from, to] ranges
+function seqRanges(array $seqs): array {
+  $seqs = array_values(array_unique($seqs));
+  sort($seqs, SORT_NUMERIC);
+  $out = [];
+  foreach ($seqs as $s) {
+    $n = count($out);
+    if ($n > 0 && $out[$n - 1][1] + 1 === $s) {
+      $out[$n - 1][1] = $s;
+    } else {
+      $out[] = [$s, $s];
+    }
+  }
+  return $out;
+}
+
+function appendRecentKey(array &$set, array &$list, int $ts, array $e, int $max): void {
+  $set[$ts][] = $e;
+  $list[] = [$ts, $e];
   while (count($list) > $max) {
     $old = array_shift($list);
-    if ($old !== null) unset($set[$old]);
+    if ($old === null) break;
+    array_shift($set[$old[0]]);   // entries of a ts are in list order
+    if (!$set[$old[0]]) unset($set[$old[0]]);
   }
 }
 
@@ -233,15 +328,22 @@ $maxSeqSeen = $lastAckSeq;
 // For dedupe inside this request too
 $reqSet = [];
 
+// Seqs the device may forget: written, duplicates and permanently invalid
+// records. Records that failed to write are left out so the device resends them.
+$ackSeqs = [];
+
 foreach ($data as $rec) {
   if (!is_array($rec)) { $skippedBad++; continue; }
 
   $seq   = $rec['seq']   ?? 0;
+  $seq   = isIntLike($seq) ? toInt($seq) : 0;
+  if ($seq > 0) $ackSeqs[] = $seq;  // provisional, withdrawn on write failure
   $ts    = $rec['ts']    ?? null;
   $latE7 = $rec['latE7'] ?? null;
   $lonE7 = $rec['lonE7'] ?? null;
   $net   = $rec['net']   ?? 'unknown';
   $bat   = $rec['bat']   ?? null;
+  $flags = $rec['flags'] ?? null;
 
   $ch = $rec['ch'] ?? 'wifi';
   $ch = strtolower((string)$ch);
@@ -254,7 +356,6 @@ foreach ($data as $rec) {
   $ts    = normalizeEpochSeconds(toInt($ts));
   $latE7 = toInt($latE7);
   $lonE7 = toInt($lonE7);
-  $seq   = isIntLike($seq) ? toInt($seq) : 0;
   
   // Validate and clamp battery
   $batVal = '';
@@ -270,49 +371,55 @@ foreach ($data as $rec) {
     $flagsVal = toInt($flags) & 0xFF;  // keep only 8 bits
   }
 
+  // Fix quality and motion (absent from older firmware: empty columns)
+  $satsVal   = optInt($rec['sats'] ?? null, 0, 255);
+  $hdopX10   = optInt($rec['hdopX10'] ?? null, 0, 9999);
+  $hdopVal   = ($hdopX10 === '' || $hdopX10 === 0) ? '' : number_format($hdopX10 / 10, 1, '.', '');
+  $speedVal  = optInt($rec['speedCmS'] ?? null, 0, 65535);
+  $courseVal = optInt($rec['courseDeg'] ?? null, 0, 359);
+  $altVal    = optInt($rec['altDm'] ?? null, -32767, 32767);
+  $fencesVal = fenceEvents($rec['fences'] ?? null);
+
   // sanity checks
   if ($ts < 0 || $ts > ($now + $MAX_FUTURE_SKEW)) { $skippedBad++; continue; }
   if ($ts < $MIN_TS) { $skippedBad++; continue; } // comment this line if you want deep backfills
   if ($latE7 < -900000000 || $latE7 >  900000000) { $skippedBad++; continue; }
   if ($lonE7 < -1800000000 || $lonE7 > 1800000000) { $skippedBad++; continue; }
 
-  // Timestamp-based idempotency key (recommendation: exclude net/ch for stable dedupe)
-  $key = $ts . ',' . $latE7 . ',' . $lonE7;
-
-  if (isset($reqSet[$key]) || isset($recentSet[$key])) {
+  // Idempotency key: ts plus seq or position (exclude net/ch so the WiFi and
+  // LoRa copies of a fix match, see $DEDUPE_TOL_E7)
+  if (isDuplicateFix($reqSet, $ts, $seq, $latE7, $lonE7, $DEDUPE_TOL_E7) ||
+      isDuplicateFix($recentSet, $ts, $seq, $latE7, $lonE7, $DEDUPE_TOL_E7)) {
     $skippedDup++;
     continue;
   }
-  $reqSet[$key] = true;
+  $key = [$seq, $latE7, $lonE7];
+  $reqSet[$ts][] = $key;
 
   $date = gmdate('Y-m-d', $ts);
   $file = $devDir . '/' . $date . '.csv';
 
-  $fp = fopen($file, 'ab');
-  if ($fp === false) { $skippedBad++; continue; }
+  $fp = fopen($file, 'c+b');
+  if ($fp === false) { $skippedBad++; if ($seq > 0) array_pop($ackSeqs); continue; }
 
   $okWrite = false;
 
   if (flock($fp, LOCK_EX)) {
-    // header only if file empty (race-safe)
-    $stat = fstat($fp);
-    $empty = ($stat !== false && (int)($stat['size'] ?? 0) === 0);
-    if ($empty) {
-      $hdr = "seq,ts_iso,ts_epoch,latE7,lonE7,lat,lon,ch,net,bat,flags\n";
-      $r = fwrite($fp, $hdr);
-      if ($r === false || $r === 0) {
-        flock($fp, LOCK_UN);
-        fclose($fp);
-        $skippedBad++;
-        continue;
-      }
+    // header if file empty, upgraded if written by an older version (race-safe)
+    if (!ensureCsvHeader($fp, $CSV_HEADER)) {
+      flock($fp, LOCK_UN);
+      fclose($fp);
+      $skippedBad++;
+      if ($seq > 0) array_pop($ackSeqs);
+      continue;
     }
 
     $lat = number_format($latE7 / 1e7, 7, '.', '');
     $lon = number_format($lonE7 / 1e7, 7, '.', '');
     $iso = gmdate('c', $ts);
 
-    $line = $seq . ',' . $iso . ',' . $ts . ',' . $latE7 . ',' . $lonE7 . ',' . $lat . ',' . $lon . ',' . $ch . ',' . $net . ',' . $batVal . ',' . $flagsVal . "\n";
+    $line = $seq . ',' . $iso . ',' . $ts . ',' . $latE7 . ',' . $lonE7 . ',' . $lat . ',' . $lon . ',' . $ch . ',' . $net . ',' . $batVal . ',' . $flagsVal
+          . ',' . $satsVal . ',' . $hdopVal . ',' . $speedVal . ',' . $courseVal . ',' . $altVal . ',' . $fencesVal . "\n";
     $r = fwrite($fp, $line);
 
     if ($r !== false && $r > 0) {
@@ -325,11 +432,11 @@ foreach ($data as $rec) {
 
   fclose($fp);
 
-  if (!$okWrite) { $skippedBad++; continue; }
+  if (!$okWrite) { $skippedBad++; if ($seq > 0) array_pop($ackSeqs); continue; }
 
   // Mark as written/deduped
   $written++;
-  appendRecentKey($recentSet, $recentList, $key, $RECENT_KEYS_MAX);
+  appendRecentKey($recentSet, $recentList, $ts, $key, $RECENT_KEYS_MAX);
 
   if ($ts > $maxTsSeen) $maxTsSeen = $ts;
   if ($seq > $maxSeqSeen) $maxSeqSeen = $seq;
@@ -338,7 +445,11 @@ foreach ($data as $rec) {
 // ================== Persist recent keys (under lock) ==================
 rewind($rkFp);
 ftruncate($rkFp, 0);
-fwrite($rkFp, implode("\n", $recentList) . (count($recentList) ? "\n" : ''));
+$rkOut = '';
+foreach ($recentList as $r) {
+  $rkOut .= ($r[1][1] === null ? $r[0] : $r[0] . ',' . $r[1][0] . ',' . $r[1][1] . ',' . $r[1][2]) . "\n";
+}
+fwrite($rkFp, $rkOut);
 fflush($rkFp);
 flock($rkFp, LOCK_UN);
 fclose($rkFp);
@@ -357,6 +468,8 @@ echo json_encode([
   'device' => $DEVICE_ID,
   'source' => $sourceType,
   'ackedTs' => $maxTsSeen,
+  // per-record acks: inclusive seq ranges the device can drop
+  'acks' => seqRanges($ackSeqs),
   // compatibility fields
   'ackedSeq' => $maxSeqSeen,
   'written' => $written,
@@ -41,6 +41,22 @@ function haversineDistance(float $lat1, float $lon1, float $lat2, float $lon2):
   return $R * $c;
 }
 
+/**
+ * Distance in meters, flat-earth (equirectangular) for nearby points, same
+ * kernel as the firmware (include/geo_distance.h): one cos and one sqrt
+ * instead of the haversine, well under 1 cm off at fix spacing.
+ * Points more than 1 degree apart fall back to the haversine.
+ */
+function flatDistance(float $lat1, float $lon1, float $lat2, float $lon2): float {
+  $dLat = $lat2 - $lat1;
+  $dLon = $lon2 - $lon1;
+  if ($dLon >= 180) $dLon -= 360;
+  elseif ($dLon < -180) $dLon += 360;
+  if (abs($dLat) > 1 || abs($dLon) > 1) return haversineDistance($lat1, $lon1, $lat2, $lon2);
+  $dx = $dLon * cos(deg2rad(($lat1 + $lat2) / 2));
+  return 111194.927 * sqrt($dx * $dx + $dLat * $dLat); // meters per degree on the 6371 km sphere
+}
+
 // ================== CONFIG ==================
 $BASE_DIR = __DIR__ . '/data';
 $EXPECTED_TOKEN = 'CHANGE_ME_LONG_RANDOM_TOKEN';
@@ -189,7 +205,7 @@ foreach ($dates as $d) {
       if ($prevLat !== null && $prevLon !== null && $prevTs !== null) {
         $timeDelta = $ts - $prevTs;
         if ($timeDelta > 0) {
-          $distance = haversineDistance($prevLat, $prevLon, $lat, $lon);
+          $distance = flatDistance($prevLat, $prevLon, $lat, $lon);
           $speedMps = $distance / $timeDelta;
           $speedKmh = $speedMps * 3.6;
           $props['speed_mps'] = round($speedMps, 2);
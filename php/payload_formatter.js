@@ -1,11 +1,51 @@
 /**
  * TTN Payload Formatter for GPS LoRa Tracker
  * 
- * Decodes 13-byte payload format and formats for gps_batch.php compatibility:
+ * Decodes the uplink payload and formats for gps_batch.php compatibility.
+ * The current firmware sends v3 frames on FPort 4; FPorts 1-3 are decoded
+ * for older firmware.
+ *
+ * v3, FPort 4, one or more fixes (codec and field rules: include/lora_payload.h;
+ * test vectors: examples/payload_bench/vectors.txt, run check_formatter.js there):
+ * - Byte 0: Version (3)
+ * - Byte 1: (Number of fixes - 1) << 2 | coordinate precision p (units of 10^p × 1e-7 degrees)
+ * - Bytes 2-5: Frame epoch, timestamp of the first fix (uint32_t, big-endian)
+ * - Per fix: presence mask (0x01 bat, 0x02 flags, 0x04 dop, 0x08 course, 0x10 speed,
+ *   0x20 altitude), ts change (not for the first fix), lat and lon (first fix
+ *   absolute, then changes), then the present fields: bat, flags, dop and course
+ *   as bytes, speed and altitude as changes. Numbers are LEB128 varints, zigzag
+ *   for signed values; absent fields keep the previous fix's value.
+ * A frame of one fix is sent in the single-fix form when its coordinates fit
+ * 24 bits and that is not longer (and only then):
+ * - Byte 0: 0x80 | p << 5 | 0x10 if the v2 mask byte follows | (mask & 3) << 2
+ *   (bat, flags) | version in the low two bits (3)
+ * - Only with 0x10: presence mask >> 2 (dop, course, speed, altitude; not 0)
+ * - Timestamp (uint32_t, big-endian)
+ * - Latitude, longitude in units of 10^p × 1e-7 degrees (int24, big-endian)
+ * - The present fields, as above
+ * Decodes to { fixes: [...] }, one v2 record per fix.
+ *
+ * v1, FPort 1, 13 bytes (big-endian):
  * - Bytes 0-3: Timestamp (uint32_t, seconds since epoch)
  * - Bytes 4-7: Latitude (int32_t, degrees × 1e7)
  * - Bytes 8-11: Longitude (int32_t, degrees × 1e7)
  * - Byte 12: Battery percentage (uint8_t, 0-100%)
+ *
+ * v2, FPort 2, 20 bytes: v1 followed by
+ * - Byte 13: Flags (uint8_t)
+ * - Byte 14: Satellites << 4 | HDOP in 0.5 steps (uint8_t, 0 = unknown)
+ * - Byte 15: Course / 2 degrees (uint8_t, 0xFF = unknown)
+ * - Bytes 16-17: Speed (uint16_t, cm/s)
+ * - Bytes 18-19: Altitude (int16_t, dm, -32768 = unknown)
+ *
+ * Batch, FPort 3 (several fixes per uplink, before v3):
+ * - Byte 0: Number of fixes
+ * - Bytes 1-20: First fix, v2 layout
+ * - Per further fix, against the fix before it: a mask byte (0x01 bat, 0x02 flags,
+ *   0x04 dop, 0x08 course, 0x10 speed, 0x20 altitude changed), ts, latE7 and lonE7
+ *   deltas as zigzag LEB128 varints, then the changed fields: bat, flags, dop and
+ *   course as bytes, speed and altitude as zigzag varint deltas
+ * Decodes to { fixes: [...] }, one v2 record per fix.
  * 
  * Output fields compatible with gps_batch.php:
  * - ts: timestamp (seconds)
@@ -13,6 +53,7 @@
  * - lonE7: longitude × 1e7 (raw int32_t value)
  * - bat: battery percentage (0-100)
  * - ch: channel ("lora")
+ * - v2 only: flags, sats, hdopX10, speedCmS, courseDeg, altDm (unknown fields are left out)
  */
 
 function decodeUplink(input) {
@@ -20,54 +61,31 @@ function decodeUplink(input) {
   var errors = [];
   var warnings = [];
 
-  // Validate payload length
-  if (data.length !== 13) {
-    errors.push("Expected 13 bytes, got " + data.length);
+  if (input.fPort === 4) {
+    return decodeFrame(data, warnings, errors);
+  }
+  if (input.fPort === 3) {
+    return decodeBatch(data, warnings, errors);
+  }
+
+  // Validate payload length (the length tells the version; fPort is checked when present)
+  var v2 = data.length === 20;
+  if (data.length !== 13 && !v2) {
+    errors.push("Expected 13 or 20 bytes, got " + data.length);
     return {
       data: {},
       warnings: warnings,
       errors: errors
     };
   }
+  if (input.fPort !== undefined && input.fPort !== (v2 ? 2 : 1)) {
+    warnings.push("Unexpected FPort " + input.fPort + " for a " + data.length + "-byte payload");
+  }
 
   try {
-    // Decode timestamp (bytes 0-3, big-endian, uint32_t)
-    var ts = (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
-    ts = ts >>> 0; // Convert to unsigned
-
-    // Decode latitude (bytes 4-7, big-endian, int32_t)
-    // Keep raw value for gps_batch.php (×1e7)
-    var latE7 = (data[4] << 24) | (data[5] << 16) | (data[6] << 8) | data[7];
-    
-    // Decode longitude (bytes 8-11, big-endian, int32_t)
-    // Keep raw value for gps_batch.php (×1e7)
-    var lonE7 = (data[8] << 24) | (data[9] << 16) | (data[10] << 8) | data[11];
-
-    // Decode battery percentage (byte 12, uint8_t)
-    var bat = data[12];
-
-    // Validation checks (using decoded values)
-    var latitude = latE7 / 1e7;
-    var longitude = lonE7 / 1e7;
-    
-    if (latitude < -90 || latitude > 90) {
-      warnings.push("Latitude out of valid range: " + latitude);
-    }
-    if (longitude < -180 || longitude > 180) {
-      warnings.push("Longitude out of valid range: " + longitude);
-    }
-    if (bat > 100) {
-      warnings.push("Battery percentage exceeds 100%: " + bat);
-    }
-
+    var fix = readFix(data, 0, v2);
     return {
-      data: {
-        ts: ts,
-        latE7: latE7,
-        lonE7: lonE7,
-        bat: bat,
-        ch: "lora"
-      },
+      data: formatFix(fix, v2, warnings),
       warnings: warnings,
       errors: errors
     };
@@ -81,6 +99,255 @@ function decodeUplink(input) {
   }
 }
 
+/**
+ * Raw fields of one fix (v1: 13 bytes, v2: 20 bytes) starting at off
+ */
+function readFix(data, off, v2) {
+  // Timestamp (uint32_t), latitude and longitude (int32_t, raw ×1e7 for gps_batch.php), big-endian
+  var fix = {
+    ts: ((data[off] << 24) | (data[off + 1] << 16) | (data[off + 2] << 8) | data[off + 3]) >>> 0,
+    latE7: (data[off + 4] << 24) | (data[off + 5] << 16) | (data[off + 6] << 8) | data[off + 7],
+    lonE7: (data[off + 8] << 24) | (data[off + 9] << 16) | (data[off + 10] << 8) | data[off + 11],
+    bat: data[off + 12]
+  };
+  if (v2) {
+    fix.flags = data[off + 13];
+    fix.dop = data[off + 14];
+    fix.course2 = data[off + 15];
+    fix.speedCmS = (data[off + 16] << 8) | data[off + 17];
+    // Altitude (int16_t)
+    fix.altDm = (data[off + 18] << 8) | data[off + 19];
+    if (fix.altDm & 0x8000) fix.altDm -= 0x10000;
+  }
+  return fix;
+}
+
+/**
+ * gps_batch.php record for a decoded fix, with range warnings
+ */
+function formatFix(fix, v2, warnings) {
+  var latitude = fix.latE7 / 1e7;
+  var longitude = fix.lonE7 / 1e7;
+
+  if (latitude < -90 || latitude > 90) {
+    warnings.push("Latitude out of valid range: " + latitude);
+  }
+  if (longitude < -180 || longitude > 180) {
+    warnings.push("Longitude out of valid range: " + longitude);
+  }
+  if (fix.bat > 100) {
+    warnings.push("Battery percentage exceeds 100%: " + fix.bat);
+  }
+
+  var out = {
+    ts: fix.ts,
+    latE7: fix.latE7,
+    lonE7: fix.lonE7,
+    bat: fix.bat,
+    ch: "lora"
+  };
+
+  if (v2) {
+    out.flags = fix.flags;
+
+    // Satellites (high nibble) and HDOP in 0.5 steps (low nibble)
+    if (fix.dop !== 0) out.sats = fix.dop >> 4;
+    if ((fix.dop & 0x0F) !== 0) out.hdopX10 = (fix.dop & 0x0F) * 5;
+
+    if (fix.course2 !== 0xFF) out.courseDeg = fix.course2 * 2;
+
+    out.speedCmS = fix.speedCmS;
+
+    if (fix.altDm !== -32768) out.altDm = fix.altDm;
+  }
+  return out;
+}
+
+/**
+ * FPort 3: a v2 fix followed by deltas
+ */
+function decodeBatch(data, warnings, errors) {
+  var fail = function (msg) {
+    errors.push(msg);
+    return { data: {}, warnings: warnings, errors: errors };
+  };
+  if (data.length < 21 || data[0] === 0) {
+    return fail("Batch too short: " + data.length + " bytes");
+  }
+
+  var pos = 21;
+  // Zigzag LEB128 varint; deltas stay below 2^34, so plain arithmetic is exact
+  var readDelta = function () {
+    var v = 0, scale = 1;
+    for (var k = 0; k < 6; k++) {
+      if (pos >= data.length) return null;
+      var b = data[pos++];
+      v += (b & 0x7F) * scale;
+      if (!(b & 0x80)) return (v % 2) ? -(v + 1) / 2 : v / 2;
+      scale *= 128;
+    }
+    return null;
+  };
+
+  var fix = readFix(data, 1, true);
+  var fixes = [formatFix(fix, true, warnings)];
+  for (var i = 1; i < data[0]; i++) {
+    if (pos >= data.length) return fail("Batch truncated at fix " + i);
+    var mask = data[pos++];
+    if (mask & 0xC0) return fail("Bad delta mask at fix " + i);
+    var dts = readDelta(), dlat = readDelta(), dlon = readDelta();
+    if (dts === null || dlat === null || dlon === null) return fail("Batch truncated at fix " + i);
+    fix.ts = (fix.ts + dts) >>> 0;
+    fix.latE7 = (fix.latE7 + dlat) | 0;
+    fix.lonE7 = (fix.lonE7 + dlon) | 0;
+    var bytes = ["bat", "flags", "dop", "course2"];
+    for (var k = 0; k < 4; k++) {
+      if (!(mask & (1 << k))) continue;
+      if (pos >= data.length) return fail("Batch truncated at fix " + i);
+      fix[bytes[k]] = data[pos++];
+    }
+    if (mask & 0x10) {
+      var ds = readDelta();
+      if (ds === null) return fail("Batch truncated at fix " + i);
+      fix.speedCmS = (fix.speedCmS + ds) & 0xFFFF;
+    }
+    if (mask & 0x20) {
+      var da = readDelta();
+      if (da === null) return fail("Batch truncated at fix " + i);
+      fix.altDm = ((fix.altDm + da) << 16) >> 16;
+    }
+    fixes.push(formatFix(fix, true, warnings));
+  }
+  if (pos !== data.length) return fail("Batch has " + (data.length - pos) + " trailing bytes");
+
+  return {
+    data: { fixes: fixes },
+    warnings: warnings,
+    errors: errors
+  };
+}
+
+/**
+ * FPort 4: v3 frame. Rejects anything the firmware's encoder would not have
+ * produced, like loraDecodeFrame().
+ */
+function decodeFrame(data, warnings, errors) {
+  var fail = function (msg) {
+    errors.push(msg);
+    return { data: {}, warnings: warnings, errors: errors };
+  };
+  var single = data.length > 0 && (data[0] & 0x83) === 0x83;
+  var more = single && (data[0] & 0x10) ? 1 : 0;   // single-fix form: v2 mask byte present
+  if (data.length < (single ? 11 + more : 6)) {
+    return fail("Frame too short: " + data.length + " bytes");
+  }
+  if (data[0] !== 3 && !single) {
+    return fail("Unsupported frame version " + data[0]);
+  }
+  var count = single ? 1 : (data[1] >> 2) + 1;
+  var step = [1, 10, 100, 1000][single ? (data[0] >> 5) & 3 : data[1] & 3];
+
+  var pos = single ? 11 + more : 6;
+  // Zigzag LEB128 varint, minimal encoding only; null if truncated or overlong
+  var readSigned = function () {
+    var v = 0, scale = 1;
+    for (var k = 0; k < 9; k++) {
+      if (pos >= data.length) return null;
+      var b = data[pos++];
+      v += (b & 0x7F) * scale;
+      if (!(b & 0x80)) {
+        if (b === 0 && k > 0) return null;
+        return (v % 2) ? -(v + 1) / 2 : v / 2;
+      }
+      scale *= 128;
+    }
+    return null;
+  };
+
+  // Bytes of a zigzag varint
+  var signedLen = function (v) {
+    var u = v < 0 ? -2 * v - 1 : 2 * v;
+    var n = 1;
+    while (u >= 128) {
+      u = Math.floor(u / 128);
+      n++;
+    }
+    return n;
+  };
+  // The single-fix form is used for a lone fix exactly when this holds
+  var singleForm = function (lat, lon, mask) {
+    var lim = 0x800000;
+    if (lat < -lim || lat >= lim || lon < -lim || lon >= lim) return false;
+    return signedLen(lat) + signedLen(lon) >= ((mask & 0x3C) ? 5 : 4);
+  };
+  var int24 = function (off) {
+    var v = (data[off] << 16) | (data[off + 1] << 8) | data[off + 2];
+    return v >= 0x800000 ? v - 0x1000000 : v;
+  };
+
+  var tsOff = single ? 1 + more : 2;
+  var ts = ((data[tsOff] << 24) | (data[tsOff + 1] << 16) | (data[tsOff + 2] << 8) | data[tsOff + 3]) >>> 0;
+  var fix = { ts: ts, latE7: 0, lonE7: 0, bat: 0, flags: 0, dop: 0, course2: 0xFF, speedCmS: 0, altDm: -32768 };
+  var fixes = [];
+  for (var i = 0; i < count; i++) {
+    var bad = "Bad frame at fix " + i;
+    var mask, v;
+    if (single) {
+      if (more && (data[1] === 0 || data[1] > 0x0F)) return fail(bad);
+      mask = ((data[0] >> 2) & 3) | (more ? data[1] << 2 : 0);
+      fix.latE7 = int24(5 + more) * step;
+      fix.lonE7 = int24(8 + more) * step;
+      if (!singleForm(fix.latE7 / step, fix.lonE7 / step, mask)) return fail(bad);
+    } else {
+      if (pos >= data.length) return fail(bad);
+      mask = data[pos++];
+      if (mask & 0xC0) return fail(bad);
+      if (i > 0) {
+        v = readSigned();
+        if (v === null) return fail(bad);
+        fix.ts += v;
+        if (fix.ts < 0 || fix.ts > 0xFFFFFFFF) return fail(bad);
+      }
+      v = readSigned();
+      if (v === null || Math.abs(v) > 1800000000) return fail(bad);
+      fix.latE7 += v * step;
+      v = readSigned();
+      if (v === null || Math.abs(v) > 3600000000) return fail(bad);
+      fix.lonE7 += v * step;
+      if (count === 1 && singleForm(fix.latE7 / step, fix.lonE7 / step, mask)) return fail(bad);
+    }
+    if (Math.abs(fix.latE7) > 900000000 || Math.abs(fix.lonE7) > 1800000000) return fail(bad);
+    var bytes = ["bat", "flags", "dop", "course2"];
+    for (var k = 0; k < 4; k++) {
+      if (!(mask & (1 << k))) continue;
+      if (pos >= data.length || data[pos] === fix[bytes[k]]) return fail(bad);
+      fix[bytes[k]] = data[pos++];
+    }
+    if (mask & 0x10) {
+      v = readSigned();
+      if (v === null || v === 0) return fail(bad);
+      v += fix.speedCmS;
+      if (v < 0 || v > 65535) return fail(bad);
+      fix.speedCmS = v;
+    }
+    if (mask & 0x20) {
+      v = readSigned();
+      if (v === null) return fail(bad);
+      v += fix.altDm === -32768 ? 0 : fix.altDm;
+      if (v < -32768 || v > 32767 || v === fix.altDm) return fail(bad);
+      fix.altDm = v;
+    }
+    fixes.push(formatFix(fix, true, warnings));
+  }
+  if (pos !== data.length) return fail("Frame has " + (data.length - pos) + " trailing bytes");
+
+  return {
+    data: { fixes: fixes },
+    warnings: warnings,
+    errors: errors
+  };
+}
+
 /**
  * Optional: Encode function for downlinks (if needed in future)
  * Currently not used but included for completeness
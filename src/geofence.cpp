@@ -0,0 +1,383 @@
+#include "geofence.h"
+#include <LittleFS.h>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdlib.h>
+#include <math.h>
+#include "geo_distance.h"
+
+// Fences live in flat arrays built once by geofenceLoad(); afterwards only the
+// sampler task reads them. Polygon vertices are E7 integers so the
+// point-in-polygon test is exact (64-bit cross products).
+
+struct Fence {
+  int32_t minLatE7, maxLatE7;       // bounding box
+  int32_t minLonE7, maxLonE7;
+  int32_t latE7, lonE7;             // circle centre
+  float radiusM;                    // circle radius
+  uint32_t firstVertex;             // polygon: index into vLat/vLon
+  uint16_t nVertices;               // 0 = circle
+  uint16_t id;
+};
+
+// Grid cell in the open-addressing hash: fences [start, start + count) of cellFences
+struct CellSlot {
+  uint32_t cy, cx;
+  uint32_t start;
+  uint32_t count;                   // 0 = empty slot
+};
+
+static std::vector<Fence> fences;
+static std::vector<int32_t> vLat, vLon;
+static std::vector<CellSlot> cells; // power-of-two size
+static std::vector<uint16_t> cellFences;
+static std::vector<uint16_t> largeFences;  // too big for the grid, bounding box check
+static uint32_t cellMask = 0;
+static uint8_t cellShift = 20;
+
+static uint16_t inside[GEOFENCE_MAX_INSIDE];  // fence indices the device is in (sampler task)
+static size_t nInside = 0;
+
+// Recent events, same stamp protocol as the track store slots
+struct EventSlot {
+  std::atomic<uint32_t> stamp;      // 1-based event number, 0 = empty or being written
+  GeofenceEvent ev;
+};
+static EventSlot eventLog[GEOFENCE_EVENT_LOG];
+static uint32_t eventsLogged = 0;   // producer only
+
+// ============= GRID =============
+
+// Signed E7 -> unsigned, order preserving, then cell number
+static inline uint32_t cellOf(int32_t e7) {
+  return ((uint32_t)e7 ^ 0x80000000u) >> cellShift;
+}
+
+static inline uint32_t cellHash(uint32_t cy, uint32_t cx) {
+  uint32_t h = cy * 0x9E3779B1u ^ cx * 0x85EBCA77u;
+  return h ^ (h >> 15);
+}
+
+static const CellSlot* findCell(uint32_t cy, uint32_t cx) {
+  if (cells.empty()) return nullptr;
+  for (uint32_t i = cellHash(cy, cx) & cellMask;; i = (i + 1) & cellMask) {
+    const CellSlot& s = cells[i];
+    if (s.count == 0) return nullptr;
+    if (s.cy == cy && s.cx == cx) return &s;
+  }
+}
+
+// Smallest power of two cell that holds a typical (median) fence
+static uint8_t pickCellShift() {
+  std::vector<uint32_t> ext;
+  ext.reserve(fences.size());
+  for (const Fence& f : fences) {
+    ext.push_back(std::max((uint32_t)(f.maxLatE7 - f.minLatE7), (uint32_t)(f.maxLonE7 - f.minLonE7)));
+  }
+  std::nth_element(ext.begin(), ext.begin() + ext.size() / 2, ext.end());
+  uint32_t median = ext[ext.size() / 2];
+  uint8_t shift = 10;               // ~110 m
+  while (shift < 26 && (1UL << shift) < median) shift++;
+  return shift;
+}
+
+static void buildIndex() {
+  cells.clear();
+  cellFences.clear();
+  largeFences.clear();
+  if (fences.empty()) return;
+  cellShift = pickCellShift();
+
+  std::vector<std::pair<uint64_t, uint16_t>> entries;   // (cy << 32 | cx, fence)
+  for (size_t i = 0; i < fences.size(); i++) {
+    const Fence& f = fences[i];
+    uint32_t cy0 = cellOf(f.minLatE7), cy1 = cellOf(f.maxLatE7);
+    uint32_t cx0 = cellOf(f.minLonE7), cx1 = cellOf(f.maxLonE7);
+    if ((uint64_t)(cy1 - cy0 + 1) * (cx1 - cx0 + 1) > GEOFENCE_MAX_CELLS_PER_FENCE) {
+      largeFences.push_back((uint16_t)i);
+      continue;
+    }
+    for (uint32_t cy = cy0; cy <= cy1; cy++) {
+      for (uint32_t cx = cx0; cx <= cx1; cx++) entries.push_back(std::make_pair((uint64_t)cy << 32 | cx, (uint16_t)i));
+    }
+  }
+  std::sort(entries.begin(), entries.end());
+
+  size_t distinct = 0;
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (i == 0 || entries[i].first != entries[i - 1].first) distinct++;
+  }
+  size_t size = 16;
+  while (size < distinct * 2) size <<= 1;
+  cells.assign(size, CellSlot{0, 0, 0, 0});
+  cellMask = (uint32_t)size - 1;
+
+  cellFences.reserve(entries.size());
+  for (size_t i = 0; i < entries.size();) {
+    uint64_t key = entries[i].first;
+    uint32_t start = (uint32_t)cellFences.size();
+    for (; i < entries.size() && entries[i].first == key; i++) cellFences.push_back(entries[i].second);
+    uint32_t cy = (uint32_t)(key >> 32), cx = (uint32_t)key;
+    uint32_t j = cellHash(cy, cx) & cellMask;
+    while (cells[j].count != 0) j = (j + 1) & cellMask;
+    cells[j] = CellSlot{cy, cx, start, (uint32_t)cellFences.size() - start};
+  }
+}
+
+// Call fn(fence index) for every fence that may contain the position
+template <typename Fn>
+static void forEachCandidate(int32_t latE7, int32_t lonE7, Fn fn) {
+  const CellSlot* c = findCell(cellOf(latE7), cellOf(lonE7));
+  if (c) {
+    for (uint32_t k = 0; k < c->count; k++) fn(cellFences[c->start + k]);
+  }
+  for (uint16_t i : largeFences) fn(i);
+}
+
+// ============= CONTAINMENT =============
+
+// Ray cast along the latitude line: exact on E7 integers
+static bool polygonContains(const Fence& f, int32_t latE7, int32_t lonE7) {
+  bool in = false;
+  const int32_t* la = vLat.data() + f.firstVertex;
+  const int32_t* lo = vLon.data() + f.firstVertex;
+  for (uint16_t i = 0, j = f.nVertices - 1; i < f.nVertices; j = i++) {
+    if ((la[i] > latE7) == (la[j] > latE7)) continue;
+    int64_t lhs = ((int64_t)lonE7 - lo[i]) * ((int64_t)la[j] - la[i]);
+    int64_t rhs = ((int64_t)latE7 - la[i]) * ((int64_t)lo[j] - lo[i]);
+    if (la[j] > la[i] ? lhs < rhs : lhs > rhs) in = !in;
+  }
+  return in;
+}
+
+// Distance in metres from the position to the nearest polygon edge
+static float polygonEdgeDistanceM(const Fence& f, int32_t latE7, int32_t lonE7) {
+  float kx = GEO_M_PER_E7 * (geoCosQ30(latE7) * (1.0f / 1073741824.0f));
+  float best = INFINITY;
+  const int32_t* la = vLat.data() + f.firstVertex;
+  const int32_t* lo = vLon.data() + f.firstVertex;
+  for (uint16_t i = 0, j = f.nVertices - 1; i < f.nVertices; j = i++) {
+    float ax = (float)((int64_t)lo[j] - lonE7) * kx, ay = (float)((int64_t)la[j] - latE7) * GEO_M_PER_E7;
+    float bx = (float)((int64_t)lo[i] - lonE7) * kx, by = (float)((int64_t)la[i] - latE7) * GEO_M_PER_E7;
+    float ex = bx - ax, ey = by - ay;
+    float len2 = ex * ex + ey * ey;
+    float t = (len2 > 0) ? -(ax * ex + ay * ey) / len2 : 0;
+    if (t < 0) t = 0;
+    if (t > 1) t = 1;
+    float dx = ax + t * ex, dy = ay + t * ey;
+    float d = sqrtf(dx * dx + dy * dy);
+    if (d < best) best = d;
+  }
+  return best;
+}
+
+// Inside the fence, or (marginM > 0) no further than marginM outside it
+static bool fenceContains(const Fence& f, int32_t latE7, int32_t lonE7, float marginM) {
+  if (marginM == 0 && (latE7 < f.minLatE7 || latE7 > f.maxLatE7 || lonE7 < f.minLonE7 || lonE7 > f.maxLonE7)) {
+    return false;
+  }
+  if (f.nVertices == 0) return geoDistanceM(f.latE7, f.lonE7, latE7, lonE7) <= f.radiusM + marginM;
+  if (polygonContains(f, latE7, lonE7)) return true;
+  return marginM > 0 && polygonEdgeDistanceM(f, latE7, lonE7) <= marginM;
+}
+
+// ============= LOADING =============
+
+static bool toE7(const char* s, char** end, double limit, int32_t& out) {
+  double deg = strtod(s, end);
+  if (*end == s || deg < -limit || deg > limit) return false;
+  out = (int32_t)lround(deg * 1e7);
+  return true;
+}
+
+// One line of the fence file; false if it is not a valid fence
+static bool parseLine(const char* p) {
+  while (*p == ' ' || *p == '\t') p++;
+  bool circle = strncmp(p, "circle", 6) == 0;
+  bool poly = strncmp(p, "poly", 4) == 0;
+  if (!circle && !poly) return false;
+  p += circle ? 6 : 4;
+
+  char* end;
+  long id = strtol(p, &end, 10);
+  if (end == p || id < 0 || id > 0xFFFF) return false;
+  p = end;
+
+  Fence f = {};
+  f.id = (uint16_t)id;
+  if (circle) {
+    double r;
+    if (!toE7(p, &end, 90, f.latE7)) return false;
+    if (!toE7(p = end, &end, 180, f.lonE7)) return false;
+    r = strtod(p = end, &end);
+    if (end == p || !(r > 0 && r <= 100000)) return false;
+    f.radiusM = (float)r;
+    int32_t dLat = (int32_t)(r / GEO_M_PER_E7) + 1;
+    int32_t cosQ30 = geoCosQ30(abs(f.latE7) + dLat < 900000000 ? abs(f.latE7) + dLat : 900000000);
+    int32_t dLon = cosQ30 > (1 << 20) ? (int32_t)std::min<int64_t>(((int64_t)dLat << 30) / cosQ30, 1800000000) : 1800000000;
+    f.minLatE7 = std::max(f.latE7 - dLat, -900000000);
+    f.maxLatE7 = std::min(f.latE7 + dLat, 900000000);
+    f.minLonE7 = (int32_t)std::max<int64_t>((int64_t)f.lonE7 - dLon, -1800000000);
+    f.maxLonE7 = (int32_t)std::min<int64_t>((int64_t)f.lonE7 + dLon, 1800000000);
+  } else {
+    f.firstVertex = (uint32_t)vLat.size();
+    f.minLatE7 = f.minLonE7 = INT32_MAX;
+    f.maxLatE7 = f.maxLonE7 = INT32_MIN;
+    int32_t lat, lon;
+    while (toE7(p, &end, 90, lat)) {
+      if (!toE7(p = end, &end, 180, lon) || f.nVertices == GEOFENCE_MAX_VERTICES) break;
+      p = end;
+      vLat.push_back(lat);
+      vLon.push_back(lon);
+      f.nVertices++;
+      f.minLatE7 = std::min(f.minLatE7, lat);
+      f.maxLatE7 = std::max(f.maxLatE7, lat);
+      f.minLonE7 = std::min(f.minLonE7, lon);
+      f.maxLonE7 = std::max(f.maxLonE7, lon);
+    }
+    // Needs 3 vertices, nothing left over, and no antimeridian crossing
+    while (*p == ' ' || *p == '\t' || *p == '\r') p++;
+    if (f.nVertices < 3 || (*p && *p != '#') || (int64_t)f.maxLonE7 - f.minLonE7 > 1800000000) {
+      vLat.resize(f.firstVertex);
+      vLon.resize(f.firstVertex);
+      return false;
+    }
+  }
+  fences.push_back(f);
+  return true;
+}
+
+size_t geofenceLoad(const char* text, size_t len) {
+  fences.clear();
+  vLat.clear();
+  vLon.clear();
+  nInside = 0;
+
+  size_t bad = 0;
+  std::string line;
+  for (size_t i = 0; i <= len; i++) {
+    if (i < len && text[i] != '\n') {
+      line += text[i];
+      continue;
+    }
+    size_t s = line.find_first_not_of(" \t\r");
+    if (s != std::string::npos && line[s] != '#') {
+      if (fences.size() >= GEOFENCE_MAX_FENCES || !parseLine(line.c_str())) bad++;
+    }
+    line.clear();
+  }
+  buildIndex();
+
+  Serial.printf("[FENCE] %u fences (%u skipped), grid 2^%u E7 cells: %u cells, %u large fences\n",
+                (unsigned)fences.size(), (unsigned)bad, cellShift,
+                (unsigned)(cells.size() ? std::count_if(cells.begin(), cells.end(), [](const CellSlot& c) { return c.count != 0; }) : 0),
+                (unsigned)largeFences.size());
+  return fences.size();
+}
+
+size_t geofenceInit() {
+  File f = LittleFS.open(GEOFENCE_FILE, FILE_READ);
+  if (!f) {
+    Serial.println("[FENCE] No " GEOFENCE_FILE ", geofencing off");
+    return 0;
+  }
+  std::vector<char> buf(f.size());
+  size_t n = f.read((uint8_t*)buf.data(), buf.size());
+  f.close();
+  return geofenceLoad(buf.data(), n);
+}
+
+size_t geofenceCount() {
+  return fences.size();
+}
+
+// ============= EVALUATION =============
+
+size_t geofenceEvaluate(int32_t latE7, int32_t lonE7, GeofenceEvent* out, size_t maxN) {
+  if (fences.empty()) return 0;
+
+  uint16_t now[GEOFENCE_MAX_INSIDE];
+  size_t nNow = 0;
+  size_t nEv = 0;
+
+  // Still inside: leaving takes GEOFENCE_HYSTERESIS_M past the edge
+  for (size_t k = 0; k < nInside; k++) {
+    const Fence& f = fences[inside[k]];
+    if (!fenceContains(f, latE7, lonE7, GEOFENCE_HYSTERESIS_M) && nEv < maxN) {
+      out[nEv++] = GeofenceEvent{0, f.id, false};
+    } else {
+      now[nNow++] = inside[k];      // inside, or the exit waits for the next call
+    }
+  }
+
+  // Entered
+  forEachCandidate(latE7, lonE7, [&](uint16_t i) {
+    if (nNow == GEOFENCE_MAX_INSIDE || nEv == maxN) return;
+    for (size_t k = 0; k < nNow; k++) {
+      if (now[k] == i) return;
+    }
+    for (size_t k = 0; k < nInside; k++) {
+      if (inside[k] == i) return;   // just left it
+    }
+    if (fenceContains(fences[i], latE7, lonE7, 0)) {
+      now[nNow++] = i;
+      out[nEv++] = GeofenceEvent{0, fences[i].id, true};
+    }
+  });
+
+  memcpy(inside, now, nNow * sizeof(now[0]));
+  nInside = nNow;
+  return nEv;
+}
+
+size_t geofenceQuery(int32_t latE7, int32_t lonE7, uint16_t* outIds, size_t maxN) {
+  size_t n = 0;
+  forEachCandidate(latE7, lonE7, [&](uint16_t i) {
+    if (fenceContains(fences[i], latE7, lonE7, 0)) {
+      if (n < maxN) outIds[n] = fences[i].id;
+      n++;
+    }
+  });
+  return n;
+}
+
+size_t geofenceQueryLinear(int32_t latE7, int32_t lonE7, uint16_t* outIds, size_t maxN) {
+  size_t n = 0;
+  for (const Fence& f : fences) {
+    if (fenceContains(f, latE7, lonE7, 0)) {
+      if (n < maxN) outIds[n] = f.id;
+      n++;
+    }
+  }
+  return n;
+}
+
+// ============= EVENT LOG =============
+
+void geofenceLogEvents(uint32_t seq, const GeofenceEvent* ev, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    EventSlot& s = eventLog[eventsLogged % GEOFENCE_EVENT_LOG];
+    s.stamp.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.ev = ev[i];
+    s.ev.seq = seq;
+    s.stamp.store(++eventsLogged, std::memory_order_release);
+    Serial.printf("[FENCE] seq=%u %s fence %u\n", seq, ev[i].enter ? "entered" : "left", ev[i].id);
+  }
+}
+
+size_t geofenceEventsAt(uint32_t seq, GeofenceEvent* out, size_t maxN) {
+  size_t n = 0;
+  for (size_t i = 0; i < GEOFENCE_EVENT_LOG && n < maxN; i++) {
+    const EventSlot& s = eventLog[i];
+    uint32_t stamp = s.stamp.load(std::memory_order_acquire);
+    if (stamp == 0) continue;
+    GeofenceEvent ev = s.ev;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s.stamp.load(std::memory_order_relaxed) != stamp || ev.seq != seq) continue;
+    out[n++] = ev;
+  }
+  return n;
+}
@@ -0,0 +1,174 @@
+#include "gnss_capture.h"
+#include <LittleFS.h>
+#include <vector>
+#include <algorithm>
+#include "gps.h"
+
+// RAM ring of encoded records. Two producers (UART reader, GPS task) and one
+// consumer (sampler task), so appends and takes run in a short critical section.
+static uint8_t ram[GNSS_CAPTURE_RAM_BYTES];
+static size_t ramHead = 0;                  // total bytes ever appended
+static size_t ramTail = 0;                  // total bytes ever taken
+static uint32_t ramSinceMs = 0;             // millis() when the ring last became non-empty
+static uint32_t lostBytes = 0;              // dropped, not yet reported in a LOST record
+static portMUX_TYPE ramMux = portMUX_INITIALIZER_UNLOCKED;
+static bool capturing = false;
+
+// Flash side (sampler task only)
+static bool fsReady = false;
+static uint32_t oldestSeg = 1;
+static uint32_t segNo = 0;
+static size_t segBytes = 0;
+
+static uint16_t crc16(const uint8_t* data, size_t n, uint16_t crc = 0xFFFF) {
+  for (size_t i = 0; i < n; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static void ramPut(const uint8_t* p, size_t n) {
+  while (n > 0) {
+    size_t at = ramHead % sizeof(ram);
+    size_t chunk = std::min(n, sizeof(ram) - at);
+    memcpy(ram + at, p, chunk);
+    ramHead += chunk;
+    p += chunk;
+    n -= chunk;
+  }
+}
+
+// Encode one record into the ring, or count it as lost
+static void appendRecord(uint8_t type, uint32_t us, const void* payload, size_t len) {
+  uint8_t head[8] = { GNSS_CAP_MAGIC, type, (uint8_t)len, (uint8_t)(len >> 8),
+                      (uint8_t)us, (uint8_t)(us >> 8), (uint8_t)(us >> 16), (uint8_t)(us >> 24) };
+  uint16_t crc = crc16((const uint8_t*)payload, len, crc16(head + 1, 7));
+  uint8_t tail[2] = { (uint8_t)(crc >> 8), (uint8_t)crc };
+
+  portENTER_CRITICAL(&ramMux);
+  if (ramHead - ramTail + GNSS_CAP_OVERHEAD + len > sizeof(ram)) {
+    lostBytes += len;
+  } else {
+    if (ramHead == ramTail) ramSinceMs = millis();
+    ramPut(head, sizeof(head));
+    ramPut((const uint8_t*)payload, len);
+    ramPut(tail, sizeof(tail));
+  }
+  portEXIT_CRITICAL(&ramMux);
+}
+
+// Report drops before the next record so the replay knows the stream has a hole
+static void reportLost(uint32_t us) {
+  uint32_t lost;
+  portENTER_CRITICAL(&ramMux);
+  lost = lostBytes;
+  lostBytes = 0;
+  portEXIT_CRITICAL(&ramMux);
+  if (lost) appendRecord(GNSS_CAP_LOST, us, &lost, sizeof(lost));
+}
+
+void gnssCaptureBegin() {
+  uint8_t boot[3] = { GNSS_CAP_VERSION, GPS_BINARY_PROTOCOL, GPS_DUTY_CYCLE };
+  capturing = true;
+  appendRecord(GNSS_CAP_BOOT, micros(), boot, sizeof(boot));
+}
+
+void gnssCaptureRx(const void* data, size_t len, uint32_t us) {
+  if (!capturing || !len) return;
+  if (lostBytes) reportLost(us);
+  appendRecord(GNSS_CAP_RX, us, data, len);
+}
+
+void gnssCapturePps(uint32_t us) {
+  if (!capturing) return;
+  appendRecord(GNSS_CAP_PPS, us, nullptr, 0);
+}
+
+// ============= FLASH =============
+
+static void segPath(uint32_t n, char* out, size_t outLen) {
+  snprintf(out, outLen, GNSS_CAPTURE_DIR "/%08lu.cap", (unsigned long)n);
+}
+
+// Continue numbering after the segments already on flash
+static bool openRing() {
+  if (!LittleFS.exists(GNSS_CAPTURE_DIR) && !LittleFS.mkdir(GNSS_CAPTURE_DIR)) return false;
+  std::vector<uint32_t> segs;
+  File dir = LittleFS.open(GNSS_CAPTURE_DIR);
+  if (!dir || !dir.isDirectory()) return false;
+  File f = dir.openNextFile();
+  while (f) {
+    const char* name = f.name();
+    const char* base = strrchr(name, '/');
+    base = base ? base + 1 : name;
+    char* end = nullptr;
+    unsigned long n = strtoul(base, &end, 10);
+    if (end != base && strcmp(end, ".cap") == 0) segs.push_back((uint32_t)n);
+    f.close();
+    f = dir.openNextFile();
+  }
+  std::sort(segs.begin(), segs.end());
+  oldestSeg = segs.empty() ? 1 : segs.front();
+  segNo = segs.empty() ? 0 : segs.back();
+  segBytes = GNSS_CAPTURE_SEGMENT_BYTES;      // every boot starts a new segment
+  return true;
+}
+
+static void rotateSegment() {
+  segNo++;
+  segBytes = 0;
+  while (segNo - oldestSeg + 1 > GNSS_CAPTURE_MAX_SEGMENTS) {
+    char path[32];
+    segPath(oldestSeg, path, sizeof(path));
+    LittleFS.remove(path);
+    oldestSeg++;
+  }
+}
+
+void gnssCaptureService() {
+  if (!capturing) return;
+  if (!fsReady) {
+    fsReady = openRing();
+    if (!fsReady) {
+      capturing = false;
+      Serial.println("[CAP] LittleFS not usable, GNSS capture off");
+      return;
+    }
+    Serial.printf("[CAP] Capturing GNSS stream to " GNSS_CAPTURE_DIR " (%u KB ring)\n",
+                  (unsigned)(GNSS_CAPTURE_SEGMENT_BYTES / 1024 * GNSS_CAPTURE_MAX_SEGMENTS));
+  }
+
+  static uint8_t page[GNSS_CAPTURE_PAGE_BYTES];
+  while (true) {
+    size_t n;
+    portENTER_CRITICAL(&ramMux);
+    size_t buffered = ramHead - ramTail;
+    bool due = buffered >= sizeof(page) || (buffered > 0 && millis() - ramSinceMs >= GNSS_CAPTURE_FLUSH_MS);
+    n = due ? std::min(buffered, sizeof(page)) : 0;
+    for (size_t i = 0; i < n; i++) page[i] = ram[(ramTail + i) % sizeof(ram)];
+    portEXIT_CRITICAL(&ramMux);
+    if (!n) return;
+
+    // Segments are concatenated on replay, so records may straddle two of them
+    if (segBytes >= GNSS_CAPTURE_SEGMENT_BYTES) rotateSegment();
+    char path[32];
+    segPath(segNo, path, sizeof(path));
+    File f = LittleFS.open(path, FILE_APPEND);
+    size_t written = f ? f.write(page, n) : 0;
+    if (f) f.close();
+    if (written != n) {
+      capturing = false;                      // never stall the sampler on a full or broken filesystem
+      Serial.println("[CAP] Write failed, GNSS capture off");
+      return;
+    }
+    segBytes += n;
+
+    portENTER_CRITICAL(&ramMux);
+    ramTail += n;
+    if (ramHead != ramTail) ramSinceMs = millis();
+    portEXIT_CRITICAL(&ramMux);
+  }
+}
@@ -0,0 +1,158 @@
+#include "gnss_casic.h"
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+
+// ============= FIELD ACCESS =============
+// Payload fields are little-endian and not necessarily aligned
+
+static inline uint16_t getU2(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t getU4(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline float getR4(const uint8_t* p) {
+  uint32_t u = getU4(p);
+  float f;
+  memcpy(&f, &u, sizeof(f));
+  return f;
+}
+
+static inline double getR8(const uint8_t* p) {
+  uint64_t u = (uint64_t)getU4(p) | ((uint64_t)getU4(p + 4) << 32);
+  double d;
+  memcpy(&d, &u, sizeof(d));
+  return d;
+}
+
+static uint32_t checksum(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t len) {
+  uint32_t ck = ((uint32_t)id << 24) + ((uint32_t)cls << 16) + len;
+  for (uint16_t i = 0; i + 4 <= len; i += 4) {
+    ck += getU4(payload + i);
+  }
+  return ck;
+}
+
+// ============= BUILDING =============
+
+size_t casicFrame(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t len, uint8_t* out, size_t cap) {
+  size_t n = CASIC_HEADER_LEN + len + CASIC_CHECKSUM_LEN;
+  if (n > cap || (len & 3)) return 0;
+  out[0] = CASIC_SYNC1;
+  out[1] = CASIC_SYNC2;
+  out[2] = (uint8_t)len;
+  out[3] = (uint8_t)(len >> 8);
+  out[4] = cls;
+  out[5] = id;
+  if (len) memcpy(out + CASIC_HEADER_LEN, payload, len);
+  uint32_t ck = checksum(cls, id, payload, len);
+  uint8_t* c = out + CASIC_HEADER_LEN + len;
+  c[0] = (uint8_t)ck;
+  c[1] = (uint8_t)(ck >> 8);
+  c[2] = (uint8_t)(ck >> 16);
+  c[3] = (uint8_t)(ck >> 24);
+  return n;
+}
+
+size_t casicCfgMsg(uint8_t cls, uint8_t id, uint16_t rate, uint8_t* out) {
+  uint8_t payload[4] = { cls, id, (uint8_t)rate, (uint8_t)(rate >> 8) };
+  return casicFrame(CASIC_CLS_CFG, CASIC_ID_CFG_MSG, payload, sizeof(payload), out,
+                    CASIC_HEADER_LEN + sizeof(payload) + CASIC_CHECKSUM_LEN);
+}
+
+size_t casicCommand(const char* body, char* out, size_t cap) {
+  uint8_t cs = 0;
+  for (const char* c = body; *c; c++) cs ^= (uint8_t)*c;
+  int n = snprintf(out, cap, "$%s*%02X\r\n", body, cs);
+  return (n > 0 && (size_t)n < cap) ? (size_t)n : 0;
+}
+
+// ============= DECODING =============
+
+bool casicValid(const uint8_t* frame, size_t n) {
+  if (n < CASIC_HEADER_LEN + CASIC_CHECKSUM_LEN) return false;
+  if (frame[0] != CASIC_SYNC1 || frame[1] != CASIC_SYNC2) return false;
+  uint16_t len = getU2(frame + 2);
+  if ((len & 3) || n != (size_t)CASIC_HEADER_LEN + len + CASIC_CHECKSUM_LEN) return false;
+  return checksum(frame[4], frame[5], frame + CASIC_HEADER_LEN, len) == getU4(frame + CASIC_HEADER_LEN + len);
+}
+
+CasicAck casicAckFor(const uint8_t* frame, size_t n, uint8_t cls, uint8_t id) {
+  if (n < CASIC_HEADER_LEN + 2 + CASIC_CHECKSUM_LEN || frame[4] != CASIC_CLS_ACK) return CASIC_ACK_NONE;
+  const uint8_t* p = frame + CASIC_HEADER_LEN;
+  if (p[0] != cls || p[1] != id) return CASIC_ACK_NONE;
+  if (frame[5] == CASIC_ID_ACK_ACK) return CASIC_ACK_OK;
+  if (frame[5] == CASIC_ID_ACK_NAK) return CASIC_ACK_NAK;
+  return CASIC_ACK_NONE;
+}
+
+// NAV-PV: runTime U4, posValid U1, velValid U1, system U1, numSV U1, 4x U1,
+// pDop R4, lon R8, lat R8, height R4, sepGeoid R4, hAcc R4, vAcc R4,
+// velN R4, velE R4, velU R4, speed3D R4, speed2D R4, heading R4, sAcc R4, cAcc R4
+static NmeaEvent decodeNavPv(NmeaFix& f, const uint8_t* p) {
+  uint8_t posValid = p[4];
+  uint8_t velValid = p[5];
+  f.sats = p[7];
+  float pDop = getR4(p + 12);
+  f.pdopX100 = (pDop > 0 && pDop < 655.0f) ? (uint16_t)(pDop * 100.0f + 0.5f) : 0;
+
+  // 6 = 2D, 7 = 3D, 8 = GNSS + dead reckoning; lower values are not a usable fix
+  f.fixValid = posValid >= 6;
+  f.fixMode = posValid >= 7 ? 3 : (posValid == 6 ? 2 : 1);
+  f.quality = f.fixValid ? 1 : 0;
+  if (!f.fixValid) return NMEA_EV_NO_FIX;
+
+  f.lonE7 = (int32_t)lround(getR8(p + 16) * 1e7);
+  f.latE7 = (int32_t)lround(getR8(p + 24) * 1e7);
+  f.altCm = (int32_t)lroundf(getR4(p + 32) * 100.0f);
+  f.hasAltitude = true;
+  f.hasLocation = true;
+
+  if (velValid >= 6) {
+    float speed = getR4(p + 64);
+    float heading = getR4(p + 68);
+    f.speedCmS = speed > 0 ? (uint32_t)(speed * 100.0f + 0.5f) : 0;
+    f.hasSpeed = true;
+    if (heading >= 0 && heading < 360.0f) {
+      f.courseCdeg = (uint16_t)(heading * 100.0f);
+      f.hasCourse = true;
+    }
+  }
+  return NMEA_EV_FIX;
+}
+
+// NAV-TIMEUTC: runTime U4, tAcc R4, msErr R4, ms U2, year U2, month U1, day U1,
+// hour U1, min U1, sec U1, valid U1, tmSrc U1, res U1
+static NmeaEvent decodeTimeUtc(NmeaFix& f, const uint8_t* p) {
+  if (p[21] == 0) return NMEA_EV_NONE;   // no valid time yet
+  uint16_t year = getU2(p + 14);
+  uint8_t month = p[16], day = p[17];
+  uint8_t hour = p[18], minute = p[19], second = p[20];
+  if (hour > 23 || minute > 59 || second > 60) return NMEA_EV_NONE;
+  f.hour = hour;
+  f.minute = minute;
+  f.second = second;
+  f.centisecond = (uint8_t)(getU2(p + 12) / 10 % 100);
+  f.hasTime = true;
+  if (year >= 2000 && month >= 1 && month <= 12 && day >= 1 && day <= 31) {
+    f.year = year;
+    f.month = month;
+    f.day = day;
+    f.hasDate = true;
+  }
+  return NMEA_EV_STATUS;
+}
+
+NmeaEvent casicDecode(NmeaFix& fix, const uint8_t* frame, size_t n) {
+  if (!casicValid(frame, n)) return NMEA_EV_BAD;
+  uint8_t cls = frame[4], id = frame[5];
+  uint16_t len = getU2(frame + 2);
+  const uint8_t* p = frame + CASIC_HEADER_LEN;
+  if (cls != CASIC_CLS_NAV) return NMEA_EV_NONE;
+  if (id == CASIC_ID_NAV_PV && len >= 80) return decodeNavPv(fix, p);
+  if (id == CASIC_ID_NAV_TIMEUTC && len >= 24) return decodeTimeUtc(fix, p);
+  return NMEA_EV_NONE;
+}
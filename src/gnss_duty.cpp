@@ -0,0 +1,134 @@
+#include "gnss_duty.h"
+#include "sample_policy.h"
+#include "geo_distance.h"
+
+// Distance from the anchor, only ever compared with SAMPLE_PARKED_MOVE_M
+static float driftM(const GnssDuty& d, const NmeaFix& fix) {
+  return geoDistanceM(d.anchorLatE7, d.anchorLonE7, fix.latE7, fix.lonE7);
+}
+
+static void setAnchor(GnssDuty& d, const NmeaFix& fix) {
+  d.anchorLatE7 = fix.latE7;
+  d.anchorLonE7 = fix.lonE7;
+  d.hasAnchor = true;
+}
+
+// Same notion of "moving" as the sampling policy: speed, or drift without speed
+static bool isMoving(const GnssDuty& d, const NmeaFix& fix) {
+  if (!fix.fixValid || !fix.hasLocation) return false;
+  if (fix.hasSpeed && fix.speedCmS >= SAMPLE_MOVING_CMS) return true;
+  return d.hasAnchor && driftM(d, fix) >= SAMPLE_PARKED_MOVE_M;
+}
+
+static void enter(GnssDuty& d, GnssDutyState s, uint32_t nowMs) {
+  if (s == GNSS_DUTY_OFF) d.onMs += nowMs - d.awakeSinceMs;
+  if (d.state == GNSS_DUTY_OFF) d.awakeSinceMs = nowMs;
+  d.state = s;
+  d.stateSinceMs = nowMs;
+}
+
+// Awake again and done with cycling for now
+static void toContinuous(GnssDuty& d, uint32_t nowMs, const NmeaFix& fix) {
+  enter(d, GNSS_DUTY_CONTINUOUS, nowMs);
+  d.stillSinceMs = nowMs;
+  d.hasAnchor = false;
+  if (fix.fixValid && fix.hasLocation) setAnchor(d, fix);
+}
+
+// Fold one wake's TTFF into the off time for the next sleep
+static void adaptOffTime(GnssDuty& d, uint32_t ttffMs) {
+  d.ttffLastMs = ttffMs;
+  if (ttffMs > d.ttffMaxMs) d.ttffMaxMs = ttffMs;
+  d.ttffAvgMs = d.ttffAvgMs ? (3 * d.ttffAvgMs + ttffMs) / 4 : ttffMs;
+
+  if (ttffMs <= GNSS_DUTY_HOT_TTFF_MS) {
+    d.hotStarts++;
+    d.offMs += d.offMs / 4;           // still hot: try sleeping longer
+  } else {
+    d.offMs /= 2;                     // ephemeris went stale: come back sooner
+  }
+
+  uint32_t floorMs = GNSS_DUTY_OFF_MIN_S * 1000UL;
+  if (d.ttffAvgMs * GNSS_DUTY_OFF_PER_TTFF > floorMs) floorMs = d.ttffAvgMs * GNSS_DUTY_OFF_PER_TTFF;
+  if (d.offMs < floorMs) d.offMs = floorMs;
+  if (d.offMs > GNSS_DUTY_OFF_MAX_S * 1000UL) d.offMs = GNSS_DUTY_OFF_MAX_S * 1000UL;
+}
+
+void gnssDutyInit(GnssDuty& d, uint32_t nowMs) {
+  d = GnssDuty();
+  d.state = GNSS_DUTY_CONTINUOUS;
+  d.stateSinceMs = nowMs;
+  d.stillSinceMs = nowMs;
+  d.offMs = GNSS_DUTY_OFF_START_S * 1000UL;
+  d.startMs = nowMs;
+  d.awakeSinceMs = nowMs;
+}
+
+GnssDutyAction gnssDutyStep(GnssDuty& d, uint32_t nowMs, const NmeaFix& fix, bool freshFix) {
+  uint32_t inState = nowMs - d.stateSinceMs;
+
+  switch (d.state) {
+    case GNSS_DUTY_CONTINUOUS:
+      if (isMoving(d, fix)) {
+        d.stillSinceMs = nowMs;
+        setAnchor(d, fix);
+        return GNSS_DUTY_NONE;
+      }
+      if (!d.hasAnchor && fix.fixValid && fix.hasLocation) setAnchor(d, fix);
+      if (nowMs - d.stillSinceMs < GNSS_DUTY_STILL_S * 1000UL) return GNSS_DUTY_NONE;
+      enter(d, GNSS_DUTY_OFF, nowMs);
+      return GNSS_DUTY_SLEEP;
+
+    case GNSS_DUTY_OFF:
+      if (inState < d.offMs) return GNSS_DUTY_NONE;
+      enter(d, GNSS_DUTY_ACQUIRE, nowMs);
+      d.wakes++;
+      return GNSS_DUTY_WAKE;
+
+    case GNSS_DUTY_ACQUIRE:
+      if (freshFix && fix.fixValid) {
+        adaptOffTime(d, inState);
+        if (isMoving(d, fix)) {
+          toContinuous(d, nowMs, fix);
+          return GNSS_DUTY_NONE;
+        }
+        if (!d.hasAnchor) setAnchor(d, fix);
+        enter(d, GNSS_DUTY_HOLD, nowMs);
+        return GNSS_DUTY_NONE;
+      }
+      if (inState < GNSS_DUTY_ACQUIRE_MAX_S * 1000UL) return GNSS_DUTY_NONE;
+      // No sky (garage, indoors): back off as far as allowed
+      d.timeouts++;
+      d.offMs = GNSS_DUTY_OFF_MAX_S * 1000UL;
+      enter(d, GNSS_DUTY_OFF, nowMs);
+      return GNSS_DUTY_SLEEP;
+
+    case GNSS_DUTY_HOLD:
+      if (isMoving(d, fix)) {
+        toContinuous(d, nowMs, fix);
+        return GNSS_DUTY_NONE;
+      }
+      if (inState < GNSS_DUTY_HOLD_MS) return GNSS_DUTY_NONE;
+      enter(d, GNSS_DUTY_OFF, nowMs);
+      return GNSS_DUTY_SLEEP;
+  }
+  return GNSS_DUTY_NONE;
+}
+
+uint32_t gnssDutyOnSecPerHour(const GnssDuty& d, uint32_t nowMs) {
+  uint32_t elapsedMs = nowMs - d.startMs;
+  if (!elapsedMs) return 3600;
+  uint64_t onMs = d.onMs;
+  if (d.state != GNSS_DUTY_OFF) onMs += nowMs - d.awakeSinceMs;   // still awake
+  return (uint32_t)(onMs * 3600ULL / elapsedMs);
+}
+
+const char* gnssDutyStateName(GnssDutyState s) {
+  switch (s) {
+    case GNSS_DUTY_CONTINUOUS: return "continuous";
+    case GNSS_DUTY_ACQUIRE:    return "acquire";
+    case GNSS_DUTY_HOLD:       return "hold";
+    case GNSS_DUTY_OFF:        return "off";
+    default:                   return "?";
+  }
+}
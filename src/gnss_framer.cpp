@@ -0,0 +1,59 @@
+#include "gnss_framer.h"
+#include "gnss_casic.h"
+
+enum : uint8_t { FR_SYNC = 0, FR_LINE, FR_BINARY };
+
+void gnssFramerReset(GnssFramer& fr) {
+  fr.state = FR_SYNC;
+  fr.len = 0;
+  fr.need = 0;
+}
+
+bool gnssFramerByte(GnssFramer& fr, uint8_t b, GnssFrameKind& kind) {
+  switch (fr.state) {
+    case FR_SYNC:
+      if (b == '$') fr.state = FR_LINE;
+      else if (b == CASIC_SYNC1) fr.state = FR_BINARY;
+      else return false;
+      fr.len = 0;
+      fr.need = 0;
+      fr.cur[fr.len++] = b;
+      return false;
+
+    case FR_LINE:
+      if (b == CASIC_SYNC1) {
+        fr.state = FR_SYNC;           // never part of a NMEA line: the '\n' was lost
+        return gnssFramerByte(fr, b, kind);
+      }
+      if (fr.len < GNSS_FRAME_MAX) fr.cur[fr.len++] = b;
+      if (b != '\n') return false;
+      fr.state = FR_SYNC;
+      if (fr.len >= GNSS_FRAME_MAX && fr.cur[fr.len - 1] != '\n') {
+        fr.truncated++;               // overlong line: the checksum would fail anyway
+        fr.len = 0;
+        return false;
+      }
+      kind = GNSS_FRAME_NMEA;
+      return true;
+
+    case FR_BINARY:
+      fr.cur[fr.len++] = b;
+      if (fr.len == 2 && b != CASIC_SYNC2) {
+        fr.state = FR_SYNC;           // false sync: look at this byte again
+        return gnssFramerByte(fr, b, kind);
+      }
+      if (fr.len == 4) {
+        fr.need = CASIC_HEADER_LEN + (fr.cur[2] | (fr.cur[3] << 8)) + CASIC_CHECKSUM_LEN;
+        if (fr.need > GNSS_FRAME_MAX) {
+          fr.truncated++;             // not a message we enabled: resync
+          fr.state = FR_SYNC;
+          return false;
+        }
+      }
+      if (!fr.need || fr.len != fr.need) return false;
+      fr.state = FR_SYNC;
+      kind = GNSS_FRAME_BINARY;
+      return true;
+  }
+  return false;
+}
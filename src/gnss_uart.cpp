@@ -0,0 +1,223 @@
+#include "gnss_uart.h"
+#include <driver/uart.h>
+#include <atomic>
+#include "gnss_framer.h"
+#include "gnss_capture.h"
+
+static QueueHandle_t uartQueue = nullptr;
+static TaskHandle_t consumerTask = nullptr;
+
+// Framing wanted by the consumer; the reader task compares it with the
+// current framing after every event and after each idle wait
+static std::atomic<uint8_t> requestedFraming{GNSS_FRAMING_LINES};
+static GnssFraming framing = GNSS_FRAMING_LINES;
+
+// ============= FRAME RING =============
+// Single producer (reader task), single consumer (GPS task)
+static GnssFrame ring[GNSS_FRAME_SLOTS];
+static std::atomic<uint32_t> ringHead{0};   // next slot to write
+static std::atomic<uint32_t> ringTail{0};   // next slot to read
+
+static GnssUartStats stats;
+
+static GnssFrame* ringReserve() {
+  uint32_t head = ringHead.load(std::memory_order_relaxed);
+  if (head - ringTail.load(std::memory_order_acquire) >= GNSS_FRAME_SLOTS) return nullptr;
+  return &ring[head & (GNSS_FRAME_SLOTS - 1)];
+}
+
+static void ringCommit() {
+  ringHead.store(ringHead.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  stats.frames++;
+  if (consumerTask) xTaskNotifyGive(consumerTask);
+}
+
+bool gnssUartPop(GnssFrame& out) {
+  uint32_t tail = ringTail.load(std::memory_order_relaxed);
+  if (tail == ringHead.load(std::memory_order_acquire)) return false;
+  out = ring[tail & (GNSS_FRAME_SLOTS - 1)];
+  ringTail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+void gnssUartDiscard() {
+  ringTail.store(ringHead.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+// ============= LINE MODE =============
+
+// Read and throw away len bytes from the driver buffer
+static void discard(size_t len) {
+  uint8_t sink[32];
+  while (len > 0) {
+    size_t n = len < sizeof(sink) ? len : sizeof(sink);
+    uart_read_bytes(GNSS_UART_NUM, sink, n, 0);
+    len -= n;
+  }
+}
+
+// Move every line the driver has found a '\n' for into the ring
+static void readLines() {
+  int pos;
+  while ((pos = uart_pattern_pop_pos(GNSS_UART_NUM)) >= 0) {
+    uint32_t arrivalUs = micros();
+    size_t len = (size_t)pos + 1;     // up to and including the '\n'
+    stats.rxBytes += len;
+
+    GnssFrame* f = ringReserve();
+    if (!f) {
+      discard(len);                   // consumer is behind: drop the line, keep the driver moving
+      stats.ringDrops++;
+      continue;
+    }
+
+    size_t keep = len < GNSS_FRAME_MAX ? len : GNSS_FRAME_MAX;
+    int got = uart_read_bytes(GNSS_UART_NUM, (uint8_t*)f->data, keep, 0);
+    if (got < 0) got = 0;
+#if GNSS_CAPTURE
+    gnssCaptureRx(f->data, got, arrivalUs);
+#endif
+    if (len > keep) {
+      discard(len - keep);
+      stats.truncated++;
+    }
+
+    f->data[got] = 0;
+    f->len = (uint8_t)got;
+    f->kind = GNSS_FRAME_NMEA;
+    f->arrivalUs = arrivalUs;
+    ringCommit();
+  }
+}
+
+// ============= MIXED MODE =============
+
+static GnssFramer framer;
+
+static void emitFrame(GnssFrameKind kind) {
+  GnssFrame* f = ringReserve();
+  if (!f) {
+    stats.ringDrops++;
+    return;
+  }
+  memcpy(f->data, framer.cur, framer.len);
+  f->data[framer.len] = 0;
+  f->len = (uint8_t)framer.len;
+  f->kind = kind;
+  f->arrivalUs = micros();
+  ringCommit();
+}
+
+static void readMixed() {
+  uint8_t buf[128];
+  int got;
+  while ((got = uart_read_bytes(GNSS_UART_NUM, buf, sizeof(buf), 0)) > 0) {
+    stats.rxBytes += got;
+#if GNSS_CAPTURE
+    gnssCaptureRx(buf, got, micros());
+#endif
+    GnssFrameKind kind;
+    for (int i = 0; i < got; i++) {
+      if (gnssFramerByte(framer, buf[i], kind)) emitFrame(kind);
+    }
+  }
+}
+
+// ============= READER TASK =============
+
+static void applyFraming() {
+  GnssFraming want = (GnssFraming)requestedFraming.load();
+  if (want == framing) return;
+  if (want == GNSS_FRAMING_MIXED) {
+    uart_disable_pattern_det_intr(GNSS_UART_NUM);
+    uart_pattern_queue_reset(GNSS_UART_NUM, GNSS_UART_QUEUE_LEN);
+    gnssFramerReset(framer);
+  } else {
+    uart_flush_input(GNSS_UART_NUM);  // drop a partial line so the first pattern position is right
+    uart_enable_pattern_det_baud_intr(GNSS_UART_NUM, '\n', 1, 9, 0, 0);
+    uart_pattern_queue_reset(GNSS_UART_NUM, GNSS_UART_QUEUE_LEN);
+  }
+  framing = want;
+}
+
+static void gnssReaderTask(void* pvParameters) {
+  uart_event_t ev;
+  while (true) {
+    if (xQueueReceive(uartQueue, &ev, pdMS_TO_TICKS(GNSS_FRAMING_POLL_MS)) != pdTRUE) {
+      applyFraming();                 // no traffic: a request must not wait for the module
+      continue;
+    }
+    uint32_t t0 = micros();
+    switch (ev.type) {
+      case UART_PATTERN_DET:
+        if (framing == GNSS_FRAMING_LINES) readLines();
+        break;
+      case UART_DATA:
+        if (framing == GNSS_FRAMING_MIXED) readMixed();
+        break;                        // line mode: wait for the pattern
+      case UART_FIFO_OVF:
+      case UART_BUFFER_FULL:
+        // Positions of already detected line ends are stale after a flush
+        uart_flush_input(GNSS_UART_NUM);
+        uart_pattern_queue_reset(GNSS_UART_NUM, GNSS_UART_QUEUE_LEN);
+        xQueueReset(uartQueue);
+        gnssFramerReset(framer);
+        stats.overflows++;
+        break;
+      default:
+        break;
+    }
+    applyFraming();
+    stats.readerBusyUs += micros() - t0;
+  }
+}
+
+// ============= SETUP =============
+
+bool gnssUartBegin(int rxPin, int txPin, TaskHandle_t consumer) {
+  consumerTask = consumer;
+
+  uart_config_t cfg = {};
+  cfg.baud_rate = GNSS_UART_BAUD;
+  cfg.data_bits = UART_DATA_8_BITS;
+  cfg.parity = UART_PARITY_DISABLE;
+  cfg.stop_bits = UART_STOP_BITS_1;
+  cfg.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+  cfg.source_clk = UART_SCLK_APB;
+
+  if (uart_driver_install(GNSS_UART_NUM, GNSS_UART_RX_BUF, 0, GNSS_UART_QUEUE_LEN, &uartQueue, 0) != ESP_OK ||
+      uart_param_config(GNSS_UART_NUM, &cfg) != ESP_OK ||
+      uart_set_pin(GNSS_UART_NUM, txPin, rxPin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) != ESP_OK) {
+    Serial.println("GNSS UART: driver setup failed");
+    return false;
+  }
+
+  // One '\n' ends a sentence; no idle time required around it
+  uart_enable_pattern_det_baud_intr(GNSS_UART_NUM, '\n', 1, 9, 0, 0);
+  uart_pattern_queue_reset(GNSS_UART_NUM, GNSS_UART_QUEUE_LEN);
+  uart_set_rx_timeout(GNSS_UART_NUM, GNSS_UART_RX_TIMEOUT);
+
+  if (xTaskCreate(gnssReaderTask, "GNSS UART", 3072, NULL, GNSS_READER_PRIORITY, NULL) != pdPASS) {
+    Serial.println("GNSS UART: reader task not started");
+    return false;
+  }
+  return true;
+}
+
+void gnssUartSetFraming(GnssFraming f) {
+  requestedFraming.store(f);
+}
+
+bool gnssUartSetBaud(uint32_t baud) {
+  return uart_set_baudrate(GNSS_UART_NUM, baud) == ESP_OK;
+}
+
+bool gnssUartWrite(const void* data, size_t len) {
+  int n = uart_write_bytes(GNSS_UART_NUM, (const char*)data, len);
+  return n == (int)len && uart_wait_tx_done(GNSS_UART_NUM, pdMS_TO_TICKS(200)) == ESP_OK;
+}
+
+void gnssUartGetStats(GnssUartStats& out) {
+  out = stats;
+  out.truncated += framer.truncated;
+}
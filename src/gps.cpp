@@ -1,5 +1,10 @@
 #include "gps.h"
-#include <TimeLib.h>
+#include <atomic>
+#include <esp_timer.h>
+#include "gnss_uart.h"
+#include "gnss_casic.h"
+#include "time_service.h"
+#include "gnss_capture.h"
 
 // UART Pins - used to communicate with the GNSS module
 #define GNSS_RX 39
@@ -8,16 +13,51 @@
 #define VGNSS_CTRL 34  // active LOW
 #define GNSS_WAKE 40   // active HIGH
 #define GNSS_RST 42    // active LOW
-#define GNSS_PPS 41    // optional, not used in this example
+#define GNSS_PPS 41    // PPS output, see pps_clock.h
 
-// GPS object
-TinyGPSPlus GPS;
+// Parser state (GPS task only) and the snapshot other tasks read
+static NmeaParser nmea;
+static NmeaFix publishedFix;
+static std::atomic<uint32_t> fixVersion{0};   // odd while publishedFix is being written
 
+// Kalman stage (GPS task only) and its published output, same seqlock
+static KalmanFilter kf;
+static KalmanOutput filtered;
+static KalmanOutput publishedFiltered;
+static uint32_t lastFilterMs = 0;
+
+// Disciplined clock (GPS task only), its published copy and the fix epoch stamp
+static PpsClock ppsClock;
+static PpsClock publishedClock;
+static GpsFixTime fixTime;
+static GpsFixTime publishedFixTime;
+static uint32_t lastLabelUtc = 0;
+
+// PPS edges from the interrupt: SPSC ring, the GPS task drains it
+#define PPS_RING 4
+static int64_t ppsRing[PPS_RING];
+static std::atomic<uint32_t> ppsHead{0};
+static uint32_t ppsTail = 0;
+
+static bool binaryProtocol = false;           // module talks CASIC binary at GPS_BINARY_BAUD
+
+// Duty cycle (GPS task only) and the flag other tasks read
+static GnssDuty duty;
+static std::atomic<bool> dutyCycling{false};
 
 // Antenna status
 bool antennaOpen = false;
 uint32_t lastAntennaMsg = 0;
 
+// Receive path measurements
+static uint32_t statsSinceMs = 0;
+static uint32_t lastStatsLogMs = 0;
+static uint64_t parseBusyUs = 0;        // time spent parsing in the GPS task
+static uint64_t fixLatencySumUs = 0;    // line end -> position committed
+static uint32_t fixLatencyCount = 0;
+static uint32_t fixLatencyMaxUs = 0;
+
+// Boot only: power up with a reset pulse. Wakes from duty cycling use gnssWake().
 static void gnssPowerOn() {
   pinMode(VGNSS_CTRL, OUTPUT);
   digitalWrite(VGNSS_CTRL, LOW);
@@ -35,156 +75,385 @@ static void gnssPowerOn() {
   delay(500);
 }
 
-void gpsInit() {
-  gnssPowerOn();
-  Serial1.begin(9600, SERIAL_8N1, GNSS_RX, GNSS_TX);
-  Serial.println("GNSS UART started @9600");
+// Make the parser state visible to gpsGetFix() readers (seqlock)
+static void publishFix() {
+  uint32_t v = fixVersion.load(std::memory_order_relaxed);
+  fixVersion.store(v + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  publishedFix = nmea.fix;
+  publishedFiltered = filtered;
+  publishedClock = ppsClock;
+  publishedFixTime = fixTime;
+  fixVersion.store(v + 2, std::memory_order_release);
 }
 
-static int32_t lastSetTimeMs = -800000; // Initialize to a time in the past to set time immediately on first GPS fix
-void gpsUpdate() {
-  while (Serial1.available()) {
-    char c = Serial1.read();
-    GPS.encode(c);
-    
-    static char txtBuf[80];
-    static uint8_t idx = 0;
-    
-    if (c == '$') {
-      idx = 0;
-    }
-    if (idx < sizeof(txtBuf) - 1) {
-      txtBuf[idx++] = c;
-      txtBuf[idx] = 0;
-    }
-    
-    if (c == '\n') {
-      if (strstr(txtBuf, "ANTENNA")) {
-        antennaOpen = strstr(txtBuf, "OPEN");
-        lastAntennaMsg = millis();
-      }
-      idx = 0;
-      // we may comment this out and rely on the dely in the GPS Task 
-      // or move this delay outside while loop to avoid delaying processing of GPS sentences when there is a stream of data coming in
-      vTaskDelay(50 / portTICK_PERIOD_MS);  // 5ms yield to allow other tasks to run, especially UI update after GPS fix
-    }
-    if (GPS.time.isValid()){
-      int32_t nowMs = millis();
-      if (nowMs - lastSetTimeMs >= 10L * 60L * 1000L && GPS.date.day() !=0) {
-        setTime(GPS.time.hour() + (gpsIsWinterTime() ? 1 : 0), GPS.time.minute(), GPS.time.second(), GPS.date.day(), GPS.date.month(), GPS.date.year());
-       lastSetTimeMs = nowMs;
-      }
-    }
+template <typename T>
+static void readPublished(const T& src, T& out) {
+  while (true) {
+    uint32_t v = fixVersion.load(std::memory_order_acquire);
+    if (v & 1) continue;
+    out = src;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (fixVersion.load(std::memory_order_relaxed) == v) return;
   }
 }
 
-bool gpsHasTime() {
-  return GPS.time.isValid();
+void gpsGetFix(NmeaFix& out) {
+  readPublished(publishedFix, out);
 }
 
-bool gpsHasLocation() {
-  return GPS.location.isValid();
+void gpsGetFiltered(KalmanOutput& out) {
+  readPublished(publishedFiltered, out);
 }
 
-bool gpsAntennaStatusValid() {
-  return (millis() - lastAntennaMsg) < 5000;
+void gpsGetFixTime(GpsFixTime& out) {
+  readPublished(publishedFixTime, out);
 }
 
-// Cache for gpsIsWinterTime() - recalculates only when date changes
-static bool gpsIsWinterTime_cachedResult = false;
-static uint8_t gpsIsWinterTime_cachedDay = 0;
-static uint8_t gpsIsWinterTime_cachedMonth = 0;
-static uint16_t gpsIsWinterTime_cachedYear = 0;
+bool gpsClockNow(ClockTime& out) {
+  PpsClock c;
+  readPublished(publishedClock, c);
+  return ppsClockRead(c, esp_timer_get_time(), out);
+}
 
+// ============= PPS =============
 
-bool gpsIsWinterTime() {
-  
-  uint16_t y = 0;
-  uint8_t m = 0;
-  uint8_t d = 0;
-  uint8_t h = 0;
-
-  if (GPS.date.isValid() && GPS.time.isValid()) {
-    y = GPS.date.year();
-    m = GPS.date.month();
-    d = GPS.date.day();
-    h = GPS.time.hour();
-  } else {
-    y = static_cast<uint16_t>(year());
-    m = static_cast<uint8_t>(month());
-    d = static_cast<uint8_t>(day());
-    h = static_cast<uint8_t>(hour());
-    if (y < 1971 || m == 0 || d == 0) {
-      return true;
+static void IRAM_ATTR onPps() {
+  int64_t t = esp_timer_get_time();
+  uint32_t h = ppsHead.load(std::memory_order_relaxed);
+  ppsRing[h % PPS_RING] = t;
+  ppsHead.store(h + 1, std::memory_order_release);
+}
+
+// Feed the edges seen since the last call to the clock
+// @return true if there were any
+static bool drainPps() {
+  uint32_t h = ppsHead.load(std::memory_order_acquire);
+  if (h - ppsTail > PPS_RING) ppsTail = h - PPS_RING;     // overrun: the oldest are gone
+  bool any = ppsTail != h;
+  while (ppsTail != h) {
+    int64_t edge = ppsRing[ppsTail % PPS_RING];
+#if GNSS_CAPTURE
+    gnssCapturePps((uint32_t)edge);
+#endif
+    ppsClockEdge(ppsClock, edge);
+    ppsTail++;
+  }
+  return any;
+}
+
+// Label the clock with the first time message of each whole second, and
+// stamp fixes with the clock
+static void clockOnFrame(NmeaEvent ev, int64_t msgUs) {
+  const NmeaFix& fix = nmea.fix;
+  if (fix.hasTime && fix.hasDate && fix.centisecond == 0) {
+    uint32_t utc = utcFromCivil(fix.year, fix.month, fix.day, fix.hour, fix.minute, fix.second);
+    if (utc != lastLabelUtc) {
+      ppsClockLabel(ppsClock, utc, msgUs);
+      lastLabelUtc = utc;
     }
   }
+  if (ev != NMEA_EV_FIX) return;
 
-  // Return cached result if date hasn't changed
-  if (y == gpsIsWinterTime_cachedYear && m == gpsIsWinterTime_cachedMonth && d == gpsIsWinterTime_cachedDay) {
-    return gpsIsWinterTime_cachedResult;
+  ClockTime ct;
+  if (ppsClockRead(ppsClock, msgUs, ct)) {
+    uint32_t ms = ct.us / 1000;
+    fixTime.valid = true;
+    fixTime.utc = ct.utc;
+    fixTime.ms = (uint16_t)(ms - ms % (KALMAN_EPOCH_MS < 1000 ? KALMAN_EPOCH_MS : 1000));   // the epoch started before its message
+    fixTime.source = ct.source;
+  } else if (fix.hasTime && fix.hasDate) {
+    fixTime.valid = true;
+    fixTime.utc = utcFromCivil(fix.year, fix.month, fix.day, fix.hour, fix.minute, fix.second);
+    fixTime.ms = fix.centisecond * 10;
+    fixTime.source = CLOCK_NONE;
   }
+}
 
-  // Date changed, recalculate
-  auto isLeap = [](uint16_t year) {
-    return ((year % 4 == 0) && (year % 100 != 0)) || (year % 400 == 0);
-  };
+// ============= BINARY PROTOCOL SETUP =============
 
-  auto daysInMonth = [&](uint16_t year, uint8_t month) {
-    static const uint8_t days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
-    if (month == 2) {
-      return static_cast<uint8_t>(isLeap(year) ? 29 : 28);
-    }
-    return days[month - 1];
-  };
+static bool sendCommand(const char* body) {
+  char buf[64];
+  size_t n = casicCommand(body, buf, sizeof(buf));
+  return n > 0 && gnssUartWrite(buf, n);
+}
 
-  auto calcDayOfWeek = [](uint16_t year, uint8_t month, uint8_t day) {
-    static const uint8_t t[] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
-    if (month < 3) {
-      year -= 1;
-    }
-    return static_cast<uint8_t>((year + year / 4 - year / 100 + year / 400 + t[month - 1] + day) % 7);
-  };
-
-  auto lastSunday = [&](uint16_t year, uint8_t month) {
-    uint8_t dim = daysInMonth(year, month);
-    for (int day = dim; day >= 1; --day) {
-      if (calcDayOfWeek(year, month, static_cast<uint8_t>(day)) == 0) {
-        return static_cast<uint8_t>(day);
-      }
+// Enable a binary message and wait for the module to acknowledge it
+static bool enableMessage(uint8_t cls, uint8_t id, uint16_t rate) {
+  uint8_t frame[CASIC_HEADER_LEN + 4 + CASIC_CHECKSUM_LEN];
+  gnssUartDiscard();
+  if (!gnssUartWrite(frame, casicCfgMsg(cls, id, rate, frame))) return false;
+
+  uint32_t start = millis();
+  while (millis() - start < GPS_HANDSHAKE_MS) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50));
+    GnssFrame f;
+    while (gnssUartPop(f)) {
+      if (f.kind != GNSS_FRAME_BINARY || !casicValid((const uint8_t*)f.data, f.len)) continue;
+      CasicAck ack = casicAckFor((const uint8_t*)f.data, f.len, CASIC_CLS_CFG, CASIC_ID_CFG_MSG);
+      if (ack != CASIC_ACK_NONE) return ack == CASIC_ACK_OK;
     }
-    return dim;
-  };
-
-  bool isSummer = false;
-  if (m < 3 || m > 10) {
-    isSummer = false;
-  } else if (m > 3 && m < 10) {
-    isSummer = true;
-  } else if (m == 3) {
-    uint8_t ls = lastSunday(y, 3);
-    if (d > ls) {
-      isSummer = true;
-    } else if (d < ls) {
-      isSummer = false;
-    } else {
-      isSummer = (h >= 1);
+  }
+  return false;
+}
+
+// Wait for a valid NAV frame (the module is talking at the current baud rate)
+static bool waitNavFrame(uint32_t timeoutMs) {
+  uint32_t start = millis();
+  while (millis() - start < timeoutMs) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    GnssFrame f;
+    while (gnssUartPop(f)) {
+      if (f.kind == GNSS_FRAME_BINARY && casicValid((const uint8_t*)f.data, f.len) &&
+          (uint8_t)f.data[4] == CASIC_CLS_NAV) return true;
     }
-  } else { // October
-    uint8_t ls = lastSunday(y, 10);
-    if (d < ls) {
-      isSummer = true;
-    } else if (d > ls) {
-      isSummer = false;
+  }
+  return false;
+}
+
+// Handshake at the default 9600 baud, then NAV-PV + NAV-TIMEUTC only (plus the
+// antenna TXT) at GPS_BINARY_BAUD. Any step failing leaves the module in NMEA.
+static bool startBinaryProtocol() {
+  gnssUartSetFraming(GNSS_FRAMING_MIXED);
+  if (!enableMessage(CASIC_CLS_NAV, CASIC_ID_NAV_PV, 1) ||
+      !enableMessage(CASIC_CLS_NAV, CASIC_ID_NAV_TIMEUTC, 1)) {
+    Serial.println("GNSS: no CASIC ACK, staying on NMEA");
+    gnssUartSetFraming(GNSS_FRAMING_LINES);
+    return false;
+  }
+
+  // $PCAS03: GGA,GLL,GSA,GSV,RMC,VTG,ZDA,ANT,DHV,LPS,,,UTC,GST,,,,TIM output rates
+  sendCommand("PCAS03,0,0,0,0,0,0,0,1,0,0,,,0,0,,,,0");
+  sendCommand("PCAS01,5");                       // CASIC_BAUD_115200
+  vTaskDelay(pdMS_TO_TICKS(50));
+  gnssUartSetBaud(GPS_BINARY_BAUD);
+  gnssUartDiscard();
+  if (waitNavFrame(2500)) return true;
+
+  // Nothing intelligible at the new rate: put both ends back to NMEA @9600
+  Serial.println("GNSS: no binary data after baud switch, back to NMEA");
+  sendCommand("PCAS01,1");                       // CASIC_BAUD_9600
+  vTaskDelay(pdMS_TO_TICKS(50));
+  gnssUartSetBaud(GNSS_UART_BAUD);
+  uint8_t frame[CASIC_HEADER_LEN + 4 + CASIC_CHECKSUM_LEN];
+  gnssUartWrite(frame, casicCfgMsg(CASIC_CLS_NAV, CASIC_ID_NAV_PV, 0, frame));
+  gnssUartWrite(frame, casicCfgMsg(CASIC_CLS_NAV, CASIC_ID_NAV_TIMEUTC, 0, frame));
+  sendCommand("PCAS03,1,1,1,1,1,1,1,1,0,0,,,0,0,,,,0");
+  gnssUartSetFraming(GNSS_FRAMING_LINES);
+  return false;
+}
+
+// ============= DUTY CYCLE =============
+
+static void gnssSleep() {
+#if GPS_DUTY_POWER_OFF
+  digitalWrite(VGNSS_CTRL, HIGH);
+#else
+  digitalWrite(GNSS_WAKE, LOW);       // standby: RAM and RTC stay powered
+#endif
+  // What the parser holds now is the last fix before sleeping, not a current one
+  nmea.fix.fixValid = false;
+  nmea.fix.hasTime = false;
+  filtered.valid = false;
+  publishFix();
+}
+
+static void gnssWake() {
+#if GPS_DUTY_POWER_OFF
+  digitalWrite(VGNSS_CTRL, LOW);
+  vTaskDelay(pdMS_TO_TICKS(500));
+  // Configuration went with the supply: the module is back on NMEA @9600
+  gnssUartSetBaud(GNSS_UART_BAUD);
+  gnssUartSetFraming(GNSS_FRAMING_LINES);
+  binaryProtocol = false;
+#if GPS_BINARY_PROTOCOL
+  binaryProtocol = startBinaryProtocol();
+#endif
+#else
+  digitalWrite(GNSS_WAKE, HIGH);
+#endif
+  gnssUartDiscard();
+}
+
+static void serviceDuty(bool freshFix) {
+  GnssDutyState before = duty.state;
+  GnssDutyAction action = gnssDutyStep(duty, millis(), nmea.fix, freshFix);
+  if (action == GNSS_DUTY_SLEEP) gnssSleep();
+  else if (action == GNSS_DUTY_WAKE) gnssWake();
+  if (duty.state == before) return;
+
+  dutyCycling.store(duty.state != GNSS_DUTY_CONTINUOUS);
+  if (before == GNSS_DUTY_CONTINUOUS) {
+    Serial.printf("GNSS: stationary, duty cycling (off %lu s)\n", (unsigned long)(duty.offMs / 1000));
+  } else if (before == GNSS_DUTY_ACQUIRE) {
+    if (duty.state == GNSS_DUTY_OFF) {
+      Serial.printf("GNSS: no fix within %d s of wake, off %lu s\n", GNSS_DUTY_ACQUIRE_MAX_S, (unsigned long)(duty.offMs / 1000));
     } else {
-      isSummer = (h < 1);
+      Serial.printf("GNSS: TTFF %lu ms (%s), next off %lu s\n", (unsigned long)duty.ttffLastMs,
+                    duty.ttffLastMs <= GNSS_DUTY_HOT_TTFF_MS ? "hot" : "slow", (unsigned long)(duty.offMs / 1000));
     }
   }
+  if (duty.state == GNSS_DUTY_CONTINUOUS) Serial.println("GNSS: moving, receiver on continuously");
+}
 
-  // Update cache
-  gpsIsWinterTime_cachedResult = !isSummer;
-  gpsIsWinterTime_cachedYear = y;
-  gpsIsWinterTime_cachedMonth = m;
-  gpsIsWinterTime_cachedDay = d;
-  
-  return gpsIsWinterTime_cachedResult;
-}
\ No newline at end of file
+bool gpsIsDutyCycling() {
+  return dutyCycling.load();
+}
+
+// ============= RECEIVE =============
+
+void gpsInit() {
+  nmeaInit(nmea);
+  kalmanReset(kf);
+  ppsClockReset(ppsClock);
+  publishFix();
+#if GNSS_CAPTURE
+  gnssCaptureBegin();
+#endif
+  gnssPowerOn();
+  pinMode(GNSS_PPS, INPUT);
+  attachInterrupt(digitalPinToInterrupt(GNSS_PPS), onPps, RISING);
+  if (gnssUartBegin(GNSS_RX, GNSS_TX, xTaskGetCurrentTaskHandle())) {
+#if GPS_BINARY_PROTOCOL
+    binaryProtocol = startBinaryProtocol();
+#endif
+    if (binaryProtocol) Serial.printf("GNSS UART started @%d, CASIC binary (NAV-PV, NAV-TIMEUTC)\n", GPS_BINARY_BAUD);
+    else Serial.printf("GNSS UART started @%d, NMEA (line events)\n", GNSS_UART_BAUD);
+  }
+  statsSinceMs = millis();
+  gnssDutyInit(duty, millis());
+}
+
+// Feed one complete frame to its decoder
+// @return true if it completed a valid position
+static bool handleFrame(const GnssFrame& f) {
+  NmeaEvent ev = (f.kind == GNSS_FRAME_BINARY)
+      ? casicDecode(nmea.fix, (const uint8_t*)f.data, f.len)
+      : nmeaParse(nmea, f.data, f.len);
+  if (ev == NMEA_EV_FIX || ev == NMEA_EV_NO_FIX || ev == NMEA_EV_STATUS) {
+    // micros() is the low half of esp_timer
+    clockOnFrame(ev, esp_timer_get_time() - (uint32_t)(micros() - f.arrivalUs));
+  }
+  if (ev == NMEA_EV_FIX) {
+    uint32_t latencyUs = micros() - f.arrivalUs;
+    fixLatencySumUs += latencyUs;
+    fixLatencyCount++;
+    if (latencyUs > fixLatencyMaxUs) fixLatencyMaxUs = latencyUs;
+    return nmea.fix.fixValid;
+  }
+  if (ev == NMEA_EV_TEXT && strstr(nmea.text, "ANTENNA")) {
+    antennaOpen = strstr(nmea.text, "OPEN");
+    lastAntennaMsg = millis();
+  }
+  return false;
+}
+
+void gpsUpdate() {
+  uint32_t t0 = micros();
+  GnssFrame f;
+  bool edges = drainPps();             // edges first: a message labels the edge before it
+  bool any = false;
+  bool freshFix = false;
+  while (gnssUartPop(f)) {
+    if (handleFrame(f)) freshFix = true;
+    any = true;
+  }
+  // RMC and GGA both complete the position: one filter step per epoch
+  uint32_t epochMs = millis();
+  if (freshFix && epochMs - lastFilterMs >= KALMAN_EPOCH_MS / 2) {
+    kalmanUpdate(kf, epochMs, nmea.fix, filtered);
+    lastFilterMs = epochMs;
+  } else if (any && !nmea.fix.fixValid) {
+    filtered.valid = false;           // lost the fix: the filter only predicts from here
+  }
+  if (any || edges) publishFix();
+#if GPS_DUTY_CYCLE
+  serviceDuty(freshFix);
+#endif
+
+  // Move the time service along with the clock
+  if (any || edges) {
+    int64_t nowUs = esp_timer_get_time();
+    ClockTime ct;
+    if (ppsClockRead(ppsClock, nowUs, ct)) timeServiceSync(ct.utc, ct.us, nowUs);
+  }
+  parseBusyUs += micros() - t0;
+
+  if (millis() - lastStatsLogMs >= GPS_STATS_LOG_MS) {
+    lastStatsLogMs = millis();
+    GpsStats st;
+    gpsGetStats(st);
+    Serial.printf("[GNSS] %s %lu B/s, %lu frames (%lu dropped, %lu overflows), fix latency avg %lu us max %lu us, CPU %lu ms/h (parse + filter %lu), filter %lu epochs %lu gated\n",
+                  st.binaryProtocol ? "binary" : "NMEA", (unsigned long)st.rxBytesPerSec,
+                  (unsigned long)st.frames, (unsigned long)st.ringDrops, (unsigned long)st.overflows,
+                  (unsigned long)st.fixLatencyAvgUs, (unsigned long)st.fixLatencyMaxUs,
+                  (unsigned long)st.cpuMsPerHour, (unsigned long)st.parseMsPerHour,
+                  (unsigned long)st.filterEpochs, (unsigned long)st.filterGated);
+    Serial.printf("[GNSS] clock %s, drift %.3f ppm, +-%lu us, %lu PPS edges (%lu rejected)\n",
+                  clockSourceName(st.clockSource), st.clockDriftPpb / 1000.0, (unsigned long)st.clockUncertaintyUs,
+                  (unsigned long)st.ppsEdges, (unsigned long)st.ppsGlitches);
+#if GPS_DUTY_CYCLE
+    Serial.printf("[GNSS] duty %s, on %lu s/h, off %lu s, %lu wakes (%lu hot, %lu no fix), TTFF last %lu avg %lu max %lu ms\n",
+                  gnssDutyStateName(st.dutyState), (unsigned long)st.onSecPerHour, (unsigned long)st.offTimeS,
+                  (unsigned long)st.wakes, (unsigned long)st.hotStarts, (unsigned long)st.wakeTimeouts,
+                  (unsigned long)st.ttffLastMs, (unsigned long)st.ttffAvgMs, (unsigned long)st.ttffMaxMs);
+#endif
+  }
+}
+
+void gpsGetStats(GpsStats& out) {
+  GnssUartStats u;
+  gnssUartGetStats(u);
+  out.binaryProtocol = binaryProtocol;
+  out.frames = u.frames;
+  out.ringDrops = u.ringDrops;
+  out.overflows = u.overflows;
+  out.fixLatencyAvgUs = fixLatencyCount ? (uint32_t)(fixLatencySumUs / fixLatencyCount) : 0;
+  out.fixLatencyMaxUs = fixLatencyMaxUs;
+
+  uint32_t elapsedMs = millis() - statsSinceMs;
+  uint64_t busyUs = u.readerBusyUs + parseBusyUs;
+  out.cpuMsPerHour = elapsedMs ? (uint32_t)(busyUs * 3600ULL / elapsedMs) : 0;  // us/ms == ms/s
+  out.parseMsPerHour = elapsedMs ? (uint32_t)(parseBusyUs * 3600ULL / elapsedMs) : 0;
+  out.rxBytesPerSec = elapsedMs ? (uint32_t)((uint64_t)u.rxBytes * 1000ULL / elapsedMs) : 0;
+
+  out.filterEpochs = kf.epochs;
+  out.filterGated = kf.rejected;
+
+  ClockTime ct;
+  if (!gpsClockNow(ct)) {
+    ct.source = CLOCK_NONE;
+    ct.uncertaintyUs = 0;
+  }
+  out.clockSource = ct.source;
+  out.clockDriftPpb = ppsClock.driftPpb;
+  out.clockUncertaintyUs = ct.uncertaintyUs;
+  out.ppsEdges = ppsClock.edges;
+  out.ppsGlitches = ppsClock.glitches;
+
+  out.dutyState = duty.state;
+  out.onSecPerHour = gnssDutyOnSecPerHour(duty, millis());
+  out.offTimeS = duty.offMs / 1000;
+  out.wakes = duty.wakes;
+  out.hotStarts = duty.hotStarts;
+  out.wakeTimeouts = duty.timeouts;
+  out.ttffLastMs = duty.ttffLastMs;
+  out.ttffAvgMs = duty.ttffAvgMs;
+  out.ttffMaxMs = duty.ttffMaxMs;
+}
+
+bool gpsHasTime() {
+  NmeaFix fix;
+  gpsGetFix(fix);
+  return fix.hasTime;
+}
+
+bool gpsHasLocation() {
+  NmeaFix fix;
+  gpsGetFix(fix);
+  return fix.hasLocation;
+}
+
+bool gpsAntennaStatusValid() {
+  return (millis() - lastAntennaMsg) < 5000;
+}
@@ -1,29 +1,39 @@
 #include "gps_sampler.h"
-#include <TimeLib.h>
 #include "gps.h"
 #include "track_storage.h"
+#include "track_log.h"
 #include "battery.h"
+#include "sample_policy.h"
+#include "time_service.h"
+#include "geofence.h"
+#include "motion.h"
+#include "upload_manager.h"
+
+static SamplePolicy policy;
+static MotionState motion;
 
 /**
  * Get current timestamp in seconds
- * Uses GPS time if available and valid, otherwise falls back to millis()
+ * UTC from the time service once GPS has set it, otherwise falls back to millis()
  */
 uint32_t getTimestampSeconds() {
-  time_t t = now();
-  if (t > 100000) return (uint32_t) t - (gpsIsWinterTime() ? 1 : 0) * 3600; // epoch seems valid, return UTC time adjusted for winter time if needed
-  return (uint32_t)(millis() / 1000);
+  uint32_t t = nowUtc();
+  return t ? t : (uint32_t)(millis() / 1000);
 }
 
 
-void sampleGPSFix()
+static bool storeFix(const NmeaFix& fix, const SampleInput& pos, SampleReason why,
+                     const GeofenceEvent* fenceEv, size_t nFenceEv)
 {
   FixRec rec = {};  // Initialize to zero (bat=0, flags=0)
-  rec.ts = getTimestampSeconds();
+  GpsFixTime ft;
+  gpsGetFixTime(ft);
+  rec.ts = ft.valid ? ft.utc : getTimestampSeconds();   // the fix's epoch, not the sampling tick
   if (rec.ts < 946684800UL) {
-    return;
+    return false;
   }
-  rec.latE7 = (int32_t)llround(GPS.location.lat() * 1e7);
-  rec.lonE7 = (int32_t)llround(GPS.location.lng() * 1e7);
+  rec.latE7 = pos.latE7;            // E7, filtered when the Kalman stage is running
+  rec.lonE7 = pos.lonE7;
   
   // Fill in battery percentage
   rec.bat = getBatteryPercent();
@@ -33,22 +43,85 @@ void sampleGPSFix()
   if (isCharging()) {
     rec.flags |= FL_CHARGING;
   }
-  if (GPS.location.isValid()) {
+  if (fix.fixValid) {
     rec.flags |= FL_GPS_VALID;
   }
   if (rec.bat <= 15) {
     rec.flags |= FL_LOW_BATTERY;
   }
-  // Note: movement state, events, and heartbeat flags are not set here
-  // They would be set by a higher-level state machine (future work)
+  if (nFenceEv) {
+    rec.flags |= FL_EVT_FENCE;
+  }
+  rec.flags |= motionFlags(motion);
+
+  // Quality and motion: speed and course follow the stored (filtered) position
+  rec.dop = fix.fixValid ? fixPackDop(fix.hdopX100, fix.sats) : 0;
+  rec.speedCmS = (uint16_t)(pos.speedCmS > 0xFFFF ? 0xFFFF : pos.speedCmS);
+  rec.course2 = pos.hasCourse ? fixPackCourse(pos.courseCdeg) : FIX_COURSE_UNKNOWN;
+  rec.altDm = fix.hasAltitude ? fixPackAlt(fix.altCm) : FIX_ALT_UNKNOWN;
   
   if (trackStorePush(rec))
   {
-    Serial.printf("Stored GPS fix: seq=%u, ts=%u, lat=%.6f, lon=%.6f, bat=%u%%, flags=0x%02x\n",
-                  rec.seq, rec.ts, rec.latE7 / 1e7, rec.lonE7 / 1e7, rec.bat, rec.flags);
+    trackLogAppend(rec);
+    motionStored(motion);
+    if (nFenceEv) geofenceLogEvents(rec.seq, fenceEv, nFenceEv);
+    if (rec.flags & FL_EVT_IMMEDIATE) uploadKick();   // LoRa picks the event up on its own next check
+    Serial.printf("Stored GPS fix (%s): seq=%u, ts=%u, lat=%.6f, lon=%.6f, bat=%u%%, flags=0x%02x, "
+                  "sats=%u, hdop=%.1f, speed=%u cm/s, course=%d, alt=%d dm\n",
+                  sampleReasonName(why), rec.seq, rec.ts, rec.latE7 / 1e7, rec.lonE7 / 1e7, rec.bat, rec.flags,
+                  fixSats(rec.dop), fixHdopX10(rec.dop) / 10.0, rec.speedCmS,
+                  rec.course2 == FIX_COURSE_UNKNOWN ? -1 : rec.course2 * 2,
+                  rec.altDm == FIX_ALT_UNKNOWN ? 0 : rec.altDm);
+    return true;
   }
   else
   {
-    Serial.println("Failed to store GPS fix due to mutex issue");
+    Serial.println("Failed to store GPS fix: track store not initialized");
+    return false;
+  }
+}
+
+void sampleGPSTick()
+{
+  NmeaFix fix;
+  gpsGetFix(fix);
+  if (!fix.hasLocation) return;     // nothing to store yet
+  // Receiver asleep or still acquiring: wait for the fresh fix of the next wake
+  if (!fix.fixValid && gpsIsDutyCycling()) return;
+
+  KalmanOutput kf;
+  gpsGetFiltered(kf);
+
+  SampleInput in;
+  in.nowS = millis() / 1000;
+  if (kf.valid) {
+    // Smoothed: parked jitter neither moves the stored fix nor fakes a speed
+    in.latE7 = kf.latE7;
+    in.lonE7 = kf.lonE7;
+    in.speedCmS = kf.speedCmS;
+    in.courseCdeg = kf.courseCdeg;
+    in.hasCourse = kf.stationaryPct < 50;
+  } else {
+    in.latE7 = fix.latE7;
+    in.lonE7 = fix.lonE7;
+    // Without a current fix the last speed is stale: treat as standing still
+    in.speedCmS = (fix.fixValid && fix.hasSpeed) ? fix.speedCmS : 0;
+    in.courseCdeg = fix.courseCdeg;
+    in.hasCourse = fix.fixValid && fix.hasCourse;
   }
+
+  // Motion and geofences on every valid fix: a start, stop or crossing is
+  // stored at once, whatever the policy says
+  GeofenceEvent fenceEv[4];
+  size_t nFenceEv = 0;
+  if (fix.fixValid) {
+    if (motionUpdate(motion, in.nowS, in.latE7, in.lonE7, in.speedCmS)) {
+      Serial.printf("Motion: %s\n", motion.moving ? "started moving" : "stopped");
+    }
+    nFenceEv = geofenceEvaluate(in.latE7, in.lonE7, fenceEv, 4);
+  }
+
+  SampleReason why = nFenceEv ? SAMPLE_FENCE : motion.pending ? SAMPLE_MOTION : samplePolicyDue(policy, in);
+  if (why == SAMPLE_NONE) return;
+  if (storeFix(fix, in, why, fenceEv, nFenceEv)) samplePolicyStored(policy, in);
 }
\ No newline at end of file
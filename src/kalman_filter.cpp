@@ -0,0 +1,244 @@
+#include "kalman_filter.h"
+#include <math.h>
+
+static const int64_t MM_PER_DEG_LAT = 111319491;    // mm per degree of latitude
+static const int64_t P_MAX = 1000000000000LL;       // covariance cap (1 km sigma): keeps products in int64
+
+// ============= FIXED POINT HELPERS =============
+
+static uint32_t isqrt64(uint64_t v) {
+  uint64_t r = (uint64_t)sqrtf((float)v);           // estimate, then exact integer correction
+  while (r * r > v) r--;
+  while ((r + 1) * (r + 1) <= v) r++;
+  return (uint32_t)r;
+}
+
+// sin of whole degrees 0..90, Q15
+static const uint16_t SIN_Q15[91] = {
+  0, 572, 1144, 1715, 2286, 2856, 3425, 3993, 4560, 5126, 5690, 6252, 6813, 7371, 7927, 8481,
+  9032, 9580, 10126, 10668, 11207, 11743, 12275, 12803, 13328, 13848, 14365, 14876, 15384, 15886,
+  16384, 16877, 17364, 17847, 18324, 18795, 19261, 19720, 20174, 20622, 21063, 21498, 21926, 22348,
+  22763, 23170, 23571, 23965, 24351, 24730, 25102, 25466, 25822, 26170, 26510, 26842, 27166, 27482,
+  27789, 28088, 28378, 28660, 28932, 29197, 29452, 29698, 29935, 30163, 30382, 30592, 30792, 30983,
+  31164, 31336, 31499, 31651, 31795, 31928, 32052, 32166, 32270, 32365, 32449, 32524, 32588, 32643,
+  32688, 32723, 32748, 32763, 32768,
+};
+
+// sin of a course in 1/100 degree, Q15 (table + linear interpolation)
+static int32_t sinCdeg(int32_t cdeg) {
+  cdeg %= 36000;
+  if (cdeg < 0) cdeg += 36000;
+  int32_t sign = 1;
+  if (cdeg >= 18000) { cdeg -= 18000; sign = -1; }
+  if (cdeg > 9000) cdeg = 18000 - cdeg;
+  int32_t deg = cdeg / 100, frac = cdeg % 100;
+  int32_t a = SIN_Q15[deg];
+  int32_t b = SIN_Q15[deg < 90 ? deg + 1 : 90];
+  return sign * (a + (b - a) * frac / 100);
+}
+
+// Course of a velocity vector, 1/100 degree clockwise from north.
+// atan(r) ~ r*45 deg + r*(1-r)*15.64 deg on 0..1, error below 0.25 deg.
+static uint16_t courseCdeg(int32_t north, int32_t east) {
+  int64_t an = north < 0 ? -(int64_t)north : north;
+  int64_t ae = east < 0 ? -(int64_t)east : east;
+  if (an == 0 && ae == 0) return 0;
+  bool steep = ae > an;
+  int64_t r = steep ? (an << 15) / ae : (ae << 15) / an;        // Q15, 0..1
+  int32_t a = (int32_t)((r * 4500 + (r * (32768 - r) >> 15) * 1564) >> 15);
+  if (steep) a = 9000 - a;                                       // angle from north, 0..90 deg
+  int32_t c;
+  if (north >= 0) c = east >= 0 ? a : 36000 - a;
+  else c = east >= 0 ? 18000 - a : 18000 + a;
+  return (uint16_t)(c % 36000);
+}
+
+static int64_t capP(int64_t p) {
+  return p > P_MAX ? P_MAX : (p < 1 ? 1 : p);
+}
+
+// ============= LOCAL PLANE =============
+
+static void setOrigin(KalmanFilter& kf, int32_t latE7, int32_t lonE7) {
+  kf.originLatE7 = latE7;
+  kf.originLonE7 = lonE7;
+  // One cos per origin change, not per fix
+  kf.mmPerDegLon = (int64_t)llround(MM_PER_DEG_LAT * cos(latE7 * 1e-7 * M_PI / 180.0));
+  if (kf.mmPerDegLon < 1000) kf.mmPerDegLon = 1000;   // poles
+}
+
+static void toPlane(const KalmanFilter& kf, int32_t latE7, int32_t lonE7, int32_t& north, int32_t& east) {
+  int64_t dLon = (int64_t)lonE7 - kf.originLonE7;
+  if (dLon > 1800000000LL) dLon -= 3600000000LL;       // across the antimeridian
+  if (dLon < -1800000000LL) dLon += 3600000000LL;
+  north = (int32_t)(((int64_t)latE7 - kf.originLatE7) * MM_PER_DEG_LAT / 10000000);
+  east = (int32_t)(dLon * kf.mmPerDegLon / 10000000);
+}
+
+static void fromPlane(const KalmanFilter& kf, int32_t north, int32_t east, int32_t& latE7, int32_t& lonE7) {
+  latE7 = kf.originLatE7 + (int32_t)((int64_t)north * 10000000 / MM_PER_DEG_LAT);
+  int64_t lon = kf.originLonE7 + (int64_t)east * 10000000 / kf.mmPerDegLon;
+  if (lon > 1800000000LL) lon -= 3600000000LL;
+  if (lon < -1800000000LL) lon += 3600000000LL;
+  lonE7 = (int32_t)lon;
+}
+
+// ============= AXIS STEPS =============
+
+static void predict(KalmanAxis& a, int64_t dtMs, int64_t accel) {
+  const int64_t acc2 = accel * accel;
+  int64_t q11 = acc2 * dtMs / 1000 * dtMs / 1000;      // a^2 dt^2
+  int64_t q01 = q11 * dtMs / 2000;                     // a^2 dt^3 / 2
+  int64_t q00 = q01 * dtMs / 2000;                     // a^2 dt^4 / 4
+
+  a.pos += (int32_t)((int64_t)a.vel * dtMs / 1000);
+  int64_t p11dt = a.p11 * dtMs / 1000;
+  a.p00 = capP(a.p00 + 2 * a.p01 * dtMs / 1000 + p11dt * dtMs / 1000 + q00);
+  a.p01 = a.p01 + p11dt + q01;
+  a.p11 = capP(a.p11 + q11);
+}
+
+// Position measurement (H = [1 0])
+static void updatePos(KalmanAxis& a, int32_t z, int64_t r) {
+  int64_t s = a.p00 + r;
+  int64_t y = (int64_t)z - a.pos;
+  int64_t k0 = (a.p00 << 16) / s;
+  int64_t k1 = (a.p01 << 16) / s;
+  a.pos += (int32_t)((k0 * y) >> 16);
+  a.vel += (int32_t)((k1 * y) >> 16);
+  int64_t p00 = a.p00, p01 = a.p01;
+  a.p00 = capP(p00 - ((k0 * p00) >> 16));
+  a.p01 = p01 - ((k0 * p01) >> 16);
+  a.p11 = capP(a.p11 - ((k1 * p01) >> 16));
+}
+
+// Velocity measurement (H = [0 1])
+static void updateVel(KalmanAxis& a, int32_t z, int64_t r) {
+  int64_t s = a.p11 + r;
+  int64_t y = (int64_t)z - a.vel;
+  int64_t k0 = (a.p01 << 16) / s;
+  int64_t k1 = (a.p11 << 16) / s;
+  a.pos += (int32_t)((k0 * y) >> 16);
+  a.vel += (int32_t)((k1 * y) >> 16);
+  int64_t p01 = a.p01, p11 = a.p11;
+  a.p00 = capP(a.p00 - ((k0 * p01) >> 16));
+  a.p01 = p01 - ((k0 * p11) >> 16);
+  a.p11 = capP(p11 - ((k1 * p11) >> 16));
+}
+
+static bool gated(const KalmanAxis& a, int32_t z, int64_t r) {
+  int64_t y = (int64_t)z - a.pos;
+  if (y > 2000000000LL || y < -2000000000LL) return true;
+  return y * y > (int64_t)KALMAN_GATE_SIGMA * KALMAN_GATE_SIGMA * (a.p00 + r);
+}
+
+// ============= FILTER =============
+
+// Doppler velocity of the fix, mm/s
+static bool velocityOf(const NmeaFix& fix, int32_t& north, int32_t& east) {
+  if (!fix.hasSpeed) return false;
+  int32_t speed = (int32_t)(fix.speedCmS * 10);
+  if (!fix.hasCourse) {
+    if (speed >= KALMAN_STILL_MMS) return false;       // a speed without a direction
+    north = east = 0;
+    return true;
+  }
+  north = (int32_t)((int64_t)speed * sinCdeg(fix.courseCdeg + 9000) >> 15);
+  east = (int32_t)((int64_t)speed * sinCdeg(fix.courseCdeg) >> 15);
+  return true;
+}
+
+static void start(KalmanFilter& kf, uint32_t nowMs, const NmeaFix& fix, int64_t r) {
+  setOrigin(kf, fix.latE7, fix.lonE7);
+  int32_t vn = 0, ve = 0;
+  bool hasVel = velocityOf(fix, vn, ve);
+  int64_t rv = hasVel ? (int64_t)KALMAN_VEL_SIGMA_MMS * KALMAN_VEL_SIGMA_MMS : 10000LL * 10000LL;
+  kf.north = KalmanAxis{0, vn, r, 0, rv};
+  kf.east = KalmanAxis{0, ve, r, 0, rv};
+  kf.lastMs = nowMs;
+  kf.rejects = 0;
+  kf.running = true;
+}
+
+static void output(KalmanFilter& kf, KalmanOutput& out) {
+  out.valid = kf.running;
+  fromPlane(kf, kf.north.pos, kf.east.pos, out.latE7, out.lonE7);
+  uint32_t speed = isqrt64((uint64_t)((int64_t)kf.north.vel * kf.north.vel + (int64_t)kf.east.vel * kf.east.vel));
+  out.speedCmS = speed / 10;
+  if (speed >= KALMAN_STILL_MMS) kf.courseCdeg = courseCdeg(kf.north.vel, kf.east.vel);
+  out.courseCdeg = kf.courseCdeg;
+  out.sigmaCm = isqrt64((uint64_t)(kf.north.p00 + kf.east.p00)) / 10;
+
+  // Normal approximation: 50% at the threshold, 100% two sigma below it
+  int64_t sigmaV = isqrt64((uint64_t)((kf.north.p11 + kf.east.p11) / 2));
+  if (sigmaV < 1) sigmaV = 1;
+  int64_t pct = 50 + 25 * ((int64_t)KALMAN_STILL_MMS - (int64_t)speed) / sigmaV;
+  out.stationaryPct = (uint8_t)(pct < 0 ? 0 : (pct > 100 ? 100 : pct));
+}
+
+void kalmanReset(KalmanFilter& kf) {
+  kf = KalmanFilter();
+}
+
+bool kalmanUpdate(KalmanFilter& kf, uint32_t nowMs, const NmeaFix& fix, KalmanOutput& out) {
+  uint32_t dop = fix.hdopX100 ? fix.hdopX100 : (fix.pdopX100 ? fix.pdopX100 : KALMAN_DOP_DEFAULT);
+  int64_t sigma = (int64_t)KALMAN_UERE_MM * dop / 100;
+  int64_t r = sigma * sigma;
+
+  uint32_t dt = nowMs - kf.lastMs;
+  if (!kf.running || dt > KALMAN_MAX_GAP_MS) {
+    start(kf, nowMs, fix, r);
+    kf.epochs++;
+    output(kf, out);
+    return true;
+  }
+  // Fixes come on whole epochs; arrival jitter is UART and queueing delay
+  if (dt >= KALMAN_EPOCH_MS / 2) dt = (dt + KALMAN_EPOCH_MS / 2) / KALMAN_EPOCH_MS * KALMAN_EPOCH_MS;
+  kf.lastMs = nowMs;
+  kf.epochs++;
+
+  int64_t v2 = (int64_t)kf.north.vel * kf.north.vel + (int64_t)kf.east.vel * kf.east.vel;
+  bool still = v2 < (int64_t)KALMAN_STILL_MMS * KALMAN_STILL_MMS;
+  int64_t accel = still ? KALMAN_ACCEL_STILL_MMS2 : KALMAN_ACCEL_MMS2;
+  predict(kf.north, dt, accel);
+  predict(kf.east, dt, accel);
+
+  // Keep the plane small: the flat projection is only exact near its origin
+  if (kf.north.pos > KALMAN_ORIGIN_MAX_MM || kf.north.pos < -KALMAN_ORIGIN_MAX_MM ||
+      kf.east.pos > KALMAN_ORIGIN_MAX_MM || kf.east.pos < -KALMAN_ORIGIN_MAX_MM) {
+    int32_t lat, lon;
+    fromPlane(kf, kf.north.pos, kf.east.pos, lat, lon);
+    setOrigin(kf, lat, lon);
+    kf.north.pos = 0;
+    kf.east.pos = 0;
+  }
+
+  int32_t zn, ze;
+  toPlane(kf, fix.latE7, fix.lonE7, zn, ze);
+  bool accepted = !gated(kf.north, zn, r) && !gated(kf.east, ze, r);
+  if (accepted) {
+    kf.rejects = 0;
+    updatePos(kf.north, zn, r);
+    updatePos(kf.east, ze, r);
+  } else {
+    kf.rejected++;
+    if (++kf.rejects >= KALMAN_MAX_REJECTS) {
+      // Consistently somewhere else: the filter is wrong, not the receiver
+      start(kf, nowMs, fix, r);
+      output(kf, out);
+      return true;
+    }
+  }
+
+  // Standing still, multipath that throws the position out corrupts the
+  // Doppler reading too; moving, Doppler is what carries the filter through
+  int32_t vn, ve;
+  if ((accepted || !still) && velocityOf(fix, vn, ve)) {
+    int64_t rv = (int64_t)KALMAN_VEL_SIGMA_MMS * KALMAN_VEL_SIGMA_MMS;
+    updateVel(kf.north, vn, rv);
+    updateVel(kf.east, ve, rv);
+  }
+
+  output(kf, out);
+  return accepted;
+}
@@ -4,8 +4,9 @@
 #include "secrets.h"
 #include "track_storage.h"
 #include "wifi_manager.h"
-#include "gps.h"
-#include <math.h>
+#include "track_simplify.h"
+#include "geo_distance.h"
+#include "lora_payload.h"
 
 // ============= HELTEC V4 PINOUT =============
 #define RADIO_SCLK_PIN 9
@@ -22,12 +23,13 @@
 #define PIN_TX_EN 46  // PA_TX_EN (HIGH only in TX)
 
 // ================= MOVEMENT CONFIG =================
-static constexpr float MOVE_START_KMH = 2.0f;   
-static constexpr float MOVE_STOP_KMH  = 1.0f;   
+// Moving or not comes from the stored fixes (motion.h)
 static constexpr float DIST_TRIGGER_M = 50.0f;  // 50m
 
 static constexpr uint32_t HEARTBEAT_INTERVAL_MS = 15 * 60 * 1000;  // 15 minutes
 static constexpr uint32_t MIN_SEND_INTERVAL_MS  = 2.5 * 60 * 1000;   // 2.5 minutes
+static constexpr uint32_t RETRY_INTERVAL_MS     = 30 * 1000;   // after a failed uplink, events included
+static constexpr size_t   TX_QUEUE_FIXES        = 32;   // corners and events waiting for an uplink
 
 
 // ============= RADIOLIB INSTANCES =============
@@ -41,11 +43,12 @@ static unsigned long lastTxMs = 0;
 static const unsigned long TX_INTERVAL_MS = 60000;  // 60 second interval
 
 static uint32_t lastSendMs = 0;
+static bool lastSendFailed = false;
 static uint32_t lastHeartbeatMs = 0;
 static int32_t lastLatE7 = 0;
 static int32_t lastLonE7 = 0;
-static bool moving = false;
-static bool prevMoving = false;
+static SimplifyState loraShape;     // simplified track sent over LoRa
+static uint32_t lastEventSeq = 0;   // newest event fix (FL_EVT_IMMEDIATE) sent
 
 // ============= TX STATS TRACKING =============
 static uint32_t lastLoraTxMs = 0;
@@ -260,38 +263,115 @@ void loraResume() {
   Serial.flush();
 }
 
-// ================= DISTANCE CALCULATION =================
-static float distanceMeters(int32_t lat1E7, int32_t lon1E7,
-                            int32_t lat2E7, int32_t lon2E7)
-{
-    const float R = 6371000.0f;
+// Fixes waiting for an uplink in seq order: corners of the simplified track
+// and event fixes. Sent as batches, oldest first.
+static FixRec pending[TX_QUEUE_FIXES];
+static size_t nPending = 0;
+static uint32_t pendingDropped = 0;   // pushed out of a full queue unsent
+static FixRec shapeKept[SIMPLIFY_MAX_WINDOW];
+
+// Queue a fix (no duplicates); a full queue gives up its oldest fix
+static void queueFix(const FixRec& f) {
+  size_t i = nPending;
+  while (i > 0 && pending[i - 1].seq > f.seq) i--;
+  if (i > 0 && pending[i - 1].seq == f.seq) return;
+  if (nPending == TX_QUEUE_FIXES) {
+    pendingDropped++;
+    if (i == 0) return;             // older than everything queued
+    memmove(pending, pending + 1, (nPending - 1) * sizeof(FixRec));
+    nPending--;
+    i--;
+  }
+  memmove(pending + i + 1, pending + i, (nPending - i) * sizeof(FixRec));
+  pending[i] = f;
+  nPending++;
+}
+
+// Drop the first n queued fixes; with keepEvents, event fixes among them stay
+static void dequeueFixes(size_t n, bool keepEvents = false) {
+  size_t kept = 0;
+  for (size_t i = 0; i < n && keepEvents; i++) {
+    if (pending[i].flags & FL_EVT_IMMEDIATE) pending[kept++] = pending[i];
+  }
+  memmove(pending + kept, pending + n, (nPending - n) * sizeof(FixRec));
+  nPending -= n - kept;
+}
 
-    float lat1 = lat1E7 / 1e7f * DEG_TO_RAD;
-    float lat2 = lat2E7 / 1e7f * DEG_TO_RAD;
-    float dLat = lat2 - lat1;
-    float dLon = (lon2E7 - lon1E7) / 1e7f * DEG_TO_RAD;
+// Queue the corners the simplifier decided since the last call. Decided
+// fixes are consumed either way; event fixes were queued when stored.
+static void collectShape() {
+  TrackLease lease;
+  if (!trackStoreChannelAcquire(TRACK_CH_LORA, SIMPLIFY_MAX_WINDOW, lease)) {
+    trackStoreRelease(lease);
+    return;
+  }
+  uint8_t keep[SIMPLIFY_MAX_WINDOW];
+  size_t decided = simplifyRun(loraShape, lease, keep);
+  size_t nKept = 0;
+  for (size_t i = 0; i < decided; i++) {
+    if (keep[i]) shapeKept[nKept++] = lease.at(i);
+  }
+  uint32_t firstSeq = lease.firstSeq;
+  bool intact = trackStoreRelease(lease);
+  if (decided > 0) trackStoreChannelSent(TRACK_CH_LORA, firstSeq + (uint32_t)decided - 1);
+  if (!intact) return;
+  for (size_t k = 0; k < nKept; k++) {
+    const FixRec& f = shapeKept[k];
+    if ((f.flags & FL_EVT_IMMEDIATE) && f.seq <= lastEventSeq) continue;
+    queueFix(f);
+  }
+}
 
-    float a = sin(dLat/2)*sin(dLat/2) +
-              cos(lat1)*cos(lat2) *
-              sin(dLon/2)*sin(dLon/2);
+// Queue motion and geofence event fixes stored since the last call
+// @return true if an event fix is waiting in the queue
+static bool queueEvents() {
+  uint32_t seqs[4];
+  size_t n = trackStoreFindFlags(lastEventSeq + 1, FL_EVT_IMMEDIATE, seqs, 4);
+  for (size_t i = 0; i < n; i++) {
+    TrackCursor cur = trackStoreCursorAtSeq(seqs[i]);
+    FixRec f;
+    if (trackStoreRead(cur, &f, 1) == 1 && f.seq == seqs[i]) queueFix(f);
+    lastEventSeq = seqs[i];
+  }
+  for (size_t i = 0; i < nPending; i++) {
+    if (pending[i].flags & FL_EVT_IMMEDIATE) return true;
+  }
+  return false;
+}
 
-    return 2 * R * atan2(sqrt(a), sqrt(1-a));
+// More queued than one frame at the current data rate holds
+static bool backlogFull() {
+  if (nPending < 2) return false;
+  static uint8_t scratch[LORA_FRAME_MAX_BYTES];
+  size_t maxLen = node->getMaxPayloadLen();
+  if (maxLen > sizeof(scratch)) maxLen = sizeof(scratch);
+  size_t packed = 0;
+  loraEncodeFrame(pending, nPending, LORA_COORD_PRECISION, scratch, maxLen, packed);
+  return packed < nPending;
 }
 
 // send when 
+// - first check after joining (resumes the LoRa track at most
+//   TX_QUEUE_FIXES fixes back; older unsent fixes are left to WiFi)
+// - a stored fix started or stopped moving, or entered or left a geofence
+//   (not rate limited)
 // - outside min send interval (rate limiting)
 // - heartbeat due
 // - latest GPS fix is present and valid
-// - movement changed: began moving, stopped, moved > DIST_TRIGGER_M
+// - moving and the simplified track has a new corner > DIST_TRIGGER_M away
+//   from the last sent fix, or more corners queued than one frame holds
+// Each uplink carries the queue from its oldest fix, as many as the data
+// rate's maximum payload allows. After a failed uplink the event fixes stay
+// queued and are retried after RETRY_INTERVAL_MS.
 void checkAndSend() {
-  // don't send more often than MIN_SEND_INTERVAL_S
-  if (millis() - lastSendMs < MIN_SEND_INTERVAL_MS) { return; }
   if (!hasJoined || !node) { return; } // [TX] Not joined yet, skipping transmit
+  const bool eventDue = loraShape.hasAnchor && queueEvents();
+  // don't send more often than MIN_SEND_INTERVAL_S, except for events
+  if (!eventDue && millis() - lastSendMs < MIN_SEND_INTERVAL_MS) { return; }
+  if (lastSendFailed && millis() - lastSendMs < RETRY_INTERVAL_MS) { return; }
 
   uint32_t nowMs = millis();
   const bool heartBeatDue = (nowMs - lastHeartbeatMs >= HEARTBEAT_INTERVAL_MS);
-  const bool movementChanged = (moving != prevMoving);
-  bool reasonDistance = false; 
   
   // no valid fix - don't send
   FixRec latestFix;
@@ -300,30 +380,62 @@ void checkAndSend() {
   if (latestFix.latE7 < -900000000 || latestFix.latE7 > 900000000) { return; }
   if (latestFix.lonE7 < -1800000000 || latestFix.lonE7 > 1800000000) { return; }
 
-  int32_t latE7 = latestFix.latE7;
-  int32_t lonE7 = latestFix.lonE7;
-  float speedKmh = GPS.speed.isValid() ? GPS.speed.kmph() : 0.0f;
-  
-  // Movement detection
-  if (!moving && speedKmh >= MOVE_START_KMH) {
-    moving = true;
-  } else if (moving && speedKmh <= MOVE_STOP_KMH) {
-    moving = false;
+  // First check after joining: report where the device is and in which
+  // motion state, and resume the LoRa track (and events) where it stopped,
+  // but no more than TX_QUEUE_FIXES fixes back so the backlog fits the queue
+  const bool joinReport = !loraShape.hasAnchor;
+  if (joinReport) {
+    uint32_t resumeSeq = trackStoreChannelNextSeq(TRACK_CH_LORA);
+    if (latestFix.seq >= TX_QUEUE_FIXES && resumeSeq < latestFix.seq - TX_QUEUE_FIXES + 1) {
+      resumeSeq = latestFix.seq - TX_QUEUE_FIXES + 1;
+    }
+    FixRec resume = latestFix;
+    if (resumeSeq < latestFix.seq) {
+      TrackCursor cur = trackStoreCursorAtSeq(resumeSeq);
+      if (trackStoreRead(cur, &resume, 1) != 1 || resume.seq != resumeSeq) resume = latestFix;
+    }
+    simplifyReset(loraShape, resume);
+    queueFix(resume);
+    trackStoreChannelSent(TRACK_CH_LORA, resume.seq);
+    lastEventSeq = resume.seq;
+    queueEvents();                  // events in the resumed stretch go out with the report
   }
-  
-  if (moving && lastLatE7 != 0) {
-    float dist = distanceMeters(lastLatE7, lastLonE7, latE7, lonE7);
-    if (dist >= DIST_TRIGGER_M) { reasonDistance = true; }
+
+  // Straight stretches are covered by their end points: only corners of the
+  // simplified track (and event fixes) are queued
+  collectShape();
+  bool reasonDistance = false;
+  if ((latestFix.flags & FL_MOVE_ACTIVE) && lastLatE7 != 0 && nPending > 0) {
+    const FixRec& corner = pending[nPending - 1];
+    reasonDistance = geoDistanceM(lastLatE7, lastLonE7, corner.latE7, corner.lonE7) >= DIST_TRIGGER_M;
   }
   
-  bool shouldSend = movementChanged || reasonDistance || heartBeatDue;
+  bool shouldSend = joinReport || eventDue || reasonDistance || heartBeatDue || backlogFull();
 
   if (shouldSend) {
-    sendPayload(latestFix.ts, latE7, lonE7, latestFix.bat);
+    // Heartbeats report the current position
+    if (joinReport || heartBeatDue) {
+      queueFix(latestFix);
+      simplifyReset(loraShape, latestFix);
+    }
+    if (nPending == 0) { return; }
+    // LoRa is selective: fixes left out by the simplifier are skipped.
+    // Unconfirmed uplink: the fixes are done with whether or not it arrives.
+    size_t packed = 0;
+    bool ok = sendBatch(pending, nPending, packed);
+    if (packed == 0) { return; }
+    const FixRec& newest = pending[packed - 1];
     lastSendMs = millis();
-    lastLatE7 = latE7;
-    lastLonE7 = lonE7;
-    if (movementChanged) { prevMoving = moving; }
+    lastSendFailed = !ok;
+    if (!ok) {
+      dequeueFixes(packed, true);   // corners are stale by the retry, events are not
+      return;
+    }
+    uint32_t decided = trackStoreChannelNextSeq(TRACK_CH_LORA) - 1;
+    trackStoreChannelAcked(TRACK_CH_LORA, newest.seq < decided ? newest.seq : decided);
+    lastLatE7 = newest.latE7;
+    lastLonE7 = newest.lonE7;
+    dequeueFixes(packed);
     if (heartBeatDue) { lastHeartbeatMs = nowMs;}
   }
   
@@ -334,39 +446,13 @@ void checkAndSend() {
 // ============= TRANSMISSION =============
 
 
-// Build 13-byte GPS payload
-// Byte 0-3:   uint32_t timestamp (big-endian)
-// Byte 4-7:   int32_t lat*1e7 (big-endian)
-// Byte 8-11:  int32_t lon*1e7 (big-endian)
-// Byte 12:    uint8_t battery %
-void sendPayload(int32_t ts, int32_t latE7, int32_t lonE7, uint8_t bat) {
+// One uplink, with the downlink / MAC answer handling
+static bool transmit(const uint8_t* payload, size_t len, uint8_t port) {
 
   // Track transmission
   lastLoraTxMs = millis();
   loraTxCount++;
 
-  uint32_t uts = static_cast<uint32_t>(ts);
-  uint32_t ulat = static_cast<uint32_t>(latE7);
-  uint32_t ulon = static_cast<uint32_t>(lonE7);
-
-  uint8_t payload[13];
-  payload[0] = (uint8_t)((uts >> 24) & 0xFF);
-  payload[1] = (uint8_t)((uts >> 16) & 0xFF);
-  payload[2] = (uint8_t)((uts >> 8) & 0xFF);
-  payload[3] = (uint8_t)(uts & 0xFF);
-  
-  payload[4] = (uint8_t)((ulat >> 24) & 0xFF);
-  payload[5] = (uint8_t)((ulat >> 16) & 0xFF);
-  payload[6] = (uint8_t)((ulat >> 8) & 0xFF);
-  payload[7] = (uint8_t)(ulat & 0xFF);
-  
-  payload[8] = (uint8_t)((ulon >> 24) & 0xFF);
-  payload[9] = (uint8_t)((ulon >> 16) & 0xFF);
-  payload[10] = (uint8_t)((ulon >> 8) & 0xFF);
-  payload[11] = (uint8_t)(ulon & 0xFF);
-  
-  payload[12] = bat;
-
   // Prepare RX buffer for potential downlinks
   uint8_t downlink[255];
   size_t downlinkLen = sizeof(downlink);
@@ -375,18 +461,8 @@ void sendPayload(int32_t ts, int32_t latE7, int32_t lonE7, uint8_t bat) {
   LoRaWANEvent_t evUp{};
   LoRaWANEvent_t evDown{};
 
-  Serial.println("\n========================================");
-  Serial.print("[TX] GPS Fix seq=");
-  //Serial.print(fix.seq);
-  Serial.print(" lat=");
-  Serial.print(latE7 / 1e7, 6);
-  Serial.print(" lon=");
-  Serial.print(lonE7 / 1e7, 6);
-  Serial.print(" bat=");
-  Serial.print(bat);
-  Serial.println("%");
   Serial.print("     Payload: ");
-  printHex(payload, sizeof(payload));
+  printHex(payload, len);
   Serial.println();
 
   // Mark transmission active
@@ -394,8 +470,8 @@ void sendPayload(int32_t ts, int32_t latE7, int32_t lonE7, uint8_t bat) {
 
   // Transmit with RX window
   int16_t txState = node->sendReceive(
-    payload, sizeof(payload),
-    1,                      // FPort=1
+    payload, len,
+    port,                   // LORA_FPORT_FRAME
     downlink, &downlinkLen,
     false,                  // confirmed=false
     &evUp, &evDown
@@ -447,6 +523,39 @@ void sendPayload(int32_t ts, int32_t latE7, int32_t lonE7, uint8_t bat) {
 
   Serial.println("========================================");
   Serial.flush();
+  return txState >= 0;
+}
+
+bool sendPayload(const FixRec& fix) {
+  size_t packed = 0;
+  return sendBatch(&fix, 1, packed);
+}
+
+bool sendBatch(const FixRec* fixes, size_t n, size_t& packed) {
+  packed = 0;
+  if (n == 0) return false;
+  size_t maxLen = node->getMaxPayloadLen();
+  uint8_t payload[LORA_FRAME_MAX_BYTES];
+  if (maxLen > sizeof(payload)) maxLen = sizeof(payload);
+  size_t len = loraEncodeFrame(fixes, n, LORA_COORD_PRECISION, payload, maxLen, packed);
+  if (len == 0) return false;
+
+  Serial.println("\n========================================");
+  if (packed == 1) {
+    Serial.print("[TX] GPS Fix seq=");
+    Serial.print(fixes[0].seq);
+    Serial.print(" lat=");
+    Serial.print(fixes[0].latE7 / 1e7, 6);
+    Serial.print(" lon=");
+    Serial.print(fixes[0].lonE7 / 1e7, 6);
+    Serial.print(" bat=");
+    Serial.print(fixes[0].bat);
+    Serial.println("%");
+  } else {
+    Serial.printf("[TX] GPS batch: %u fixes seq=%u..%u, %u bytes (max %u)\n", (unsigned)packed,
+                  fixes[0].seq, fixes[packed - 1].seq, (unsigned)len, (unsigned)maxLen);
+  }
+  return transmit(payload, len, LORA_FPORT_FRAME);
 }
 
 // ============= TX STATS GETTERS =============
@@ -0,0 +1,287 @@
+#include "lora_payload.h"
+
+#define MAX_LAT_E7 900000000
+#define MAX_LON_E7 1800000000
+#define INT24_MIN  (-0x800000)
+#define INT24_MAX  0x7FFFFF
+
+static const int32_t STEP_E7[4] = {1, 10, 100, 1000};
+
+static void putU32BE(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)((v >> 24) & 0xFF);
+  p[1] = (uint8_t)((v >> 16) & 0xFF);
+  p[2] = (uint8_t)((v >> 8) & 0xFF);
+  p[3] = (uint8_t)(v & 0xFF);
+}
+
+static uint32_t getU32BE(const uint8_t* p) {
+  return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static void putI24BE(uint8_t* p, int32_t v) {
+  p[0] = (uint8_t)((v >> 16) & 0xFF);
+  p[1] = (uint8_t)((v >> 8) & 0xFF);
+  p[2] = (uint8_t)(v & 0xFF);
+}
+
+static int32_t getI24BE(const uint8_t* p) {
+  int32_t v = (int32_t)p[0] << 16 | (int32_t)p[1] << 8 | p[2];
+  return v > INT24_MAX ? v - 0x1000000 : v;
+}
+
+static int32_t clampE7(int32_t v, int32_t maxAbs) {
+  return v < -maxAbs ? -maxAbs : (v > maxAbs ? maxAbs : v);
+}
+
+static uint64_t zigzag(int64_t v) {
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// Varint writer that stops at the end of the buffer; false if it did not fit
+static bool putVarint(uint8_t* p, size_t& n, size_t maxLen, uint64_t v) {
+  do {
+    if (n >= maxLen) return false;
+    p[n++] = (uint8_t)((v & 0x7F) | (v >= 0x80 ? 0x80 : 0));
+    v >>= 7;
+  } while (v);
+  return true;
+}
+
+static bool putSigned(uint8_t* p, size_t& n, size_t maxLen, int64_t v) {
+  return putVarint(p, n, maxLen, zigzag(v));
+}
+
+static size_t signedLen(int64_t v) {
+  uint64_t u = zigzag(v);
+  size_t n = 1;
+  while (u >= 0x80) {
+    u >>= 7;
+    n++;
+  }
+  return n;
+}
+
+// Bounded varint reader; false on a truncated, overlong or non-minimal value
+static bool getVarint(const uint8_t* p, size_t& n, size_t len, uint64_t& v) {
+  v = 0;
+  for (int shift = 0; shift < 63; shift += 7) {
+    if (n >= len) return false;
+    uint8_t b = p[n++];
+    v |= (uint64_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) return b != 0 || shift == 0;
+  }
+  return false;
+}
+
+static bool getSigned(const uint8_t* p, size_t& n, size_t len, int64_t& v) {
+  uint64_t u;
+  if (!getVarint(p, n, len, u)) return false;
+  v = unzigzag(u);
+  return true;
+}
+
+int32_t loraQuantizeE7(int32_t e7, uint8_t precision) {
+  int32_t step = STEP_E7[precision & 3];
+  int32_t v = clampE7(e7, MAX_LON_E7);
+  int32_t q = (v >= 0 ? v + step / 2 : v - step / 2) / step;
+  return q * step;
+}
+
+// Fields before the first fix of a frame
+static FixRec frameDefaults() {
+  FixRec f = FixRec();
+  f.course2 = FIX_COURSE_UNKNOWN;
+  f.altDm = FIX_ALT_UNKNOWN;
+  return f;
+}
+
+static int32_t altBase(int16_t altDm) {
+  return altDm == FIX_ALT_UNKNOWN ? 0 : altDm;
+}
+
+// Presence bits of the v2 fields, which the single-fix form carries in its own byte
+static const uint8_t V2_FIELDS = LORA_FIELD_DOP | LORA_FIELD_COURSE | LORA_FIELD_SPEED | LORA_FIELD_ALT;
+
+// A frame of one fix uses the single-fix form when its coordinates fit 24
+// bits and that form is no longer: 11 header bytes (12 with v2 fields)
+// against 7 plus the two coordinate varints (lat and lon in 10^p E7 units,
+// already quantized)
+static bool singleForm(int32_t lat, int32_t lon, uint8_t mask) {
+  if (lat < INT24_MIN || lat > INT24_MAX || lon < INT24_MIN || lon > INT24_MAX) return false;
+  size_t header = LORA_SINGLE_HEADER_BYTES + ((mask & V2_FIELDS) ? 1 : 0);
+  return signedLen(lat) + signedLen(lon) >= header - LORA_FRAME_HEADER_BYTES - 1;
+}
+
+static uint8_t fieldMask(const FixRec& prev, const FixRec& f) {
+  return (f.bat != prev.bat ? LORA_FIELD_BAT : 0) | (f.flags != prev.flags ? LORA_FIELD_FLAGS : 0) |
+         (f.dop != prev.dop ? LORA_FIELD_DOP : 0) | (f.course2 != prev.course2 ? LORA_FIELD_COURSE : 0) |
+         (f.speedCmS != prev.speedCmS ? LORA_FIELD_SPEED : 0) | (f.altDm != prev.altDm ? LORA_FIELD_ALT : 0);
+}
+
+// The fields present in mask; false if they did not fit
+static bool putFields(const FixRec& prev, const FixRec& f, uint8_t mask, uint8_t* out, size_t& n, size_t maxLen) {
+  const uint8_t bytes[4] = {f.bat, f.flags, f.dop, f.course2};
+  for (int k = 0; k < 4; k++) {
+    if (!(mask & (1 << k))) continue;
+    if (n >= maxLen) return false;
+    out[n++] = bytes[k];
+  }
+  if ((mask & LORA_FIELD_SPEED) && !putSigned(out, n, maxLen, (int64_t)f.speedCmS - prev.speedCmS)) return false;
+  if ((mask & LORA_FIELD_ALT) && !putSigned(out, n, maxLen, (int64_t)f.altDm - altBase(prev.altDm))) return false;
+  return true;
+}
+
+// One fix against the previous one; false if it did not fit
+static bool putFix(const FixRec& prev, const FixRec& f, bool first, int32_t step, uint8_t* out, size_t& n,
+                   size_t maxLen) {
+  uint8_t mask = fieldMask(prev, f);
+  if (n >= maxLen) return false;
+  out[n++] = mask;
+  if (!first && !putSigned(out, n, maxLen, (int64_t)f.ts - prev.ts)) return false;
+  // Coordinates are already quantized; 0 before the first fix
+  if (!putSigned(out, n, maxLen, ((int64_t)f.latE7 - prev.latE7) / step)) return false;
+  if (!putSigned(out, n, maxLen, ((int64_t)f.lonE7 - prev.lonE7) / step)) return false;
+  return putFields(prev, f, mask, out, n, maxLen);
+}
+
+// Single-fix form of a quantized fix; 0 if it did not fit
+static size_t putSingle(const FixRec& f, uint8_t precision, uint8_t* out, size_t maxLen) {
+  const int32_t step = STEP_E7[precision];
+  const FixRec prev = frameDefaults();
+  uint8_t mask = fieldMask(prev, f);
+  const size_t more = (mask & V2_FIELDS) ? 1 : 0;
+  if (maxLen < LORA_SINGLE_HEADER_BYTES + more) return 0;
+  out[0] = (uint8_t)(LORA_FRAME_SINGLE | precision << 5 | (more ? LORA_SINGLE_MORE : 0) | (mask & 3) << 2 |
+                     LORA_FRAME_VERSION);
+  if (more) out[1] = mask >> 2;
+  putU32BE(out + 1 + more, f.ts);
+  putI24BE(out + 5 + more, f.latE7 / step);
+  putI24BE(out + 8 + more, f.lonE7 / step);
+  size_t n = LORA_SINGLE_HEADER_BYTES + more;
+  return putFields(prev, f, mask, out, n, maxLen) ? n : 0;
+}
+
+size_t loraEncodeFrame(const FixRec* fixes, size_t n, uint8_t precision, uint8_t* out, size_t maxLen,
+                       size_t& packed) {
+  packed = 0;
+  precision &= 3;
+  if (n == 0 || maxLen < LORA_FRAME_HEADER_BYTES) return 0;
+  const int32_t step = STEP_E7[precision];
+  out[0] = LORA_FRAME_VERSION;
+  putU32BE(out + 2, fixes[0].ts);
+  size_t len = LORA_FRAME_HEADER_BYTES;
+  FixRec prev = frameDefaults();
+  FixRec first = prev;
+  uint8_t firstMask = 0;
+  while (packed < n && packed < LORA_FRAME_MAX_FIXES) {
+    FixRec f = fixes[packed];
+    f.latE7 = loraQuantizeE7(clampE7(f.latE7, MAX_LAT_E7), precision);
+    f.lonE7 = loraQuantizeE7(f.lonE7, precision);
+    if (packed == 0) {
+      first = f;
+      firstMask = fieldMask(prev, f);
+    }
+    size_t end = len;
+    if (!putFix(prev, f, packed == 0, step, out, end, maxLen)) break;
+    len = end;
+    prev = f;
+    packed++;
+  }
+  // One fix: the single-fix form if it applies, also when the batch form did not fit
+  if (packed <= 1 && singleForm(first.latE7 / step, first.lonE7 / step, firstMask)) {
+    len = putSingle(first, precision, out, maxLen);
+    packed = len ? 1 : 0;
+    return len;
+  }
+  if (packed == 0) return 0;
+  out[1] = (uint8_t)((packed - 1) << 2 | precision);
+  return len;
+}
+
+// Fields present in mask, against the previous fix in f; false if malformed
+static bool getFields(const uint8_t* p, size_t& n, size_t len, uint8_t mask, FixRec& f) {
+  uint8_t* bytes[4] = {&f.bat, &f.flags, &f.dop, &f.course2};
+  for (int k = 0; k < 4; k++) {
+    if (!(mask & (1 << k))) continue;
+    if (n >= len || p[n] == *bytes[k]) return false;
+    *bytes[k] = p[n++];
+  }
+  int64_t v;
+  if (mask & LORA_FIELD_SPEED) {
+    if (!getSigned(p, n, len, v) || v == 0) return false;
+    v += f.speedCmS;
+    if (v < 0 || v > UINT16_MAX) return false;
+    f.speedCmS = (uint16_t)v;
+  }
+  if (mask & LORA_FIELD_ALT) {
+    if (!getSigned(p, n, len, v)) return false;
+    v += altBase(f.altDm);
+    if (v < INT16_MIN || v > INT16_MAX || v == f.altDm) return false;
+    f.altDm = (int16_t)v;
+  }
+  return true;
+}
+
+static size_t decodeSingle(const uint8_t* p, size_t len, FixRec* out, size_t maxN) {
+  const size_t more = (p[0] & LORA_SINGLE_MORE) ? 1 : 0;
+  if (len < LORA_SINGLE_HEADER_BYTES + more || maxN < 1) return 0;
+  // The v2 mask byte is only there when it is not 0
+  if (more && (p[1] == 0 || p[1] > (V2_FIELDS >> 2))) return 0;
+  const uint8_t mask = (uint8_t)((p[0] >> 2 & 3) | (more ? p[1] << 2 : 0));
+  const int32_t step = STEP_E7[p[0] >> 5 & 3];
+  const int32_t lat = getI24BE(p + 5 + more), lon = getI24BE(p + 8 + more);
+  // Coordinates in range, and a frame the batch form would not have been used for
+  if ((int64_t)lat * step < -MAX_LAT_E7 || (int64_t)lat * step > MAX_LAT_E7) return 0;
+  if ((int64_t)lon * step < -MAX_LON_E7 || (int64_t)lon * step > MAX_LON_E7) return 0;
+  if (!singleForm(lat, lon, mask)) return 0;
+  FixRec f = frameDefaults();
+  f.ts = getU32BE(p + 1 + more);
+  f.latE7 = lat * step;
+  f.lonE7 = lon * step;
+  size_t n = LORA_SINGLE_HEADER_BYTES + more;
+  if (!getFields(p, n, len, mask, f) || n != len) return 0;
+  out[0] = f;
+  return 1;
+}
+
+size_t loraDecodeFrame(const uint8_t* p, size_t len, FixRec* out, size_t maxN) {
+  if (len >= 1 && (p[0] & (LORA_FRAME_SINGLE | 3)) == (LORA_FRAME_SINGLE | LORA_FRAME_VERSION)) {
+    return decodeSingle(p, len, out, maxN);
+  }
+  if (len < LORA_FRAME_HEADER_BYTES || p[0] != LORA_FRAME_VERSION) return 0;
+  const size_t count = (size_t)(p[1] >> 2) + 1;
+  const int64_t step = STEP_E7[p[1] & 3];
+  if (count > maxN) return 0;
+  FixRec f = frameDefaults();
+  int64_t ts = getU32BE(p + 2), lat = 0, lon = 0;
+  size_t n = LORA_FRAME_HEADER_BYTES;
+  for (size_t i = 0; i < count; i++) {
+    if (n >= len) return 0;
+    const uint8_t mask = p[n++];
+    if (mask & 0xC0) return 0;
+    int64_t v;
+    if (i > 0) {
+      if (!getSigned(p, n, len, v)) return 0;
+      ts += v;
+      if (ts < 0 || ts > (int64_t)UINT32_MAX) return 0;
+    }
+    // Bounded before scaling so the sums cannot overflow
+    if (!getSigned(p, n, len, v) || v > 2LL * MAX_LAT_E7 || v < -2LL * MAX_LAT_E7) return 0;
+    lat += v * step;
+    if (!getSigned(p, n, len, v) || v > 2LL * MAX_LON_E7 || v < -2LL * MAX_LON_E7) return 0;
+    lon += v * step;
+    if (lat < -MAX_LAT_E7 || lat > MAX_LAT_E7 || lon < -MAX_LON_E7 || lon > MAX_LON_E7) return 0;
+    // A lone fix the single-fix form applies to is never sent this way
+    if (count == 1 && singleForm((int32_t)(lat / step), (int32_t)(lon / step), mask)) return 0;
+    if (!getFields(p, n, len, mask, f)) return 0;
+    f.ts = (uint32_t)ts;
+    f.latE7 = (int32_t)lat;
+    f.lonE7 = (int32_t)lon;
+    out[i] = f;
+  }
+  return n == len ? count : 0;
+}
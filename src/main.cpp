@@ -6,12 +6,16 @@
 #include "button.h"  
 #include "wifi_manager.h"
 #include "track_storage.h"
+#include "track_log.h"
 #include "gps_sampler.h"
 #include "upload_manager.h"
 #include "battery.h"
 #include "lora_manager.h"
+#include "sample_policy.h"
+#include "gnss_capture.h"
+#include "geofence.h"
 
-#define GPS_SAMPLING_RATE_SEC 30 // Sample GPS every 30 seconds
+#define TRACK_LOG_SERVICE_SEC 30 // Persist acks / flush the track log this often
 
 // #define ESP32_RTOS 
 // #include "OTA.h"
@@ -51,8 +55,8 @@ void gpsTask(void *pvParameters) {
   // Initialize GPS
   gpsInit();
   while (true) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(GPS_IDLE_WAKE_MS)); // Woken by the UART reader per complete sentence; the timeout drives the duty cycle while the receiver sleeps
     gpsUpdate();
-    vTaskDelay(100 / portTICK_PERIOD_MS); // Adjust the delay as needed
   }
 }
 
@@ -92,20 +96,28 @@ void WiFiTask(void *pvParameters) {
 
 void gpsSamplerTask(void *pvParameters) {
   initTrackStore(TRACK_CAPACITY); // Initialize track storage (ring buffer)
+  trackLogInit();                 // Replay unacked fixes from flash into the ring
+  geofenceInit();                 // Fences from flash, evaluated on every fix
   TickType_t lastWake = xTaskGetTickCount();
-  const TickType_t sampleInterval = pdMS_TO_TICKS(GPS_SAMPLING_RATE_SEC * 1000); // Sample every GPS_SAMPLING_RATE_SEC seconds
+  const TickType_t tick = pdMS_TO_TICKS(SAMPLE_TICK_MS); // The sampling policy decides which ticks store a fix
+  uint32_t ticks = 0;
   while (true) {
-    vTaskDelayUntil(&lastWake, sampleInterval); // Wait for the next sample time
-    if (!gpsHasLocation()) continue; // Skip if no valid location fix
-    sampleGPSFix();
+    vTaskDelayUntil(&lastWake, tick);
+    if (++ticks % (TRACK_LOG_SERVICE_SEC * 1000 / SAMPLE_TICK_MS) == 0) {
+      trackLogService();             // Persist ack changes, flush aged log pages
+    }
+#if GNSS_CAPTURE
+    gnssCaptureService();            // Raw GNSS stream to flash, off the GPS task
+#endif
+    sampleGPSTick();
   }
 }
 
 void uploadTask(void *pvParameters) {
-  FixRec batch[MAX_UPLOAD_BATCH_SIZE];
+  uploadSetTask(xTaskGetCurrentTaskHandle());
   while (true) {
-    vTaskDelay(UPLOAD_INTERVAL_MS / portTICK_PERIOD_MS);
-    uploadBatchOverWiFi(batch);
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(UPLOAD_INTERVAL_MS));  // interval, or early on uploadKick()
+    uploadBatchOverWiFi();
     // Serial.printf("Task1 Stack Free: %u words\n", uxTaskGetStackHighWaterMark(NULL));
     // Serial.printf("Stack free: %u bytes\n", uxTaskGetStackHighWaterMark(NULL) * sizeof(StackType_t));
   }
@@ -0,0 +1,62 @@
+#include "motion.h"
+#include "track_storage.h"
+#include "geo_distance.h"
+
+static void setAnchor(MotionState& m, uint32_t nowS, int32_t latE7, int32_t lonE7) {
+  m.hasAnchor = true;
+  m.anchorLatE7 = latE7;
+  m.anchorLonE7 = lonE7;
+  m.anchorSinceS = nowS;
+}
+
+void motionReset(MotionState& m) {
+  m = MotionState();
+}
+
+bool motionUpdate(MotionState& m, uint32_t nowS, int32_t latE7, int32_t lonE7, uint32_t speedCmS) {
+  if (speedCmS >= MOTION_START_CMS) {
+    if (!m.fast) m.fastSinceS = nowS;
+    m.fast = true;
+  } else {
+    m.fast = false;
+  }
+  if (!m.hasAnchor) {
+    setAnchor(m, nowS, latE7, lonE7);
+    return false;
+  }
+  float fromAnchorM = geoDistanceM(m.anchorLatE7, m.anchorLonE7, latE7, lonE7);
+
+  if (!m.moving) {
+    if ((m.fast && nowS - m.fastSinceS >= MOTION_START_S) || fromAnchorM >= MOTION_START_M) {
+      m.moving = true;
+      // A stop that never reached a stored fix cancels out with this start
+      m.pending = (m.pending & FL_EVT_MOVE_STOP) ? 0 : FL_EVT_MOVE_START;
+      m.starts++;
+      setAnchor(m, nowS, latE7, lonE7);
+      return true;
+    }
+    return false;
+  }
+
+  // Moving: restart the dwell whenever the fix leaves its radius
+  if (fromAnchorM > MOTION_DWELL_M) {
+    setAnchor(m, nowS, latE7, lonE7);
+    return false;
+  }
+  if (speedCmS <= MOTION_STOP_CMS && nowS - m.anchorSinceS >= MOTION_DWELL_S) {
+    m.moving = false;
+    m.pending = (m.pending & FL_EVT_MOVE_START) ? 0 : FL_EVT_MOVE_STOP;
+    m.stops++;
+    setAnchor(m, nowS, latE7, lonE7);
+    return true;
+  }
+  return false;
+}
+
+uint8_t motionFlags(const MotionState& m) {
+  return (m.moving ? FL_MOVE_ACTIVE : 0) | m.pending;
+}
+
+void motionStored(MotionState& m) {
+  m.pending = 0;
+}
@@ -0,0 +1,302 @@
+#include "nmea_parser.h"
+#include <string.h>
+
+// ============= SENTENCE TABLE =============
+
+// What a field holds; the table below maps field index -> kind per sentence
+enum FieldKind : uint8_t {
+  F_SKIP = 0,
+  F_TIME,         // hhmmss.ss
+  F_STATUS,       // A = valid, V = void
+  F_LAT,          // ddmm.mmmm
+  F_NS,
+  F_LON,          // dddmm.mmmm
+  F_EW,
+  F_SPEED_KN,     // knots
+  F_COURSE,       // degrees true
+  F_DATE,         // ddmmyy
+  F_QUALITY,      // GGA fix quality
+  F_SATS,
+  F_HDOP,
+  F_PDOP,
+  F_VDOP,
+  F_ALT,          // metres
+  F_FIXMODE,      // GSA 1/2/3
+  F_TEXT,
+};
+
+struct SentenceDef {
+  char id[3];
+  NmeaSentenceType type;
+  FieldKind kinds[NMEA_MAX_FIELDS];   // index 0 is the address field
+};
+
+static const SentenceDef SENTENCES[] = {
+  // $--RMC,time,status,lat,N,lon,E,speed,course,date,magvar,E,mode*cs
+  { {'R', 'M', 'C'}, NMEA_RMC,
+    { F_SKIP, F_TIME, F_STATUS, F_LAT, F_NS, F_LON, F_EW, F_SPEED_KN, F_COURSE, F_DATE } },
+  // $--GGA,time,lat,N,lon,E,quality,sats,hdop,alt,M,geoid,M,age,station*cs
+  { {'G', 'G', 'A'}, NMEA_GGA,
+    { F_SKIP, F_TIME, F_LAT, F_NS, F_LON, F_EW, F_QUALITY, F_SATS, F_HDOP, F_ALT } },
+  // $--GSA,mode,fixmode,sv1..sv12,pdop,hdop,vdop[,system]*cs
+  { {'G', 'S', 'A'}, NMEA_GSA,
+    { F_SKIP, F_SKIP, F_FIXMODE, F_SKIP, F_SKIP, F_SKIP, F_SKIP, F_SKIP, F_SKIP, F_SKIP,
+      F_SKIP, F_SKIP, F_SKIP, F_SKIP, F_SKIP, F_PDOP, F_HDOP, F_VDOP } },
+  // $--VTG,course,T,course,M,speed,N,speed,K,mode*cs
+  { {'V', 'T', 'G'}, NMEA_VTG,
+    { F_SKIP, F_COURSE, F_SKIP, F_SKIP, F_SKIP, F_SPEED_KN } },
+  // $--TXT,total,number,id,text*cs
+  { {'T', 'X', 'T'}, NMEA_TXT,
+    { F_SKIP, F_SKIP, F_SKIP, F_SKIP, F_TEXT } },
+};
+
+static const SentenceDef* findSentence(const char* id) {
+  for (const SentenceDef& d : SENTENCES) {
+    if (d.id[0] == id[0] && d.id[1] == id[1] && d.id[2] == id[2]) return &d;
+  }
+  return nullptr;
+}
+
+// ============= FIELD CONVERSION =============
+
+static inline bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+static inline int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+// Two-digit number at s
+static inline uint8_t twoDigits(const char* s) {
+  return (uint8_t)((s[0] - '0') * 10 + (s[1] - '0'));
+}
+
+// Decimal "[-]123.4567" -> integer scaled by 10^decimals (extra digits truncated)
+static bool parseFixed(const char* a, const char* b, uint8_t decimals, int32_t& out) {
+  bool neg = false;
+  if (a < b && *a == '-') {
+    neg = true;
+    a++;
+  }
+  int32_t v = 0;
+  bool any = false;
+  while (a < b && isDigit(*a)) {
+    v = v * 10 + (*a++ - '0');
+    any = true;
+  }
+  if (a < b && *a == '.') {
+    a++;
+    while (a < b && isDigit(*a)) {
+      if (decimals > 0) {
+        v = v * 10 + (*a - '0');
+        decimals--;
+      }
+      a++;
+      any = true;
+    }
+  }
+  if (!any || a != b) return false;
+  while (decimals-- > 0) v *= 10;
+  out = neg ? -v : v;
+  return true;
+}
+
+// "ddmm.mmmm" / "dddmm.mmmm" -> E7 degrees, without going through a double:
+// minutes are read as millionths (mm.mmmmmm) and 1e6 minutes = 1e7/6 E7
+static bool parseCoord(const char* a, const char* b, int32_t& e7) {
+  const char* dot = a;
+  while (dot < b && *dot != '.') dot++;
+  int degDigits = (int)(dot - a) - 2;
+  if (degDigits < 1 || degDigits > 3) return false;
+
+  int32_t deg = 0;
+  for (int i = 0; i < degDigits; i++) {
+    if (!isDigit(a[i])) return false;
+    deg = deg * 10 + (a[i] - '0');
+  }
+  int32_t minE6;
+  if (!parseFixed(a + degDigits, b, 6, minE6) || minE6 < 0 || minE6 >= 60000000) return false;
+  e7 = deg * 10000000 + (minE6 + 3) / 6;
+  return true;
+}
+
+// Everything one sentence produces; committed only after the checksum matched
+struct Work {
+  NmeaFix next;               // copy of the fix with this sentence's fields applied
+  char status;                // RMC status
+  bool latOk;
+  bool lonOk;
+  int32_t latE7;
+  int32_t lonE7;
+  const char* text;           // TXT message inside the line
+  size_t textLen;
+};
+
+static void applyField(Work& w, FieldKind kind, const char* a, const char* b) {
+  if (a == b) return;         // empty: leave the previous value
+  int32_t v;
+  NmeaFix& f = w.next;
+  switch (kind) {
+    case F_TIME: {
+      if (b - a < 6 || !isDigit(a[0]) || !isDigit(a[5])) return;
+      uint8_t hh = twoDigits(a), mm = twoDigits(a + 2), ss = twoDigits(a + 4);
+      if (hh > 23 || mm > 59 || ss > 60) return;
+      f.hour = hh;
+      f.minute = mm;
+      f.second = ss;
+      f.centisecond = (b - a >= 9 && a[6] == '.' && isDigit(a[7]) && isDigit(a[8])) ? twoDigits(a + 7) : 0;
+      f.hasTime = true;
+      break;
+    }
+    case F_STATUS:
+      w.status = *a;
+      break;
+    case F_LAT:
+      w.latOk = parseCoord(a, b, w.latE7) && w.latE7 <= 900000000;
+      break;
+    case F_NS:
+      if (*a == 'S') w.latE7 = -w.latE7;
+      break;
+    case F_LON:
+      w.lonOk = parseCoord(a, b, w.lonE7) && w.lonE7 <= 1800000000;
+      break;
+    case F_EW:
+      if (*a == 'W') w.lonE7 = -w.lonE7;
+      break;
+    case F_SPEED_KN:
+      if (parseFixed(a, b, 3, v) && v >= 0) {
+        f.speedCmS = (uint32_t)((uint64_t)v * 463 / 9000);   // 1 kn = 1852/36 cm/s
+        f.hasSpeed = true;
+      }
+      break;
+    case F_COURSE:
+      if (parseFixed(a, b, 2, v) && v >= 0 && v < 36000) {
+        f.courseCdeg = (uint16_t)v;
+        f.hasCourse = true;
+      }
+      break;
+    case F_DATE: {
+      if (b - a != 6 || !isDigit(a[0]) || !isDigit(a[5])) return;
+      uint8_t dd = twoDigits(a), mo = twoDigits(a + 2);
+      if (dd < 1 || dd > 31 || mo < 1 || mo > 12) return;
+      f.day = dd;
+      f.month = mo;
+      f.year = (uint16_t)(2000 + twoDigits(a + 4));
+      f.hasDate = true;
+      break;
+    }
+    case F_QUALITY:
+      f.quality = isDigit(*a) ? (uint8_t)(*a - '0') : 0;
+      break;
+    case F_SATS:
+      if (parseFixed(a, b, 0, v) && v >= 0 && v < 256) f.sats = (uint8_t)v;
+      break;
+    case F_HDOP:
+    case F_PDOP:
+    case F_VDOP:
+      if (parseFixed(a, b, 2, v) && v >= 0) {
+        uint16_t dop = v > 65535 ? 65535 : (uint16_t)v;
+        if (kind == F_HDOP) f.hdopX100 = dop;
+        else if (kind == F_PDOP) f.pdopX100 = dop;
+        else f.vdopX100 = dop;
+      }
+      break;
+    case F_ALT:
+      if (parseFixed(a, b, 2, v)) {
+        f.altCm = v;
+        f.hasAltitude = true;
+      }
+      break;
+    case F_FIXMODE:
+      if (isDigit(*a)) f.fixMode = (uint8_t)(*a - '0');
+      break;
+    case F_TEXT:
+      w.text = a;
+      w.textLen = (size_t)(b - a);
+      break;
+    default:
+      break;
+  }
+}
+
+// ============= PARSER =============
+
+void nmeaInit(NmeaParser& p) {
+  memset(&p, 0, sizeof(p));
+}
+
+NmeaEvent nmeaParse(NmeaParser& p, const char* line, size_t len) {
+  const char* end = line + len;
+  const char* s = (const char*)memchr(line, '$', len);
+  if (!s) {
+    p.badChecksum++;
+    return NMEA_EV_BAD;
+  }
+  s++;
+
+  // Address field: 2-char talker + 3-char type; others (proprietary $P...) are skipped
+  const SentenceDef* def = (end - s > 5 && s[5] == ',') ? findSentence(s + 2) : nullptr;
+  if (!def) {
+    p.skipped++;
+    return NMEA_EV_NONE;
+  }
+
+  Work w;
+  memset(&w, 0, sizeof(w));
+  w.next = p.fix;
+
+  // One pass: checksum and fields together
+  uint8_t sum = 0;
+  uint8_t field = 0;
+  const char* fieldStart = s;
+  const char* q = s;
+  for (; q < end && *q != '*'; q++) {
+    sum ^= (uint8_t)*q;
+    if (*q == ',') {
+      if (field < NMEA_MAX_FIELDS) applyField(w, def->kinds[field], fieldStart, q);
+      field++;
+      fieldStart = q + 1;
+    }
+  }
+  if (end - q < 3 || hexValue(q[1]) < 0 || hexValue(q[2]) < 0 ||
+      sum != (uint8_t)(hexValue(q[1]) << 4 | hexValue(q[2]))) {
+    p.badChecksum++;
+    return NMEA_EV_BAD;
+  }
+  if (field < NMEA_MAX_FIELDS) applyField(w, def->kinds[field], fieldStart, q);
+
+  // Commit
+  NmeaFix& f = w.next;
+  p.parsed++;
+
+  NmeaEvent ev = NMEA_EV_STATUS;
+  switch (def->type) {
+    case NMEA_RMC:
+    case NMEA_GGA: {
+      bool valid = (def->type == NMEA_RMC) ? (w.status == 'A') : (f.quality > 0);
+      f.fixValid = valid && w.latOk && w.lonOk;
+      if (f.fixValid) {
+        f.latE7 = w.latE7;
+        f.lonE7 = w.lonE7;
+        f.hasLocation = true;
+      }
+      ev = f.fixValid ? NMEA_EV_FIX : NMEA_EV_NO_FIX;
+      break;
+    }
+    case NMEA_TXT: {
+      size_t n = w.textLen < NMEA_TEXT_MAX ? w.textLen : NMEA_TEXT_MAX;
+      if (n > 0) memcpy(p.text, w.text, n);
+      p.text[n] = 0;
+      ev = NMEA_EV_TEXT;
+      break;
+    }
+    default:
+      break;
+  }
+  p.fix = f;
+  return ev;
+}
@@ -31,7 +31,10 @@ String twoDigits(int digits) {
 
 
 void digitalClockFrame(ScreenDisplay *display, DisplayUiState* state, int16_t x, int16_t y) {
-    String timenow = String(hour()) + ":" + twoDigits(minute()) + ":" + twoDigits(second());
+    uint32_t utc = nowUtc();
+    LocalTime lt;
+    localTimeOfDay(utc, lt);
+    String timenow = utc ? String(lt.hour) + ":" + twoDigits(lt.minute) + ":" + twoDigits(lt.second) : String("--:--:--");
     display->setTextAlignment(TEXT_ALIGN_CENTER);
     display->setFont(ArialMT_Plain_24);
     display->drawString(clockCenterX + x , clockCenterY/2 + y, timenow );
@@ -40,6 +43,8 @@ void digitalClockFrame(ScreenDisplay *display, DisplayUiState* state, int16_t x,
 
 void analogClockFrame(ScreenDisplay *display, DisplayUiState* state, int16_t x, int16_t y) {
   //  ui.disableIndicator();
+  LocalTime lt;
+  localTimeOfDay(nowUtc(), lt);
 
   // Draw the clock face
   //  display->drawCircle(clockCenterX + x, clockCenterY + y, clockRadius);
@@ -58,21 +63,21 @@ void analogClockFrame(ScreenDisplay *display, DisplayUiState* state, int16_t x,
   }
 
   // display second hand
-  float angle = second() * 6 ;
+  float angle = lt.second * 6 ;
   angle = ( angle / 57.29577951 ) ; //Convert degrees to radians
   int x3 = ( clockCenterX + ( sin(angle) * ( clockRadius - ( clockRadius / 5 ) ) ) );
   int y3 = ( clockCenterY - ( cos(angle) * ( clockRadius - ( clockRadius / 5 ) ) ) );
   display->drawLine( clockCenterX + x , clockCenterY + y , x3 + x , y3 + y);
   //
   // display minute hand
-  angle = minute() * 6 ;
+  angle = lt.minute * 6 ;
   angle = ( angle / 57.29577951 ) ; //Convert degrees to radians
   x3 = ( clockCenterX + ( sin(angle) * ( clockRadius - ( clockRadius / 4 ) ) ) );
   y3 = ( clockCenterY - ( cos(angle) * ( clockRadius - ( clockRadius / 4 ) ) ) );
   display->drawLine( clockCenterX + x , clockCenterY + y , x3 + x , y3 + y);
   //
   // display hour hand
-  angle = hour() * 30 + int( ( minute() / 12 ) * 6 )   ;
+  angle = lt.hour * 30 + int( ( lt.minute / 12 ) * 6 )   ;
   angle = ( angle / 57.29577951 ) ; //Convert degrees to radians
   x3 = ( clockCenterX + ( sin(angle) * ( clockRadius - ( clockRadius / 2 ) ) ) );
   y3 = ( clockCenterY - ( cos(angle) * ( clockRadius - ( clockRadius / 2 ) ) ) );
@@ -83,22 +88,25 @@ void analogClockFrame(ScreenDisplay *display, DisplayUiState* state, int16_t x,
 static uint32_t lastGPSUi = 0;
 void GPSFrame(ScreenDisplay *display, DisplayUiState* state, int16_t x, int16_t y) {
 
-    bool hasTime = GPS.time.isValid();
-    bool hasLoc = GPS.location.isValid();
+    NmeaFix fix;
+    gpsGetFix(fix);
+    bool hasTime = fix.hasTime;
+    bool hasLoc = fix.hasLocation;
     bool antennaStatusValid = gpsAntennaStatusValid();
   
     char t[20], la[24], lo[24];
 
     if (hasTime) {
+        int32_t s = (fix.hour * 3600L + fix.minute * 60 + fix.second + localOffsetS(nowUtc())) % 86400L;
         snprintf(t, sizeof(t), "%02d:%02d:%02d.%02d",
-                GPS.time.hour() + (gpsIsWinterTime() ? 1 : 0), GPS.time.minute(), GPS.time.second(), GPS.time.centisecond());
+                (int)(s / 3600), (int)(s / 60 % 60), (int)(s % 60), fix.centisecond);
     } else {
         snprintf(t, sizeof(t), "--:--:--.--");
     }
 
     if (hasLoc) {
-        snprintf(la, sizeof(la), "LAT: %.6f", GPS.location.lat());
-        snprintf(lo, sizeof(lo), "LON: %.6f", GPS.location.lng());
+        snprintf(la, sizeof(la), "LAT: %.6f", fix.latE7 / 1e7);
+        snprintf(lo, sizeof(lo), "LON: %.6f", fix.lonE7 / 1e7);
     } else {
         snprintf(la, sizeof(la), "LAT: ----");
         snprintf(lo, sizeof(lo), "LON: ----");
@@ -162,16 +170,14 @@ void WLANFrame(ScreenDisplay *display, DisplayUiState* state, int16_t x, int16_t
 void transmissionStatsFrame(ScreenDisplay *display, DisplayUiState* state, int16_t x, int16_t y) {
   // Get stats
   size_t totalPoints = trackStoreSize();
-  uint32_t ackedTs = trackStoreGetAckedTs();
-  size_t ackedCount = 0;
+  size_t wiFiLag = trackStoreChannelLag(TRACK_CH_WIFI);
+  size_t loraLag = trackStoreChannelLag(TRACK_CH_LORA);
   
   uint32_t lastWiFiMs = getLastWiFiTxMs();
   uint32_t wiFiCount = getWiFiTxCount();
   uint32_t lastLoraMs = getLastLoraTxMs();
   uint32_t loraCount = getLoraTxCount();
   
-  uint32_t pendingCount = totalPoints - wiFiCount;
-  
   // Format timestamps as HH:MM:SS
   char wiFiTime[12] = "--:--:--";
   char loraTime[12] = "--:--:--";
@@ -211,7 +217,7 @@ void transmissionStatsFrame(ScreenDisplay *display, DisplayUiState* state, int16
   display->drawString(0*LH + x, 0*LH + y, "DATA & TRANSMISSIONS");
   
   char line1[32];
-  snprintf(line1, sizeof(line1), "%lu | %lu [a] | %lu [p]", (unsigned long)totalPoints, (unsigned long)wiFiCount, (unsigned long)pendingCount);
+  snprintf(line1, sizeof(line1), "%lu | lag W %lu L %lu", (unsigned long)totalPoints, (unsigned long)wiFiLag, (unsigned long)loraLag);
   display->drawString(0 + x, 1*LH + y, line1);
   
   char line2[64];
@@ -0,0 +1,180 @@
+#include "pps_clock.h"
+
+static const int64_t US_PER_S = 1000000;
+
+// Local timer interval <-> true interval, drift in ppb
+static int64_t localToTrue(int64_t localUs, int32_t driftPpb) {
+  return localUs - localUs * driftPpb / 1000000000;
+}
+
+static int64_t trueToLocal(int64_t trueUs, int32_t driftPpb) {
+  return trueUs + trueUs * driftPpb / 1000000000;
+}
+
+void ppsClockReset(PpsClock& c) {
+  c = PpsClock();
+  c.anchorSource = CLOCK_NONE;
+}
+
+// ============= PPS EDGES =============
+
+// Start counting edges afresh at this one (first edge, or after a gap the
+// count cannot bridge). The anchor stays where it is until the next label.
+static void restartChain(PpsClock& c, int64_t edgeUs) {
+  c.lastEdgeUs = edgeUs;
+  c.anchorOnEdge = false;
+}
+
+void ppsClockEdge(PpsClock& c, int64_t edgeUs) {
+  edgeUs -= PPS_ISR_LATENCY_US;
+  if (!c.edges) {
+    restartChain(c, edgeUs);
+    c.edges = 1;
+    return;
+  }
+
+  // Whole seconds since the previous edge, with the known drift taken out
+  int64_t interval = edgeUs - c.lastEdgeUs;
+  int64_t trueInterval = localToTrue(interval, c.driftPpb);
+  int64_t n = (trueInterval + US_PER_S / 2) / US_PER_S;
+  int64_t residual = trueInterval - n * US_PER_S;
+  if (n < 1) {
+    c.glitches++;                     // a spike between two edges: ignore it
+    return;
+  }
+  int64_t tolerance = n <= PPS_MAX_GAP_S ? PPS_EDGE_TOLERANCE_US : US_PER_S / 10;
+  if (residual > tolerance || residual < -tolerance) {
+    c.glitches++;
+    if (interval >= 2 * US_PER_S) {
+      restartChain(c, edgeUs);        // can't tell how many seconds passed
+      c.edges++;
+    }
+    return;
+  }
+  if (c.edges == 1) {
+    c.driftPpb = (int32_t)((interval - n * US_PER_S) * 1000 / n);   // coarse start for the loop
+  }
+
+  // Discipline: PI loop on the phase error between the edge and the second
+  // the clock predicted for it. P pulls the phase, I learns the drift.
+  if (c.anchorSource == CLOCK_PPS && c.anchorOnEdge) {
+    int64_t predicted = c.anchorUs + trueToLocal(n * US_PER_S, c.driftPpb);
+    int64_t phase = edgeUs - predicted;
+    int64_t absPhase = phase < 0 ? -phase : phase;
+    // A single late interrupt is clipped; a persistent error (drift still
+    // being learned) raises the jitter and with it the clip
+    int64_t clip = PPS_PHASE_CLIP_US + 2 * (int64_t)(c.jitterNs / 1000);
+    c.jitterNs += (int32_t)(absPhase * 1000 - c.jitterNs) / 16;
+    if (phase > clip) phase = clip;
+    if (phase < -clip) phase = -clip;
+    if (n > PPS_MAX_GAP_S) {
+      c.anchorUs = edgeUs;            // back from holdover: the edge is better than the prediction
+    } else {
+      c.anchorUs = predicted + phase / PPS_LOOP_P;
+      c.driftPpb += (int32_t)(phase * 1000 / (n * PPS_LOOP_I));
+    }
+    c.anchorUtc += (uint32_t)n;
+  }
+  c.lastEdgeUs = edgeUs;
+  c.edges++;
+}
+
+// ============= TIME MESSAGES =============
+
+void ppsClockLabel(PpsClock& c, uint32_t utc, int64_t msgUs) {
+  c.labels++;
+
+  // The receiver sends the time of an epoch after that epoch's PPS edge
+  int64_t sinceEdge = msgUs - c.lastEdgeUs;
+  if (c.edges && sinceEdge >= 0 && sinceEdge < US_PER_S) {
+    if (c.anchorSource == CLOCK_PPS && c.anchorOnEdge) {
+      if (c.anchorUtc != utc) {
+        c.relabels++;                 // counted wrong (missed edge, leap second): trust the message
+        c.anchorUtc = utc;
+      }
+      return;
+    }
+    c.anchorSource = CLOCK_PPS;
+    c.anchorOnEdge = true;
+    c.anchorUs = c.lastEdgeUs;
+    c.anchorUtc = utc;
+    return;
+  }
+
+  // PPS anchor in holdover stays better than NMEA until its error reaches the NMEA bias
+  if (c.anchorSource == CLOCK_PPS &&
+      sinceEdge / US_PER_S * PPS_HOLDOVER_PPB / 1000 < PPS_NMEA_BIAS_US) {
+    return;
+  }
+
+  if (c.anchorSource != CLOCK_NMEA) {
+    c.anchorSource = CLOCK_NMEA;
+    c.anchorUs = msgUs;
+    c.anchorUtc = utc;
+    c.nmeaSpreadUs = 0;
+    return;
+  }
+
+  // Min filter: a message can only be late, so the earliest arrival bounds the
+  // start of the second. The bound leaks later slowly to follow the oscillator.
+  int64_t predicted = c.anchorUs + trueToLocal((int64_t)(int32_t)(utc - c.anchorUtc) * US_PER_S, c.driftPpb);
+  int64_t lag = msgUs - predicted;
+  if (lag < 0) {
+    c.anchorUs = msgUs;
+  } else {
+    c.anchorUs = predicted + (lag < PPS_NMEA_CREEP_US ? lag : PPS_NMEA_CREEP_US);
+    c.nmeaSpreadUs += (int32_t)(lag - c.nmeaSpreadUs) / 8;
+  }
+  c.anchorUtc = utc;
+}
+
+// ============= READ =============
+
+bool ppsClockRead(const PpsClock& c, int64_t nowUs, ClockTime& out) {
+  if (c.anchorSource == CLOCK_NONE) return false;
+
+  int64_t elapsed = localToTrue(nowUs - c.anchorUs, c.driftPpb);
+  int64_t sec = elapsed >= 0 ? elapsed / US_PER_S : -((-elapsed + US_PER_S - 1) / US_PER_S);
+  out.utc = c.anchorUtc + (uint32_t)sec;
+  out.us = (uint32_t)(elapsed - sec * US_PER_S);
+  out.driftPpb = c.driftPpb;
+
+  if (c.anchorSource == CLOCK_NMEA) {
+    out.source = CLOCK_NMEA;
+    out.uncertaintyUs = PPS_NMEA_BIAS_US + c.nmeaSpreadUs;
+    return true;
+  }
+  int64_t sinceEdge = nowUs - c.lastEdgeUs;
+  uint32_t base = c.jitterNs / 1000 + PPS_ISR_LATENCY_US;
+  if (sinceEdge < PPS_LOST_US) {
+    out.source = CLOCK_PPS;
+    out.uncertaintyUs = base;
+  } else {
+    out.source = CLOCK_HOLDOVER;
+    out.uncertaintyUs = base + (uint32_t)(sinceEdge / 1000 * PPS_HOLDOVER_PPB / 1000000);
+  }
+  return true;
+}
+
+// ============= CALENDAR =============
+
+uint32_t utcFromCivil(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second) {
+  // Days from 1970-01-01 (proleptic Gregorian, March-based year)
+  int32_t y = (int32_t)year - (month <= 2 ? 1 : 0);
+  int32_t era = y / 400;
+  int32_t yoe = y - era * 400;
+  int32_t mp = (month + 9) % 12;
+  int32_t doy = (153 * mp + 2) / 5 + day - 1;
+  int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  int32_t days = era * 146097 + doe - 719468;
+  return (uint32_t)days * 86400UL + hour * 3600UL + minute * 60UL + second;
+}
+
+const char* clockSourceName(ClockSource s) {
+  switch (s) {
+    case CLOCK_NMEA:     return "nmea";
+    case CLOCK_PPS:      return "pps";
+    case CLOCK_HOLDOVER: return "holdover";
+    default:             return "none";
+  }
+}
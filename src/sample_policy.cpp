@@ -0,0 +1,63 @@
+#include "sample_policy.h"
+#include "geo_distance.h"
+
+// Smallest angle between two courses, degrees
+static float headingChangeDeg(uint16_t aCdeg, uint16_t bCdeg) {
+  int d = (int)bCdeg - (int)aCdeg;
+  if (d < 0) d = -d;
+  if (d > 18000) d = 36000 - d;
+  return d / 100.0f;
+}
+
+void samplePolicyReset(SamplePolicy& p) {
+  p.hasLast = false;
+  p.stored = 0;
+}
+
+SampleReason samplePolicyDue(const SamplePolicy& p, const SampleInput& in) {
+  if (!p.hasLast) return SAMPLE_FIRST;
+
+  uint32_t elapsed = in.nowS - p.last.nowS;
+  if (elapsed < SAMPLE_MIN_INTERVAL_S) return SAMPLE_NONE;
+
+  float dist = geoDistanceM(p.last.latE7, p.last.lonE7, in.latE7, in.lonE7);
+  bool moving = in.speedCmS >= SAMPLE_MOVING_CMS;
+
+  if (!moving) {
+    if (dist >= SAMPLE_PARKED_MOVE_M) return SAMPLE_PARKED_MOVE;
+    if (elapsed >= SAMPLE_PARKED_MAX_S) return SAMPLE_PARKED_MAX;
+    return SAMPLE_NONE;
+  }
+
+  if (dist >= SAMPLE_MAX_GAP_M) return SAMPLE_DISTANCE;
+  // Corner: course now vs course at the last stored fix (course is only
+  // meaningful at speed, and only once the fix has actually moved)
+  if (in.hasCourse && p.last.hasCourse && dist >= SAMPLE_TURN_MIN_M &&
+      headingChangeDeg(p.last.courseCdeg, in.courseCdeg) >= SAMPLE_TURN_DEG) {
+    return SAMPLE_TURN;
+  }
+  if (elapsed >= SAMPLE_MOVING_MAX_S) return SAMPLE_MOVING_MAX;
+  return SAMPLE_NONE;
+}
+
+void samplePolicyStored(SamplePolicy& p, const SampleInput& in) {
+  p.last = in;
+  // A course taken while (nearly) standing still is noise: don't measure turns against it
+  p.last.hasCourse = in.hasCourse && in.speedCmS >= SAMPLE_MOVING_CMS;
+  p.hasLast = true;
+  p.stored++;
+}
+
+const char* sampleReasonName(SampleReason r) {
+  switch (r) {
+    case SAMPLE_FIRST:       return "first";
+    case SAMPLE_DISTANCE:    return "distance";
+    case SAMPLE_TURN:        return "turn";
+    case SAMPLE_MOVING_MAX:  return "moving-max";
+    case SAMPLE_PARKED_MAX:  return "parked-max";
+    case SAMPLE_PARKED_MOVE: return "parked-move";
+    case SAMPLE_FENCE:       return "fence";
+    case SAMPLE_MOTION:      return "motion";
+    default:                 return "none";
+  }
+}
@@ -0,0 +1,129 @@
+#include "time_service.h"
+#include <atomic>
+#include <esp_timer.h>
+
+// ============= DST TABLE =============
+
+// Days from 1970-01-01 to January 1st of year y (y >= 1970)
+static constexpr uint32_t daysBeforeYear(uint32_t y) {
+  return 365 * (y - 1970) + (y - 1969) / 4 - (y - 1901) / 100 + (y - 1601) / 400;
+}
+
+static constexpr uint32_t leapDay(uint32_t y) {
+  return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0 ? 1 : 0;
+}
+
+// Last Sunday on or before day d (days since 1970; 1970-01-01 was a Thursday)
+static constexpr uint32_t sundayOnOrBefore(uint32_t d) {
+  return d - (d + 4) % 7;
+}
+
+// Switches happen at 01:00 UTC on the last Sunday of March and of October
+static constexpr uint32_t dstStart(uint32_t y) {
+  return sundayOnOrBefore(daysBeforeYear(y) + 89 + leapDay(y)) * 86400UL + 3600;     // March 31st
+}
+
+static constexpr uint32_t dstEnd(uint32_t y) {
+  return sundayOnOrBefore(daysBeforeYear(y) + 303 + leapDay(y)) * 86400UL + 3600;    // October 31st
+}
+
+struct DstYear {
+  uint32_t start;
+  uint32_t end;
+};
+
+#define DST_YEAR(y) { dstStart(y), dstEnd(y) }
+#define DST_DECADE(d) DST_YEAR(d##0), DST_YEAR(d##1), DST_YEAR(d##2), DST_YEAR(d##3), DST_YEAR(d##4), \
+                      DST_YEAR(d##5), DST_YEAR(d##6), DST_YEAR(d##7), DST_YEAR(d##8), DST_YEAR(d##9)
+
+static constexpr DstYear DST_TABLE[] = {
+  DST_DECADE(202), DST_DECADE(203), DST_DECADE(204), DST_DECADE(205),
+  DST_DECADE(206), DST_DECADE(207), DST_DECADE(208), DST_DECADE(209),
+};
+
+static_assert(sizeof(DST_TABLE) / sizeof(DST_TABLE[0]) == TIME_DST_YEARS, "DST table size");
+static_assert(DST_TABLE[0].start == 1585443600UL && DST_TABLE[0].end == 1603587600UL, "2020-03-29 / 2020-10-25 01:00 UTC");
+static_assert(DST_TABLE[6].start == 1774746000UL && DST_TABLE[6].end == 1792890000UL, "2026-03-29 / 2026-10-25 01:00 UTC");
+static_assert(DST_TABLE[79].start == 4078429200UL && DST_TABLE[79].end == 4096573200UL, "2099-03-29 / 2099-10-25 01:00 UTC");
+
+bool isSummerTime(uint32_t utc) {
+  // The year estimate can be one off around New Year, where it is winter either way
+  uint32_t i = utc / 31556952UL + 1970 - TIME_DST_FIRST_YEAR;     // mean Gregorian year
+  if (utc < TIME_VALID_UTC || i >= TIME_DST_YEARS) return false;
+  return utc >= DST_TABLE[i].start && utc < DST_TABLE[i].end;
+}
+
+int32_t localOffsetS(uint32_t utc) {
+  return TIME_ZONE_STD_S + (isSummerTime(utc) ? TIME_ZONE_DST_S : 0);
+}
+
+void localTimeOfDay(uint32_t utc, LocalTime& out) {
+  out.summer = isSummerTime(utc);
+  uint32_t s = (utc + TIME_ZONE_STD_S + (out.summer ? TIME_ZONE_DST_S : 0)) % 86400UL;
+  out.hour = (uint8_t)(s / 3600);
+  out.minute = (uint8_t)(s / 60 % 60);
+  out.second = (uint8_t)(s % 60);
+}
+
+// ============= UTC BASE =============
+
+// UTC second baseUtc started at esp_timer baseUs. Written by the GPS task,
+// read by any task (seqlock, odd version while writing).
+static int64_t baseUs = 0;
+static uint32_t baseUtc = 0;
+static std::atomic<uint32_t> baseVersion{0};
+
+static void writeBase(uint32_t utc, int64_t us) {
+  uint32_t v = baseVersion.load(std::memory_order_relaxed);
+  baseVersion.store(v + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  baseUs = us;
+  baseUtc = utc;
+  baseVersion.store(v + 2, std::memory_order_release);
+}
+
+void timeServiceSync(uint32_t utc, uint32_t us, int64_t monoUs) {
+  if (utc < TIME_VALID_UTC) return;
+  writeBase(utc, monoUs - us);
+}
+
+void timeServiceClear() {
+  writeBase(0, 0);
+}
+
+uint32_t nowUtcMs(uint16_t& ms) {
+  int64_t us;
+  uint32_t utc;
+  while (true) {
+    uint32_t v = baseVersion.load(std::memory_order_acquire);
+    if (v & 1) continue;
+    us = baseUs;
+    utc = baseUtc;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (baseVersion.load(std::memory_order_relaxed) == v) break;
+  }
+  ms = 0;
+  if (!utc) return 0;
+
+  int64_t elapsed = esp_timer_get_time() - us;
+  if (elapsed < 0) return utc;
+  if (elapsed < 0x100000000LL) {
+    // The GPS task moves the base every second: 32-bit arithmetic
+    uint32_t e = (uint32_t)elapsed;
+    uint32_t s = e / 1000000UL;
+    ms = (uint16_t)((e - s * 1000000UL) / 1000);
+    return utc + s;
+  }
+  // No clock update for over an hour: free-running on esp_timer
+  ms = (uint16_t)(elapsed / 1000 % 1000);
+  return utc + (uint32_t)(elapsed / 1000000);
+}
+
+uint32_t nowUtc() {
+  uint16_t ms;
+  return nowUtcMs(ms);
+}
+
+bool timeIsSet() {
+  return nowUtc() != 0;
+}
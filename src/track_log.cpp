@@ -0,0 +1,288 @@
+#include "track_log.h"
+#include <LittleFS.h>
+#include <vector>
+#include <algorithm>
+
+// Segmented append-only log.
+//
+// Segments are files TRACK_LOG_DIR/<n>.seg with consecutive numbers n; a new
+// segment is started when the current one is full (or ends in a torn record
+// at boot). Beyond TRACK_LOG_MAX_SEGMENTS the oldest segment is deleted once
+// all its fixes are below the ack floor; only past TRACK_LOG_HARD_SEGMENTS is
+// a segment with unacked fixes evicted (and logged). LittleFS allocates
+// blocks copy-on-write across the whole partition, so rotating whole files
+// spreads erases evenly (wear levelling).
+//
+// Records are batched in a RAM page and appended to the current segment in one
+// write: when the page cannot take another fix, when its oldest record is
+// TRACK_LOG_FLUSH_MS old, and at once for event fixes (FL_EVT_IMMEDIATE). A
+// reset loses at most the fixes of the last TRACK_LOG_FLUSH_MS.
+// A segment always holds whole records. On-flash record layout:
+//   [magic][type][len][payload: len bytes][crc16 hi][crc16 lo]
+// crc16 (CCITT) covers type, len and payload. A FIX_V2 payload is the raw
+// FixRec; the reader copies min(len, sizeof(FixRec)) so the record layout can
+// grow. FIX records from v1 firmware end at FixRec::flags and are restored
+// with the v2 fields unknown; they age out with their segments.
+
+static constexpr uint8_t LOG_MAGIC = 0xA5;
+static constexpr uint8_t REC_FIX = 1;       // payload: v1 FixRec (seq .. flags), read only
+static constexpr uint8_t REC_ACK = 2;       // payload: uint32_t acked timestamp
+static constexpr uint8_t REC_ACK_FLOOR = 3; // payload: uint32_t first possibly unacked seq
+static constexpr uint8_t REC_FIX_V2 = 4;    // payload: FixRec
+static constexpr size_t REC_OVERHEAD = 5;   // magic + type + len + crc16
+
+static bool logReady = false;
+static uint32_t oldestSeg = 1;              // oldest segment number on flash
+static uint32_t segNo = 1;                  // segment currently appended to
+static size_t segBytes = 0;                 // bytes already written to segNo
+static uint8_t page[TRACK_LOG_PAGE_BYTES];  // write batch
+static size_t pageLen = 0;
+static uint32_t pageSinceMs = 0;            // millis() when the oldest buffered record was added
+static uint32_t segLastSeq[TRACK_LOG_HARD_SEGMENTS + 1];  // newest fix seq per live segment (n % size)
+static uint32_t loggedAckTs = 0;            // ack watermark last appended to the log
+static uint32_t loggedAckFloor = 1;         // ack floor last appended to the log
+
+static uint16_t crc16(const uint8_t* data, size_t n) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < n; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static void segPath(uint32_t n, char* out, size_t outLen) {
+  snprintf(out, outLen, TRACK_LOG_DIR "/%08lu.seg", (unsigned long)n);
+}
+
+static void listSegments(std::vector<uint32_t>& out) {
+  File dir = LittleFS.open(TRACK_LOG_DIR);
+  if (!dir || !dir.isDirectory()) return;
+
+  File f = dir.openNextFile();
+  while (f) {
+    const char* name = f.name();
+    const char* base = strrchr(name, '/');
+    base = base ? base + 1 : name;
+    char* end = nullptr;
+    unsigned long n = strtoul(base, &end, 10);
+    if (end != base && strcmp(end, ".seg") == 0) {
+      out.push_back((uint32_t)n);
+    }
+    f.close();
+    f = dir.openNextFile();
+  }
+  std::sort(out.begin(), out.end());
+}
+
+static uint32_t& lastSeqOf(uint32_t n) {
+  return segLastSeq[n % (TRACK_LOG_HARD_SEGMENTS + 1)];
+}
+
+// Replay one segment into the track store. Stops at the first framing error
+// (torn write), skips single records with a bad CRC.
+// @param intact Output: the segment ends in a whole record
+// @param bytes Output: segment length
+static size_t replaySegment(uint32_t n, uint32_t& ackTs, uint32_t& ackFloor, size_t& corrupt, bool& intact,
+                            size_t& bytes) {
+  char path[32];
+  segPath(n, path, sizeof(path));
+  lastSeqOf(n) = 0;
+  intact = false;
+  bytes = 0;
+  File f = LittleFS.open(path, FILE_READ);
+  if (!f) return 0;
+
+  std::vector<uint8_t> buf(f.size());
+  size_t len = f.read(buf.data(), buf.size());
+  f.close();
+
+  size_t fixes = 0;
+  size_t pos = 0;
+  bytes = len;
+  intact = true;
+  while (pos < len) {
+    const uint8_t* p = buf.data() + pos;
+    uint8_t payloadLen = pos + REC_OVERHEAD <= len ? p[2] : 0;
+    if (pos + REC_OVERHEAD > len || p[0] != LOG_MAGIC || pos + REC_OVERHEAD + payloadLen > len) {
+      corrupt++;
+      intact = false;
+      break;
+    }
+    pos += REC_OVERHEAD + payloadLen;
+
+    uint16_t crc = ((uint16_t)p[3 + payloadLen] << 8) | p[4 + payloadLen];
+    if (crc16(p + 1, payloadLen + 2) != crc) {
+      corrupt++;
+      continue;
+    }
+
+    if (p[1] == REC_FIX_V2) {
+      FixRec rec = {};
+      memcpy(&rec, p + 3, std::min<size_t>(payloadLen, sizeof(FixRec)));
+      if (rec.seq > lastSeqOf(n)) lastSeqOf(n) = rec.seq;
+      if (trackStoreRestore(rec)) fixes++;
+    } else if (p[1] == REC_FIX) {
+      FixRec rec = {};
+      memcpy(&rec, p + 3, std::min<size_t>(payloadLen, offsetof(FixRec, dop)));
+      rec.course2 = FIX_COURSE_UNKNOWN;
+      rec.altDm = FIX_ALT_UNKNOWN;
+      if (rec.seq > lastSeqOf(n)) lastSeqOf(n) = rec.seq;
+      if (trackStoreRestore(rec)) fixes++;
+    } else if (p[1] == REC_ACK && payloadLen >= sizeof(uint32_t)) {
+      uint32_t ts;
+      memcpy(&ts, p + 3, sizeof(ts));
+      if (ts > ackTs) ackTs = ts;
+    } else if (p[1] == REC_ACK_FLOOR && payloadLen >= sizeof(uint32_t)) {
+      uint32_t seq;
+      memcpy(&seq, p + 3, sizeof(seq));
+      if (seq > ackFloor) ackFloor = seq;
+    }
+  }
+  return fixes;
+}
+
+// Start the next segment and drop the oldest ones beyond the budget that
+// hold no unacked fix (any beyond the hard limit)
+static void rotateSegment() {
+  segNo++;
+  segBytes = 0;
+  lastSeqOf(segNo) = 0;
+  uint32_t floor = trackStoreGetAckFloor();
+  while (segNo - oldestSeg + 1 > TRACK_LOG_MAX_SEGMENTS) {
+    uint32_t last = lastSeqOf(oldestSeg);
+    if (last >= floor) {
+      if (segNo - oldestSeg + 1 <= TRACK_LOG_HARD_SEGMENTS) break;
+      Serial.printf("[LOG] Log full: evicting segment %lu with unacked fixes up to seq %lu (ack floor %lu)\n",
+                    (unsigned long)oldestSeg, (unsigned long)last, (unsigned long)floor);
+    }
+    char path[32];
+    segPath(oldestSeg, path, sizeof(path));
+    LittleFS.remove(path);
+    oldestSeg++;
+  }
+}
+
+static void appendRecord(uint8_t type, const void* payload, uint8_t len) {
+  if (!logReady) return;
+
+  size_t need = REC_OVERHEAD + len;
+  if (pageLen + need > sizeof(page)) trackLogFlush();
+  if (pageLen + need > sizeof(page)) {
+    Serial.println("[LOG] Page flush failed, record dropped");
+    return; // never block the sampler on a broken filesystem
+  }
+
+  uint8_t* p = page + pageLen;
+  p[0] = LOG_MAGIC;
+  p[1] = type;
+  p[2] = len;
+  memcpy(p + 3, payload, len);
+  uint16_t crc = crc16(p + 1, len + 2);
+  p[3 + len] = (uint8_t)(crc >> 8);
+  p[4 + len] = (uint8_t)(crc & 0xFF);
+
+  if (pageLen == 0) pageSinceMs = millis();
+  pageLen += need;
+}
+
+bool trackLogInit() {
+  if (!LittleFS.begin(true)) {  // format on first use
+    Serial.println("[LOG] LittleFS mount failed - track store is RAM-only");
+    return false;
+  }
+  if (!LittleFS.exists(TRACK_LOG_DIR)) {
+    LittleFS.mkdir(TRACK_LOG_DIR);
+  }
+
+  uint32_t startMs = millis();
+  std::vector<uint32_t> segs;
+  listSegments(segs);
+
+  uint32_t ackTs = 0;
+  uint32_t ackFloor = 1;
+  size_t fixes = 0;
+  size_t corrupt = 0;
+  bool intact = false;
+  size_t lastBytes = 0;
+  for (uint32_t n : segs) {
+    fixes += replaySegment(n, ackTs, ackFloor, corrupt, intact, lastBytes);
+  }
+  trackStoreSetAckedTs(ackTs);
+  trackStoreSetAckFloor(ackFloor);
+  loggedAckTs = ackTs;
+  loggedAckFloor = trackStoreGetAckFloor();
+
+  // Continue the newest segment unless it is full or ends in a torn record
+  // (never append behind one), so reboots do not use up segments
+  oldestSeg = segs.empty() ? 1 : segs.front();
+  segNo = segs.empty() ? 0 : segs.back();
+  if (segs.empty() || !intact || lastBytes + REC_OVERHEAD + sizeof(FixRec) > TRACK_LOG_SEGMENT_BYTES) {
+    rotateSegment();
+  } else {
+    segBytes = lastBytes;
+  }
+  pageLen = 0;
+  logReady = true;
+
+  Serial.printf("[LOG] Recovered %u fixes (ackedTs=%lu, ackFloor=%lu, %u corrupt) from %u segments in %lu ms\n",
+                (unsigned)fixes, (unsigned long)ackTs, (unsigned long)loggedAckFloor, (unsigned)corrupt, (unsigned)segs.size(),
+                (unsigned long)(millis() - startMs));
+  return true;
+}
+
+void trackLogAppend(const FixRec& rec) {
+  appendRecord(REC_FIX_V2, &rec, sizeof(FixRec));
+  if (rec.seq > lastSeqOf(segNo)) lastSeqOf(segNo) = rec.seq;
+  if ((rec.flags & FL_EVT_IMMEDIATE) || pageLen + REC_OVERHEAD + sizeof(FixRec) > sizeof(page) ||
+      millis() - pageSinceMs >= TRACK_LOG_FLUSH_MS) {
+    trackLogFlush();
+  }
+}
+
+void trackLogService() {
+  if (!logReady) return;
+
+  uint32_t ts = trackStoreGetAckedTs();
+  if (ts > loggedAckTs) {
+    appendRecord(REC_ACK, &ts, sizeof(ts));
+    loggedAckTs = ts;
+  }
+  uint32_t floor = trackStoreGetAckFloor();
+  if (floor > loggedAckFloor) {
+    appendRecord(REC_ACK_FLOOR, &floor, sizeof(floor));
+    loggedAckFloor = floor;
+  }
+  if (pageLen > 0 && millis() - pageSinceMs >= TRACK_LOG_FLUSH_MS) {
+    trackLogFlush();
+  }
+}
+
+void trackLogFlush() {
+  if (!logReady || pageLen == 0) return;
+
+  if (segBytes + pageLen > TRACK_LOG_SEGMENT_BYTES) {
+    rotateSegment();
+  }
+
+  char path[32];
+  segPath(segNo, path, sizeof(path));
+  File f = LittleFS.open(path, FILE_APPEND);
+  if (!f) {
+    Serial.printf("[LOG] Cannot open %s\n", path);
+    return;
+  }
+  size_t written = f.write(page, pageLen);
+  f.close();
+
+  if (written != pageLen) {
+    // Partial page: the segment now ends in a torn record, continue in a new one
+    Serial.printf("[LOG] Short write to %s (%u of %u bytes)\n", path, (unsigned)written, (unsigned)pageLen);
+    rotateSegment();
+    return;
+  }
+  segBytes += pageLen;
+  pageLen = 0;
+}
@@ -0,0 +1,65 @@
+#include "track_scan.h"
+
+// The rest of the firmware builds with -Os/-O2, whose cost model skips loop
+// vectorization; these kernels are hot and small enough to be worth -O3.
+#pragma GCC optimize ("O3")
+
+// The loops below are kept free of branches and early exits on purpose:
+// results are accumulated with compares that compile to selects, so GCC
+// vectorizes them on the host and unrolls them into tight loads on Xtensa.
+
+size_t scanCountTsAtMost(const uint32_t* __restrict ts, size_t n, uint32_t t) {
+  size_t c = 0;
+  for (size_t i = 0; i < n; i++) {
+    c += (ts[i] <= t);
+  }
+  return c;
+}
+
+size_t scanFlagsAny(const uint8_t* __restrict flags, size_t n, uint8_t mask, uint8_t* __restrict hit) {
+  size_t c = 0;
+  for (size_t i = 0; i < n; i++) {
+    uint8_t h = (flags[i] & mask) != 0;
+    hit[i] = h;
+    c += h;
+  }
+  return c;
+}
+
+size_t scanInBox(const int32_t* __restrict latE7, const int32_t* __restrict lonE7, size_t n,
+                 const TrackBox& box, uint8_t* __restrict hit) {
+  const int32_t minLat = box.minLatE7, maxLat = box.maxLatE7;
+  const int32_t minLon = box.minLonE7, maxLon = box.maxLonE7;
+  size_t c = 0;
+  for (size_t i = 0; i < n; i++) {
+    uint8_t h = (latE7[i] >= minLat) & (latE7[i] <= maxLat) &
+                (lonE7[i] >= minLon) & (lonE7[i] <= maxLon);
+    hit[i] = h;
+    c += h;
+  }
+  return c;
+}
+
+void scanBounds(const int32_t* __restrict latE7, const int32_t* __restrict lonE7, size_t n, TrackBox& box) {
+  int32_t minLat = box.minLatE7, maxLat = box.maxLatE7;
+  int32_t minLon = box.minLonE7, maxLon = box.maxLonE7;
+  for (size_t i = 0; i < n; i++) {
+    minLat = latE7[i] < minLat ? latE7[i] : minLat;
+    maxLat = latE7[i] > maxLat ? latE7[i] : maxLat;
+    minLon = lonE7[i] < minLon ? lonE7[i] : minLon;
+    maxLon = lonE7[i] > maxLon ? lonE7[i] : maxLon;
+  }
+  box.minLatE7 = minLat;
+  box.maxLatE7 = maxLat;
+  box.minLonE7 = minLon;
+  box.maxLonE7 = maxLon;
+}
+
+TrackBox trackBoxEmpty() {
+  TrackBox box;
+  box.minLatE7 = INT32_MAX;
+  box.maxLatE7 = INT32_MIN;
+  box.minLonE7 = INT32_MAX;
+  box.maxLonE7 = INT32_MIN;
+  return box;
+}
@@ -0,0 +1,102 @@
+#include "track_simplify.h"
+#include <math.h>
+#include "geo_distance.h"
+
+static constexpr float M_PER_E7 = GEO_M_PER_E7;   // metres per 1e-7 degree of latitude
+
+// Local flat projection around the anchor (plenty for segments of a few km)
+struct Frame {
+  int32_t latE7;
+  int32_t lonE7;
+  float kx;                       // metres per 1e-7 degree of longitude at the anchor
+};
+
+static Frame frameAt(const FixRec& a) {
+  Frame f;
+  f.latE7 = a.latE7;
+  f.lonE7 = a.lonE7;
+  f.kx = M_PER_E7 * (geoCosQ30(a.latE7) * (1.0f / 1073741824.0f));
+  return f;
+}
+
+// Distance in metres of p from the segment anchor -> e
+static float segmentDistanceM(const Frame& f, const FixRec& e, const FixRec& p) {
+  float ex = (float)((int64_t)e.lonE7 - f.lonE7) * f.kx;
+  float ey = (float)((int64_t)e.latE7 - f.latE7) * M_PER_E7;
+  float px = (float)((int64_t)p.lonE7 - f.lonE7) * f.kx;
+  float py = (float)((int64_t)p.latE7 - f.latE7) * M_PER_E7;
+
+  float len2 = ex * ex + ey * ey;
+  float t = (len2 > 0) ? (px * ex + py * ey) / len2 : 0;
+  if (t < 0) t = 0;
+  if (t > 1) t = 1;
+  float dx = px - t * ex;
+  float dy = py - t * ey;
+  return sqrtf(dx * dx + dy * dy);
+}
+
+// Close the window [start, end]: keep 'end', drop everything before it
+static void closeWindow(SimplifyState& st, const TrackLease& lease, uint8_t* keep, size_t start, size_t end) {
+  FixRec e = lease.at(end);
+  Frame f = frameAt(st.anchor);
+  for (size_t k = start; k < end; k++) {
+    keep[k] = 0;
+    float d = segmentDistanceM(f, e, lease.at(k));
+    if (d > st.maxDeviationM) st.maxDeviationM = d;
+  }
+  keep[end] = 1;
+  st.anchor = e;
+  st.seen += end - start + 1;
+  st.kept++;
+}
+
+size_t simplifyRun(SimplifyState& st, const TrackLease& lease, uint8_t* keep) {
+  size_t n = lease.count < SIMPLIFY_MAX_WINDOW ? lease.count : SIMPLIFY_MAX_WINDOW;
+  size_t i = 0;
+
+  // Decided on an earlier run (the uplink went back after a failed delivery)
+  while (i < n && st.hasAnchor && lease.at(i).seq <= st.anchor.seq) keep[i++] = 1;
+
+  // Very first fix starts the track
+  if (i < n && !st.hasAnchor) {
+    keep[i] = 1;
+    st.anchor = lease.at(i);
+    st.hasAnchor = true;
+    st.seen++;
+    st.kept++;
+    i++;
+  }
+
+  size_t start = i;               // first undecided fix
+  for (size_t j = start; j < n; j++) {
+    FixRec e = lease.at(j);
+
+    // Does the line anchor -> e still pass close enough to every fix in between?
+    Frame f = frameAt(st.anchor);
+    bool fits = true;
+    for (size_t k = start; k < j && fits; k++) {
+      fits = segmentDistanceM(f, e, lease.at(k)) <= st.toleranceM;
+    }
+    if (!fits) {
+      closeWindow(st, lease, keep, start, j - 1);   // j > start: a window without inner fixes always fits
+      start = j;
+    }
+
+    if ((e.flags & SIMPLIFY_KEEP_FLAGS) || e.ts - st.anchor.ts >= SIMPLIFY_MAX_SPAN_S) {
+      closeWindow(st, lease, keep, start, j);
+      start = j + 1;
+    }
+  }
+
+  // A full window cannot grow any further: close it at its newest fix
+  if (start < n && n - start >= SIMPLIFY_MAX_WINDOW) {
+    closeWindow(st, lease, keep, start, n - 1);
+    start = n;
+  }
+  return start;
+}
+
+void simplifyReset(SimplifyState& st, const FixRec& rec) {
+  st.anchor = rec;
+  st.hasAnchor = true;
+}
@@ -1,135 +1,1082 @@
 #include "track_storage.h"
-#include <vector>
-#include <freertos/FreeRTOS.h>
-#include <freertos/semphr.h>
+#include <atomic>
 
-// Ring storage for GPS fixes
-static std::vector<FixRec> ring;    // the ring storage for GPS fixes, allocated to max capacity in initTrackStorage()
-static size_t cap = 0;              // storage capacity (number of records) - set by initTrackStorage()
-static size_t head = 0;             // next write position
-static size_t count = 0;            // how many valid records in the ring (<= cap)
-static uint32_t nextSeq = 1;        // next sequence number to assign to new record
-static uint32_t ackedTs = 0;        // highest timestamp confirmed by server (ACK)
+// Lock-free single-producer / multi-consumer ring for GPS fixes.
+//
+// The GPS sampler is the only writer. Uploader, LoRa and UI tasks read
+// concurrently without ever blocking: every slot has a stamp holding the seq
+// of the record stored in it (0 while the producer is rewriting it).
+// A reader copies the record and accepts the copy only if the stamp still
+// matches the seq it wanted before and after the copy (per-slot seqlock).
+// Record seq N lives in slot (N - 1) & mask, so capacity is a power of two.
+// The ring is stored as structure of arrays: one column per field plus the
+// stamps. Scans (ts search, flag filters, bounding boxes) only touch the
+// columns they need, and leases hand out column spans.
+//
+// Behind the (small, uncompressed) hot ring sits a compressed archive. Every
+// pushed record is also appended to the producer's open block; full blocks are
+// sealed into a ring of fixed-size block slots using the same stamp protocol.
+// The hot ring is at least one block long, so every record that has left the
+// hot ring is in a sealed block. Blocks are decoded lazily by readers.
+//
+// Block encoding: the first record is the keyframe (ts/lat/lon/speed/course/
+// alt/dop in the header). Each following record appends varint(dts), then
+// zigzag varints of dlat, dlon, dspeed, dcourse, dalt and ddop to the front of
+// data[]. bat/flags are run-length coded as [count][bat][flags] triples growing
+// down from the end of data[].
 
-static SemaphoreHandle_t mtx;       // mutex to protect concurrent access to ring buffer and related variables
+struct BlockData {
+  uint32_t firstSeq;                // seq of the keyframe; records are firstSeq .. firstSeq + count - 1
+  uint32_t firstTs;                 // keyframe ts
+  uint32_t lastTs;                  // ts of the last record (block search key)
+  int32_t  latE7;                   // keyframe latitude
+  int32_t  lonE7;                   // keyframe longitude
+  uint16_t speedCmS;                // keyframe speed
+  int16_t  altDm;                   // keyframe altitude
+  uint8_t  course2;                 // keyframe course
+  uint8_t  dop;                     // keyframe sats/HDOP
+  uint16_t count;                   // number of records in the block
+  uint16_t frontLen;                // bytes of delta stream at the front of data[]
+  uint16_t backLen;                 // bytes of bat/flags runs at the end of data[]
+  uint8_t  data[TRACK_BLOCK_BYTES];
+};
+
+struct BlockSlot {
+  std::atomic<uint32_t> stamp;      // logical block number + 1, 0 = empty or being written
+  BlockData blk;
+};
+
+// Sparse index: seq and ts bounds of every sealed block (one entry per <= 64
+// records), kept apart from the block payloads so searches bisect over 16-byte
+// entries instead of copying whole blocks
+struct IndexEntry {
+  uint32_t firstSeq;
+  uint32_t count;
+  uint32_t minTs;                   // ts is non-decreasing: minTs = first, maxTs = last record
+  uint32_t maxTs;
+};
+
+struct IndexSlot {
+  std::atomic<uint32_t> stamp;      // same stamp as the block slot
+  IndexEntry e;
+};
+
+// Hot ring columns, allocated in initTrackStore(); slot i of every column belongs together
+static uint32_t* colTs = nullptr;
+static int32_t*  colLat = nullptr;
+static int32_t*  colLon = nullptr;
+static uint8_t*  colBat = nullptr;
+static uint8_t*  colFlags = nullptr;
+static uint8_t*  colDop = nullptr;
+static uint8_t*  colCourse = nullptr;
+static uint16_t* colSpeed = nullptr;
+static int16_t*  colAlt = nullptr;
+static std::atomic<uint32_t>* stamps = nullptr;  // per slot: seq of the record in it, 0 = empty or being written
+static size_t cap = 0;              // storage capacity (number of records, power of two)
+static size_t mask = 0;             // cap - 1, maps seq to slot index
+static uint32_t nextSeq = 1;        // next sequence number to assign (producer only)
+static uint32_t lastTs = 0;         // ts of the newest pushed record (producer only)
+static std::atomic<uint32_t> lastSeq{0};  // seq of the newest published record (0 = empty)
+static std::atomic<uint32_t> ackedTs{0};  // highest timestamp confirmed by server (ACK)
+
+static BlockSlot* blocks = nullptr; // compressed archive, TRACK_ARCHIVE_BLOCKS slots
+static IndexSlot* blockIndex = nullptr;  // sparse index over blocks, same slots
+static std::atomic<uint32_t> sealedBlocks{0};  // number of blocks sealed so far
+static std::atomic<uint32_t> archivedFixes{0}; // fixes in the sealed blocks (producer writes)
+static std::atomic<uint32_t> archivedBytes{0}; // coded bytes of the sealed blocks, header included
+static BlockData openBlk;           // block being filled (producer only)
+static int32_t encLat = 0;          // previous record's values for delta coding (producer only)
+static int32_t encLon = 0;
+static uint32_t encTs = 0;
+static uint16_t encSpeed = 0;
+static int16_t  encAlt = 0;
+static uint8_t  encCourse = 0;
+static uint8_t  encDop = 0;
+
+// Selective acks. Word i covers seq group g = (seq - 1) / 32 with ackTag[i] == g + 1.
+// The producer recycles a word when it first pushes into a new group; ackers
+// (uploader, LoRa) only ever OR bits in, so they need no lock either.
+static std::atomic<uint32_t> ackTag[TRACK_ACK_WORDS];
+static std::atomic<uint32_t> ackBits[TRACK_ACK_WORDS];
+static std::atomic<uint32_t> ackFloor{1};  // every seq below is acked
+
+// Delivery channels. Each position is only advanced by the channel's own task;
+// positions below the ack floor are read as the floor (everything acked).
+static const char* const channelNames[TRACK_CH_COUNT] = { "WiFi", "LoRa" };
+static std::atomic<uint32_t> chanSent[TRACK_CH_COUNT];   // last seq handed to the uplink
+static std::atomic<uint32_t> chanAcked[TRACK_CH_COUNT];  // last seq confirmed on the channel
+
+// Read leases: pins[i] is the first seq lease i reads in place (0 = no pin)
+static std::atomic<bool> leaseUsed[TRACK_MAX_LEASES];
+static std::atomic<uint32_t> pins[TRACK_MAX_LEASES];
+static std::atomic<bool> leaseOverrun[TRACK_MAX_LEASES];
+
+// Decoded archive block per lease, same column layout as the ring
+struct ScratchColumns {
+  uint32_t ts[TRACK_BLOCK_MAX_FIXES];
+  int32_t  latE7[TRACK_BLOCK_MAX_FIXES];
+  int32_t  lonE7[TRACK_BLOCK_MAX_FIXES];
+  uint8_t  bat[TRACK_BLOCK_MAX_FIXES];
+  uint8_t  flags[TRACK_BLOCK_MAX_FIXES];
+  uint8_t  dop[TRACK_BLOCK_MAX_FIXES];
+  uint8_t  course2[TRACK_BLOCK_MAX_FIXES];
+  uint16_t speedCmS[TRACK_BLOCK_MAX_FIXES];
+  int16_t  altDm[TRACK_BLOCK_MAX_FIXES];
+};
+static ScratchColumns leaseScratch[TRACK_MAX_LEASES];
+
+static size_t roundUpPow2(size_t n) {
+  size_t p = 1;
+  while (p < n) p <<= 1;
+  return p;
+}
+
+// Oldest seq still held by the ring given the newest published seq
+static uint32_t oldestSeqFor(uint32_t newest) {
+  return (newest > cap) ? newest - (uint32_t)cap + 1 : 1;
+}
+
+// Copy record 'seq' out of its slot. Fails if the slot was (or is being)
+// overwritten by a newer record.
+static bool readSlot(uint32_t seq, FixRec& out) {
+  size_t i = (seq - 1) & mask;
+  if (stamps[i].load(std::memory_order_acquire) != seq) return false;
+  out.seq = seq;
+  out.ts = colTs[i];
+  out.latE7 = colLat[i];
+  out.lonE7 = colLon[i];
+  out.bat = colBat[i];
+  out.flags = colFlags[i];
+  out.dop = colDop[i];
+  out.course2 = colCourse[i];
+  out.speedCmS = colSpeed[i];
+  out.altDm = colAlt[i];
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return stamps[i].load(std::memory_order_relaxed) == seq;
+}
+
+// Same as readSlot() for the ts column only
+static bool readSlotTs(uint32_t seq, uint32_t& ts) {
+  size_t i = (seq - 1) & mask;
+  if (stamps[i].load(std::memory_order_acquire) != seq) return false;
+  ts = colTs[i];
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return stamps[i].load(std::memory_order_relaxed) == seq;
+}
+
+// ============= BLOCK CODEC =============
+
+static size_t putVarint(uint8_t* p, uint64_t v) {
+  size_t n = 0;
+  while (v >= 0x80) {
+    p[n++] = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  p[n++] = (uint8_t)v;
+  return n;
+}
+
+static uint64_t getVarint(const uint8_t*& p) {
+  uint64_t v = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    uint8_t b = *p++;
+    v |= (uint64_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) break;
+  }
+  return v;
+}
+
+static uint64_t zigzag(int64_t v) {
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static void startBlock(const FixRec& rec) {
+  openBlk.firstSeq = rec.seq;
+  openBlk.firstTs = rec.ts;
+  openBlk.lastTs = rec.ts;
+  openBlk.latE7 = rec.latE7;
+  openBlk.lonE7 = rec.lonE7;
+  openBlk.speedCmS = rec.speedCmS;
+  openBlk.altDm = rec.altDm;
+  openBlk.course2 = rec.course2;
+  openBlk.dop = rec.dop;
+  openBlk.count = 1;
+  openBlk.frontLen = 0;
+  openBlk.backLen = 3;
+  uint8_t* run = openBlk.data + TRACK_BLOCK_BYTES - 3;
+  run[0] = 1;
+  run[1] = rec.bat;
+  run[2] = rec.flags;
+  encTs = rec.ts;
+  encLat = rec.latE7;
+  encLon = rec.lonE7;
+  encSpeed = rec.speedCmS;
+  encAlt = rec.altDm;
+  encCourse = rec.course2;
+  encDop = rec.dop;
+}
+
+// Publish the open block into the next archive slot (producer only)
+static void sealBlock() {
+  if (openBlk.count == 0) return;
+
+  uint32_t b = sealedBlocks.load(std::memory_order_relaxed);
+  BlockSlot& s = blocks[b % TRACK_ARCHIVE_BLOCKS];
+  IndexSlot& x = blockIndex[b % TRACK_ARCHIVE_BLOCKS];
+  s.stamp.store(0, std::memory_order_relaxed);
+  x.stamp.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  s.blk = openBlk;
+  x.e.firstSeq = openBlk.firstSeq;
+  x.e.count = openBlk.count;
+  x.e.minTs = openBlk.firstTs;
+  x.e.maxTs = openBlk.lastTs;
+  s.stamp.store(b + 1, std::memory_order_release);
+  x.stamp.store(b + 1, std::memory_order_release);
+  sealedBlocks.store(b + 1, std::memory_order_release);
+
+  // Counted, not logged: boot replay seals a block every few dozen fixes
+  archivedFixes.store(archivedFixes.load(std::memory_order_relaxed) + openBlk.count, std::memory_order_relaxed);
+  archivedBytes.store(archivedBytes.load(std::memory_order_relaxed) + offsetof(BlockData, data) +
+                      openBlk.frontLen + openBlk.backLen, std::memory_order_relaxed);
+  openBlk.count = 0;
+}
+
+// Append a published record to the open block, sealing it when full (producer only)
+static void archiveAppend(const FixRec& rec) {
+  if (!blocks) return;
+  if (openBlk.count == 0) {
+    startBlock(rec);
+    return;
+  }
+
+  uint8_t delta[40];
+  size_t dn = putVarint(delta, rec.ts - encTs);
+  dn += putVarint(delta + dn, zigzag((int64_t)rec.latE7 - encLat));
+  dn += putVarint(delta + dn, zigzag((int64_t)rec.lonE7 - encLon));
+  dn += putVarint(delta + dn, zigzag((int64_t)rec.speedCmS - encSpeed));
+  dn += putVarint(delta + dn, zigzag((int64_t)rec.course2 - encCourse));
+  dn += putVarint(delta + dn, zigzag((int64_t)rec.altDm - encAlt));
+  dn += putVarint(delta + dn, zigzag((int64_t)rec.dop - encDop));
+
+  uint8_t* run = openBlk.data + TRACK_BLOCK_BYTES - openBlk.backLen;
+  bool sameRun = (run[1] == rec.bat && run[2] == rec.flags && run[0] < 0xFF);
+  size_t need = dn + (sameRun ? 0 : 3);
+
+  if (openBlk.count >= TRACK_BLOCK_MAX_FIXES ||
+      rec.seq != openBlk.firstSeq + openBlk.count ||      // seq hole: blocks are contiguous
+      openBlk.frontLen + openBlk.backLen + need > TRACK_BLOCK_BYTES) {
+    sealBlock();
+    startBlock(rec);
+    return;
+  }
+
+  memcpy(openBlk.data + openBlk.frontLen, delta, dn);
+  openBlk.frontLen += dn;
+  if (sameRun) {
+    run[0]++;
+  } else {
+    openBlk.backLen += 3;
+    run -= 3;
+    run[0] = 1;
+    run[1] = rec.bat;
+    run[2] = rec.flags;
+  }
+  openBlk.count++;
+  openBlk.lastTs = rec.ts;
+  encTs = rec.ts;
+  encLat = rec.latE7;
+  encLon = rec.lonE7;
+  encSpeed = rec.speedCmS;
+  encAlt = rec.altDm;
+  encCourse = rec.course2;
+  encDop = rec.dop;
+}
+
+// Decode records fromSeq .. end of block (at most maxN), handing each to
+// emit(index, record)
+template <typename Emit>
+static size_t decodeBlockWith(const BlockData& blk, uint32_t fromSeq, size_t maxN, Emit emit) {
+  const uint8_t* p = blk.data;
+  const uint8_t* run = blk.data + TRACK_BLOCK_BYTES - 3;
+  uint8_t runLeft = run[0];
+  uint32_t ts = blk.firstTs;
+  int64_t lat = blk.latE7;
+  int64_t lon = blk.lonE7;
+  int64_t speed = blk.speedCmS;
+  int64_t course = blk.course2;
+  int64_t alt = blk.altDm;
+  int64_t dop = blk.dop;
+
+  size_t n = 0;
+  FixRec rec;
+  for (uint16_t i = 0; i < blk.count && n < maxN; i++) {
+    if (i > 0) {
+      ts += (uint32_t)getVarint(p);
+      lat += unzigzag(getVarint(p));
+      lon += unzigzag(getVarint(p));
+      speed += unzigzag(getVarint(p));
+      course += unzigzag(getVarint(p));
+      alt += unzigzag(getVarint(p));
+      dop += unzigzag(getVarint(p));
+      if (runLeft == 0) {
+        run -= 3;
+        runLeft = run[0];
+      }
+    }
+    runLeft--;
+    uint32_t seq = blk.firstSeq + i;
+    if (seq < fromSeq) continue;
+    rec.seq = seq;
+    rec.ts = ts;
+    rec.latE7 = (int32_t)lat;
+    rec.lonE7 = (int32_t)lon;
+    rec.bat = run[1];
+    rec.flags = run[2];
+    rec.dop = (uint8_t)dop;
+    rec.course2 = (uint8_t)course;
+    rec.speedCmS = (uint16_t)speed;
+    rec.altDm = (int16_t)alt;
+    emit(n++, rec);
+  }
+  return n;
+}
+
+// Decode into records (AoS readers)
+static size_t decodeBlock(const BlockData& blk, uint32_t fromSeq, FixRec* out, size_t maxN) {
+  return decodeBlockWith(blk, fromSeq, maxN,
+    [out](size_t k, const FixRec& rec) { out[k] = rec; });
+}
+
+// Decode into columns (lease scratch, archive ts search)
+static size_t decodeBlockColumns(const BlockData& blk, uint32_t fromSeq, ScratchColumns& out, size_t maxN) {
+  return decodeBlockWith(blk, fromSeq, maxN,
+    [&out](size_t k, const FixRec& rec) {
+      out.ts[k] = rec.ts;
+      out.latE7[k] = rec.latE7;
+      out.lonE7[k] = rec.lonE7;
+      out.bat[k] = rec.bat;
+      out.flags[k] = rec.flags;
+      out.dop[k] = rec.dop;
+      out.course2[k] = rec.course2;
+      out.speedCmS[k] = rec.speedCmS;
+      out.altDm[k] = rec.altDm;
+    });
+}
+
+// ============= ARCHIVE LOOKUP =============
+
+// Oldest logical block still held by the archive
+static uint32_t oldestBlockFor(uint32_t sealed) {
+  return (sealed > TRACK_ARCHIVE_BLOCKS) ? sealed - TRACK_ARCHIVE_BLOCKS : 0;
+}
+
+// Copy sealed block #b out of its slot; fails if the slot was recycled
+static bool readBlock(uint32_t b, BlockData& out) {
+  const BlockSlot& s = blocks[b % TRACK_ARCHIVE_BLOCKS];
+  if (s.stamp.load(std::memory_order_acquire) != b + 1) return false;
+  out = s.blk;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return s.stamp.load(std::memory_order_relaxed) == b + 1;
+}
+
+// Copy index entry #b out of its slot; fails if the slot was recycled
+static bool readIndex(uint32_t b, IndexEntry& out) {
+  const IndexSlot& x = blockIndex[b % TRACK_ARCHIVE_BLOCKS];
+  if (x.stamp.load(std::memory_order_acquire) != b + 1) return false;
+  out = x.e;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return x.stamp.load(std::memory_order_relaxed) == b + 1;
+}
+
+// Bisect the sparse index for the first block b in [oldest, sealed) with
+// past(entry) true (past must be monotonic over blocks). Returns false if the
+// producer recycled a probed slot; the caller retries on the new window.
+template <typename Past>
+static bool bisectIndex(uint32_t oldest, uint32_t sealed, Past past, uint32_t& out) {
+  uint32_t lo = oldest;
+  uint32_t hi = sealed;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    IndexEntry e;
+    if (!readIndex(mid, e)) return false;
+    if (past(e)) hi = mid; else lo = mid + 1;
+  }
+  out = lo;
+  return true;
+}
+
+// Find the sealed block holding 'seq', or the first block after it if seq is
+// older than the archive or fell into a hole.
+static bool findBlockBySeq(uint32_t seq, BlockData& out) {
+  if (!blocks) return false;
+  while (true) {
+    uint32_t sealed = sealedBlocks.load(std::memory_order_acquire);
+    uint32_t oldest = oldestBlockFor(sealed);
+    uint32_t after;                 // first block starting after seq
+    if (!bisectIndex(oldest, sealed, [seq](const IndexEntry& e) { return e.firstSeq > seq; }, after)) continue;
+
+    uint32_t b = (after > oldest) ? after - 1 : oldest;
+    if (b >= sealed) return false;
+    IndexEntry e;
+    if (!readIndex(b, e)) continue;
+    if (seq >= e.firstSeq + e.count && ++b >= sealed) return false;
+    if (!readBlock(b, out)) continue;
+    return true;
+  }
+}
+
+// Find the first archived record with ts > afterTs
+static bool findSeqAfterTsInArchive(uint32_t afterTs, uint32_t& seqOut) {
+  if (!blocks) return false;
+  BlockData blk;
+  while (true) {
+    uint32_t sealed = sealedBlocks.load(std::memory_order_acquire);
+    uint32_t b;                     // first block with maxTs > afterTs
+    if (!bisectIndex(oldestBlockFor(sealed), sealed, [afterTs](const IndexEntry& e) { return e.maxTs > afterTs; }, b)) continue;
+    if (b >= sealed) return false;
+    if (!readBlock(b, blk)) continue;
+
+    // blk.lastTs > afterTs, so the block holds the answer
+    ScratchColumns cols;
+    size_t n = decodeBlockColumns(blk, 0, cols, TRACK_BLOCK_MAX_FIXES);
+    size_t k = scanCountTsAtMost(cols.ts, n, afterTs);
+    seqOut = blk.firstSeq + (uint32_t)k;
+    return k < n;
+  }
+}
+
+// Oldest seq held by the archive, 0 if it is empty
+static uint32_t oldestArchivedSeq() {
+  if (!blocks) return 0;
+  while (true) {
+    uint32_t sealed = sealedBlocks.load(std::memory_order_acquire);
+    if (sealed == 0) return 0;
+    IndexEntry e;
+    if (readIndex(oldestBlockFor(sealed), e)) return e.firstSeq;
+  }
+}
+
+// Oldest seq held by the store (archive or hot ring). A hot ring larger than
+// the archive reaches further back than the oldest sealed block.
+static uint32_t oldestStoredSeq(uint32_t newest) {
+  uint32_t archived = oldestArchivedSeq();
+  uint32_t hot = oldestSeqFor(newest);
+  return (archived && archived < hot) ? archived : hot;
+}
+
+// ============= PUBLIC API =============
 
 void initTrackStore(size_t capacity) {
-  cap = capacity;
-  ring.assign(capacity, FixRec{});  // pre-allocate storage
-  head = 0;
-  count = 0;
+  if (capacity < TRACK_BLOCK_MAX_FIXES) capacity = TRACK_BLOCK_MAX_FIXES;  // hot ring must span a block
+  cap = roundUpPow2(capacity);
+  mask = cap - 1;
+  delete[] colTs;
+  delete[] colLat;
+  delete[] colLon;
+  delete[] colBat;
+  delete[] colFlags;
+  delete[] colDop;
+  delete[] colCourse;
+  delete[] colSpeed;
+  delete[] colAlt;
+  delete[] stamps;
+  colTs = new uint32_t[cap]();      // pre-allocate storage
+  colLat = new int32_t[cap]();
+  colLon = new int32_t[cap]();
+  colBat = new uint8_t[cap]();
+  colFlags = new uint8_t[cap]();
+  colDop = new uint8_t[cap]();
+  colCourse = new uint8_t[cap]();
+  colSpeed = new uint16_t[cap]();
+  colAlt = new int16_t[cap]();
+  stamps = new std::atomic<uint32_t>[cap];
+  for (size_t i = 0; i < cap; i++) {
+    stamps[i].store(0, std::memory_order_relaxed);
+  }
+  for (size_t i = 0; i < TRACK_ACK_WORDS; i++) {
+    ackTag[i].store(0, std::memory_order_relaxed);
+    ackBits[i].store(0, std::memory_order_relaxed);
+  }
+  ackFloor.store(1);
+  for (size_t i = 0; i < TRACK_CH_COUNT; i++) {
+    chanSent[i].store(0);
+    chanAcked[i].store(0);
+  }
+  for (size_t i = 0; i < TRACK_MAX_LEASES; i++) {
+    leaseUsed[i].store(false);
+    pins[i].store(0);
+    leaseOverrun[i].store(false);
+  }
+  delete[] blocks;
+  delete[] blockIndex;
+  blocks = new BlockSlot[TRACK_ARCHIVE_BLOCKS];
+  blockIndex = new IndexSlot[TRACK_ARCHIVE_BLOCKS];
+  for (size_t i = 0; i < TRACK_ARCHIVE_BLOCKS; i++) {
+    blocks[i].stamp.store(0, std::memory_order_relaxed);
+    blockIndex[i].stamp.store(0, std::memory_order_relaxed);
+  }
+  openBlk.count = 0;
+  sealedBlocks.store(0, std::memory_order_relaxed);
+  archivedFixes.store(0, std::memory_order_relaxed);
+  archivedBytes.store(0, std::memory_order_relaxed);
   nextSeq = 1;
-  ackedTs = 0;
-  mtx = xSemaphoreCreateMutex();
+  lastTs = 0;
+  ackedTs.store(0, std::memory_order_relaxed);
+  lastSeq.store(0, std::memory_order_release);
+  if (cap != capacity) {
+    Serial.printf("Track store capacity rounded up from %u to %u\n", (unsigned)capacity, (unsigned)cap);
+  }
+}
+
+// Entering a new 32-seq group: recycle its ack word (long since evicted) (producer only)
+static void openAckGroup(uint32_t seq) {
+  uint32_t group = (seq - 1) / 32;
+  size_t w = group % TRACK_ACK_WORDS;
+  if (ackTag[w].load(std::memory_order_relaxed) != group + 1) {
+    ackTag[w].store(0);
+    ackBits[w].store(0);
+    ackTag[w].store(group + 1);
+  }
+}
+
+// Write a record with an assigned seq into its slot and publish it (producer only)
+static void publish(FixRec& rec) {
+  // Keep ts monotonic (clock resyncs can step back a second) so lookups can bisect
+  if (rec.ts < lastTs) rec.ts = lastTs;
+  lastTs = rec.ts;
+
+  // Compress first: once the hot slot below is reused, the evicted record
+  // must already be in a sealed block
+  archiveAppend(rec);
+
+  openAckGroup(rec.seq);
+
+  // Never wait for readers: a lease still pinning the record evicted now was
+  // held across TRACK_LEASE_HEADROOM pushes and is reported as overrun
+  if (rec.seq > cap) {
+    uint32_t evicted = rec.seq - (uint32_t)cap;
+    for (size_t i = 0; i < TRACK_MAX_LEASES; i++) {
+      uint32_t pin = pins[i].load();
+      if (pin != 0 && pin <= evicted) leaseOverrun[i].store(true);
+    }
+  }
+
+  // If full, this overwrites the oldest record. Invalidate the stamp first so
+  // readers racing with the copy below reject what they read.
+  size_t i = (rec.seq - 1) & mask;
+  stamps[i].store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  colTs[i] = rec.ts;
+  colLat[i] = rec.latE7;
+  colLon[i] = rec.lonE7;
+  colBat[i] = rec.bat;
+  colFlags[i] = rec.flags;
+  colDop[i] = rec.dop;
+  colCourse[i] = rec.course2;
+  colSpeed[i] = rec.speedCmS;
+  colAlt[i] = rec.altDm;
+  stamps[i].store(rec.seq, std::memory_order_release);
+  lastSeq.store(rec.seq);           // seq_cst: pairs with the pin check in trackStoreAcquire()
 }
 
 bool trackStorePush(FixRec& recIn) {
-  if (xSemaphoreTake(mtx, portMAX_DELAY) != pdTRUE) {
-    return false; // failed to acquire mutex
+  if (!colTs) {
+    return false; // store not initialized
   }
 
   FixRec& rec = recIn;
   rec.seq = nextSeq++;
+  publish(rec);
+  return true;
+}
 
-  // If full, we overwrite the oldest (which is at head when count==cap).
-  // Oldest seq in buffer is not tracked explicitly here
-  ring[head] = rec;
-  head = (head + 1) % cap;
-  if (count < cap) { 
-    count++; 
+bool trackStoreRestore(const FixRec& recIn) {
+  if (!colTs || recIn.seq == 0 || recIn.seq < nextSeq) {
+    return false; // not initialized, or out of order
+  }
+
+  // A hole left by lost log records can never be delivered: count it as acked
+  // so the ack floor (and every channel resuming from it) moves past it
+  if (nextSeq > 1 && recIn.seq > nextSeq) {
+    uint32_t from = recIn.seq - nextSeq > TRACK_ACK_WORDS * 32 ? recIn.seq - TRACK_ACK_WORDS * 32 : nextSeq;
+    for (uint32_t seq = from; seq < recIn.seq; seq++) {
+      openAckGroup(seq);
+      ackBits[((seq - 1) / 32) % TRACK_ACK_WORDS].fetch_or(1u << ((seq - 1) % 32));
+    }
   }
-  
-  xSemaphoreGive(mtx);
+
+  FixRec rec = recIn;
+  nextSeq = rec.seq + 1;
+  publish(rec);
   return true;
 }
 
-uint32_t trackStoreGetAckedTs() {
-  uint32_t ts = 0;
-  if (xSemaphoreTake(mtx, portMAX_DELAY) != pdTRUE) {
-    return 0; // failed to acquire mutex
+size_t trackStoreRead(TrackCursor& cur, FixRec* outBuf, size_t maxN) {
+  if (!colTs || !outBuf || maxN == 0) return 0;
+
+  size_t n = 0;
+  uint32_t newest = lastSeq.load(std::memory_order_acquire);
+  bool recycled = false;            // nextSeq's slot was rewritten under us: take it from the archive
+  while (n < maxN) {
+    uint32_t oldest = recycled ? cur.nextSeq + 1 : oldestSeqFor(newest);
+    recycled = false;
+    if (cur.nextSeq < oldest) {
+      // Older than the hot ring: decode from the archive
+      BlockData blk;
+      if (findBlockBySeq(cur.nextSeq, blk) && blk.firstSeq < oldest) {
+        if (cur.nextSeq < blk.firstSeq) {
+          if (cur.nextSeq != 0) cur.dropped += blk.firstSeq - cur.nextSeq;
+          cur.nextSeq = blk.firstSeq;
+        }
+        size_t got = decodeBlock(blk, cur.nextSeq, outBuf + n, maxN - n);
+        n += got;
+        cur.nextSeq += got;
+        newest = lastSeq.load(std::memory_order_acquire);
+        continue;
+      }
+      // Reader fell behind archive and ring: skip what has been overwritten
+      if (cur.nextSeq != 0) cur.dropped += oldest - cur.nextSeq;
+      cur.nextSeq = oldest;
+    }
+    if (cur.nextSeq > newest) break;
+    if (readSlot(cur.nextSeq, outBuf[n])) {
+      n++;
+      cur.nextSeq++;
+      continue;
+    }
+    // Overwritten while copying, or the producer is rewriting the slot for the
+    // next push: the record is still in the archive
+    newest = lastSeq.load(std::memory_order_acquire);
+    if (cur.nextSeq < oldestSeqFor(newest + 1)) {
+      recycled = true;
+      continue;
+    }
+    // A hole left by a lost log record
+    cur.dropped++;
+    cur.nextSeq++;
   }
-  ts = ackedTs;
-  xSemaphoreGive(mtx);
-  return ts;
+  return n;
 }
 
-bool trackStoreSetAckedTs(uint32_t ts) {
-  if (xSemaphoreTake(mtx, portMAX_DELAY) != pdTRUE) {
-    return false; // failed to acquire mutex
+uint32_t trackStoreSeqAfterTs(uint32_t afterTs) {
+  uint32_t newest = colTs ? lastSeq.load(std::memory_order_acquire) : 0;
+  uint32_t lo = oldestSeqFor(newest);
+  uint32_t hi = newest + 1;         // answer is in [lo, hi]; ts is non-decreasing in seq
+  const uint32_t hotOldest = lo;
+
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    uint32_t ts = 0;
+    uint32_t probe = mid;
+    while (probe < hi && !readSlotTs(probe, ts)) {
+      // Overwritten meanwhile (everything up to the new oldest is gone) or a
+      // hole: decide on the next readable record instead
+      uint32_t oldest = oldestSeqFor(lastSeq.load(std::memory_order_acquire));
+      probe = (oldest > probe + 1) ? oldest : probe + 1;
+    }
+    if (probe >= hi) {
+      hi = mid;                     // nothing readable in [mid, hi)
+      continue;
+    }
+    if (ts > afterTs) {
+      hi = mid;
+    } else {
+      lo = probe + 1;
+    }
+  }
+
+  // Everything in the hot ring is newer: the start may lie in the archive
+  uint32_t archived;
+  if (lo == hotOldest && findSeqAfterTsInArchive(afterTs, archived) && archived < lo) {
+    return archived;
+  }
+  return lo;
+}
+
+TrackCursor trackStoreCursorAfterTs(uint32_t afterTs) {
+  TrackCursor cur;
+  cur.nextSeq = trackStoreSeqAfterTs(afterTs);
+  return cur;
+}
+
+TrackCursor trackStoreCursorAtSeq(uint32_t seq) {
+  TrackCursor cur;
+  cur.nextSeq = seq;
+  return cur;
+}
+
+size_t trackStoreAvailable(const TrackCursor& cur) {
+  uint32_t newest = lastSeq.load(std::memory_order_acquire);
+  uint32_t from = oldestStoredSeq(newest);
+  if (cur.nextSeq > from) from = cur.nextSeq;
+  return (from <= newest) ? newest - from + 1 : 0;
+}
+
+// Span over hot ring slots first .. first + n - 1 (no wrap)
+static TrackSpan hotSpan(size_t first, size_t n) {
+  TrackSpan s;
+  s.ts = colTs + first;
+  s.latE7 = colLat + first;
+  s.lonE7 = colLon + first;
+  s.bat = colBat + first;
+  s.flags = colFlags + first;
+  s.dop = colDop + first;
+  s.course2 = colCourse + first;
+  s.speedCmS = colSpeed + first;
+  s.altDm = colAlt + first;
+  s.n = n;
+  return s;
+}
+
+// Span over the first n decoded records of a lease scratch
+static TrackSpan scratchSpan(const ScratchColumns& sc, size_t n) {
+  TrackSpan s;
+  s.ts = sc.ts;
+  s.latE7 = sc.latE7;
+  s.lonE7 = sc.lonE7;
+  s.bat = sc.bat;
+  s.flags = sc.flags;
+  s.dop = sc.dop;
+  s.course2 = sc.course2;
+  s.speedCmS = sc.speedCmS;
+  s.altDm = sc.altDm;
+  s.n = n;
+  return s;
+}
+
+bool trackStoreAcquire(uint32_t fromSeq, size_t maxN, TrackLease& lease) {
+  lease = TrackLease{};
+  if (!colTs || maxN == 0) return false;
+
+  size_t slot = 0;
+  while (slot < TRACK_MAX_LEASES && leaseUsed[slot].exchange(true)) slot++;
+  if (slot == TRACK_MAX_LEASES) return false; // all leases taken
+  lease.slot = (uint8_t)slot;
+
+  // Pin first, then check the producer has not reached the pinned record yet.
+  // Leases keep TRACK_LEASE_HEADROOM records clear of the ring's oldest slot.
+  uint32_t start = fromSeq ? fromSeq : 1;
+  pins[slot].store(start);
+  uint32_t newest = lastSeq.load();
+  uint32_t minSeq = (newest + TRACK_LEASE_HEADROOM >= cap) ? newest + TRACK_LEASE_HEADROOM - (uint32_t)cap + 1 : 1;
+
+  if (start < minSeq) {
+    // Too old to read in place: decode the archive block into the lease scratch
+    pins[slot].store(0);
+    BlockData blk;
+    if (findBlockBySeq(start, blk) && blk.firstSeq < minSeq) {
+      if (start < blk.firstSeq) start = blk.firstSeq;
+      ScratchColumns& sc = leaseScratch[slot];
+      size_t n = decodeBlockColumns(blk, start, sc, maxN);
+      lease.span[0] = scratchSpan(sc, n);
+      lease.count = n;
+      lease.firstSeq = start;
+      return n > 0;
+    }
+    start = minSeq;
+    pins[slot].store(start);
+  }
+
+  // Skip holes at the start, then take the contiguous run of valid slots
+  while (start <= newest && stamps[(start - 1) & mask].load(std::memory_order_acquire) != start) {
+    start++;
+    pins[slot].store(start);
   }
-  if (ts > ackedTs) {
-    ackedTs = ts;
+  size_t n = 0;
+  while (n < maxN && start + n <= newest &&
+         stamps[(start + n - 1) & mask].load(std::memory_order_acquire) == start + n) {
+    n++;
   }
-  xSemaphoreGive(mtx);
+  if (n == 0) return false;
+
+  size_t first = (start - 1) & mask;
+  size_t n0 = (first + n <= cap) ? n : cap - first;
+  lease.span[0] = hotSpan(first, n0);
+  lease.span[1] = hotSpan(0, n - n0);
+  lease.count = n;
+  lease.firstSeq = start;
   return true;
 }
 
-uint32_t trackStoreGetOldestTs() {
-  uint32_t ts = 0;
-  if (xSemaphoreTake(mtx, portMAX_DELAY) != pdTRUE) {
-    return 0; // failed to acquire mutex
+bool trackStoreRelease(TrackLease& lease) {
+  if (lease.slot >= TRACK_MAX_LEASES) return false;
+
+  size_t slot = lease.slot;
+  bool intact = !leaseOverrun[slot].exchange(false);
+  pins[slot].store(0);
+  leaseUsed[slot].store(false);
+  lease = TrackLease{};
+  return intact;
+}
+
+uint32_t trackStoreGetAckedTs() {
+  return ackedTs.load(std::memory_order_acquire);
+}
+
+bool trackStoreSetAckedTs(uint32_t ts) {
+  uint32_t cur = ackedTs.load(std::memory_order_relaxed);
+  while (ts > cur && !ackedTs.compare_exchange_weak(cur, ts, std::memory_order_release, std::memory_order_relaxed)) {
+    // cur reloaded by compare_exchange_weak; only ever move forward
   }
-  if (count == 0) {
-    ts = 0;
-  } else {
-    // Calculate oldest index: head points to next write, so oldest is count positions back
-    size_t oldestIdx = (head + cap - count) % cap;
-    ts = ring[oldestIdx].ts;
+  trackStoreSetAckFloor(trackStoreSeqAfterTs(ts));
+  return true;
+}
+
+static bool ackBitSet(uint32_t seq) {
+  uint32_t group = (seq - 1) / 32;
+  size_t w = group % TRACK_ACK_WORDS;
+  return ackTag[w].load() == group + 1 && (ackBits[w].load() & (1u << ((seq - 1) % 32)));
+}
+
+// Move the floor over the contiguous run of acked seqs (and evicted ones)
+static void advanceAckFloor() {
+  uint32_t newest = lastSeq.load();
+  uint32_t oldest = oldestStoredSeq(newest);
+  uint32_t f = ackFloor.load();
+  while (f <= newest) {
+    uint32_t next = (f < oldest) ? oldest : f + 1;
+    if (f >= oldest && !ackBitSet(f)) break;
+    if (ackFloor.compare_exchange_weak(f, next)) f = next;
   }
-  xSemaphoreGive(mtx);
-  return ts;
 }
 
-bool trackStoreGetLatest(FixRec& out) {
-  if (xSemaphoreTake(mtx, portMAX_DELAY) != pdTRUE) {
-    return false; // failed to acquire mutex
+void trackStoreAckRange(uint32_t fromSeq, uint32_t toSeq) {
+  uint32_t newest = lastSeq.load();
+  if (fromSeq == 0) fromSeq = 1;
+  if (toSeq > newest) toSeq = newest;   // never ack what has not been stored yet
+  uint32_t floor = ackFloor.load();
+  if (fromSeq < floor) fromSeq = floor;
+
+  for (uint32_t seq = fromSeq; seq <= toSeq; ) {
+    uint32_t group = (seq - 1) / 32;
+    size_t w = group % TRACK_ACK_WORDS;
+    uint32_t bit = (seq - 1) % 32;
+    uint32_t n = 32 - bit;
+    if (n > toSeq - seq + 1) n = toSeq - seq + 1;
+    uint32_t bits = (n == 32) ? 0xFFFFFFFFu : ((1u << n) - 1) << bit;
+    // A word whose tag moved on belongs to a recycled group: the record is gone
+    if (ackTag[w].load() == group + 1) ackBits[w].fetch_or(bits);
+    seq += n;
   }
+  advanceAckFloor();
+}
+
+bool trackStoreIsAcked(uint32_t seq) {
+  return seq < ackFloor.load() || ackBitSet(seq);
+}
 
-  bool found = false;
-  if (count > 0) {
-    // Latest record is at (head - 1 + cap) % cap
-    size_t latestIdx = (head + cap - 1) % cap;
-    out = ring[latestIdx];
-    found = true;
+uint32_t trackStoreGetAckFloor() {
+  return ackFloor.load();
+}
+
+void trackStoreSetAckFloor(uint32_t seq) {
+  uint32_t f = ackFloor.load();
+  while (seq > f && !ackFloor.compare_exchange_weak(f, seq)) {
+    // f reloaded; only ever move forward
   }
+  advanceAckFloor();
+}
 
-  xSemaphoreGive(mtx);
-  return found;
+// ============= DELIVERY CHANNELS =============
+
+static void storeMax(std::atomic<uint32_t>& a, uint32_t v) {
+  uint32_t cur = a.load();
+  while (v > cur && !a.compare_exchange_weak(cur, v)) {
+    // cur reloaded; only ever move forward
+  }
 }
 
-// Returns records with ts > afterTs (typically afterTs == ackedTs)
-// Copies up to maxN in increasing seq order.
-size_t trackStoreGetBatch(FixRec* outBuf, size_t maxN, uint32_t afterTs) {
-  if (!outBuf || maxN == 0) return 0;
-  if (xSemaphoreTake(mtx, portMAX_DELAY) != pdTRUE) {
-    return 0; // failed to acquire mutex
+// Records stored after position pos (pos = last seq already handled)
+static size_t countAfter(uint32_t pos) {
+  uint32_t newest = lastSeq.load();
+  uint32_t floor = ackFloor.load();
+  if (pos + 1 < floor) pos = floor - 1;
+  uint32_t oldest = oldestStoredSeq(newest);
+  if (pos + 1 < oldest) pos = oldest - 1;
+  return (newest > pos) ? newest - pos : 0;
+}
+
+const char* trackStoreChannelName(TrackChannel ch) {
+  return (ch < TRACK_CH_COUNT) ? channelNames[ch] : "?";
+}
+
+uint32_t trackStoreChannelNextSeq(TrackChannel ch) {
+  if (ch >= TRACK_CH_COUNT) return 0;
+  uint32_t next = chanSent[ch].load() + 1;
+  uint32_t floor = ackFloor.load();
+  return (next > floor) ? next : floor;
+}
+
+bool trackStoreChannelAcquire(TrackChannel ch, size_t maxN, TrackLease& lease) {
+  if (ch >= TRACK_CH_COUNT) return false;
+  return trackStoreAcquire(trackStoreChannelNextSeq(ch), maxN, lease);
+}
+
+void trackStoreChannelSent(TrackChannel ch, uint32_t seq) {
+  if (ch >= TRACK_CH_COUNT) return;
+  storeMax(chanSent[ch], seq);
+}
+
+void trackStoreChannelAcked(TrackChannel ch, uint32_t seq) {
+  if (ch >= TRACK_CH_COUNT) return;
+  storeMax(chanAcked[ch], seq);
+  storeMax(chanSent[ch], seq);
+}
+
+void trackStoreChannelRewind(TrackChannel ch) {
+  if (ch >= TRACK_CH_COUNT) return;
+  uint32_t floor = ackFloor.load();
+  uint32_t back = floor > 0 ? floor - 1 : 0;
+  uint32_t acked = chanAcked[ch].load();
+  chanSent[ch].store(acked > back ? acked : back);
+}
+
+size_t trackStoreChannelBacklog(TrackChannel ch) {
+  if (ch >= TRACK_CH_COUNT || !colTs) return 0;
+  return countAfter(chanSent[ch].load());
+}
+
+size_t trackStoreChannelLag(TrackChannel ch) {
+  if (ch >= TRACK_CH_COUNT || !colTs) return 0;
+  return countAfter(chanAcked[ch].load());
+}
+
+size_t trackStoreRange(uint32_t fromTs, uint32_t toTs, TrackRangeCallback cb, void* ctx) {
+  if (!colTs || !cb || fromTs > toTs) return 0;
+
+  TrackCursor cur = (fromTs > 0) ? trackStoreCursorAfterTs(fromTs - 1) : TrackCursor{};
+  size_t streamed = 0;
+  FixRec buf[16];
+  while (true) {
+    size_t n = trackStoreRead(cur, buf, 16);
+    if (n == 0) return streamed;
+    for (size_t i = 0; i < n; i++) {
+      if (buf[i].ts > toTs) return streamed;
+      streamed++;
+      if (!cb(buf[i], ctx)) return streamed;
+    }
   }
+}
 
-  size_t n = 0;
-  
-  if (count == 0) {
-    n = 0;
-  } else {
-    size_t oldestIdx = (head + cap - count) % cap;
-    size_t idx = oldestIdx;
-    for (size_t i = 0; i < count && n < maxN; i++) {
-      if (ring[idx].ts > afterTs) {
-        outBuf[n++] = ring[idx];
+// ============= COLUMN SCANS =============
+
+// Walk the hot ring from fromSeq to the newest record in runs that are
+// contiguous in the columns (at most one block long), calling
+// fn(firstSeq, slot, n) for each run; fn returns false to stop.
+template <typename Fn>
+static void forEachHotRun(uint32_t fromSeq, Fn fn) {
+  uint32_t newest = lastSeq.load();
+  uint32_t seq = oldestSeqFor(newest);
+  if (fromSeq > seq) seq = fromSeq;
+  while (seq <= newest) {
+    size_t slot = (seq - 1) & mask;
+    size_t n = newest - seq + 1;
+    if (n > cap - slot) n = cap - slot;
+    if (n > TRACK_BLOCK_MAX_FIXES) n = TRACK_BLOCK_MAX_FIXES;
+    if (!fn(seq, slot, n)) return;
+    seq += (uint32_t)n;
+  }
+}
+
+// After a column scan: did slot still hold 'seq'? (rejects overwritten slots and holes)
+static bool slotStillHolds(size_t slot, uint32_t seq) {
+  return stamps[slot].load(std::memory_order_relaxed) == seq;
+}
+
+size_t trackStoreFindFlags(uint32_t fromSeq, uint8_t flagMask, uint32_t* outSeq, size_t maxN) {
+  if (!colTs || !outSeq || maxN == 0) return 0;
+
+  size_t found = 0;
+  forEachHotRun(fromSeq, [&](uint32_t seq, size_t slot, size_t n) {
+    uint8_t hit[TRACK_BLOCK_MAX_FIXES];
+    if (scanFlagsAny(colFlags + slot, n, flagMask, hit) == 0) return true;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    for (size_t k = 0; k < n && found < maxN; k++) {
+      if (hit[k] && slotStillHolds(slot + k, seq + (uint32_t)k)) outSeq[found++] = seq + (uint32_t)k;
+    }
+    return found < maxN;
+  });
+  return found;
+}
+
+bool trackStoreBounds(uint32_t fromSeq, TrackBox& box) {
+  box = trackBoxEmpty();
+  if (!colTs) return false;
+
+  size_t used = 0;
+  forEachHotRun(fromSeq, [&](uint32_t seq, size_t slot, size_t n) {
+    TrackBox run = trackBoxEmpty();
+    scanBounds(colLat + slot, colLon + slot, n, run);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    bool intact = true;
+    for (size_t k = 0; k < n; k++) {
+      intact = intact && slotStillHolds(slot + k, seq + (uint32_t)k);
+    }
+    if (intact) {
+      scanBounds(&run.minLatE7, &run.minLonE7, 1, box);
+      scanBounds(&run.maxLatE7, &run.maxLonE7, 1, box);
+      used += n;
+      return true;
+    }
+    // Overwritten meanwhile or holes in the run: fall back to checked reads
+    for (size_t k = 0; k < n; k++) {
+      FixRec rec;
+      if (readSlot(seq + (uint32_t)k, rec)) {
+        scanBounds(&rec.latE7, &rec.lonE7, 1, box);
+        used++;
       }
-      idx = (idx + 1) % cap;
     }
+    return true;
+  });
+  return used > 0;
+}
+
+uint32_t trackStoreGetOldestTs() {
+  if (!colTs) return 0;
+  FixRec rec;
+  TrackCursor cur;
+  return trackStoreRead(cur, &rec, 1) ? rec.ts : 0;
+}
+
+bool trackStoreGetLatest(FixRec& out) {
+  if (!colTs) return false;
+
+  uint32_t newest = lastSeq.load(std::memory_order_acquire);
+  while (newest != 0) {
+    // Latest record is at seq 'newest'; if the producer lapped us, reload
+    if (readSlot(newest, out)) return true;
+    newest = lastSeq.load(std::memory_order_acquire);
   }
+  return false;
+}
 
-  xSemaphoreGive(mtx);
-  return n;
+// Returns records with ts > afterTs (typically afterTs == ackedTs)
+// Copies up to maxN in increasing seq order. The start is found by binary
+// search, so a mostly-acked ring is not walked record by record; archived
+// blocks are only decoded when the batch reaches back into them.
+size_t trackStoreGetBatch(FixRec* outBuf, size_t maxN, uint32_t afterTs) {
+  if (!outBuf || maxN == 0) return 0;
+
+  TrackCursor cur = trackStoreCursorAfterTs(afterTs);
+  return trackStoreRead(cur, outBuf, maxN);
+}
+
+void trackStoreGetStats(TrackStoreStats& out) {
+  out.sealedBlocks = sealedBlocks.load(std::memory_order_acquire);
+  out.archivedFixes = archivedFixes.load(std::memory_order_relaxed);
+  out.archivedBytes = archivedBytes.load(std::memory_order_relaxed);
+  out.ramBytes = (uint32_t)(cap * (sizeof(uint32_t) * 3 + sizeof(uint8_t) * 4 + sizeof(uint16_t) * 2 + sizeof(stamps[0])) +
+                            TRACK_ARCHIVE_BLOCKS * (sizeof(BlockSlot) + sizeof(IndexSlot)) + sizeof(openBlk) +
+                            sizeof(leaseScratch) + sizeof(ackTag) + sizeof(ackBits));
 }
 
 size_t trackStoreSize() {
-  size_t c = 0;
-  if (xSemaphoreTake(mtx, portMAX_DELAY) != pdTRUE) {
-    return 0; // failed to acquire mutex
-  }
-  c = count;
-  xSemaphoreGive(mtx);
-  return c;
-}
\ No newline at end of file
+  uint32_t newest = lastSeq.load(std::memory_order_acquire);
+  if (newest == 0) return 0;
+  return newest - oldestStoredSeq(newest) + 1;
+}
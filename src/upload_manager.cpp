@@ -4,29 +4,57 @@
 #include <WiFiClientSecure.h>
 #include "wifi_manager.h"
 #include "battery.h"
+#include "track_simplify.h"
+#include "geofence.h"
 
 // ============= TX STATS TRACKING =============
 static uint32_t lastWiFiTxMs = 0;
 static uint32_t wiFiTxCount = 0;
+static uint32_t resendSkipped = 0;  // already-acked records left out of uploads
 static volatile bool wiFiTxActive = false;
 
-String buildJSONBatch(FixRec* recs, size_t n) {
+static SimplifyState wifiShape;     // simplified track uploaded over WiFi
+static TaskHandle_t uploadTaskToKick = NULL;
+
+String buildJSONBatch(const TrackLease& lease, size_t limit, const uint8_t* keep, size_t& count) {
   JsonDocument doc;
   JsonArray arr = doc.to<JsonArray>();
 
   char ssidBuf[33] = "";
   getConnectedSsidCopy(ssidBuf, sizeof(ssidBuf));
 
-  for (size_t i = 0; i < n; i++) {
+  count = 0;
+  if (limit > lease.count) limit = lease.count;
+  for (size_t i = 0; i < limit; i++) {
+    FixRec rec = lease.at(i);
+    if (keep && !keep[i]) continue;            // simplified away
+    if (trackStoreIsAcked(rec.seq)) continue;  // server has it already
+    count++;
     JsonObject o = arr.add<JsonObject>();
-    o["seq"]   = recs[i].seq;
-    o["ts"]    = recs[i].ts;
-    o["latE7"] = recs[i].latE7;
-    o["lonE7"] = recs[i].lonE7;
+    o["seq"]   = rec.seq;
+    o["ts"]    = rec.ts;
+    o["latE7"] = rec.latE7;
+    o["lonE7"] = rec.lonE7;
     o["net"]   = ssidBuf;
     o["ch"]    = "wifi";
-    o["bat"]   = recs[i].bat;       // Battery from stored record
-    o["flags"] = recs[i].flags;     // Flags from stored record
+    o["bat"]   = rec.bat;           // Battery from stored record
+    o["flags"] = rec.flags;         // Flags from stored record
+    // Quality and motion, left out while unknown
+    if (rec.dop) o["sats"] = fixSats(rec.dop);
+    if (fixHdopX10(rec.dop)) o["hdopX10"] = fixHdopX10(rec.dop);
+    o["speedCmS"] = rec.speedCmS;
+    if (rec.course2 != FIX_COURSE_UNKNOWN) o["courseDeg"] = rec.course2 * 2;
+    if (rec.altDm != FIX_ALT_UNKNOWN) o["altDm"] = rec.altDm;
+    if (rec.flags & FL_EVT_FENCE) {
+      GeofenceEvent ev[8];
+      size_t nEv = geofenceEventsAt(rec.seq, ev, 8);   // empty once the event log has moved on
+      JsonArray fences = o["fences"].to<JsonArray>();
+      for (size_t k = 0; k < nEv; k++) {
+        JsonObject f = fences.add<JsonObject>();
+        f["id"] = ev[k].id;
+        f["ev"] = ev[k].enter ? "enter" : "exit";
+      }
+    }
   }
 
   String out;
@@ -34,7 +62,7 @@ String buildJSONBatch(FixRec* recs, size_t n) {
   return out;
 }
 
-bool parseACKResponse(const String& response, uint32_t& ackedTs) {
+bool parseACKResponse(const String& response, AckSet& acks) {
   JsonDocument doc;
   DeserializationError error = deserializeJson(doc, response);
 
@@ -44,26 +72,106 @@ bool parseACKResponse(const String& response, uint32_t& ackedTs) {
     return false;
   }
 
+  acks.nRanges = 0;
+  for (JsonArrayConst r : doc["acks"].as<JsonArrayConst>()) {
+    if (acks.nRanges >= MAX_ACK_RANGES) break;  // rest is acked on a later round
+    if (!r[0].is<uint32_t>() || !r[1].is<uint32_t>()) continue;
+    acks.ranges[acks.nRanges][0] = r[0].as<uint32_t>();
+    acks.ranges[acks.nRanges][1] = r[1].as<uint32_t>();
+    acks.nRanges++;
+  }
+
   if (!doc["ackedTs"].is<uint32_t>()) {
+    if (acks.nRanges > 0) return true;
     Serial.println("parseACKResponse: 'ackedTs' key not found or invalid type");
     return false;
   }
 
-  ackedTs = doc["ackedTs"].as<uint32_t>();
-  Serial.printf("parseACKResponse: Successfully parsed ackedTs = %u\n", ackedTs);
+  acks.ackedTs = doc["ackedTs"].as<uint32_t>();
+  Serial.printf("parseACKResponse: Successfully parsed ackedTs = %u, %u ack ranges\n",
+                acks.ackedTs, (unsigned)acks.nRanges);
   return true;
 }
 
-void uploadBatchOverWiFi(FixRec batch[MAX_UPLOAD_BATCH_SIZE]) {
+// Fixes the simplifier dropped from the WiFi track, slot seq % DROPPED_SLOTS.
+// They are never uploaded and never acked in the store (the ack bits are for
+// records a server confirmed); only the WiFi channel moves past them. A round
+// that goes back after a failed delivery re-offers at most one batch past the
+// channel's confirmed seq, which these slots still cover.
+#define DROPPED_SLOTS (2 * MAX_UPLOAD_BATCH_SIZE)
+static uint32_t droppedSeqs[DROPPED_SLOTS];
+
+static bool wasDropped(uint32_t seq) {
+  return droppedSeqs[seq % DROPPED_SLOTS] == seq;
+}
+
+// Remember this run's drops and drop again what an earlier run dropped (the
+// simplifier keeps every re-offered fix). Returns the number of dropped fixes.
+static size_t markDropped(const TrackLease& lease, uint8_t* keep, size_t decided) {
+  size_t dropped = 0;
+  for (size_t i = 0; i < decided; i++) {
+    uint32_t seq = lease.firstSeq + (uint32_t)i;
+    if (!keep[i]) droppedSeqs[seq % DROPPED_SLOTS] = seq;
+    else if (wasDropped(seq)) keep[i] = 0;
+    dropped += !keep[i];
+  }
+  return dropped;
+}
+
+// Every record in [firstSeq, lastSeq] has been acked or simplified away
+static bool allDelivered(uint32_t firstSeq, uint32_t lastSeq) {
+  for (uint32_t seq = firstSeq; seq <= lastSeq; seq++) {
+    if (!trackStoreIsAcked(seq) && !wasDropped(seq)) return false;
+  }
+  return true;
+}
+
+void uploadBatchOverWiFi() {
   if (!wifiConnected) return;
   if (!uploadBegin()) return;
 
   uint32_t ackedTs = trackStoreGetAckedTs();
-  size_t n = trackStoreGetBatch(batch, MAX_UPLOAD_BATCH_SIZE, ackedTs);
-  if (n == 0) { uploadEnd(); return; }
+  TrackLease lease;
+  if (!trackStoreChannelAcquire(TRACK_CH_WIFI, MAX_UPLOAD_BATCH_SIZE, lease)) {
+    trackStoreRelease(lease);
+    uploadEnd();
+    return;
+  }
 
-  String jsonPayload = buildJSONBatch(batch, n);
-  Serial.printf("Uploading %u GPS fixes (payload bytes=%u)\n", (unsigned)n, (unsigned)jsonPayload.length());
+  // Simplify: fixes the simplifier drops are skipped, fixes in the
+  // still-open window stay in the store until a later round decides them
+  uint8_t keep[MAX_UPLOAD_BATCH_SIZE];
+  size_t decided = simplifyRun(wifiShape, lease, keep);
+  size_t dropped = markDropped(lease, keep, decided);
+  if (decided == 0) {
+    trackStoreRelease(lease);
+    uploadEnd();
+    return;
+  }
+
+  // Serialize straight from the ring, then let go of it before the slow POST
+  size_t n = 0;
+  String jsonPayload = buildJSONBatch(lease, decided, keep, n);
+  size_t skipped = decided - dropped - n;
+  uint32_t firstSeq = lease.firstSeq;
+  uint32_t lastSeq = lease.firstSeq + (uint32_t)decided - 1;
+  if (!trackStoreRelease(lease)) {
+    Serial.println("Upload batch overwritten while serializing, retrying next round");
+    uploadEnd();
+    return;
+  }
+  if (n == 0) {
+    trackStoreChannelAcked(TRACK_CH_WIFI, lastSeq);  // everything in it was acked elsewhere or dropped
+    uploadEnd();
+    return;
+  }
+  trackStoreChannelSent(TRACK_CH_WIFI, lastSeq);
+  resendSkipped += skipped;
+  Serial.printf("Uploading %u GPS fixes (payload bytes=%u, %u already acked skipped, %lu total)\n",
+                (unsigned)n, (unsigned)jsonPayload.length(), (unsigned)skipped, (unsigned long)resendSkipped);
+  Serial.printf("[SIMPLIFY] %u dropped; kept %lu of %lu fixes since boot (%.0f%%), max deviation %.1f m\n",
+                (unsigned)dropped, (unsigned long)wifiShape.kept, (unsigned long)wifiShape.seen,
+                wifiShape.seen ? 100.0f * wifiShape.kept / wifiShape.seen : 100.0f, wifiShape.maxDeviationM);
 
   HTTPClient http;
   http.setTimeout(10000);
@@ -74,6 +182,7 @@ void uploadBatchOverWiFi(FixRec batch[MAX_UPLOAD_BATCH_SIZE]) {
 
   if (!http.begin(client, UPLOAD_URL)) {
     Serial.println("http.begin failed");
+    trackStoreChannelRewind(TRACK_CH_WIFI);
     uploadEnd();
     return;
   }
@@ -94,25 +203,56 @@ void uploadBatchOverWiFi(FixRec batch[MAX_UPLOAD_BATCH_SIZE]) {
   Serial.printf("Upload response code: %d, body: %s\n", code, response.c_str());
 
   if (code == 200) {
-    uint32_t newAckedTs = ackedTs;
-    if (parseACKResponse(response, newAckedTs) && newAckedTs > ackedTs) {
-      trackStoreSetAckedTs(newAckedTs);
-      Serial.printf("Updated ackedTs to %u\n", newAckedTs);
-      
+    AckSet acks;
+    acks.ackedTs = ackedTs;
+    if (parseACKResponse(response, acks)) {
+      if (acks.nRanges > 0) {
+        // Per-record acks: a record the server failed to write stays unacked
+        // even if later ones in the batch made it
+        for (size_t i = 0; i < acks.nRanges; i++) {
+          trackStoreAckRange(acks.ranges[i][0], acks.ranges[i][1]);
+        }
+        Serial.printf("Applied %u ack ranges, ack floor now %u\n",
+                      (unsigned)acks.nRanges, trackStoreGetAckFloor());
+      } else if (acks.ackedTs > ackedTs) {
+        trackStoreSetAckedTs(acks.ackedTs);
+        Serial.printf("Updated ackedTs to %u\n", acks.ackedTs);
+      }
+
+      // Advance the channel only over a fully acked batch; otherwise go back
+      // to its last confirmed seq and offer the rest again next round
+      if (trackStoreGetAckFloor() > lastSeq || allDelivered(firstSeq, lastSeq)) {
+        trackStoreChannelAcked(TRACK_CH_WIFI, lastSeq);
+      } else {
+        trackStoreChannelRewind(TRACK_CH_WIFI);
+      }
+
       // Track successful upload
       lastWiFiTxMs = millis();
       wiFiTxCount += n;
+    } else {
+      trackStoreChannelRewind(TRACK_CH_WIFI);
     }
   } else if (code > 0) {
     Serial.printf("Upload failed with HTTP code %d\n", code);
+    trackStoreChannelRewind(TRACK_CH_WIFI);
   } else {
     Serial.printf("HTTP POST failed, error: %s\n", http.errorToString(code).c_str());
+    trackStoreChannelRewind(TRACK_CH_WIFI);
   }
 
   http.end();
   uploadEnd();
 }
 
+void uploadSetTask(TaskHandle_t task) {
+  uploadTaskToKick = task;
+}
+
+void uploadKick() {
+  if (uploadTaskToKick) xTaskNotifyGive(uploadTaskToKick);
+}
+
 // ============= TX STATS GETTERS =============
 
 uint32_t getLastWiFiTxMs() {